@@ -35,23 +35,44 @@
  *                     set 'linux' when compiling on Linux - MT
  * 22 Apr 22         - Moved  compiler feature macro definitions to generic
  *                     busy loop - MT
+ * 18 Oct 26         - Added l_clock() and i_wait_until() to allow callers
+ *                     to wait until an absolute time using the  monotonic
+ *                     clock where it is available - MT
+ *                   - Added i_wait_input() to wait for input on a file, or
+ *                     until an absolute time, whichever is first - MT
+ *                   - Added i_wait_inputs() to wait for input on more than
+ *                     one file, and made the timer local to each thread so
+ *                     different threads can wait at the same time - MT
+ *                   - Uses poll() to wait for input on any POSIX system,
+ *                     not just Linux and NetBSD - MT
  *
  */
 
 #define NAME           "gcc-wait"
-#define BUILD          "0005"
-#define DATE           "07 Feb 24"
+#define BUILD          "0006"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #if defined(linux) || defined(__linux__) || defined(__NetBSD__)
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
 #include <sys/types.h>
+#if defined(linux) || defined(__linux__)
+#include <stdint.h>
+#include <sys/timerfd.h>
+#endif
 #elif defined(VMS)
 #include <timeb.h>
 #include <lib$routines.h>
 #else
 #include <sys/types.h>
 #include <sys/timeb.h>
+#if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <poll.h>
+#endif
 #endif
 
 /*
@@ -85,3 +106,148 @@ while ((1000 * (o_end.time - o_start.time) + o_end.millitm - o_start.millitm) <
 return(0);
 #endif
 }
+
+/*
+ * clock
+ *
+ * Returns the current time in nanoseconds.  Only the difference between two
+ * values is meaningful, the starting point is undefined.  Uses the monotonic
+ * clock if available so the result is not affected by changes to the system
+ * time.
+ *
+ * 18 Oct 26         - Initial version - MT
+ *
+ */
+long long l_clock(void)
+{
+#if defined(linux) || defined(__linux__) || defined(__NetBSD__)
+struct timespec o_now;
+clock_gettime(CLOCK_MONOTONIC, &o_now);
+return (o_now.tv_sec * 1000000000LL + o_now.tv_nsec);
+#else
+struct timeb o_now;
+ftime(&o_now);
+return (o_now.time * 1000000000LL + o_now.millitm * 1000000LL);
+#endif
+}
+
+/*
+ * wait until (nanoseconds)
+ *
+ * Waits until the clock returned by l_clock() reaches the specified  time,
+ * returns immediately if it has already passed.  Using an absolute time
+ * means that any time spent by the caller since the last wait is  taken
+ * into account and errors do not accumulate.
+ *
+ * 18 Oct 26         - Initial version - MT
+ *
+ */
+int i_wait_until(long long l_deadline)
+{
+#if defined(linux) || defined(__linux__) || defined(__NetBSD__)
+struct timespec o_deadline;
+int i_status;
+o_deadline.tv_sec = l_deadline / 1000000000LL;
+o_deadline.tv_nsec = l_deadline % 1000000000LL;
+while ((i_status = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &o_deadline, NULL)) == EINTR); /* Restart if interrupted */
+return (i_status);
+#else
+long long l_delay;
+l_delay = (l_deadline - l_clock()) / 1000000LL;
+if (l_delay > 0) return (i_wait(l_delay));
+return (0);
+#endif
+}
+
+/*
+ * wait inputs (files, count, nanoseconds)
+ *
+ * Waits until there is input to read from any of the files or  the  clock
+ * returned  by  l_clock() reaches the specified time (if the time is  neg-
+ * ative  waits for input indefinitely).  Returns a bit mask  showing  which
+ * of the files (up to 16) have input to read.
+ *
+ * Uses  poll() on any POSIX system with the timeout rounded up to a whole
+ * millisecond.  On Linux a timer file is used for the deadline instead so
+ * it has the same resolution as i_wait_until(),  and nothing happens until
+ * either the input or the timer is ready.  Each thread has its own timer.
+ *
+ * 18 Oct 26         - Initial version - MT
+ *
+ */
+int i_wait_inputs(int *i_files, int i_count, long long l_deadline)
+{
+#if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#if defined(linux) || defined(__linux__)
+static __thread int i_timer = -1;
+struct itimerspec o_timer;
+uint64_t l_expired;
+#endif
+struct pollfd o_poll[17];
+long long l_delay = -1;
+int i_index, i_polled, i_status, i_ready = 0;
+if (i_count > 16) i_count = 16;
+for (i_index = 0; i_index < i_count; i_index++)
+{
+   o_poll[i_index].fd = i_files[i_index];
+   o_poll[i_index].events = POLLIN;
+   o_poll[i_index].revents = 0;
+}
+i_polled = i_count;
+#if defined(linux) || defined(__linux__)
+if (l_deadline >= 0)
+{
+   if (i_timer < 0) i_timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+   o_timer.it_interval.tv_sec = o_timer.it_interval.tv_nsec = 0;
+   o_timer.it_value.tv_sec = l_deadline / 1000000000LL;
+   o_timer.it_value.tv_nsec = l_deadline % 1000000000LL;
+   if (l_deadline == 0) o_timer.it_value.tv_nsec = 1; /* A zero time would disarm the timer */
+   if ((i_timer >= 0) && (timerfd_settime(i_timer, TFD_TIMER_ABSTIME, &o_timer, NULL) == 0))
+   {
+      o_poll[i_count].fd = i_timer;
+      o_poll[i_count].events = POLLIN;
+      o_poll[i_count].revents = 0;
+      i_polled++;
+   }
+}
+#endif
+do
+{
+   if ((l_deadline >= 0) && (i_polled == i_count)) /* No timer so use a timeout */
+   {
+      l_delay = (l_deadline - l_clock() + 999999LL) / 1000000LL; /* Round up to a whole millisecond */
+      if (l_delay < 0) l_delay = 0;
+      if (l_delay > 0x7fffffffLL) l_delay = 0x7fffffffLL;
+   }
+   i_status = poll(o_poll, i_polled, (int) l_delay);
+} while ((i_status < 0) && (errno == EINTR)); /* Restart if interrupted */
+#if defined(linux) || defined(__linux__)
+if ((i_polled > i_count) && (o_poll[i_count].revents & POLLIN))
+   if (read(i_timer, &l_expired, sizeof(l_expired)) < 0) l_expired = 0; /* Acknowledge the timer */
+#endif
+for (i_index = 0; i_index < i_count; i_index++)
+   if (o_poll[i_index].revents & POLLIN) i_ready |= 1 << i_index;
+return (i_ready);
+#else
+if (l_deadline >= 0)
+   i_wait_until(l_deadline); /* Can't wait for input so just wait */
+else
+   i_wait(10); /* Don't return immediately or the caller will never stop checking */
+return (0);
+#endif
+}
+
+/*
+ * wait input (file, nanoseconds)
+ *
+ * Waits  until there is input to read from the file or the clock  returned
+ * by  l_clock() reaches the specified time (if the time is negative  waits
+ * for input indefinitely).  Returns True if there is input to read.
+ *
+ * 18 Oct 26         - Initial version - MT
+ *
+ */
+int i_wait_input(int i_file, long long l_deadline)
+{
+return (i_wait_inputs(&i_file, 1, l_deadline) != 0);
+}
@@ -19,9 +19,20 @@
  * with this program.  If not, see <http://www.gnu.org/licenses/>.
  *
  * 16 Aug 20         - Initial version - MT
+ * 18 Oct 26         - Added l_clock() and i_wait_until() - MT
+ *                   - Added i_wait_input() - MT
+ *                   - Added i_wait_inputs() - MT
  *
  */
 
 int i_wait(long l_delay);
 
+long long l_clock(void);
+
+int i_wait_until(long long l_deadline);
+
+int i_wait_input(int i_file, long long l_deadline);
+
+int i_wait_inputs(int *i_files, int i_count, long long l_deadline);
+
 
@@ -26,21 +26,27 @@
  * 22 May 22         - Fixed shortcut key for SST - MT
  * 18 Mar 24         - Embedded firmware - MT
  * 22 Apr 24         - Removed duplicate definition - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  * TO DO :           -
  */
 
 #define NAME           "x11-calc-10c"
-#define BUILD          "0006"
-#define DATE           "18 Mar 24"
+#define BUILD          "0007"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -160,7 +166,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[i_count++] = h_button_create(00025, '+', "+", "-DEG", "", "",  h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_WIDTH, KEY_HEIGHT, False, False, BLACK, YELLOW, MID_BLUE, BLACK);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    0x0107, 0x004e, 0x0270, 0x0238, 0x02ee, 0x013f, 0x01e5, 0x0000,
    0x004e, 0x02e0, 0x006e, 0x0014, 0x006b, 0x00a1, 0x0000, 0x013b,
    0x00dc, 0x00e1, 0x00bc, 0x00dd, 0x00d9, 0x00b9, 0x0393, 0x00d6,
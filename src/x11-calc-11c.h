@@ -21,6 +21,7 @@
  * 30 Jan 22         - Initial version (derived from x11-calc-10.c) - MT
  * 09 Mar 22         - Fixed width and height (when scaled) - MT
  * 22 Apr 24         - Define display colour separately - MT
+ * 18 Oct 26         - Made the ROM a constant 16-bit array - MT
  *
  */
 
@@ -60,7 +61,7 @@
 #define ROM_SIZE           014000
 #define CONTINIOUS
 
-extern int i_rom [ROM_SIZE];
+extern const unsigned short i_rom [ROM_SIZE];
 
 void v_init_buttons(obutton *h_button[]);
 
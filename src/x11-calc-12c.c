@@ -24,20 +24,26 @@
  * 12 Mar 22         - Added the label state property - MT
  * 18 Mar 24         - Embedded firmware - MT
  * 22 Apr 24         - Removed duplicate definition - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-12c"
-#define BUILD          "0005"
-#define DATE           "18 Mar 24"
+#define BUILD          "0006"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -165,7 +171,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[i_count++] = h_button_create(00025, '+', "+", "", "", "",  h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_WIDTH, KEY_HEIGHT, False, False, BLACK, YELLOW, MID_BLUE, BLACK);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    0x0107, 0x004e, 0x0270, 0x0238, 0x02ee, 0x014f, 0x01e5, 0x0000,
    0x004e, 0x02e0, 0x006e, 0x0014, 0x006b, 0x00a9, 0x0000, 0x013b,
    0x0118, 0x0060, 0x00ec, 0x0111, 0x00e8, 0x00f0, 0x0393, 0x00e4,
@@ -23,21 +23,27 @@
  * 18 Mar 24         - Embedded firmware - MT
  * 22 Apr 24         - Removed duplicate definition - MT
  *  2 May 24         - Added shortcut keys 'A-E' - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  * TO DO :           -
  */
 
 #define NAME           "x11-calc-15c"
-#define BUILD          "0005"
-#define DATE           "02 May 24"
+#define BUILD          "0006"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -157,7 +163,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[i_count++] = h_button_create(00025, '+', "+", "Py,x", "", "Cy,x",  h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_WIDTH, KEY_HEIGHT, False, False, BLACK, YELLOW, MID_BLUE, BLACK);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    0x01cf, 0x004e, 0x0270, 0x0238, 0x02ee, 0x010f, 0x0041, 0x00a0,
    0x0121, 0x000c, 0x006e, 0x0304, 0x0184, 0x01a5, 0x0002, 0x0000,
    0x01bc, 0x01fb, 0x0132, 0x0179, 0x0140, 0x0113, 0x03ce, 0x0135,
@@ -23,6 +23,7 @@
  * 09 Mar 22         - Fixed width and height (when scaled) - MT
  * 21 Mar 24         - Fixed display position - MT
  * 22 Apr 24         - Define display colour separately - MT
+ * 18 Oct 26         - Made the ROM a constant 16-bit array - MT
  *
  */
 
@@ -62,7 +63,7 @@
 #define ROM_SIZE           034000
 #define CONTINIOUS
 
-extern int i_rom [ROM_SIZE];
+extern const unsigned short i_rom [ROM_SIZE];
 
 void v_init_buttons(obutton *h_button[]);
 
@@ -22,21 +22,27 @@
  * 12 Mar 22         - Added the label state property - MT
  * 18 Mar 24         - Embedded firmware - MT
  * 22 Apr 24         - Removed duplicate definition - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  * TO DO :           -
  */
 
 #define NAME           "x11-calc-16c"
-#define BUILD          "0003"
-#define DATE           "18 Mar 24"
+#define BUILD          "0004"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -164,7 +170,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[i_count++] = h_button_create(00025, '+', "+", "OR", "", "X=0",  h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_WIDTH, KEY_HEIGHT, False, False, BLACK, YELLOW, MID_BLUE, BLACK);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    0x01cf, 0x004e, 0x0270, 0x0238, 0x02ee, 0x00ff, 0x0231, 0x000c,
    0x01a1, 0x000c, 0x006e, 0x0304, 0x0184, 0x019d, 0x0002, 0x0000,
    0x0308, 0x0166, 0x014a, 0x00ee, 0x014c, 0x014d, 0x0146, 0x014b,
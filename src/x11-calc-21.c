@@ -42,20 +42,26 @@
  *                     for buttons and switches into two functions - MT
  * 21 Oct 23         - Updated switch parameters to accomodate a 3 position
  *                     switch and made DEG the default mode - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-21"
-#define BUILD          "0016"
-#define DATE           "21 Oct 23"
+#define BUILD          "0017"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -162,7 +168,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[29] = h_button_create(00221, 000, "DSP", "", "", "", h_large_font, h_small_font, h_alternate_font, i_left, i_top, KEY_NUMERIC, KEY_HEIGHT, False, False, LIGHT_GRAY, BACKGROUND, MID_BLUE, BLACK);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    00672, 00672, 01710, 00410, 00432, 00214, 00110, 00310,
    01635, 01566, 00014, 00432, 00072, 00445, 01610, 00134,
    00120, 01015, 01112, 01512, 00264, 00272, 01363, 00006,
@@ -33,6 +33,7 @@
  * 29 Jan 22         - Added an optional bezel to the display - MT
  * 12 Feb 22         - Updated layout and separated the initialisation code
  *                     for buttons and switches into two functions - MT
+ * 18 Oct 26         - Made the ROM a constant 16-bit array - MT
  *
  */
 
@@ -81,7 +82,7 @@
 #define MEMORY_SIZE     (8 + 1 + (49 / 7))
 #define ROM_SIZE        04000
 
-extern int i_rom [ROM_SIZE];
+extern const unsigned short i_rom [ROM_SIZE];
 
 void v_init_labels(olabel *h_label[]);
 
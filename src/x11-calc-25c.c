@@ -38,20 +38,26 @@
  *                     for buttons and switches into two functions - MT
  * 21 Oct 23         - Updated switch parameters to accomodate a 3 position
  *                     switch - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-25c"
-#define BUILD          "0015"
-#define DATE           "21 Oct 23"
+#define BUILD          "0016"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -159,7 +165,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[29] = h_button_create(00220, 000, "R/S", "PAUSE", "", "NOP", h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_NUMERIC, KEY_HEIGHT, False, False, LIGHT_GRAY, YELLOW, MID_BLUE, LIGHT_GRAY);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    01173, 00202, 01242, 00202, 00427, 01053, 00555, 00313,
    00643, 01671, 00710, 01566, 00030, 00704, 00006, 01526,
    00110, 01731, 00774, 00432, 00742, 00342, 00302, 00610,
@@ -39,20 +39,26 @@
  * 21 Oct 23         - Updated switch parameters to accomodate a 3 position
  *                     switch - MT
  * 04 May 24         - Do not define unused switches - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-27"
-#define BUILD          "0014"
-#define DATE           "21 Oct 23"
+#define BUILD          "0015"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -158,7 +164,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[29] = h_button_create(00220, 000, "E+", "E-", "", "%E", h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_NUMERIC, KEY_HEIGHT, False, False, LIGHT_GRAY, YELLOW, BLACK, LIGHT_GRAY);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    00310, 00204, 00672, 00672, 01710, 01160, 01260, 00610,
    00432, 01247, 00745, 00004, 00724, 00201, 01124, 00201,
    01314, 01414, 01777, 01224, 00127, 00110, 01504, 01327,
@@ -38,20 +38,26 @@
  * 28 Dec 22         - Fixed PRGM/RUN switch label - MT
  * 21 Oct 23         - Updated switch parameters to accomodate a 3 position
  *                     switch - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-29c"
-#define BUILD          "0015"
-#define DATE           "21 Oct 23"
+#define BUILD          "0016"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -156,7 +162,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[29] = h_button_create(00220, 000, "R/S", "PAUSE", "", "1/x", h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_NUMERIC, KEY_HEIGHT, False, False, LIGHT_GRAY, YELLOW, MID_BLUE, LIGHT_GRAY);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    00000, 00000, 01464, 01417, 00264, 00557, 00256, 01160,
    00070, 00232, 00520, 00520, 01152, 00053, 01020, 00664,
    00033, 00610, 00710, 01020, 00104, 00710, 01356, 00034,
@@ -38,6 +38,7 @@
  * 12 Feb 22         - Updated layout and separated the initialisation code
  *                     for buttons and switches into two functions - MT
  * 30 Mar 24         - Corrected number of switches - MT
+ * 18 Oct 26         - Made the ROM a constant 16-bit array - MT
  *
  */
 
@@ -84,7 +85,7 @@
 #define ROM_SIZE           07000
 #define MEMORY_SIZE        20
 
-extern int i_rom [ROM_SIZE];
+extern const unsigned short i_rom [ROM_SIZE];
 
 void v_init_labels(olabel *h_label[]);
 
@@ -21,20 +21,26 @@
  * 11 Dec 22         - Initial version derived from hp33c - MT
  * 21 Oct 23         - Updated switch parameters to accomodate a 3 position
  *                     switch - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-33e"
-#define BUILD          "0002"
-#define DATE           "21 Oct 23"
+#define BUILD          "0003"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -142,7 +148,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[29] = h_button_create(00100, 000, "R/S", "PAUSE", "", "%", h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_NUMERIC, KEY_HEIGHT, False, False, LIGHT_GRAY, YELLOW, MID_BLUE, BLACK);
 }
 
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    00664, 00013, 01460, 00031, 01360, 01020, 01566, 00011,
    00432, 01410, 00774, 01352, 00022, 01156, 00752, 01152,
    00117, 00756, 01020, 00552, 00137, 00432, 00157, 00406,
@@ -29,20 +29,26 @@
  *                     for buttons and switches into two functions - MT
  * 21 Oct 23         - Updated switch parameters to accomodate a 3 position
  *                     switch - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-34c"
-#define BUILD          "0008"
-#define DATE           "21 Oct 23"
+#define BUILD          "0009"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -150,7 +156,7 @@ void v_init_buttons(obutton *h_button[]) {
    h_button[29] = h_button_create(00100, 000, "R/S", "E+", "E-", "PSE", h_normal_font, h_alternate_font, h_alternate_font, i_left, i_top, KEY_NUMERIC, KEY_HEIGHT, False, False, LIGHT_GRAY, YELLOW, MID_BLUE, BLACK);
 }
 
-int i_rom[] = {
+const unsigned short i_rom[] = {
    00440, 00063, 00073, 00107, 00747, 00757, 00773, 01113,
    01123, 01137, 01713, 01367, 00072, 00126, 00410, 00510,
    00416, 00062, 00422, 00410, 01074, 00620, 00652, 00752,
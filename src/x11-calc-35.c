@@ -31,12 +31,14 @@
  *                     switch -
  * 03 Mar 24         - Updated font sizes for new fonts - MT
  * 04 May 24         - Do not define unused switches - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-35"
-#define BUILD          "0008"
-#define DATE           "03 Mar 24"
+#define BUILD          "0009"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 /* Define REDDOT to build a version with the original HP35 bugs */
@@ -45,8 +47,12 @@
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -220,7 +226,7 @@ void v_init_buttons(obutton *h_button[]) {
 }
 
 #if defined(REDDOT)
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    00335, 01377, 01044, 00027, 00504, 01104, 00204, 00420,
    00521, 00413, 00137, 00303, 00650, 01547, 01356, 01742,
    00056, 00220, 01752, 01752, 01752, 00153, 01151, 00250,
@@ -319,7 +325,7 @@ int i_rom[ROM_SIZE] = {
    00230, 00330, 00030, 00230, 00530, 01007, 00514, 00773
 };
 #else
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    00335, 01377, 01044, 00027, 00504, 01104, 00204, 00420,
    01321, 01773, 00137, 00303, 00650, 01547, 01356, 01742,
    00056, 00220, 01752, 01752, 01752, 00153, 01151, 00250,
@@ -26,6 +26,7 @@
  * 12 Feb 22         - Updated layout and separated the initialisation code
  *                     for buttons and switches into two functions - MT
  * 30 Mar 24         - Corrected number of switches - MT
+ * 18 Oct 26         - Made the ROM a constant 16-bit array - MT
  *
  */
 
@@ -65,7 +66,7 @@
 #define ROM_SIZE           01400
 #define MEMORY_SIZE        1
 
-extern int i_rom [ROM_SIZE];
+extern const unsigned short i_rom [ROM_SIZE];
 
 void v_init_labels(olabel *h_label[]);
 
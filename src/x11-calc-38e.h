@@ -24,6 +24,7 @@
  * 20 Jan 22         - Fixed compilation warnings on VAXC by defining i_rom
  *                     as external - MT
  * 29 Jan 22         - Added an optional bezel to the display - MT
+ * 18 Oct 26         - Made the ROM a constant 16-bit array - MT
  *
  */
 
@@ -70,7 +71,7 @@
 #define ROM_SIZE           020000
 #define MEMORY_SIZE        51
 
-extern int i_rom [ROM_SIZE];
+extern const unsigned short i_rom [ROM_SIZE];
 
 void v_init_labels(olabel *h_label[]);
 
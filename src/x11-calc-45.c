@@ -30,20 +30,26 @@
  *                     switch - MT
  * 03 Mar 24         - Updated font sizes for new fonts - MT
  * 04 May 24         - Do not define unused switches - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-45"
-#define BUILD          "0007"
-#define DATE           "03 Mar 24"
+#define BUILD          "0008"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -161,7 +167,7 @@ void v_init_buttons(obutton *h_button[]) {
    i_left += (KEY_NUMERIC + 3 * KEY_GAP);
    h_button[i_count++] = h_button_create(00042, 000, "E+", "E-", "", "", h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_NUMERIC, KEY_HEIGHT, False, True, LIGHT_GRAY, YELLOW, BACKGROUND, BACKGROUND);
 }
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
    00255, 01420, 00451, 01456, 01746, 00472, 01572, 01616,
    01352, 01611, 01611, 01352, 01445, 00623, 01024, 00507,
    01035, 01656, 00616, 00013, 01220, 01035, 01656, 01020,
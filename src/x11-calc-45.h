@@ -24,6 +24,7 @@
  *                     as external - MT
  * 29 Jan 22         - Added an optional bezel to the display - MT
  * 30 Mar 24         - Corrected number of switches - MT
+ * 18 Oct 26         - Made the ROM a constant 16-bit array - MT
  *
  */
 
@@ -63,7 +64,7 @@
 #define ROM_SIZE           04000
 #define MEMORY_SIZE        10
 
-extern int i_rom [ROM_SIZE];
+extern const unsigned short i_rom [ROM_SIZE];
 
 void v_init_labels(olabel *h_label[]);
 
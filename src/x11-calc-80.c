@@ -29,20 +29,26 @@
  *                     switch - MT
  * 03 Mar 24         - Updated font sizes for new fonts - MT
  * 04 May 24         - Do not define unused switches - MT
+ * 18 Oct 26         - Don't include the X11 headers in a headless build - MT
+ *                   - Made the ROM a constant 16-bit array - MT
  *
  */
 
 #define NAME           "x11-calc-80"
-#define BUILD          "0007"
-#define DATE           "03 Mar 24"
+#define BUILD          "0008"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <stdarg.h>    /* strlen(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* getenv(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-font.h"
 #include "x11-calc-button.h"
@@ -160,7 +166,7 @@ void v_init_buttons(obutton *h_button[]) {
    i_left += (KEY_NUMERIC + 3 * KEY_GAP);
    h_button[i_count++] = h_button_create(00042, 000, "E+", "E-", "", "", h_normal_font, h_small_font, h_alternate_font, i_left, i_top, KEY_NUMERIC, KEY_HEIGHT, False, True, LIGHT_GRAY, BACKGROUND, BACKGROUND, BACKGROUND);
 }
-int i_rom[ROM_SIZE] = {
+const unsigned short i_rom[ROM_SIZE] = {
 01311, 00563, 01752, 01752, 01752, 00223, 00650, 00220,
 01450, 01203, 00220, 01767, 01450, 00477, 00650, 00207,
 00000, 00000, 01752, 01752, 01752, 00013, 00650, 00220,
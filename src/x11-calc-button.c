@@ -60,14 +60,18 @@
  *                     dividing line in the same place regardless of aspect
  *                     ratio - MT
  * 23 Apr 24         - Separated out prototypes for error handlers - MT
+ * 18 Oct 26         - Drawing functions are not needed in a headless build
+ *                     so don't include the X11 headers - MT
+ *                   - Added button_map() to build a table that maps  each
+ *                     key directly to a button, including aliases - MT
  *
  * To Do             - Add a new style to handle the type of button used by
  *                     the classic series.
  */
 
 #define NAME           "x11-calc-button"
-#define BUILD          "0020"
-#define DATE           "25 Mar 24"
+#define BUILD          "0021"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <errno.h>     /* errno */
@@ -76,8 +80,12 @@
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* malloc(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-messages.h"
 #include "x11-calc-errors.h"
@@ -131,6 +139,60 @@ obutton *h_button_pressed(obutton *h_button, int i_xpos, int i_ypos){
    return(NULL);
 }
 
+/*
+ * button_map (keymap, buttons, count)
+ *
+ * Fills in a table that gives the button for every possible key, so the
+ * button can be found without checking every button in turn.  As well as
+ * the key defined for each button, a key may be given aliases which  are
+ * used if they aren't already assigned to another button, including the
+ * other  case of any letter.  This is the only place keys are  remapped.
+ * Returns the number of keys that are mapped to a button.
+ *
+ */
+
+int i_button_map(obutton *h_keymap[], obutton *h_button[], int i_buttons)
+{
+   static const char c_alias[][2] = { /* Alias, key */
+      {'\010', '\033'},  /* Backspace for escape */
+      {'\n', '\r'},      /* Linefeed for enter */
+      {'=', '+'},        /* Unshifted plus */
+      {'_', '-'},        /* Shifted minus */
+      {',', '.'},        /* Decimal comma */
+   };
+   int i_count, i_mapped = 0;
+
+   for (i_count = 0; i_count < KEYS; i_count++)
+      h_keymap[i_count] = NULL;
+
+   for (i_count = 0; i_count < i_buttons; i_count++) /* Key defined for each button */
+      if ((h_button[i_count] != NULL) && (h_button[i_count]->key != '\000') &&
+         (h_keymap[(unsigned char) h_button[i_count]->key] == NULL))
+      {
+         h_keymap[(unsigned char) h_button[i_count]->key] = h_button[i_count];
+         i_mapped++;
+      }
+
+   for (i_count = 0; i_count < sizeof(c_alias) / sizeof(*c_alias); i_count++) /* Aliases for particular keys */
+      if ((h_keymap[(unsigned char) c_alias[i_count][0]] == NULL) && (h_keymap[(unsigned char) c_alias[i_count][1]] != NULL))
+      {
+         h_keymap[(unsigned char) c_alias[i_count][0]] = h_keymap[(unsigned char) c_alias[i_count][1]];
+         i_mapped++;
+      }
+
+   for (i_count = 'A'; i_count <= 'Z'; i_count++) /* Either case of a letter selects the same button (unless used) */
+      if ((h_keymap[i_count] == NULL) != (h_keymap[i_count - 'A' + 'a'] == NULL))
+      {
+         if (h_keymap[i_count] == NULL)
+            h_keymap[i_count] = h_keymap[i_count - 'A' + 'a'];
+         else
+            h_keymap[i_count - 'A' + 'a'] = h_keymap[i_count];
+         i_mapped++;
+      }
+
+   return (i_mapped);
+}
+
 /*button_create (index, key, text, label ,label, font, function_font,
  *                label_font, left, top, width, height,
  *                state, colour)
@@ -193,6 +255,7 @@ int i_button_resize(obutton *h_button, float f_scale)
 }
 
 
+#if !defined(HEADLESS)
 /* button_draw (display, window, screen, button) */
 
 int i_button_draw(Display *h_display, int x_application_window, int i_screen, obutton *h_button) {
@@ -343,3 +406,4 @@ int i_button_draw(Display *h_display, int x_application_window, int i_screen, ob
    }
    return(True);
 }
+#endif
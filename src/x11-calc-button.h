@@ -28,8 +28,11 @@
  *                     function text to be defined - MT
  * 06 Dec 21         - Label text colour now explicitly defined to allow it
  *                     to be different from the main text colour- MT
+ * 18 Oct 26         - Added button_map() - MT
  */
 
+#define KEYS            256   /* Number of entries in a key map */
+
 typedef struct { /* Calculator button structure. */
    int index;
    XRectangle button_position;   /* Current button position */
@@ -54,6 +57,8 @@ obutton *h_button_key_pressed(obutton *h_button, char c_key);
 
 obutton *h_button_pressed(obutton *h_button, int i_xpos, int i_ypos);
 
+int i_button_map(obutton *h_keymap[], obutton *h_button[], int i_buttons);
+
 obutton *h_button_create(int i_index, char c_key,
    char* s_text, char* s_function ,char* s_alternate ,char* s_label,
    XFontStruct *h_normal_font, XFontStruct *h_shift_font, XFontStruct *h_label_font,
@@ -390,6 +390,84 @@
  *                   - Fixed array subscript and string operation  compiler
  *                     warnings -MT
  * 23 Apr 24         - Separated out prototypes for error handlers - MT
+ * 18 Oct 26         - Each ROM word is decoded once when the ROM is loaded
+ *                     and the predecoded field select and branch addresses
+ *                     are used when executing each instruction - MT
+ *                   - The nibbles in each register are packed into a 64
+ *                     bit value so register arithmetic, comparisons, and
+ *                     shifts operate on all the nibbles in a field at the
+ *                     same time, falling back to the original  nibble  by
+ *                     nibble loops if a field contains digits that are not
+ *                     valid for the current base - MT
+ *                   - Registers  and memory are no longer allocated  one
+ *                     at a time but are part of the processor - MT
+ *                   - The instruction decoder is compiled twice,  once
+ *                     with  and once without any trace output,  so  that
+ *                     tracing costs nothing unless it is enabled - MT
+ *                   - Added processor_run() to execute several instruct-
+ *                     ions  at once, stopping early if the processor goes
+ *                     to  sleep, the display is enabled or disabled,  the
+ *                     keyboard is read, or at a breakpoint or trap - MT
+ *                   - Breakpoints and traps are stored as bitmaps so any
+ *                     number can be set and checked with one test - MT
+ *                   - Detects when the ROM is in a loop waiting for a key
+ *                     by comparing the processor state each time the  key
+ *                     status is tested, if nothing has changed then there
+ *                     is nothing to do until a key is pressed - MT
+ *                   - Don't include the X11 headers in a headless  build
+ *                     - MT
+ *                   - Load  the ROM into the processor's own ROM and not
+ *                     the global one, and added processor_free() so  that
+ *                     several processors can be used at the same time - MT
+ *                   - Saves the complete processor state as a binary snap-
+ *                     shot (with a header and checksum) which is  written
+ *                     to a temporary file and then renamed, and loaded by
+ *                     mapping  it into memory.  Text data files can still
+ *                     be loaded and are imported if there is no snapshot
+ *                     - MT
+ *                   - Added an option to keep the memory of a continuous
+ *                     memory model in a memory mapped file - MT
+ *                   - Keeps a binary image of a ROM loaded from a  file
+ *                     which is used instead of the text file as long  as
+ *                     that hasn't changed - MT
+ *                   - The built-in ROM is a constant array of 16-bit words
+ *                     and is only copied if it is loaded from a file - MT
+ *                   - Optionally counts the instructions executed at each
+ *                     address,  of each type,  and in each calling context
+ *                     and writes them to a profile - MT
+ *                   - Keeps a history of the last instructions executed as
+ *                     binary  records in a ring buffer instead of printing
+ *                     each one,  which is written to a file on demand,  on
+ *                     a signal or after an error, and can be decoded later
+ *                     using the same text as the trace - MT
+ *                   - Trace output can be sent to any file - MT
+ *                   - Memory kept in a memory mapped file is never cleared
+ *                     by a reset or overwritten when the saved state  is
+ *                     restored,  and it is left out of the snapshot.  The
+ *                     memory file is removed whenever the state  is  saved
+ *                     without it so it is never older than the snapshot
+ *                     - MT
+ *                   - A ROM image is checked against a checksum of the ROM
+ *                     file and not its modification time,  and if it holds
+ *                     the complete ROM the processor uses the mapped image
+ *                     directly instead of copying it - MT
+ *                   - Conditional branches are only traced in the traced
+ *                     build of the decoder - MT
+ *                   - Added key_seen() so both front ends decide when the
+ *                     ROM has seen a key in the same way - MT
+ *                   - Taking a snapshot and writing it to a file are  now
+ *                     separate steps so the state can be saved by another
+ *                     thread - MT
+ *                   - Every  instruction  is decoded into the handler that
+ *                     executes  it and any operand that is part of the op-
+ *                     code, so executing it needs just one switch - MT
+ *                   - A history is decoded from the op-codes it recorded
+ *                     without executing them again - MT
+ *                   - Signal handlers are set up by history_catch() for a
+ *                     single processor instead of every time a history is
+ *                     started - MT
+ *                   - Added processor_step() so an instruction executed on
+ *                     its own is also added to the history and profile - MT
  *
  * To Do             - Finish adding code to display any modified registers
  *                     to every instruction.
@@ -399,19 +477,25 @@
  */
 
 #define NAME           "x11-calc-cpu"
-#define BUILD          "0171"
-#define DATE           "29 Mar 24"
+#define BUILD          "0172"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <errno.h>     /* errno */
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>    /* uint64_t */
+#include <stddef.h>    /* offsetof() */
 #include <stdio.h>
 #include <stdarg.h>
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#endif
 
 #include "x11-calc-messages.h"
 #include "x11-calc-errors.h"
@@ -427,6 +511,10 @@
 
 #if defined(unix) || defined(__unix__) || defined(__APPLE__)
 #include <sys/stat.h>
+#include <sys/mman.h>  /* mmap() */
+#include <fcntl.h>     /* open() */
+#include <unistd.h>    /* write(), fsync(), close() */
+#include <signal.h>    /* sigaction() */
 #endif
 
 static void v_fprint_register(FILE *h_file, oregister *h_register) /* Print the contents of a register */
@@ -442,7 +530,7 @@ static void v_fprint_register(FILE *h_file, oregister *h_register) /* Print the
          fprintf(h_file, "%03d", h_register->id);
       fprintf(h_file, "] = 0x");
       for (i_count = REG_SIZE - 1; i_count >=0 ; i_count--)
-         fprintf(h_file, "%1x", h_register->nibble[i_count]);
+         fprintf(h_file, "%1x", NIBBLE(h_register, i_count));
    }
 }
 
@@ -528,68 +616,137 @@ void v_fprint_memory(FILE *h_file, oprocessor *h_processor) /* Display current m
    }
 }
 
-oregister *h_register_create(int i_id) /* Create a new register , */
+/*
+ * Packed registers
+ *
+ * The nibbles in each register are packed into a 64-bit value  with  the
+ * first nibble in the least significant position,  so a whole field  can
+ * be copied, exchanged, added, subtracted, compared, or shifted in one go.
+ * Decimal arithmetic uses the usual trick of adding six to every digit to
+ * propagate the carry between digits, then subtracting six from any digit
+ * that did not generate a carry.  This only gives the same result as  the
+ * original nibble by nibble loop if every digit is a valid decimal digit,
+ * so fields containing anything else fall back to the loop.
+ */
+
+#define PACKED_SIXES    0x66666666666666ULL     /* Six in every nibble */
+#define PACKED_CARRIES  0x1111111111111110ULL   /* Carry out of every nibble */
+#define PACKED_REGISTER 0x00ffffffffffffffULL   /* Every nibble in a register */
+
+static void v_nibble_set(oregister *h_register, int i_nibble, int i_value) /* Set a nibble in a register */
 {
-   oregister *h_register; /* Pointer to register */
-   int i_count, i_temp;
-   if ((h_register = malloc (sizeof(*h_register))) == NULL)
-   {
-      fprintf(stdout, h_err_register_alloc, __FILE__, __LINE__);
-   }
-   i_temp = sizeof(h_register->nibble) / sizeof(*h_register->nibble);
-   h_register->id = i_id;
-   for (i_count = 0; i_count < i_temp; i_count++)
-      h_register->nibble[i_count] = 0;
-   return(h_register);
+   h_register->value = (h_register->value & ~(0x0fULL << (4 * i_nibble))) | ((unsigned long long) (i_value & 0x0f) << (4 * i_nibble));
+}
+
+static uint64_t i_field_mask(oprocessor *h_processor) /* Mask with one bits in every nibble of the selected field */
+{
+   int i_width = 4 * (h_processor->last - h_processor->first + 1);
+   if (i_width <= 0) return 0;
+   if (i_width >= 64) return ~(uint64_t) 0;
+   return (((uint64_t) 1 << i_width) - 1) << (4 * h_processor->first);
 }
 
 static void v_reg_exch(oprocessor *h_processor, oregister *h_destination, oregister *h_source) /* Exchange the contents of two registers */
 {
-   int i_count, i_temp;
-   for (i_count = h_processor->first; i_count <= h_processor->last; i_count++)
-   {
-      i_temp = h_destination->nibble[i_count];
-      h_destination->nibble[i_count] = h_source->nibble[i_count];
-      h_source->nibble[i_count] = i_temp;
-   }
+   uint64_t i_temp = (h_destination->value ^ h_source->value) & i_field_mask(h_processor);
+   h_destination->value ^= i_temp;
+   h_source->value ^= i_temp;
 }
 
 static void v_reg_copy(oprocessor *h_processor, oregister *h_destination, oregister *h_source) /* Copy the contents of a register */
 {
-   int i_count, i_temp;
-   for (i_count = h_processor->first; i_count <= h_processor->last; i_count++)
-   {
-      if (h_source != NULL) i_temp = h_source->nibble[i_count]; else i_temp = 0;
-      h_destination->nibble[i_count] = i_temp;
-   }
+   uint64_t i_mask = i_field_mask(h_processor);
+   if (h_destination->id >= 0) h_processor->writes++; /* Memory registers have a positive id */
+   h_destination->value &= ~i_mask;
+   if (h_source != NULL) h_destination->value |= h_source->value & i_mask;
 }
 
 #if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
 static void v_reg_or(oprocessor *h_processor, oregister *h_destination, oregister *h_source, oregister *h_argument) /* Or the contents of two registers */
 {
-   int i_count, i_temp;
-   for (i_count = h_processor->first; i_count <= h_processor->last; i_count++){
-      if (h_argument != NULL) i_temp = h_argument->nibble[i_count]; else i_temp = 0;
-      h_destination->nibble[i_count] = h_source->nibble[i_count] | i_temp;
-   }
+   uint64_t i_mask = i_field_mask(h_processor);
+   h_destination->value = (h_destination->value & ~i_mask) | ((h_source->value | (h_argument != NULL ? h_argument->value : 0)) & i_mask);
 }
 
 static void v_reg_and(oprocessor *h_processor, oregister *h_destination, oregister *h_source, oregister *h_argument) /* And the contents of two registers */
 {
-   int i_count, i_temp;
-   for (i_count = h_processor->first; i_count <= h_processor->last; i_count++){
-      if (h_argument != NULL) i_temp = h_argument->nibble[i_count]; else i_temp = 0;
-      h_destination->nibble[i_count] = h_source->nibble[i_count] & i_temp;
-   }
+   uint64_t i_mask = i_field_mask(h_processor);
+   h_destination->value = (h_destination->value & ~i_mask) | ((h_source->value & (h_argument != NULL ? h_argument->value : 0)) & i_mask);
 }
 #endif
 
+static int i_packed_decimal(uint64_t i_value, uint64_t i_mask) /* Check all nibbles are valid decimal digits */
+{
+   return !(((i_value + (PACKED_SIXES & i_mask)) ^ i_value ^ (PACKED_SIXES & i_mask)) & PACKED_CARRIES & (i_mask << 4));
+}
+
+static int i_reg_add_packed(oprocessor *h_processor, oregister *h_destination, oregister *h_source, oregister *h_argument) /* Add two fields */
+{
+   uint64_t i_source, i_argument, i_result, i_mask, i_sixes, i_carries;
+   int i_shift, i_width;
+   if ((h_processor->last < h_processor->first) || (h_processor->last >= REG_SIZE)) return False;
+   i_shift = 4 * h_processor->first;
+   i_width = 4 * (h_processor->last - h_processor->first + 1);
+   i_mask = ((uint64_t) 1 << i_width) - 1;
+   i_source = (h_source->value >> i_shift) & i_mask;
+   i_argument = (h_argument != NULL) ? (h_argument->value >> i_shift) & i_mask : 0;
+   switch (h_processor->base)
+   {
+   case 16:
+      i_result = i_source + i_argument + (h_processor->flags[CARRY] != 0);
+      break;
+   case 10:
+      if (!i_packed_decimal(i_source, i_mask) || !i_packed_decimal(i_argument, i_mask)) return False;
+      i_sixes = i_source + (PACKED_SIXES & i_mask);
+      i_result = i_sixes + i_argument + (h_processor->flags[CARRY] != 0);
+      i_carries = ~(i_result ^ i_sixes ^ i_argument) & PACKED_CARRIES & (i_mask << 4); /* Digits that did not carry */
+      i_result -= (i_carries >> 2) | (i_carries >> 3);
+      break;
+   default:
+      return False;
+   }
+   h_processor->flags[CARRY] = (i_result >> i_width) & 1;
+   if (h_destination != NULL) /* Destination can be null */
+      h_destination->value = (h_destination->value & ~(i_mask << i_shift)) | ((i_result & i_mask) << i_shift);
+   return True;
+}
+
+static int i_reg_sub_packed(oprocessor *h_processor, oregister *h_destination, oregister *h_source, oregister *h_argument) /* Subtract two fields */
+{
+   uint64_t i_source, i_argument, i_result, i_mask, i_borrows;
+   int i_shift, i_width;
+   if ((h_processor->last < h_processor->first) || (h_processor->last >= REG_SIZE)) return False;
+   i_shift = 4 * h_processor->first;
+   i_width = 4 * (h_processor->last - h_processor->first + 1);
+   i_mask = ((uint64_t) 1 << i_width) - 1;
+   i_source = (h_source != NULL) ? (h_source->value >> i_shift) & i_mask : 0;
+   i_argument = (h_argument != NULL) ? (h_argument->value >> i_shift) & i_mask : 0;
+   i_result = i_source - i_argument - (h_processor->flags[CARRY] != 0);
+   switch (h_processor->base)
+   {
+   case 16:
+      break;
+   case 10:
+      if (!i_packed_decimal(i_source, i_mask) || !i_packed_decimal(i_argument, i_mask)) return False;
+      i_borrows = (i_result ^ i_source ^ i_argument) & PACKED_CARRIES & (i_mask << 4); /* Digits that borrowed */
+      i_result -= (i_borrows >> 2) | (i_borrows >> 3);
+      break;
+   default:
+      return False;
+   }
+   h_processor->flags[CARRY] = (i_result >> i_width) & 1;
+   if (h_destination != NULL) /* Destination can be null */
+      h_destination->value = (h_destination->value & ~(i_mask << i_shift)) | ((i_result & i_mask) << i_shift);
+   return True;
+}
+
 static void v_reg_add(oprocessor *h_processor, oregister *h_destination, oregister *h_source, oregister *h_argument) /* Add the contents of two registers */
 {
    int i_count, i_temp;
+   if (i_reg_add_packed(h_processor, h_destination, h_source, h_argument)) return;
    for (i_count = h_processor->first; i_count <= h_processor->last; i_count++){
-      if (h_argument != NULL) i_temp = h_argument->nibble[i_count]; else i_temp = 0;
-      i_temp = h_source->nibble[i_count] + i_temp;
+      if (h_argument != NULL) i_temp = NIBBLE(h_argument, i_count); else i_temp = 0;
+      i_temp = NIBBLE(h_source, i_count) + i_temp;
       if (h_processor->flags[CARRY]) i_temp++;
       if (i_temp >= h_processor->base)
       {
@@ -600,17 +757,18 @@ static void v_reg_add(oprocessor *h_processor, oregister *h_destination, oregist
       {
          h_processor->flags[CARRY] = False;
       }
-      if (h_destination != NULL) h_destination->nibble[i_count] = i_temp & 0x0f; /* Destination can be null */
+      if (h_destination != NULL) v_nibble_set(h_destination, i_count, i_temp); /* Destination can be null */
    }
 }
 
 static void v_reg_sub(oprocessor *h_processor, oregister *h_destination, oregister *h_source, oregister *h_argument) /* Subtract the contents of two registers */
 {
    int i_count, i_temp;
+   if (i_reg_sub_packed(h_processor, h_destination, h_source, h_argument)) return;
    for (i_count = h_processor->first; i_count <= h_processor->last; i_count++)
    {
-      if (h_argument != NULL) i_temp = h_argument->nibble[i_count]; else i_temp = 0;
-      if (h_source != NULL) i_temp = (h_source->nibble[i_count] - i_temp); else i_temp = (0 - i_temp);
+      if (h_argument != NULL) i_temp = NIBBLE(h_argument, i_count); else i_temp = 0;
+      if (h_source != NULL) i_temp = (NIBBLE(h_source, i_count) - i_temp); else i_temp = (0 - i_temp);
       if (h_processor->flags[CARRY]) i_temp--;
       if (i_temp < 0)
       {
@@ -619,23 +777,14 @@ static void v_reg_sub(oprocessor *h_processor, oregister *h_destination, oregist
       }
       else
          h_processor->flags[CARRY] = False;
-      if (h_destination != NULL) h_destination->nibble[i_count] = i_temp & 0x0f; /* Destination can be null */
+      if (h_destination != NULL) v_nibble_set(h_destination, i_count, i_temp); /* Destination can be null */
    }
 }
 
 static void v_reg_test_eq(oprocessor *h_processor, oregister *h_destination, oregister *h_source) /* Test if registers are equal */
 {
-   int i_count, i_temp;
-   h_processor->flags[CARRY] = True; /* Clear carry - Do If True */
-   for (i_count = h_processor->first; i_count <= h_processor->last; i_count++)
-   {
-      if (h_source != NULL) i_temp = h_source->nibble[i_count]; else i_temp = 0;
-      if (h_destination->nibble[i_count] != i_temp)
-      {
-         h_processor->flags[CARRY] = False; /* Set carry - Do If True */
-         break;
-      }
-   }
+   uint64_t i_source = (h_source != NULL) ? h_source->value : 0;
+   h_processor->flags[CARRY] = !((h_destination->value ^ i_source) & i_field_mask(h_processor)); /* Set carry - Do If True */
 }
 
 static void v_reg_test_ne(oprocessor *h_processor, oregister *h_destination, oregister *h_source) /* Test if registers are not equal */
@@ -652,29 +801,128 @@ static void v_reg_inc(oprocessor *h_processor, oregister *h_register) /* Increme
 
 static void v_reg_shr(oprocessor *h_processor, oregister *h_register) /* Logical shift right a register */
 {
-   int i_count;
+   uint64_t i_mask = i_field_mask(h_processor);
    h_processor->flags[CARRY] = False; /* Clear carry */
-   for (i_count = h_processor->first; i_count <= h_processor->last; i_count++)
+   h_register->value = (h_register->value & ~i_mask) | (((h_register->value & i_mask) >> 4) & i_mask);
+}
+
+static void v_reg_shl(oprocessor *h_processor, oregister *h_register) /* Logical shift left a register */
+{
+   uint64_t i_mask = i_field_mask(h_processor);
+   h_register->value = (h_register->value & ~i_mask) | (((h_register->value & i_mask) << 4) & i_mask);
+   h_processor->flags[PREV_CARRY] = h_processor->flags[CARRY] = False;
+}
+
+static void v_rom_writable(oprocessor *h_processor) /* The built-in ROM and a mapped ROM image are read only so make a copy that can be changed */
+{
+   if (h_processor->overlay == NULL)
    {
-      if (i_count == h_processor->last)
-         h_register->nibble[i_count] = 0;
-      else
-         h_register->nibble[i_count] = h_register->nibble[i_count + 1];
+      if ((h_processor->overlay = malloc(sizeof(*h_processor->overlay) * ROM_SIZE)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+      memcpy(h_processor->overlay, h_processor->rom, sizeof(*h_processor->overlay) * ROM_SIZE);
+      h_processor->rom = h_processor->overlay;
    }
+#if defined(SNAPSHOT)
+   if (h_processor->image != NULL) munmap(h_processor->image, sizeof(*h_processor->image)); /* Now copied */
+   h_processor->image = NULL;
+#endif
 }
 
-static void v_reg_shl(oprocessor *h_processor, oregister *h_register) /* Logical shift left a register */
+#if defined(SNAPSHOT)
+static unsigned int i_checksum(unsigned char *h_data, unsigned int i_length) /* FNV-1a hash */
 {
-   int i_count;
-   for (i_count = h_processor->last; i_count >= h_processor->first; i_count--)
+   unsigned int i_hash = 2166136261u;
+   while (i_length-- > 0)
+      i_hash = (i_hash ^ *h_data++) * 16777619u;
+   return i_hash;
+}
+
+static unsigned int i_file_checksum(char *s_pathname, struct stat *h_stat) /* Checksum of the contents of a file */
+{
+   unsigned char *h_data;
+   unsigned int i_hash = 0;
+   int i_file;
+
+   if ((h_stat->st_size > 0) && ((i_file = open(s_pathname, O_RDONLY)) >= 0))
    {
-      if (i_count == h_processor->first)
-         h_register->nibble[i_count] = 0;
-      else
-         h_register->nibble[i_count] = h_register->nibble[i_count - 1];
+      h_data = mmap(NULL, h_stat->st_size, PROT_READ, MAP_PRIVATE, i_file, 0);
+      close(i_file);
+      if (h_data != MAP_FAILED)
+      {
+         i_hash = i_checksum(h_data, h_stat->st_size);
+         munmap(h_data, h_stat->st_size);
+      }
    }
-   h_processor->flags[PREV_CARRY] = h_processor->flags[CARRY] = False;
+   return i_hash;
+}
+
+static int i_read_rom_image(oprocessor *h_processor, char *s_pathname, struct stat *h_source, unsigned int i_source, unsigned int i_base) /* Load a binary ROM image */
+/*
+ * The image holds the complete ROM so the processor uses the mapped image
+ * directly, and the pages are shared by every instance using the same ROM.
+ */
+{
+   oromimage *h_image;
+   struct stat o_stat;
+   int i_file, b_valid;
+
+   if ((i_file = open(s_pathname, O_RDONLY)) < 0) return False;
+   if ((fstat(i_file, &o_stat) != 0) || (o_stat.st_size != sizeof(*h_image)))
+   {
+      close(i_file);
+      return False;
+   }
+   h_image = mmap(NULL, sizeof(*h_image), PROT_READ, MAP_SHARED, i_file, 0);
+   close(i_file);
+   if (h_image == MAP_FAILED) return False;
+   b_valid = !memcmp(h_image->header.magic, ROM_IMAGE_MAGIC, sizeof(h_image->header.magic)) &&
+      (h_image->header.version == ROM_IMAGE_VERSION) &&
+      !strncmp(h_image->header.model, FILENAME, sizeof(h_image->header.model)) &&
+      (h_image->header.size == h_source->st_size) && /* Must be made from the current ROM file */
+      (h_image->header.source == i_source) &&
+      (h_image->header.base == i_base) && /* Loaded over the same ROM (addresses not in the file are unchanged) */
+      (h_image->header.checksum == i_checksum((unsigned char *) h_image->word, sizeof(h_image->word)));
+   if (!b_valid)
+   {
+      munmap(h_image, sizeof(*h_image));
+      return False;
+   }
+   free(h_processor->overlay); /* Use the image in place of the existing ROM */
+   h_processor->overlay = NULL;
+   if (h_processor->image != NULL) munmap(h_processor->image, sizeof(*h_processor->image));
+   h_processor->image = h_image;
+   h_processor->rom = h_image->word;
+   return True;
+}
+
+static void v_write_rom_image(oprocessor *h_processor, char *s_pathname, struct stat *h_source, unsigned int i_source, unsigned int i_base) /* Save a binary ROM image */
+{
+   oromimage *h_image;
+   char *s_temp;
+   int i_file, b_error;
+
+   if ((h_image = calloc(1, sizeof(*h_image))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   memcpy(h_image->header.magic, ROM_IMAGE_MAGIC, sizeof(h_image->header.magic));
+   h_image->header.version = ROM_IMAGE_VERSION;
+   strncpy(h_image->header.model, FILENAME, sizeof(h_image->header.model) - 1);
+   h_image->header.size = h_source->st_size;
+   h_image->header.source = i_source;
+   h_image->header.base = i_base;
+   memcpy(h_image->word, h_processor->rom, sizeof(h_image->word));
+   h_image->header.checksum = i_checksum((unsigned char *) h_image->word, sizeof(h_image->word));
+
+   if ((s_temp = malloc(strlen(s_pathname) + 5)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   strcpy(s_temp, s_pathname);
+   strcat(s_temp, ".tmp");
+   if ((i_file = open(s_temp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) >= 0) /* Not having an image is not an error */
+   {
+      b_error = (write(i_file, h_image, sizeof(*h_image)) != sizeof(*h_image));
+      b_error |= (close(i_file) != 0);
+      if (b_error || (rename(s_temp, s_pathname) != 0)) unlink(s_temp); /* Readers only ever see a complete image */
+   }
+   free(s_temp);
+   free(h_image);
 }
+#endif
 
 void v_read_rom(oprocessor *h_processor, char *s_pathname) /* Load rom from 'object' file */
 {
@@ -682,6 +930,27 @@ void v_read_rom(oprocessor *h_processor, char *s_pathname) /* Load rom from 'obj
    unsigned int i_addr, i_opcode;
    int i_count, i_counter;
    char c_char;
+#if defined(SNAPSHOT)
+   struct stat o_stat;
+   char *s_image = NULL;
+   unsigned int i_source = 0, i_base = 0;
+
+   if (stat(s_pathname, &o_stat) == 0)
+   {
+      if ((s_image = malloc(strlen(s_pathname) + 5)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+      strcpy(s_image, s_pathname);
+      strcat(s_image, ".bin"); /* The image is kept alongside the ROM file */
+      i_source = i_file_checksum(s_pathname, &o_stat);
+      i_base = i_checksum((unsigned char *) h_processor->rom, sizeof(*h_processor->rom) * ROM_SIZE);
+      if (i_read_rom_image(h_processor, s_image, &o_stat, i_source, i_base))
+      {
+         free(s_image);
+         v_processor_decode(h_processor); /* Decode the new ROM contents */
+         return;
+      }
+   }
+#endif
+   v_rom_writable(h_processor);
 
    h_file = fopen(s_pathname, "r");
    if (h_file != NULL)
@@ -697,13 +966,20 @@ void v_read_rom(oprocessor *h_processor, char *s_pathname) /* Load rom from 'obj
             while ((i_count < i_addr) && (i_count < ROM_SIZE))
                /** i_rom[i_count++] = 0; */
                i_count++; /* Don't clear ROM */
-            if (i_count < ROM_SIZE) i_rom[i_count++] = i_opcode;
+            if (i_count < ROM_SIZE) h_processor->overlay[i_count++] = i_opcode;
          }
       }
       fclose(h_file);
+      v_processor_decode(h_processor); /* Decode the new ROM contents */
+#if defined(SNAPSHOT)
+      if (s_image != NULL) v_write_rom_image(h_processor, s_image, &o_stat, i_source, i_base);
+#endif
    }
    else
       v_error(errno, h_err_opening_file, s_pathname); /* Can't open data file */
+#if defined(SNAPSHOT)
+   free(s_image);
+#endif
 }
 
 void v_read_state(oprocessor *h_processor, char *s_pathname) /* Read processor state from file */
@@ -714,6 +990,9 @@ void v_read_state(oprocessor *h_processor, char *s_pathname) /* Read processor s
    int i_count, i_counter;
 
    if ((h_processor != NULL) && (s_pathname != NULL)) { /* Check processor and pathname are defined */
+#if defined(SNAPSHOT)
+      if (i_read_snapshot(h_processor, s_pathname, True)) return; /* Binary snapshot loaded */
+#endif
       h_file = fopen(s_pathname, "r");
       if (h_file !=NULL) { /* If file exists and can be opened restore state */
          fprintf(stderr,h_msg_loading, s_pathname);
@@ -729,7 +1008,7 @@ void v_read_state(oprocessor *h_processor, char *s_pathname) /* Read processor s
          for (i_count = 0; i_count < REGISTERS; i_count++)
             for (i_counter = REG_SIZE - 1; i_counter >= 0 ; i_counter--)
             {
-               if (fscanf(h_file, "%x,", &i_temp)) h_processor->reg[i_count]->nibble[i_counter] = i_temp;
+               if (fscanf(h_file, "%x,", &i_temp)) v_nibble_set(h_processor->reg[i_count], i_counter, i_temp);
             }
          if (fscanf(h_file, "%x,", &i_temp)) h_processor->p = i_temp;
          if (fscanf(h_file, "%x,", &i_temp)) h_processor->q = i_temp;
@@ -740,7 +1019,7 @@ void v_read_state(oprocessor *h_processor, char *s_pathname) /* Read processor s
          for (i_count = 0; i_count < MEMORY_SIZE; i_count++)
             for (i_counter = REG_SIZE - 1; i_counter >= 0 ; i_counter--)
             {
-               if (fscanf(h_file, "%x,", &i_temp)) h_processor->mem[i_count]->nibble[i_counter] = i_temp;
+               if (fscanf(h_file, "%x,", &i_temp)) v_nibble_set(h_processor->mem[i_count], i_counter, i_temp);
             }
          fclose(h_file);
       }
@@ -774,7 +1053,7 @@ void v_write_state(oprocessor *h_processor, char *s_pathname) /* Write processor
          for (i_count = 0; i_count < REGISTERS; i_count++)
          {
             for (i_counter = REG_SIZE - 1; i_counter >= 0 ; i_counter--)
-               fprintf(h_file, "%02x,", h_processor->reg[i_count]->nibble[i_counter]);
+               fprintf(h_file, "%02x,", NIBBLE(h_processor->reg[i_count], i_counter));
             fprintf(h_file,"\n");
          }
          fprintf(h_file, "%02x,", h_processor->p);
@@ -787,7 +1066,7 @@ void v_write_state(oprocessor *h_processor, char *s_pathname) /* Write processor
          for (i_count = 0; i_count < MEMORY_SIZE; i_count++)
          {
             for (i_counter = REG_SIZE - 1; i_counter >= 0 ; i_counter--)
-               fprintf(h_file, "%02x,", h_processor->mem[i_count]->nibble[i_counter]);
+               fprintf(h_file, "%02x,", NIBBLE(h_processor->mem[i_count], i_counter));
             fprintf(h_file,"\n");
          }
          fclose(h_file);
@@ -883,24 +1162,153 @@ char *v_get_datafile_path(oprocessor *h_processor) /* Returns path the the data
 }
 #endif
 
-void v_save_state(oprocessor *h_processor) /* Restore saved processor state */
+#if defined(SNAPSHOT)
+static char *s_datafile_type(char *s_pathname, char *s_filetype) /* Change the file type of the data file */
+{
+   char *s_datafile, *s_type;
+   if ((s_datafile = malloc(strlen(s_pathname) + strlen(s_filetype) + 1)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   strcpy(s_datafile, s_pathname);
+   s_type = strrchr(s_datafile, '.');
+   if ((s_type != NULL) && (strchr(s_type, '/') == NULL)) *s_type = 0; /* Remove the existing file type (if any) */
+   strcat(s_datafile, s_filetype);
+   return s_datafile;
+}
+#endif
+
+void v_save_state(oprocessor *h_processor) /* Save processor state */
 {
 #if defined(CONTINIOUS)
+#if defined(SNAPSHOT)
+   osnapshot o_snapshot;
+   v_take_snapshot(h_processor, &o_snapshot);
+   v_save_snapshot(h_processor, &o_snapshot);
+#else
    char *s_pathname = v_get_datafile_path(h_processor);
    v_write_state(h_processor, s_pathname); /* Save settings */
    free(s_pathname); /* Free up pathname */
 #endif
+#endif
+}
+
+#if defined(CONTINIOUS) && defined(SNAPSHOT)
+void v_save_snapshot(oprocessor *h_processor, osnapshot *h_snapshot) /* Save a snapshot of the processor state taken earlier */
+/*
+ * Only uses the processor to find the data file and any mapped memory,  so
+ * can be called by another thread while the processor is running.
+ */
+{
+   char *s_pathname = v_get_datafile_path(h_processor);
+   char *s_snapshot = s_datafile_type(s_pathname, ".snp");
+   char *s_memory = s_datafile_type(s_pathname, ".mem");
+   if (h_processor->mapped != NULL) /* Memory is already in the mapped file so just make sure it is on disk */
+      msync(h_processor->mapped, sizeof(omemoryfile), MS_SYNC);
+   if (i_write_snapshot(h_snapshot, s_snapshot) && !(h_snapshot->header.flags & SNAPSHOT_MAPPED))
+      unlink(s_memory); /* Memory is in the snapshot so any memory file is now out of date */
+   free(s_memory);
+   free(s_snapshot);
+   free(s_pathname); /* Free up pathname */
 }
+#endif
 
 void v_restore_state(oprocessor *h_processor) /* Restore saved processor state */
 {
 #if defined(CONTINIOUS)
    char *s_pathname = v_get_datafile_path(h_processor);
+#if defined(SNAPSHOT)
+   char *s_snapshot = s_datafile_type(s_pathname, ".snp");
+   char *s_memory = s_datafile_type(s_pathname, ".mem");
+   if (h_processor->mapped != NULL) /* Mapped memory is always up to date */
+      i_read_snapshot(h_processor, s_snapshot, False);
+   else if (i_isfile(s_memory)) /* A memory file is only kept while it is newer than the snapshot */
+   {
+      if (!i_read_snapshot(h_processor, s_snapshot, False)) v_read_state(h_processor, s_pathname);
+      i_read_memory(h_processor, s_memory);
+   }
+   else if (!i_read_snapshot(h_processor, s_snapshot, True)) /* Import the old data file if there is no snapshot */
+      v_read_state(h_processor, s_pathname);
+   free(s_memory);
+   free(s_snapshot);
+#else
    v_read_state(h_processor, s_pathname); /* Load settings */
+#endif
    free(s_pathname); /* Free up pathname */
 #endif
 }
 
+#if defined(CONTINIOUS)
+void v_map_memory(oprocessor *h_processor, int b_import) /* Keep memory in a memory mapped file */
+/*
+ * Maps  a file alongside the data file and points the memory registers at
+ * it so every change to memory is persistent without having to save  it,
+ * and the contents survive even if the program is killed.
+ *
+ *  - If the file is new, or 'b_import' is set because the state has  been
+ *    loaded from a file given on the command line, the current contents of
+ *    memory are copied into the file.
+ *
+ *  - Otherwise the file already holds the most recent copy of memory (the
+ *    file is removed whenever the state is saved without it, so if it is
+ *    still there it is newer than the snapshot).
+ *
+ */
+{
+#if defined(SNAPSHOT)
+   char *s_pathname = v_get_datafile_path(h_processor);
+   char *s_memory = s_datafile_type(s_pathname, ".mem");
+   omemoryfile *h_mapped;
+   struct stat o_stat;
+   int i_file, i_count;
+
+   free(s_pathname);
+   if (h_processor->mapped != NULL) return; /* Already mapped */
+   if ((i_file = open(s_memory, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0)
+      v_warning(h_err_opening_file, s_memory);
+   else
+   {
+      if (fstat(i_file, &o_stat) != 0) o_stat.st_size = -1;
+      if (o_stat.st_size == 0) /* New file */
+      {
+         b_import = True;
+         if (ftruncate(i_file, sizeof(omemoryfile)) != 0) o_stat.st_size = -1;
+         else o_stat.st_size = sizeof(omemoryfile);
+      }
+      h_mapped = MAP_FAILED;
+      if (o_stat.st_size == sizeof(omemoryfile)) /* Must be the right size for this model */
+         h_mapped = mmap(NULL, sizeof(omemoryfile), PROT_READ | PROT_WRITE, MAP_SHARED, i_file, 0);
+      if ((h_mapped != MAP_FAILED) && !b_import &&
+         (memcmp(h_mapped->header.magic, MEMORY_FILE_MAGIC, sizeof(h_mapped->header.magic)) ||
+         (h_mapped->header.version != MEMORY_FILE_VERSION) ||
+         strncmp(h_mapped->header.model, FILENAME, sizeof(h_mapped->header.model))))
+      {
+         munmap(h_mapped, sizeof(omemoryfile)); /* Not a memory file for this model so leave it alone */
+         h_mapped = MAP_FAILED;
+      }
+      if (h_mapped == MAP_FAILED)
+         v_warning(h_err_memory_file, s_memory);
+      else
+      {
+         if (b_import)
+         {
+            memset(&h_mapped->header, 0, sizeof(h_mapped->header));
+            memcpy(h_mapped->header.magic, MEMORY_FILE_MAGIC, sizeof(h_mapped->header.magic));
+            h_mapped->header.version = MEMORY_FILE_VERSION;
+            strncpy(h_mapped->header.model, FILENAME, sizeof(h_mapped->header.model) - 1);
+         }
+         for (i_count = 0; i_count < MEMORY_SIZE; i_count++)
+         {
+            if (b_import) h_mapped->memory[i_count].value = h_processor->mem[i_count]->value;
+            h_mapped->memory[i_count].id = i_count;
+            h_processor->mem[i_count] = &h_mapped->memory[i_count]; /* Use the mapped file from now on */
+         }
+         h_processor->mapped = h_mapped;
+      }
+      close(i_file); /* The mapping stays valid after the file is closed */
+   }
+   free(s_memory);
+#endif
+}
+#endif
+
 void v_processor_reset(oprocessor *h_processor) /* Reset processor */
 {
    int i_count;
@@ -909,8 +1317,9 @@ void v_processor_reset(oprocessor *h_processor) /* Reset processor */
       v_reg_copy(h_processor, h_processor->reg[i_count], NULL); /* Copying nothing to a register clears it */
    for (i_count = 0; i_count < STACK_SIZE; i_count++) /* Clear the processor stack */
       h_processor->stack[i_count] = 0;
-   for (i_count = 0; i_count < MEMORY_SIZE; i_count++) /*Clear memory */
-      v_reg_copy(h_processor, h_processor->mem[i_count], NULL); /* Copying nothing to a register clears it */
+   if (h_processor->mapped == NULL) /* Memory mapped from a file is never cleared */
+      for (i_count = 0; i_count < MEMORY_SIZE; i_count++) /*Clear memory */
+         v_reg_copy(h_processor, h_processor->mem[i_count], NULL); /* Copying nothing to a register clears it */
    for (i_count = 0; i_count < STATUS_BITS; i_count++) /* Clear the processor status word */
       h_processor->status[i_count] = False;
    for (i_count = 0; i_count < FLAGS; i_count++) /* Clear the processor flags */
@@ -924,6 +1333,9 @@ void v_processor_reset(oprocessor *h_processor) /* Reset processor */
    h_processor->base = 10;
    h_processor->code = 0;
    h_processor->keypressed = False;
+   h_processor->keyscan = False;
+   h_processor->keytest = False;
+   h_processor->idle = ROM_SIZE; /* No keyboard test seen yet */
    h_processor->enabled = True;
    h_processor->sleep = False;
 #if defined(WOODSTOCK) || defined(SPICE) || defined(HP10) || defined(HP67)
@@ -948,20 +1360,48 @@ void v_processor_reset(oprocessor *h_processor) /* Reset processor */
 #endif
 }
 
-oprocessor *h_processor_create(int *h_rom) /* Create a new processor 'object' */
+static oprocessor *h_fatal_processor = NULL; /* Processor whose history is written if the program is about to end unexpectedly */
+
+oprocessor *h_processor_create(const unsigned short *h_rom) /* Create a new processor 'object' */
 {
    oprocessor *h_processor;
    int i_count;
+#if defined(CACHE_LINE)
+   void *h_memory = NULL;
+   if (posix_memalign(&h_memory, CACHE_LINE, sizeof(*h_processor)) != 0) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   h_processor = h_memory; /* Aligned to a cache line */
+#else
    if ((h_processor = malloc(sizeof(*h_processor)))==NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+#endif
+   memset(h_processor->store, 0, sizeof(h_processor->store)); /* Clear registers and memory */
    for (i_count = 0; i_count < REGISTERS; i_count++)
-      h_processor->reg[i_count] = h_register_create((i_count + 1) * -1); /* Allocate storage for the registers */
+   {
+      h_processor->reg[i_count] = &h_processor->store[i_count]; /* Registers are at the start of the block */
+      h_processor->reg[i_count]->id = (i_count + 1) * -1;
+   }
    for (i_count = 0; i_count < MEMORY_SIZE; i_count++)
-      h_processor->mem[i_count] = h_register_create(i_count); /* Allocate storage for the RAM */
+   {
+      h_processor->mem[i_count] = &h_processor->store[REGISTERS + i_count]; /* Followed by the RAM */
+      h_processor->mem[i_count]->id = i_count;
+   }
+   h_processor->mapped = NULL; /* Memory isn't mapped from a file */
    h_processor->rom = h_rom ; /* Address of ROM */
+   h_processor->overlay = NULL; /* Only needed if the ROM is changed */
+   h_processor->image = NULL; /* No ROM image mapped from a file */
+   if ((h_processor->decoded = malloc(sizeof(*h_processor->decoded) * ROM_SIZE)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   v_processor_decode(h_processor);
    h_processor->mode = False;
    h_processor->timer = False;
    h_processor->trace = False;
    h_processor->step = False;
+   h_processor->ticks = 0;
+   h_processor->writes = 0;
+   memset(h_processor->breakpoints, 0, sizeof(h_processor->breakpoints)); /* No breakpoints or traps */
+   memset(h_processor->traps, 0, sizeof(h_processor->traps));
+   h_processor->profile = NULL; /* Not profiling */
+   h_processor->history = NULL; /* Not recording */
+   h_processor->record = False;
+   h_processor->output = stdout;
    v_processor_reset(h_processor);
 #if defined(HP10)
    h_processor->print = MANUAL;
@@ -969,6 +1409,21 @@ oprocessor *h_processor_create(int *h_rom) /* Create a new processor 'object' */
    return(h_processor);
 }
 
+void v_processor_free(oprocessor *h_processor) /* Free a processor 'object' */
+{
+#if defined(SNAPSHOT)
+   if (h_processor->mapped != NULL) munmap(h_processor->mapped, sizeof(omemoryfile));
+   if (h_processor->image != NULL) munmap(h_processor->image, sizeof(*h_processor->image));
+#endif
+   free(h_processor->overlay);
+   free(h_processor->decoded);
+   if (h_processor->profile != NULL) free(h_processor->profile->context);
+   free(h_processor->profile);
+   if (h_fatal_processor == h_processor) h_fatal_processor = NULL;
+   free(h_processor->history);
+   free(h_processor);
+}
+
 #if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
 static unsigned char *h_active_pointer (oprocessor *h_processor) /* Return address of active pointer */
 {
@@ -1066,6 +1521,7 @@ void op_jsb(oprocessor *h_processor, int i_address) /* Call to subroutine */
    h_processor->stack[h_processor->sp] = h_processor->pc; /* Push current address on the stack */
    h_processor->sp = (h_processor->sp + 1) & (STACK_SIZE - 1); /* Update stack pointer */
    h_processor->pc = i_address; /* Long address */
+   if (h_processor->profile != NULL) v_profile_call(h_processor);
 }
 
 #else
@@ -1086,25 +1542,29 @@ void op_jsb(oprocessor *h_processor, int i_address) /* Jump to subroutine */
    h_processor->sp = (h_processor->sp + 1) & (STACK_SIZE - 1); /* Update stack pointer */
    h_processor->pc = ((h_processor->pc & 0xff00) | i_address); /* Note - Uses an eight bit address */
    v_delayed_rom(h_processor);
+   if (h_processor->profile != NULL) v_profile_call(h_processor);
 }
 #endif
 
 
-void v_op_goto(oprocessor *h_processor) /* Conditional go to */
+#if defined(__GNUC__)
+static inline void v_op_goto(oprocessor *h_processor, const int b_trace) __attribute__ ((always_inline));
+#endif
+static inline void v_op_goto(oprocessor *h_processor, const int b_trace) /* Conditional go to */
 {
-   if (h_processor->trace)
+   if (b_trace)
    {
-      fprintf(stdout, "\n"); fprintf(stdout,h_msg_opcode, (h_processor->pc >> 12), (h_processor->pc & 0x0fff), h_processor->rom[h_processor->pc]);
-      fprintf(stdout,"  then go to ");
+      fprintf(h_processor->output, "\n"); fprintf(h_processor->output,h_msg_opcode, (h_processor->pc >> 12), (h_processor->pc & 0x0fff), h_processor->rom[h_processor->pc]);
+      fprintf(h_processor->output,"  then go to ");
    }
    h_processor->flags[PREV_CARRY] = h_processor->flags[CARRY];
    h_processor->flags[CARRY] = False;
 #if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
-   if (h_processor->trace) fprintf(stdout, h_msg_address, (h_processor->pc & 0xf00) | (h_processor->rom[h_processor->pc]) >> 2); /* Mask off the bank number and least significant 8 bits*/
+   if (b_trace) fprintf(h_processor->output, h_msg_address, (h_processor->pc & 0xf00) | (h_processor->rom[h_processor->pc]) >> 2); /* Mask off the bank number and least significant 8 bits*/
    if (h_processor->flags[PREV_CARRY])  /* Do if True */
       h_processor->pc = (h_processor->pc & 0xff00) | h_processor->rom[h_processor->pc] >> 2; /* Classic CPU uses a _eight_ bit address */
 #else
-   if (h_processor->trace) fprintf(stdout, h_msg_address, ((h_processor->pc & 0xc00) | h_processor->rom[h_processor->pc] )); /* Mask off the bank number and least significant 10 bits */
+   if (b_trace) fprintf(h_processor->output, h_msg_address, ((h_processor->pc & 0xc00) | h_processor->rom[h_processor->pc] )); /* Mask off the bank number and least significant 10 bits */
    if (h_processor->flags[PREV_CARRY])  /* Do if True */
       h_processor->pc = ((h_processor->pc & 0xfc00) | h_processor->rom[h_processor->pc]); /* Use a _ten_ bit address */
 #endif
@@ -1112,2332 +1572,3508 @@ void v_op_goto(oprocessor *h_processor) /* Conditional go to */
       v_op_inc_pc(h_processor);
 }
 
-void v_processor_tick(oprocessor *h_processor) /* Decode and execute a single instruction */
-{
-#if defined(WOODSTOCK) || defined(SPICE) || defined(HP10) || defined(HP67)
-   static const int i_set_p[16] = { 14,  4,  7,  8, 11,  2, 10, 12,  1,  3, 13,  6,  0,  9,  5, 14 };
-   static const int i_tst_p[16] = { 4 ,  8, 12,  2,  9,  1,  6,  3,  1, 13,  5,  0, 11, 10,  7,  4 };
-#endif
-
 #if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
-/* static const int n_map_i[16] = {  3,  4,  5, 10,  8,  6, 11, -1,  2,  9,  7, 13,  1, 12,  0, -1 }; /* map nnnn to index */
-   static const int n_map_i[16] = {  3,  4,  5, 10,  8,  6, 11, 15,  2,  9,  7, 13,  1, 12,  0, 15 }; /* map nnnn to index */
+#if defined(__GNUC__)
+static inline void v_op_branch(oprocessor *h_processor, unsigned int i_address, const int b_trace) __attribute__ ((always_inline));
 #endif
-
-   unsigned int i_last; /* Save the current PC */
-   unsigned int i_opcode;
-   unsigned int i_field; /* Field modifier */
-   const char *s_field; /* Holds pointer to field name */
-
-   if (h_processor->enabled && !h_processor->sleep)
+static inline void v_op_branch(oprocessor *h_processor, unsigned int i_address, const int b_trace) /* Skip the second word of a branch */
+{
+   if (b_trace)
    {
+      fprintf(h_processor->output, "\n");
+      fprintf(h_processor->output, h_msg_opcode, (h_processor->pc >> 12), (h_processor->pc & 0x0fff), h_processor->rom[h_processor->pc]);
+      fprintf(h_processor->output,"  ");
+      fprintf(h_processor->output, h_msg_address, i_address);
+   }
+   h_processor->flags[CARRY] = h_processor->flags[PREV_CARRY]; /* Save carry */
+   v_op_inc_pc(h_processor); /* Increment program counter */
+}
 
-#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
-      /* TIMER : status[11] = 1, status[3] = 0
-       * PRGM  : status[11] = 0, status[3] = 1
-       * RUN   : status[11] = 0, status[3] = 0 */
-      if (h_processor->keypressed) h_processor->status[0] = True; /* Set status bit 0 if key pressed */
-      if (h_processor->mode) h_processor->status[3] = True; /* Set status bits based on switch position */
-      if (h_processor->timer) h_processor->status[11] = True;
+static void v_fprint_offset(FILE *h_file, unsigned int i_opcode) /* Print the offset of a relative jump */
+{
+   int i_offset;
+   i_offset = i_opcode >> 3;
+   if (i_offset >= 0x40) i_offset = i_offset - 128; /* Fixed relative jump offset */
+   if (i_offset < 0)
+      fprintf(h_file, h_msg_negative_offset, abs(i_offset));
+   else
+      fprintf(h_file, h_msg_positive_offset , abs(i_offset));
+}
 #endif
 
-#if defined(HP21) || defined(HP22) || defined(HP25) || defined(HP25c) || defined(HP27) || defined(HP29c)
-      if (h_processor->keypressed) h_processor->status[15] = True; /* Set status bit if key pressed */
-      if (h_processor->mode) h_processor->status[3] = True; /* Set status bits based on switch position */
-      h_processor->status[5] = True; /* Low Power */
+#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
+#define KEY_STATUS      0              /* Status bit set when a key is pressed */
+#elif defined(WOODSTOCK) || defined(SPICE) || defined(HP10) || defined(HP67)
+#define KEY_STATUS      15
 #endif
 
-#if defined(HP67) /* Seems to use a flag rather then the status word for the switch position */
-      if (h_processor->keypressed) h_processor->status[15] = True; /* Set status bit 15 if key pressed */
-      h_processor->flags[MODE] = h_processor->mode; /* Set the program mode flag based on switch position */
+#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
+/* Select field
+   000   P  : determined by P                   [P]
+   001   M  : mantissa                          [3 .. 12]
+   010   X  : exponent                          [0 ..  1]
+   011   W  : word                              [0 .. 13]
+   100  WP  : word up to and including P        [0 ..  P]
+   101  MS  : mantissa and sign                 [3 .. 13]
+   110  XS  : exponent sign                     [2]
+   111   S  : sign                              [13] */
+static const char *s_field_name[8] = { "p", "m", "x", "w", "wp", "ms", "xs", "s" };
+static const signed char i_field_first[8] = { -1, EXP_SIZE, 0, 0, -1, EXP_SIZE, EXP_SIZE - 1, REG_SIZE - 1 };
+static const signed char i_field_last[8] = { -1, REG_SIZE - 2, EXP_SIZE - 1, REG_SIZE - 1, -1, REG_SIZE - 1, EXP_SIZE - 1, REG_SIZE - 1 };
 #endif
 
-#if defined(HP31e) || defined(HP32e) || defined(HP33e) || defined(HP33c) || defined(HP34c) || defined(HP37e) || defined(HP38e) || defined(HP38c) /* Setting S(5) breaks the self test */
-      if (h_processor->keypressed) h_processor->status[15] = True; /* Set status bit if key pressed */
-      if (h_processor->mode) h_processor->status[3] = True; /* Set status bits based on switch position */
-      h_processor->status[5] = False; /* Self Test */
+#if defined(WOODSTOCK) || defined(SPICE) || defined(HP10) || defined(HP67)
+/* Select field
+   000   P  : determined by P                   [P]
+   001  WP  : word up to and including P        [0 ..  P]
+   010  XS  : exponent sign                     [2]
+   011   X  : exponent                          [0 ..  1]
+   100   S  : sign                              [13]
+   101   M  : mantissa                          [3 .. 12]
+   110   W  : word                              [0 .. 13]
+   111  MS  : mantissa and sign                 [3 .. 13] */
+static const char *s_field_name[8] = { "p", "wp", "xs", "x", "s", "m", "w", "ms" };
+static const signed char i_field_first[8] = { -1, -1, EXP_SIZE - 1, 0, REG_SIZE - 1, EXP_SIZE, 0, EXP_SIZE };
+static const signed char i_field_last[8] = { -1, -1, EXP_SIZE - 1, EXP_SIZE - 1, REG_SIZE - 1, REG_SIZE - 2, REG_SIZE - 1, REG_SIZE - 1 };
 #endif
 
 #if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
-      if (h_processor->keypressed) h_processor->kyf = True; /* Set keyboard flag if key pressed */
+/* Select field
+   000   R  : determined by active pointer            [R]
+   001 S+X  : exponent and sign                       [0 .. 2]
+   010  WR  : word up to and including active pointer [0 ..  P]
+   011   W  : word                                    [0 .. 13]
+   100 P-Q  : word from P up to and including Q       [P .. Q]
+   101  XS  : exponent sign only                      [2]
+   110   M  : mantissa                                [3 .. 12]
+   111   S  : sign                                    [13] */
+static const char *s_field_name[8] = { "pt", "x", "wpt", "all", "pq", "xs", "m", "s" };
+static const signed char i_field_first[8] = { -1, 0, -1, 0, -1, EXP_SIZE - 1, EXP_SIZE, REG_SIZE - 1 };
+static const signed char i_field_last[8] = { -1, EXP_SIZE - 1, -1, REG_SIZE - 1, -1, EXP_SIZE - 1, REG_SIZE - 2, REG_SIZE - 1 };
 #endif
 
-      i_opcode = h_processor->rom[h_processor->pc]; /* Get next instruction */
-      i_last = h_processor->pc;
-      if (h_processor->trace)
-         fprintf(stdout, h_msg_opcode, (i_last >> 12), (i_last & 0x0fff), h_processor->rom[i_last]);
-      v_op_inc_pc(h_processor); /* Increment program counter _before_ decoding the opcode */
-      switch (i_opcode & 03)
-      {
+/* Each instruction is decoded into the handler that executes it, arithmetic
+   operations are handled by their own operation code, everything else has a
+   handler of its own */
+#define ARITHMETIC             32             /* Handlers below this are arithmetic operations */
 
 #if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
-      case 00: /* Type 0 - Special operations */
-         switch ((i_opcode >> 2) & 03)
-         {
-         case 00: /* Op-Codes matching x xxx xx 00 00 */
-            switch ((i_opcode >> 4) & 03)
-            {
-            case 00:  /* Op-Codes matching x xxx 000 000 */
-               switch (i_opcode)
-               {
-               case 00000: /* nop */
-                  if (h_processor->trace) fprintf(stdout, "nop");
-                  break;
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            case 01: /* Op-Codes matching x xxx 010 000 */
-               switch ((i_opcode >> 6) & 01)
-               {
-               case 00: /* Op-Codes matching x xx0 010 000 */ /* select rom */
-                  if (h_processor->trace) fprintf(stdout, "select rom %02o", i_opcode >> 7); /* Note - Not the same as the Woodstock CPU */
-                  h_processor->pc = ((i_opcode >> 7) << 8) + ((h_processor->pc) & 0xff);
-                  break;
-               case 01: /* keys -> rom address */
-                  if (h_processor->trace) fprintf(stdout, "keys -> rom address");
-                  h_processor->pc &= 0xff00;
-                  v_delayed_rom(h_processor);
-                  h_processor->pc += h_processor->code;
-                  break;
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            case 02: /* Op-Codes matching x xxx 100 000 */
-               switch (i_opcode)
-               {
-               case 0:
-                  break;
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            case 03: /* Op-Codes matching x xxx 110 000 */
-               switch (i_opcode)
-               {
-               case 00060: /* return */
-                  if (h_processor->trace) fprintf(stdout, "return");
-                  h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
-                  h_processor->pc = (h_processor->pc & (~0xff)) + (h_processor->stack[h_processor->sp] & 0xff); /* Pop program counter from the stack */
-                  break;
-               case 01160: /* c -> data address */
-                  {
-                     int i_addr;
-                     if (h_processor->trace) fprintf(stdout, "c -> data address\t");
-                     i_addr = h_processor->reg[C_REG]->nibble[12];
-                     h_processor->addr = i_addr;
-                     if (i_addr < MEMORY_SIZE)
-                        h_processor->addr = i_addr;
-                     else {
-                        h_processor->addr = MEMORY_SIZE - 1;
-                     }
-                  }
-                  if (h_processor->trace) fprintf(stdout, "addr = %d", h_processor->addr);
-                  break;
-               case 01360: /* c -> data */
-                  if (h_processor->trace) fprintf(stdout, "c -> data\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  if (h_processor->addr < MEMORY_SIZE)
-                     v_reg_copy(h_processor, h_processor->mem[h_processor->addr], h_processor->reg[C_REG]);
-                  else
-                  {
-                     if (h_processor->trace) fprintf(stdout, "\n");
-                     v_error(errno, h_err_invalid_register, h_processor->addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-                  }
-                  if (h_processor->trace) v_fprint_register(stdout,h_processor->mem[h_processor->addr]);
-                  break;
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            }
-            break;
-         case 01: /* Op-Codes matching x xxx xx 01 00 */
-            switch ((i_opcode >> 4) & 03)
-            {
-            case 00: /* 1 -> s(n) */
-               if (h_processor->trace) fprintf(stdout, "1 -> s(%d)\t\t", i_opcode >> 6);
-               h_processor->status[i_opcode >> 6] = True;
-               if (h_processor->trace) v_fprint_status(stdout, h_processor);
-               break;
-            case 01: /* if 0 = s(n) */
-               if (h_processor->trace) fprintf(stdout, "if 0 = s(%d) ", i_opcode >> 6);
-               h_processor->flags[CARRY] = !h_processor->status[i_opcode >> 6];
-               v_op_goto(h_processor);
-               break;
-            case 02: /* 0 -> s(n) */
-               if (h_processor->trace) fprintf(stdout, "0 -> s(%d)\t\t", i_opcode >> 6);
-               h_processor->status[i_opcode >> 6] = False;
-               if (h_processor->trace) v_fprint_status(stdout, h_processor);
-               break;
-            case 03: /* delayed select rom n */
-               switch (i_opcode)
-               {
-               case 00064: /* clear status */
-                  if (h_processor->trace) fprintf(stdout, "clear status\t");
-                  {
-                     int i_count;
-                     for (i_count = 0; i_count < sizeof(h_processor->status) / sizeof(*h_processor->status); i_count++)
-                        h_processor->status[i_count] = False; /* Clear all bits */
-                  }
-                  if (h_processor->trace) v_fprint_status(stdout, h_processor);
-                  break;
-               case 01064: /*delayed select */
-               case 01264: /*delayed select */
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-                  break;
-               default: /* delayed select rom n */
-                  if (h_processor->trace) fprintf(stdout, "delayed select rom %d", i_opcode >> 7); /* Note - Not the same as the Woodstock CPU */
-                  h_processor->rom_number = i_opcode >> 7;
-                  h_processor->flags[DELAYED_ROM] = True;
-               }
-               break;
-            }
-            break;
-
-         case 02: /* Op-Codes matching x xx xx 10 00 */
-            switch ((i_opcode >> 4) & 03)
-            {
-            case 01: /* Op-Codes matching xx xx 01 10 00 */ /* load constant n */
-               if (h_processor->trace) fprintf(stdout, "load constant %d\t", i_opcode >> 6);
-               h_processor->reg[C_REG]->nibble[h_processor->p] = i_opcode >> 6;
-               v_op_dec_p(h_processor);
-               if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-               break;
-            case 02: /* Op-Codes matching x xx 10 10 00 */
-               switch (i_opcode)
-               {
-               case 00050: /* display toggle */
-                  if (h_processor->trace) fprintf(stdout, "display toggle");
-                  h_processor->flags[DISPLAY_ENABLE] = (!h_processor->flags[DISPLAY_ENABLE]);
-                  break;
-               case 00250: /* m exch c */
-                  if (h_processor->trace) fprintf(stdout, "m exch c\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_exch(h_processor, h_processor->reg[M_REG], h_processor->reg[C_REG]);
-                  if (h_processor->trace)
-                  {
-                     v_fprint_register(stdout,h_processor->reg[C_REG]);
-                     v_fprint_register(stdout,h_processor->reg[M_REG]);
-                  }
-                  break;
-               case 00450: /* c -> stack */
-                  if (h_processor->trace) fprintf(stdout, "c -> stack\t\t");
-                     h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                     v_reg_copy(h_processor, h_processor->reg[T_REG], h_processor->reg[Z_REG]); /* T = Z */
-                     v_reg_copy(h_processor, h_processor->reg[Z_REG], h_processor->reg[Y_REG]); /* T = Z */
-                     v_reg_copy(h_processor, h_processor->reg[Y_REG], h_processor->reg[C_REG]); /* T = Z */
-                     if (h_processor->trace)
-                     {
-                        v_fprint_register(stdout,h_processor->reg[Y_REG]);
-                        v_fprint_register(stdout,h_processor->reg[Z_REG]);
-                        v_fprint_register(stdout,h_processor->reg[T_REG]);
-                     }
-                  break;
-               case 00650: /* stack -> a */
-                  if (h_processor->trace) fprintf(stdout, "stack -> a\t\t");
-                     h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                     v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[Y_REG]); /* T = Z */
-                     v_reg_copy(h_processor, h_processor->reg[Y_REG], h_processor->reg[Z_REG]); /* T = Z */
-                     v_reg_copy(h_processor, h_processor->reg[Z_REG], h_processor->reg[T_REG]); /* T = Z */
-                     if (h_processor->trace)
-                     {
-                        v_fprint_register(stdout,h_processor->reg[A_REG]);
-                        v_fprint_register(stdout,h_processor->reg[Y_REG]);
-                        v_fprint_register(stdout,h_processor->reg[Z_REG]);
-                     }
-                  break;
-               case 01050: /* display off */
-                  if (h_processor->trace) fprintf(stdout, "display off");
-                  h_processor->flags[DISPLAY_ENABLE] = False;
-                  break;
-               case 01250: /* m -> c */
-                  if (h_processor->trace) fprintf(stdout, "m -> c\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[M_REG]);
-                  if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-                  break;
-               case 01450: /* down rotate */
-                  if (h_processor->trace) fprintf(stdout, "down rotate\t\t");
-                     h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                     v_reg_exch(h_processor, h_processor->reg[T_REG], h_processor->reg[C_REG]); /* T <> C - C to T */
-                     v_reg_exch(h_processor, h_processor->reg[C_REG], h_processor->reg[Y_REG]); /* C <> Y - Y to C */
-                     v_reg_exch(h_processor, h_processor->reg[Y_REG], h_processor->reg[Z_REG]); /* Y <> Z - Z to Y and T ends up in Z */
-                     if (h_processor->trace)
-                     {
-                        v_fprint_register(stdout,h_processor->reg[C_REG]);
-                        v_fprint_register(stdout,h_processor->reg[Y_REG]);
-                        v_fprint_register(stdout,h_processor->reg[Z_REG]);
-                        v_fprint_register(stdout,h_processor->reg[T_REG]);
-                     }
-                  break;
-               case 01650: /* clear registers */
-                  if (h_processor->trace) fprintf(stdout, "clear registers");
-                  {
-                     int i_count;
-                     h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                     for (i_count = 0; i_count < REGISTERS - 2; i_count++) /* Don't clear M or N */
-                        v_reg_copy(h_processor, h_processor->reg[i_count], NULL); /* Copying nothing to a register clears it */
-                  }
-                  break;
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            case 03: /* Op-Codes matching x xx 10 10 00 */
-               switch (i_opcode)
-               {
-               case 01360: /* c -> data */
-                  if (h_processor->trace) fprintf(stdout, "c -> data\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  if (h_processor->addr < MEMORY_SIZE)
-                     v_reg_copy(h_processor, h_processor->mem[h_processor->addr], h_processor->reg[C_REG]);
-                  else
-                  {
-                     if (h_processor->trace) fprintf(stdout, "\n");
-                     v_error(errno, h_err_invalid_register, h_processor->addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-                  }
-                  if (h_processor->trace) v_fprint_register(stdout,h_processor->mem[h_processor->addr]);
-                  break;
-               case 01370: /* data -> c */
-                  if (h_processor->trace) fprintf(stdout, "data -> c\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->mem[h_processor->addr]);
-                  if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-                  break;
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            default:
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
+#define OP_NOP                 32
+#define OP_SELECT_ROM          33
+#define OP_KEYS_TO_ROM         34
+#define OP_RETURN              35
+#define OP_C_TO_ADDR           36
+#define OP_C_TO_DATA           37
+#define OP_SET_S               38
+#define OP_TEST_S0             39
+#define OP_CLEAR_S             40
+#define OP_CLEAR_STATUS        41
+#define OP_DELAYED_ROM         42
+#define OP_LOAD_CONSTANT       43
+#define OP_DISPLAY_TOGGLE      44
+#define OP_M_EXCH_C            45
+#define OP_C_TO_STACK          46
+#define OP_STACK_TO_A          47
+#define OP_DISPLAY_OFF         48
+#define OP_M_TO_C              49
+#define OP_DOWN_ROTATE         50
+#define OP_CLEAR_REGISTERS     51
+#define OP_DATA_TO_C           52
+#define OP_SET_P               53
+#define OP_DEC_P               54
+#define OP_TEST_P_NE           55
+#define OP_INC_P               56
+#define OP_JSB                 57
+#define OP_GO_TO               58
+#define OP_UNEXPECTED          59
+#define HANDLERS               60             /* Number of handlers */
 
-         case 03: /* Op-Codes matching xx xx xx 11 00 */
-            switch ((i_opcode >> 4) & 03)
-            {
-            case 00: /* Op-Codes matching xx xx 00 11 00 */ /* n -> p */
-               if (h_processor->trace) fprintf(stdout, "%d -> p", i_opcode >> 6);
-               h_processor->p = i_opcode >> 6;
-               break;
-            case 01: /* Op-Codes matching xx xx 01 11 00 */ /* p - 1 -> p */
-               if (h_processor->trace) fprintf(stdout, "p - 1 -> p");
-               v_op_dec_p(h_processor);
-               break;
-            case 02: /* Op-Codes matching xx xx 10 11 00 */ /* if p != n */
-               if (h_processor->trace) fprintf(stdout, "if p != %d", i_opcode >> 6);
-               h_processor->flags[CARRY] = (h_processor->p != i_opcode >> 6);
-               v_op_goto(h_processor);
-               break;
-            case 03: /* Op-Codes matching xx xx 11 11 00 */ /* p + 1 -> p */
-               if (h_processor->trace) fprintf(stdout, "p + 1 -> p");
-               v_op_inc_p(h_processor);
-               break;
-            default:
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
-         default:
-            if (h_processor->trace) fprintf(stdout, "\n");
-            v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-         }
-         break;
+static unsigned char i_special(unsigned int i_opcode, unsigned char *h_arg) /* Find the handler for a special operation */
+{
+   *h_arg = i_opcode >> 6;
+   switch (i_opcode) /* Op-codes with no operand */
+   {
+   case 00000: return OP_NOP;
+   case 00060: return OP_RETURN;
+   case 01160: return OP_C_TO_ADDR;
+   case 01360: return OP_C_TO_DATA;
+   case 00064: return OP_CLEAR_STATUS;
+   case 01064: /* delayed select */
+   case 01264: return OP_UNEXPECTED;
+   case 00050: return OP_DISPLAY_TOGGLE;
+   case 00250: return OP_M_EXCH_C;
+   case 00450: return OP_C_TO_STACK;
+   case 00650: return OP_STACK_TO_A;
+   case 01050: return OP_DISPLAY_OFF;
+   case 01250: return OP_M_TO_C;
+   case 01450: return OP_DOWN_ROTATE;
+   case 01650: return OP_CLEAR_REGISTERS;
+   case 01370: return OP_DATA_TO_C;
+   }
+   switch (i_opcode & 077) /* Op-codes with an operand in the top bits */
+   {
+   case 020: /* select rom or keys -> rom address */
+      *h_arg = i_opcode >> 7; /* Note - Not the same as the Woodstock CPU */
+      return (i_opcode & 0100) ? OP_KEYS_TO_ROM : OP_SELECT_ROM;
+   case 004: return OP_SET_S;
+   case 024: return OP_TEST_S0;
+   case 044: return OP_CLEAR_S;
+   case 064:
+      *h_arg = i_opcode >> 7;
+      return OP_DELAYED_ROM;
+   case 030: return OP_LOAD_CONSTANT;
+   case 014: return OP_SET_P;
+   case 034: return OP_DEC_P;
+   case 054: return OP_TEST_P_NE;
+   case 074: return OP_INC_P;
+   }
+   return OP_UNEXPECTED;
+}
 #endif
 
 #if defined(WOODSTOCK) || defined(SPICE) || defined(HP10) || defined(HP67)
-      case 00: /* Type 0 - Special operations */
-         switch ((i_opcode >> 2) & 03)
-         {
-         case 00: /* Op-Codes matching x xxx xx0 000 */
-            switch ((i_opcode >> 4) & 03)
-            {
-            case 00: /* Op-Codes matching x xxx 000 000 */
-               switch (i_opcode)
-               {
-               case 00000: /* nop */
-                  if (h_processor->trace) fprintf(stdout, "nop");
-                  break;
+#define OP_NOP                 32
+#define OP_TEST_MOTOR          33
+#define OP_TEST_MODE           34
+#define OP_SET_KEY_FLAG        35
+#define OP_TEST_KEY_FLAG       36
+#define OP_SET_FUNCTION_FLAG   37
+#define OP_TEST_FUNCTION_FLAG  38
+#define OP_SET_MERGE_FLAG      39
+#define OP_TEST_MERGE_FLAG     40
+#define OP_SET_PAUSE_FLAG      41
+#define OP_TEST_PAUSE_FLAG     42
+#define OP_CARD_READ_WRITE     43
+#define OP_KEYS_TO_ROM         44
+#define OP_KEYS_TO_A           45
+#define OP_A_TO_ROM            46
+#define OP_RESET_TWF           47
+#define OP_BINARY              48
+#define OP_ROTATE_LEFT_A       49
+#define OP_DEC_P               50
+#define OP_INC_P               51
+#define OP_RETURN              52
+#define OP_PIK1120             53
+#define OP_PIK1220             54
+#define OP_PIK1320             55
+#define OP_PIK1720             56
+#define OP_SELECT_ROM          57
+#define OP_SET_DISPLAY_DIGITS  58
+#define OP_TEST_DISPLAY_DIGITS 59
+#define OP_MOTOR_ON            60
+#define OP_MOTOR_OFF           61
+#define OP_TEST_CARD           62
+#define OP_SET_WRITE_MODE      63
+#define OP_SET_READ_MODE       64
+#define OP_BANK_SWITCH         65
+#define OP_C_TO_ADDR           66
+#define OP_CLEAR_DATA          67
+#define OP_C_TO_DATA           68
+#define OP_PIK1660             69
+#define OP_ROM_CHECKSUM        70
+#define OP_HI_WOODSTOCK        71
+#define OP_SET_S               72
+#define OP_TEST_S1             73
+#define OP_TEST_P              74
+#define OP_DELAYED_ROM         75
+#define OP_CLEAR_REGISTERS     76
+#define OP_CLEAR_STATUS        77
+#define OP_DISPLAY_TOGGLE      78
+#define OP_DISPLAY_OFF         79
+#define OP_M_EXCH_C            80
+#define OP_M_TO_C              81
+#define OP_N_EXCH_C            82
+#define OP_N_TO_C              83
+#define OP_STACK_TO_A          84
+#define OP_DOWN_ROTATE         85
+#define OP_Y_TO_A              86
+#define OP_C_TO_STACK          87
+#define OP_DECIMAL             88
+#define OP_F_TO_A              89
+#define OP_F_EXCH_A            90
+#define OP_LOAD_CONSTANT       91
+#define OP_C_TO_REGISTER       92
+#define OP_DATA_TO_C           93
+#define OP_CLEAR_S             94
+#define OP_TEST_S0             95
+#define OP_TEST_P_NE           96
+#define OP_SET_P               97
+#define OP_JSB                 98
+#define OP_GO_TO               99
+#define OP_UNEXPECTED          100
+#define HANDLERS               101            /* Number of handlers */
+
+static const unsigned char i_set_p[16] = { 14,  4,  7,  8, 11,  2, 10, 12,  1,  3, 13,  6,  0,  9,  5, 14 };
+static const unsigned char i_tst_p[16] = { 4 ,  8, 12,  2,  9,  1,  6,  3,  1, 13,  5,  0, 11, 10,  7,  4 };
+
+static unsigned char i_special(unsigned int i_opcode, unsigned char *h_arg) /* Find the handler for a special operation */
+{
+   *h_arg = i_opcode >> 6;
+   switch (i_opcode) /* Op-codes with no operand */
+   {
+   case 00000: return OP_NOP;
 #if defined(HP67)
-               /*
-                * 00100   Test ready
-                * 00300   Test W/PGM switch
-                * 00400   Set key pressed
-                * 00500   Test if a key was pressed
-                * 01000   Set default function keys
-                * 01100   Test if default function keys set
-                * 01200   Set merge flag
-                * 01300   Test merge flag
-                * 01400   Set waiting for card side 2 flag
-                * 01500   Test waiting for card side 2 flag
-                * 01700   Read/Write data to/from card via RAM $99 and $9B
-                */
-               case 00100: /* test motor on */
-                  if (h_processor->trace) fprintf(stdout, "test motor on");
-                  h_processor->status[3] = True; /* device always ready */
-                  h_processor->crc[CARD] = False;
-                  break;
-               case 00300: /* test mode flag */
-                  if (h_processor->trace) fprintf(stdout, "test mode flag (%d)", !h_processor->flags[MODE] );
-                  h_processor->status[3] = !h_processor->flags[MODE]; /* Test the PRGM/RUN switch */
-                  break;
-               case 00400: /* set key pressed flag */
-                  if (h_processor->trace) fprintf(stdout, "set key pressed flag");
-                  h_processor->crc[ANYKEY] = True; /* Sets the any key pressed flag */
-                  break;
-               case 00500: /* test key pressed flag */ /* f -x- */
-                  if (h_processor->trace) fprintf(stdout, "test key pressed flag");
-                  h_processor->status[3] = h_processor->crc[ANYKEY];
-                  if (h_processor->crc[ANYKEY]) h_processor->crc[ANYKEY] = False;
-                  break;
-               case 01000: /* set default function flag */
-                  if (h_processor->trace) fprintf(stdout, "set flag 4");
-                  h_processor->crc[FUNCTION] = True;
-                  break;
-               case 01100: /* test default function key flag */
-                  if (h_processor->trace) fprintf(stdout, "test flag 4");
-                  h_processor->status[3] = h_processor->crc[FUNCTION];
-                  if (h_processor->crc[FUNCTION]) h_processor->crc[FUNCTION] = False;
-                  break;
-               case 01200: /* set merge flag */
-                  if (h_processor->trace) fprintf(stdout, "set merge flag");
-                  h_processor->crc[MERGE] = True;
-                  break;
-               case 01300: /* test merge flag */
-                  if (h_processor->trace) fprintf(stdout, "clear flag 0");
-                  h_processor->status[3] = h_processor->crc[MERGE];
-                  if (h_processor->crc[MERGE]) h_processor->crc[MERGE] = False;
-                  break;
-               case 01400: /* set waiting flag */
-                  if (h_processor->trace) fprintf(stdout, "clear waiting flag");
-                  h_processor->crc[PAUSE] = True;
-                  break;
-               case 01500: /* test pause flag ? */
-                  if (h_processor->trace) fprintf(stdout, "clear flag 1");
-                  h_processor->status[3] = h_processor->crc[PAUSE];
-                  if (h_processor->crc[PAUSE]) h_processor->crc[PAUSE] = False;
-                  break;
-               case 01700: /* read from or write to card */
-                  if (h_processor->trace) fprintf(stdout, "card read write");
-                  h_processor->status[3] = h_processor->crc[PAUSE];
-                  if (h_processor->crc[PAUSE]) h_processor->crc[PAUSE] = False;
-                  break;
-#endif
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            case 01: /* Op-Codes matching x xxx 010 000 */
-               switch (i_opcode)
-               {
-               case 00020: /* keys -> rom address (0 000 010 000) */
-                  if (h_processor->trace) fprintf(stdout, "keys -> rom address");
-                  h_processor->pc &= 0xff00;
-                  v_delayed_rom(h_processor);
-                  h_processor->pc += h_processor->code;
-                  break;
-               case 00120: /* keys -> a[2:1] (0 001 010 000) */
-                  if (h_processor->trace) fprintf(stdout, "keys -> a\t\t");
-                  /* The HP10 and HP19C use this to get the state of the printer mode switch */
-#if defined(HP10)
-                  /* HP10 - All = 1, Print = 2 (print with display off), Display = 4 */
-                  /* HP19C/97 - Trace = 1, Normal = 2 (print with display off), Manual = 4 */
-                  h_processor->reg[A_REG]->nibble[1] = h_processor->print;
-#else
-                  h_processor->reg[A_REG]->nibble[2] = (h_processor->code >> 4); /* Put keycode in A_REG */
-                  h_processor->reg[A_REG]->nibble[1] = (h_processor->code & 0x0f);
-#endif
-                  if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-                  break;
-               case 00220: /* a -> rom address */
-                  {
-                     int i_addr;
-                     if (h_processor->trace) fprintf(stdout, "a -> rom address");
-                     h_processor->pc &= 0x0ff00;
-                     i_addr = h_processor->pc + (h_processor->reg[A_REG]->nibble[2] << 4) + h_processor->reg[A_REG]->nibble[1];
-                     if (i_addr < ROM_SIZE)
-                         h_processor->pc = i_addr;
-                     else
-                     {
-                        if (h_processor->trace) fprintf(stdout, "\n");
-                        v_error(errno, h_err_invalid_address, i_addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-                     }
-                     v_delayed_rom(h_processor);
-                  }
-                  break;
-               case 00320: /* reset twf */
-                  if (h_processor->trace) fprintf(stdout, "reset twf");
-                  break;
-               case 00420: /* binary */
-                  if (h_processor->trace) fprintf(stdout, "binary");
-                  h_processor->base = 16;
-                  break;
-               case 00520: /* rotate left a */
-                  if (h_processor->trace) fprintf(stdout, "rotate left a");
-                  {
-                     int c_temp, i_count;
-                     c_temp = h_processor->reg[A_REG]->nibble[REG_SIZE - 1];
-                     for (i_count = REG_SIZE - 1; i_count > 0; i_count--)
-                        h_processor->reg[A_REG]->nibble[i_count] = h_processor->reg[A_REG]->nibble[i_count - 1];
-                     h_processor->reg[A_REG]->nibble[0] = c_temp;
-                     h_processor->flags[PREV_CARRY] = h_processor->flags[CARRY] = False;
-                  }
-                  break;
-               case 00620: /* p - 1 -> p */
-                  if (h_processor->trace) fprintf(stdout, "p - 1 -> p\t\t\t");
-                  v_op_dec_p(h_processor);
-                  if (h_processor->trace) fprintf(stdout, "p = %d", h_processor->p);
-                  break;
-               case 00720: /* p + 1 -> p */
-                  if (h_processor->trace) fprintf(stdout, "p + 1 -> p\t\t\t");
-                  v_op_inc_p(h_processor);
-                  if (h_processor->trace) fprintf(stdout, "p = %d", h_processor->p);
-                  break;
-               case 01020: /* return */
-                  if (h_processor->trace) fprintf(stdout, "return");
-                  h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
-                  h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter from the stack */
-                  break;
+   case 00100: return OP_TEST_MOTOR;
+   case 00300: return OP_TEST_MODE;
+   case 00400: return OP_SET_KEY_FLAG;
+   case 00500: return OP_TEST_KEY_FLAG;
+   case 01000: return OP_SET_FUNCTION_FLAG;
+   case 01100: return OP_TEST_FUNCTION_FLAG;
+   case 01200: return OP_SET_MERGE_FLAG;
+   case 01300: return OP_TEST_MERGE_FLAG;
+   case 01400: return OP_SET_PAUSE_FLAG;
+   case 01500: return OP_TEST_PAUSE_FLAG;
+   case 01700: return OP_CARD_READ_WRITE;
+#endif
+   case 00020: return OP_KEYS_TO_ROM;
+   case 00120: return OP_KEYS_TO_A;
+   case 00220: return OP_A_TO_ROM;
+   case 00320: return OP_RESET_TWF;
+   case 00420: return OP_BINARY;
+   case 00520: return OP_ROTATE_LEFT_A;
+   case 00620: return OP_DEC_P;
+   case 00720: return OP_INC_P;
+   case 01020: return OP_RETURN;
 #if defined(HP10)
-               case 01120: /* pik1120 */
-                  if (h_processor->trace) fprintf(stdout, "pik1120\t\t");
-                  v_fprint_buffer (stdout, h_processor);
-                  h_processor->status[3] = True; /* Set status bit 3 if printer ready (it always will be!) */
-                  if (h_processor->trace) v_fprint_status(stdout, h_processor);
-                  break;
-               case 01220: /* pik1220 */
-                  if (h_processor->trace) fprintf(stdout, "pik1220\t\t");
-                  v_fprint_buffer (stdout, h_processor);
-                  h_processor->status[3] = True; /* Clear status bit 3 if printer is out of paper */
-                  if (h_processor->trace) v_fprint_status(stdout, h_processor);
-                  break;
-               case 01320: /* pik1320 */
-                  if (h_processor->trace) fprintf(stdout, "pik1320\t\t");
-                  v_fprint_buffer (stdout, h_processor);
-                  if (h_processor->keypressed && h_processor->code) h_processor->status[3] = True; /* Set status bit 3 if key is pressed and a key code is pending */
-                  if (h_processor->trace) v_fprint_status(stdout, h_processor);
-                  break;
-               case 01720: /* pik1720 print numeric (4 bit data)*/
-                  if (h_processor->trace) fprintf(stdout, "pik1720\t\t");
-                  if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-                  if (h_processor->buffer[h_processor->position] == 0x3f) h_processor->position++;
-                  {
-                     int i_count;
-                     for (i_count = 0; (i_count < REG_SIZE)  && (h_processor->reg[C_REG]->nibble[i_count] != 0xf); i_count++)
-                     {
-                        h_processor->position--;
-                        h_processor->buffer[h_processor->position] = (h_processor->reg[C_REG]->nibble[i_count] << 2) | 0x3;
-                     }
-                  }
-                  break;
-#endif
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            case 02: /* Op-Codes matching x xxx 100 000 */ /* select rom */
-               if (h_processor->trace) fprintf(stdout, "select rom %02o", i_opcode >> 6);
-               h_processor->pc = ((i_opcode >> 6) << 8) + ((h_processor->pc) & 0xff);
-               break;
-            case 03: /* Op-Codes matching x xxx 110 000 */
-               switch (i_opcode)
-               {
+   case 01120: return OP_PIK1120;
+   case 01220: return OP_PIK1220;
+   case 01320: return OP_PIK1320;
+   case 01720: return OP_PIK1720;
+#endif
 #if defined(HP67)
-               /*
-                * 00060   Set display digits
-                * 00160   Test display digits
-                * 00260   Motor on
-                * 00360   Motor off
-                * 00560   Test if card inserted
-                * 00660   Set card write mode
-                * 00760   Set card read mode
-                */
-               case 00060: /* set display digits */
-                  if (h_processor->trace) fprintf(stdout, "set display digits");
-                  h_processor->crc[DISPLAY] = True;
-                  break;
-               case 00160: /* test display digits */
-                  if (h_processor->trace) fprintf(stdout, "test display digits");
-                  h_processor->status[3] = h_processor->crc[DISPLAY];
-                  if (h_processor->crc[DISPLAY]) h_processor->crc[DISPLAY] = False;
-                  break;
-               case 00260: /* card reader motor on */
-                  if (h_processor->trace) fprintf(stdout, "motor on");
-                  break;
-               case 00360: /* card reader motor off */
-                  if (h_processor->trace) fprintf(stdout, "motor off");
-                  break;
-               case 00560: /* test card inserted */
-                  if (h_processor->trace) fprintf(stdout, "test card inserted");
-                  h_processor->status[3] = h_processor->crc[CARD]; /* Test if card is inserted */
-                  break;
-               case 00660: /* card reader set write mode */
-                  if (h_processor->trace) fprintf(stdout, "set write mode");
-                  break;
-               case 00760: /* card reader set read mode */
-                  if (h_processor->trace) fprintf(stdout, "set read mode");
-                  break;
-#endif
-               case 01060: /* bank switch */
-                  if (h_processor->trace) fprintf(stdout, "bank switch");
-                  h_processor->flags[BANK_SWITCH] = (!h_processor->flags[BANK_SWITCH]); /* Toggle bank switch */
-                  h_processor->pc ^=  0x01000; /* Toggle bank */
-                  break;
-               case 01160: /* c -> data address */
-                  {
-                     int i_addr;
-                     if (h_processor->trace) fprintf(stdout, "c -> data address\t");
-                     i_addr = (h_processor->reg[C_REG]->nibble[1] << 4) + h_processor->reg[C_REG]->nibble[0];
+   case 00060: return OP_SET_DISPLAY_DIGITS;
+   case 00160: return OP_TEST_DISPLAY_DIGITS;
+   case 00260: return OP_MOTOR_ON;
+   case 00360: return OP_MOTOR_OFF;
+   case 00560: return OP_TEST_CARD;
+   case 00660: return OP_SET_WRITE_MODE;
+   case 00760: return OP_SET_READ_MODE;
+#endif
+   case 01060: return OP_BANK_SWITCH;
+   case 01160: return OP_C_TO_ADDR;
+   case 01260: return OP_CLEAR_DATA;
+   case 01360: return OP_C_TO_DATA;
 #if defined(HP10)
-                     if ((i_addr < MEMORY_SIZE) || (i_addr == 0xFF)) /* Address 0xFF tells the PIK chip to put the key code on the data bus */
-                        h_processor->addr = i_addr;
-                     else
-                     {
-                        h_processor->addr = MEMORY_SIZE - 1;
-                        if (h_processor->trace) fprintf(stdout, "\n");
-                        v_error(errno, h_err_invalid_register, i_addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-                     }
-#else
-                     if (i_addr < MEMORY_SIZE)
-                        h_processor->addr = i_addr;
-                     else
-                     {
-                        h_processor->addr = MEMORY_SIZE - 1;
-                     }
-#endif
-                  }
-                  if (h_processor->trace) fprintf(stdout, "\taddr = %d", h_processor->addr);
-                  break;
-               case 01260: /* clear data registers */
-                  {
-#if (defined(HP25) || defined(HP25c)) && defined(CONTINIOUS)
-                     /* Ignore the instruction */
-#else
-                     int i_count;
-                     if (h_processor->trace) fprintf(stdout, "clear data registers");
-#if (defined(HP67)) && defined(CONTINIOUS)
-                     if (h_processor->crc[READY])
-                        h_processor->crc[READY]++;
-                     else
-#endif
-                     {
-                        h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                        for (i_count = h_processor->addr & ~0x0f; i_count < (h_processor->addr & ~0x0f) + 16; i_count++)
-                        {
-                           if (i_count < MEMORY_SIZE) /* Check memory size */
-                              v_reg_copy(h_processor, h_processor->mem[i_count], NULL); /* Copying nothing to a register clears it */
-                        }
-                     }
-#endif
-                  }
-                  break;
-               case 01360: /* c -> data */
-                  if (h_processor->trace) fprintf(stdout, "c -> data\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->mem[h_processor->addr], h_processor->reg[C_REG]);
-                  if (h_processor->trace)
-                     v_fprint_register(stdout, h_processor->mem[h_processor->addr]);
-                  break;
+   case 01660: return OP_PIK1660;
+#endif
+   case 01460: return OP_ROM_CHECKSUM;
+   case 01760: return OP_HI_WOODSTOCK;
+   case 00010: return OP_CLEAR_REGISTERS;
+   case 00110: return OP_CLEAR_STATUS;
+   case 00210: return OP_DISPLAY_TOGGLE;
+   case 00310: return OP_DISPLAY_OFF;
+   case 00410: return OP_M_EXCH_C;
+   case 00510: return OP_M_TO_C;
+   case 00610: return OP_N_EXCH_C;
+   case 00710: return OP_N_TO_C;
+   case 01010: return OP_STACK_TO_A;
+   case 01110: return OP_DOWN_ROTATE;
+   case 01210: return OP_Y_TO_A;
+   case 01310: return OP_C_TO_STACK;
+   case 01410: return OP_DECIMAL;
+   case 01610: return OP_F_TO_A;
+   case 01710: return OP_F_EXCH_A;
+   }
+   switch (i_opcode & 077) /* Op-codes with an operand in the top bits */
+   {
+   case 040: return OP_SELECT_ROM;
+   case 004: return OP_SET_S;
+   case 024: return OP_TEST_S1;
+   case 044:
+      *h_arg = i_tst_p[i_opcode >> 6];
+      return OP_TEST_P;
+   case 064: return OP_DELAYED_ROM;
+   case 030: return OP_LOAD_CONSTANT;
+   case 050: return OP_C_TO_REGISTER;
+   case 070: return OP_DATA_TO_C;
+   case 014: return OP_CLEAR_S;
+   case 034: return OP_TEST_S0;
+   case 054:
+      *h_arg = i_tst_p[i_opcode >> 6];
+      return OP_TEST_P_NE;
+   case 074:
+      *h_arg = i_set_p[i_opcode >> 6];
+      return OP_SET_P;
+   }
+   return OP_UNEXPECTED;
+}
+#endif
+
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+#define OP_NOP                 32
+#define OP_CLEAR_S             33
+#define OP_CLEAR_STATUS        34
+#define OP_SET_S               35
+#define OP_RESET_KEYBOARD      36
+#define OP_TEST_S1             37
+#define OP_TEST_KEYBOARD       38
+#define OP_LOAD_CONSTANT       39
+#define OP_TEST_PT             40
+#define OP_DEC_PT              41
+#define OP_G_FROM_C            42
+#define OP_C_FROM_G            43
+#define OP_C_EXCH_G            44
+#define OP_M_FROM_C            45
+#define OP_C_FROM_M            46
+#define OP_C_EXCH_M            47
+#define OP_C_FROM_ST           48
+#define OP_C_EXCH_ST           49
+#define OP_SET_PT              50
+#define OP_INC_PT              51
+#define OP_POWER_OFF           52
+#define OP_SELECT_P            53
+#define OP_SELECT_Q            54
+#define OP_TEST_P_Q            55
+#define OP_TEST_LLD            56
+#define OP_CLEAR_ABC           57
+#define OP_C_TO_PC             58
+#define OP_KEYS_TO_C           59
+#define OP_SET_HEX             60
+#define OP_SET_DEC             61
+#define OP_DISPLAY_OFF         62
+#define OP_DISPLAY_TOGGLE      63
+#define OP_RETURN_C            64
+#define OP_RETURN_NC           65
+#define OP_RETURN              66
+#define OP_C_TO_REGISTER       67
+#define OP_BLINK               68
+#define OP_N_FROM_C            69
+#define OP_C_FROM_N            70
+#define OP_C_EXCH_N            71
+#define OP_LOAD_IMMEDIATE      72
+#define OP_PUSH_C              73
+#define OP_POP_C               74
+#define OP_C_TO_ADDR           75
+#define OP_C_TO_DATA           76
+#define OP_CXISA               77
+#define OP_C_OR_A              78
+#define OP_C_AND_A             79
+#define OP_REGISTER_TO_C       80
+#define OP_ROTATE_C            81
+#define OP_GSB_NC              82
+#define OP_GSB_C               83
+#define OP_GO_TO_NC            84
+#define OP_GO_TO_C             85
+#define OP_JC                  86
+#define OP_JNC                 87
+#define OP_UNEXPECTED          88
+#define HANDLERS               89             /* Number of handlers */
+
+/* static const int n_map_i[16] = {  3,  4,  5, 10,  8,  6, 11, -1,  2,  9,  7, 13,  1, 12,  0, -1 }; /* map nnnn to index */
+static const unsigned char n_map_i[16] = {  3,  4,  5, 10,  8,  6, 11, 15,  2,  9,  7, 13,  1, 12,  0, 15 }; /* map nnnn to index */
+
+static unsigned char i_special(unsigned int i_opcode, unsigned char *h_arg) /* Find the handler for a special operation */
+{
+   static const unsigned char i_misc[16] = { /* xxxx 10 0000 */
+      OP_UNEXPECTED, OP_POWER_OFF, OP_SELECT_P, OP_SELECT_Q, OP_TEST_P_Q, OP_TEST_LLD, OP_CLEAR_ABC, OP_C_TO_PC,
+      OP_KEYS_TO_C, OP_SET_HEX, OP_SET_DEC, OP_DISPLAY_OFF, OP_DISPLAY_TOGGLE, OP_RETURN_C, OP_RETURN_NC, OP_RETURN };
+   static const unsigned char i_register[16] = { /* xxxx 01 1000 */
+      OP_UNEXPECTED, OP_G_FROM_C, OP_C_FROM_G, OP_C_EXCH_G, OP_UNEXPECTED, OP_M_FROM_C, OP_C_FROM_M, OP_C_EXCH_M,
+      OP_UNEXPECTED, OP_UNEXPECTED, OP_UNEXPECTED, OP_UNEXPECTED, OP_UNEXPECTED, OP_UNEXPECTED, OP_C_FROM_ST, OP_C_EXCH_ST };
+   static const unsigned char i_memory[16] = { /* xxxx 11 0000 */
+      OP_BLINK, OP_N_FROM_C, OP_C_FROM_N, OP_C_EXCH_N, OP_LOAD_IMMEDIATE, OP_PUSH_C, OP_POP_C, OP_UNEXPECTED,
+      OP_UNEXPECTED, OP_C_TO_ADDR, OP_UNEXPECTED, OP_C_TO_DATA, OP_CXISA, OP_C_OR_A, OP_C_AND_A, OP_UNEXPECTED };
+   unsigned int i_n = i_opcode >> 6;
+
+   *h_arg = n_map_i[i_n];
+   switch ((i_opcode >> 2) & 0xf)
+   {
+   case 0x00: /* No operation (00 0000 0000) */
+      return (i_n == 0) ? OP_NOP : OP_UNEXPECTED;
+   case 0x01: /* 0 -> status[7:0] - Clear status (11 1100 0100) or 0 -> status[d] - Clear status bit (dd dd00 0100) */
+      if (i_n == 7) return OP_UNEXPECTED; /* Reserved opcode (01 1100 0100) */
+      return (i_n < 15) ? OP_CLEAR_S : OP_CLEAR_STATUS;
+   case 0x02: /* 0 -> kyf  - Reset keyboard (11 1100 1000) or 1 -> status[d] - Set status bit (dd dd00 0100) */
+      if (i_n == 7) return OP_UNEXPECTED; /* Reserved opcode (01 1100 1000) */
+      return (i_n < 15) ? OP_SET_S : OP_RESET_KEYBOARD;
+   case 0x03: /* Test status bit [dddd] if 0 <= dddd <= 14 (dd dd00 1100) or test keyboard (11 1100 1100) */
+      if (i_n == 7) return OP_UNEXPECTED; /* Reserved opcode (01 1100 1100) */
+      return (i_n < 15) ? OP_TEST_S1 : OP_TEST_KEYBOARD;
+   case 0x04: /* nn -> c[pt] - Load constant n (nn nn01 0000) */
+      *h_arg = i_n;
+      return OP_LOAD_CONSTANT;
+   case 0x05: /* Test pointer equal to dddd if 0 <= dddd <= 14 (dd dd00 1100) or decrement pointer (11 1101 0100) */
+      if (i_n == 7) return OP_UNEXPECTED; /* Reserved opcode (01 1101 0100) */
+      return (i_n < 15) ? OP_TEST_PT : OP_DEC_PT;
+   case 0x06:
+      return i_register[i_n];
+   case 0x07: /* Load pointer with dddd if 0 <= dddd <= 14 (dd dd00 1100) or decrement pointer (11 1101 0100) */
+      if (i_n == 7) return OP_UNEXPECTED; /* Reserved opcode (01 1101 0100)*/
+      return (i_n < 15) ? OP_SET_PT : OP_INC_PT;
+   case 0x08: /* xxxx 10 0000 */
+      return i_misc[i_n];
+   case 0x0a: /* {addr[11:4], nnnn} -> addr, c -> reg[addr] - Load register from c (nn nn10 1000) */
+      *h_arg = i_n;
+      return OP_C_TO_REGISTER;
+   case 0x0c:
+      return i_memory[i_n];
+   case 0x0e: /* {addr[11:4], nnnn} -> addr, reg[addr] -> c - Load c from register (nn nn11 1000) */
+      *h_arg = i_n;
+      return OP_REGISTER_TO_C;
+   case 0x0f: /* Rotate c register right (dddd 1111 00) */
+      return OP_ROTATE_C;
+   }
+   return OP_UNEXPECTED;
+}
+#endif
+
+static unsigned int i_next_address(unsigned int i_address) /* Address of the following instruction */
+{
+#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
+   return ((i_address >> 8) << 8) | ((i_address + 1) & 0xff); /* Same wrap round as v_op_inc_pc() */
+#else
+   if (i_address >= (ROM_SIZE - 1)) /* Same wrap round as v_op_inc_pc() */
+      return 0;
+   return (i_address & 0xf000) | ((i_address + 1) & 0xfff);
+#endif
+}
+
+static void v_decode(odecoded *h_decoded, unsigned int i_address, unsigned int i_opcode, unsigned int i_next) /* Decode an instruction (and the word after it) */
+{
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   int i_offset;
+#endif
+
+   h_decoded->type = i_opcode & 03;
+   h_decoded->op = (i_opcode >> 5) & 0x1f;
+   h_decoded->field = (i_opcode >> 2) & 7;
+   h_decoded->first = i_field_first[h_decoded->field]; /* Fields that depend on a pointer are negative */
+   h_decoded->last = i_field_last[h_decoded->field];
+   h_decoded->address = i_opcode >> 2;
+   h_decoded->arg = 0;
+   switch (h_decoded->type)
+   {
+   case 00: /* Special operations */
+      h_decoded->handler = i_special(i_opcode, &h_decoded->arg);
+      break;
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   case 01: /* Branch instruction (two words) */
+      h_decoded->address = (i_opcode >> 2) | ((i_next & 0x3fc) << 6);
+      h_decoded->op = i_next & 0x3; /* Branch condition */
+      h_decoded->handler = OP_GSB_NC + h_decoded->op; /* Handlers are in the same order as the conditions */
+      break;
+   case 03: /* Relative jump */
+      i_offset = i_opcode >> 3;
+      if (i_offset >= 0x40) i_offset = i_offset - 128;
+      h_decoded->address = (i_address + i_offset) & 0xffff;
+      h_decoded->handler = (i_opcode & 00004) ? OP_JC : OP_JNC;
+      break;
+#else
+   case 01: /* Jump subroutine */
+      h_decoded->handler = OP_JSB;
+      break;
+   case 03: /* Conditional go to */
+      h_decoded->handler = OP_GO_TO;
+      break;
+#endif
+   case 02: /* Arithmetic operations */
+      h_decoded->handler = h_decoded->op;
+      break;
+   }
+}
+
+void v_processor_decode(oprocessor *h_processor) /* Decode every instruction in the ROM */
+{
+   unsigned int i_count;
+
+   for (i_count = 0; i_count < ROM_SIZE; i_count++)
+      v_decode(&h_processor->decoded[i_count], i_count, h_processor->rom[i_count], h_processor->rom[i_next_address(i_count)]);
+}
+
+typedef struct {
+   const char *text;                   /* Mnemonic (the field name or operand is filled in) */
+   int go_to;                          /* Followed by the address to go to */
+} omnemonic;
+
+#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
+static const omnemonic o_mnemonic[HANDLERS] = { /* Text used by the trace (without any register contents) */
+   [000] = {"if b[%s] = 0", True},
+   [001] = {"0 -> b[%s]"},
+   [002] = {"if a >= c[%s]", True},
+   [003] = {"if c[%s] != 0", True},
+   [004] = {"b -> c[%s]"},
+   [005] = {"0 - c -> c[%s]"},
+   [006] = {"0 -> c[%s]"},
+   [007] = {"0 - c - 1 -> c[%s]"},
+   [010] = {"shift left a[%s]"},
+   [011] = {"a -> b[%s]"},
+   [012] = {"a - c -> c[%s]"},
+   [013] = {"c - 1 -> c[%s]"},
+   [014] = {"c -> a[%s]"},
+   [015] = {"if c[%s] = 0", True},
+   [016] = {"a + c -> c[%s]"},
+   [017] = {"c + 1 -> c[%s]"},
+   [020] = {"if a >= b[%s]", True},
+   [021] = {"b exch c[%s]"},
+   [022] = {"shift right c[%s]"},
+   [023] = {"if a[%s] != 0", True},
+   [024] = {"shift right b[%s]"},
+   [025] = {"c + c -> c[%s]"},
+   [026] = {"shift right a[%s]"},
+   [027] = {"0 -> a[%s]"},
+   [030] = {"a - b -> a[%s]"},
+   [031] = {"a exch b[%s]"},
+   [032] = {"a - c -> a[%s]"},
+   [033] = {"a - 1 -> a[%s]"},
+   [034] = {"a + b -> a[%s]"},
+   [035] = {"a exch c[%s]"},
+   [036] = {"a + c -> a[%s]"},
+   [037] = {"a + 1 -> a[%s]"},
+   [OP_NOP] = {"nop"},
+   [OP_SELECT_ROM] = {"select rom %02o"},
+   [OP_KEYS_TO_ROM] = {"keys -> rom address"},
+   [OP_RETURN] = {"return"},
+   [OP_C_TO_ADDR] = {"c -> data address"},
+   [OP_C_TO_DATA] = {"c -> data"},
+   [OP_SET_S] = {"1 -> s(%d)"},
+   [OP_TEST_S0] = {"if 0 = s(%d)", True},
+   [OP_CLEAR_S] = {"0 -> s(%d)"},
+   [OP_CLEAR_STATUS] = {"clear status"},
+   [OP_DELAYED_ROM] = {"delayed select rom %d"},
+   [OP_LOAD_CONSTANT] = {"load constant %d"},
+   [OP_DISPLAY_TOGGLE] = {"display toggle"},
+   [OP_M_EXCH_C] = {"m exch c"},
+   [OP_C_TO_STACK] = {"c -> stack"},
+   [OP_STACK_TO_A] = {"stack -> a"},
+   [OP_DISPLAY_OFF] = {"display off"},
+   [OP_M_TO_C] = {"m -> c"},
+   [OP_DOWN_ROTATE] = {"down rotate"},
+   [OP_CLEAR_REGISTERS] = {"clear registers"},
+   [OP_DATA_TO_C] = {"data -> c"},
+   [OP_SET_P] = {"%d -> p"},
+   [OP_DEC_P] = {"p - 1 -> p"},
+   [OP_TEST_P_NE] = {"if p != %d", True},
+   [OP_INC_P] = {"p + 1 -> p"},
+   [OP_JSB] = {"jsb"},
+   [OP_GO_TO] = {"if nc go to"},
+};
+#endif
+
+#if defined(WOODSTOCK) || defined(SPICE) || defined(HP10) || defined(HP67)
+static const omnemonic o_mnemonic[HANDLERS] = {
+   [000] = {"0 -> a[%s]"},
+   [001] = {"0 -> b[%s]"},
+   [002] = {"a exch b[%s]"},
+   [003] = {"a -> b[%s]"},
+   [004] = {"a exch c[%s]"},
+   [005] = {"c -> a[%s]"},
+   [006] = {"b -> c[%s]"},
+   [007] = {"b exch c[%s]"},
+   [010] = {"0 -> c[%s]"},
+   [011] = {"a + b -> a[%s]"},
+   [012] = {"a + c -> a[%s]"},
+   [013] = {"c + c -> c[%s]"},
+   [014] = {"a + c -> c[%s]"},
+   [015] = {"a + 1 -> a[%s]"},
+   [016] = {"shift left a[%s]"},
+   [017] = {"c + 1 -> c[%s]"},
+   [020] = {"a - b -> a[%s]"},
+   [021] = {"a - c -> c[%s]"},
+   [022] = {"a - 1 -> a[%s]"},
+   [023] = {"c - 1 -> c[%s]"},
+   [024] = {"0 - c -> c[%s]"},
+   [025] = {"0 - c - 1 -> c[%s]"},
+   [026] = {"if b[%s] = 0", True},
+   [027] = {"if c[%s] = 0", True},
+   [030] = {"if a >= c[%s]", True},
+   [031] = {"if a >= b[%s]", True},
+   [032] = {"if a[%s] != 0", True},
+   [033] = {"if c[%s] != 0", True},
+   [034] = {"a - c -> a[%s]"},
+   [035] = {"shift right a[%s]"},
+   [036] = {"shift right b[%s]"},
+   [037] = {"shift right c[%s]"},
+   [OP_NOP] = {"nop"},
+#if defined(HP67)
+   [OP_TEST_MOTOR] = {"test motor on"},
+   [OP_TEST_MODE] = {"test mode flag"},
+   [OP_SET_KEY_FLAG] = {"set key pressed flag"},
+   [OP_TEST_KEY_FLAG] = {"test key pressed flag"},
+   [OP_SET_FUNCTION_FLAG] = {"set flag 4"},
+   [OP_TEST_FUNCTION_FLAG] = {"test flag 4"},
+   [OP_SET_MERGE_FLAG] = {"set merge flag"},
+   [OP_TEST_MERGE_FLAG] = {"clear flag 0"},
+   [OP_SET_PAUSE_FLAG] = {"clear waiting flag"},
+   [OP_TEST_PAUSE_FLAG] = {"clear flag 1"},
+   [OP_CARD_READ_WRITE] = {"card read write"},
+#endif
+   [OP_KEYS_TO_ROM] = {"keys -> rom address"},
+   [OP_KEYS_TO_A] = {"keys -> a"},
+   [OP_A_TO_ROM] = {"a -> rom address"},
+   [OP_RESET_TWF] = {"reset twf"},
+   [OP_BINARY] = {"binary"},
+   [OP_ROTATE_LEFT_A] = {"rotate left a"},
+   [OP_DEC_P] = {"p - 1 -> p"},
+   [OP_INC_P] = {"p + 1 -> p"},
+   [OP_RETURN] = {"return"},
 #if defined(HP10)
-               case 01660: /* pik1660 print alpha (6 bit data)*/
-                  if (h_processor->trace) fprintf(stdout, "pik1660");
-                  {
-                     int i_counter = 0;
-                     int i_count;
-                     for (i_count = 0; (i_count < REG_SIZE - 1) && (h_processor->position >= 0); i_count++)
-                     {
-                        h_processor->position--;
-                        if((i_counter & 1) == 0) /* Even numbered nibble */
-                        {
-                           h_processor->buffer[h_processor->position] = (h_processor->reg[C_REG]->nibble[i_count]) | ((h_processor->reg[C_REG]->nibble[i_count + 1]) & 0x3) << 4;
-                        }
-                        else
-                        {
-                           h_processor->buffer[h_processor->position] = ((h_processor->reg[C_REG]->nibble[i_count]) >> 2) | (h_processor->reg[C_REG]->nibble[i_count + 1]) << 2;
-                           i_count++;
-                        }
-                        i_counter++;
-                        if (h_processor->buffer[h_processor->position] == 0x3f) i_count = REG_SIZE;
-                     }
-                  }
-                  break;
-#endif
-               case 01460: /* rom checksum */
-                  if (h_processor->trace) fprintf(stdout, "rom checksum");
-                  h_processor->status[5] = False;
-                  h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
-                  h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter on the stack */
-                  break;
-               case 01760: /* hi I'm woodstock */
-                  if (h_processor->trace) fprintf(stdout, "hi I'm woodstock");
-                  break;
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-            }
-            break;
-         case 01: /* Op-Codes matching x xxx xx0 100 */
-            switch ((i_opcode >> 4) & 03)
-            {
-            case 00: /* 1 -> s(n) */
-               if (h_processor->trace) fprintf(stdout, "1 -> s(%d)\t\t", i_opcode >> 6);
-               h_processor->status[i_opcode >> 6] = True;
-               if (h_processor->trace) v_fprint_status(stdout, h_processor);
-               break;
-            case 01: /* if 1 = s(n) */
-               if (h_processor->trace) fprintf(stdout, "if 1 = s(%d)", i_opcode >> 6);
-               h_processor->flags[CARRY] = h_processor->status[i_opcode >> 6];
-               v_op_goto(h_processor);
-               break;
-            case 02: /* if p = n */
-               if (h_processor->trace) fprintf(stdout, "if p = %d", i_tst_p[i_opcode >> 6]);
-               h_processor->flags[CARRY] = (h_processor->p == i_tst_p[i_opcode >> 6]);
-               v_op_goto(h_processor);
-               break;
-            case 03: /* delayed select rom n */
-               if (h_processor->trace) fprintf(stdout, "delayed select rom %d", i_opcode >> 6);
-               h_processor->rom_number = i_opcode >> 6;
-               h_processor->flags[DELAYED_ROM] = True;
-            }
-            break;
-         case 02: /* Op-Codes matching x xxx xx1 000 */
-            switch ((i_opcode >> 4) & 03)
-            {
-            case 00: /* Op-Codes matching x xxx 001 000 */
-               switch (i_opcode)
-               {
-               case 00010: /* clear registers */
-                  if (h_processor->trace) fprintf(stdout, "clear registers");
-                  {
-                     int i_count;
-                     h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                     for (i_count = 0; i_count < REGISTERS - 2; i_count++) /* Don't clear M or N */
-                        v_reg_copy(h_processor, h_processor->reg[i_count], NULL); /* Copying nothing to a register clears it */
-                  }
-                  break;
-               case 00110: /* clear status */
-                  if (h_processor->trace) fprintf(stdout, "clear status\t");
-                  {
-                     int i_count;
-                     for (i_count = 0; i_count < sizeof(h_processor->status) / sizeof(*h_processor->status); i_count++)
-                        switch (i_count) {
-                           case 1:  /* Scientific notation */
-                           case 2:  /* Auto Enter (if set entering digit will push 'X') */
-#if (!defined(HP10))
-                           case 5:  /* Low power (Woodstock) / Self test (Spice) */
-#endif
-                           case 15: /* Set if any key is pressed */
-                              break;
-                           default:
-                              h_processor->status[i_count] = False; /* Clear all bits except bits 1, 2, 5, 15 */
-                        }
-                  }
-               if (h_processor->trace) v_fprint_status(stdout, h_processor);
-                  break;
-               case 00210: /* display toggle */
-                  if (h_processor->trace) fprintf(stdout, "display toggle");
-                  h_processor->flags[DISPLAY_ENABLE] = (!h_processor->flags[DISPLAY_ENABLE]);
-                  break;
-               case 00310: /* display off */
-                  if (h_processor->trace) fprintf(stdout, "display off");
-                  h_processor->flags[DISPLAY_ENABLE] = False;
-                  break;
-               case 00410: /* m exch c */
-                  if (h_processor->trace) fprintf(stdout, "m exch c\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_exch(h_processor, h_processor->reg[M_REG], h_processor->reg[C_REG]);
-                  if (h_processor->trace)
-                  {
-                     v_fprint_register(stdout,h_processor->reg[C_REG]);
-                     v_fprint_register(stdout,h_processor->reg[M_REG]);
-                  }
-                  break;
-               case 00510: /* m -> c */
-                  if (h_processor->trace) fprintf(stdout, "m -> c\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[M_REG]);
-                  if (h_processor->trace)
-                     v_fprint_register(stdout,h_processor->reg[C_REG]);
-                  break;
-               case 00610: /* n exch c */
-                  if (h_processor->trace) fprintf(stdout, "n exch c\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_exch(h_processor, h_processor->reg[N_REG], h_processor->reg[C_REG]);
-                  if (h_processor->trace)
-                  {
-                     v_fprint_register(stdout,h_processor->reg[C_REG]);
-                     v_fprint_register(stdout,h_processor->reg[N_REG]);
-                  }
-                  break;
-               case 00710: /* n -> c */
-                  if (h_processor->trace) fprintf(stdout, "n -> c\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[N_REG]);
-                  if (h_processor->trace)
-                     v_fprint_register(stdout,h_processor->reg[C_REG]);
-                  break;
-               case 01010: /* stack -> a */
-                  if (h_processor->trace) fprintf(stdout, "stack -> a");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[Y_REG]); /* A = Y */
-                  v_reg_copy(h_processor, h_processor->reg[Y_REG], h_processor->reg[Z_REG]); /* Y = Z */
-                  v_reg_copy(h_processor, h_processor->reg[Z_REG], h_processor->reg[T_REG]); /* Z = T */
-                  if (h_processor->trace)
-                  {
-                     v_fprint_register(stdout,h_processor->reg[A_REG]);
-                     v_fprint_register(stdout,h_processor->reg[Y_REG]);
-                     v_fprint_register(stdout,h_processor->reg[Z_REG]);
-                  }
-                  break;
-               case 01110: /* down rotate */
-                  if (h_processor->trace) fprintf(stdout, "down rotate\t");
-                     h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                     v_reg_exch(h_processor, h_processor->reg[T_REG], h_processor->reg[C_REG]); /* T <> C - C to T */
-                     v_reg_exch(h_processor, h_processor->reg[C_REG], h_processor->reg[Y_REG]); /* C <> Y - Y to C */
-                     v_reg_exch(h_processor, h_processor->reg[Y_REG], h_processor->reg[Z_REG]); /* Y <> Z - Z to Y and T ends up in Z */
-                     if (h_processor->trace)
-                     {
-                        v_fprint_register(stdout,h_processor->reg[C_REG]);
-                        v_fprint_register(stdout,h_processor->reg[Y_REG]);
-                        v_fprint_register(stdout,h_processor->reg[Z_REG]);
-                        v_fprint_register(stdout,h_processor->reg[T_REG]);
-                     }
-                  break;
-               case 01210: /* y -> a */
-                  if (h_processor->trace) fprintf(stdout, "y -> a\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[Y_REG]);
-                  if (h_processor->trace)
-                     v_fprint_register(stdout,h_processor->reg[A_REG]);
-                  break;
-               case 01310: /* c _> stack */
-                  if (h_processor->trace) fprintf(stdout, "c -> stack\t\t");
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->reg[T_REG], h_processor->reg[Z_REG]); /* T = Z */
-                  v_reg_copy(h_processor, h_processor->reg[Z_REG], h_processor->reg[Y_REG]); /* T = Z */
-                  v_reg_copy(h_processor, h_processor->reg[Y_REG], h_processor->reg[C_REG]); /* T = Z */
-                  if (h_processor->trace)
-                  {
-                     v_fprint_register(stdout,h_processor->reg[C_REG]);
-                     v_fprint_register(stdout,h_processor->reg[Y_REG]);
-                     v_fprint_register(stdout,h_processor->reg[Z_REG]);
-                     v_fprint_register(stdout,h_processor->reg[T_REG]);
-                  }
-                  break;
-               case 01410: /* decimal */
-                  if (h_processor->trace) fprintf(stdout, "decimal");
-                  h_processor->base = 10;
-                  break;
-               case 01610: /* f -> a */
-                  h_processor->reg[A_REG]->nibble[0] = h_processor->f;
-                  if (h_processor->trace) fprintf(stdout, "f -> a\t\t");
-                  if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-                  break;
-               case 01710: /* f exch a */
-                  if (h_processor->trace) fprintf(stdout, "f exch a\t\t");
-                  {
-                     int i_temp;
-                     i_temp = h_processor->reg[A_REG]->nibble[0];
-                     h_processor->reg[A_REG]->nibble[0] = h_processor->f;
-                     h_processor->f = i_temp;
-                  }
-                  if (h_processor->trace)
-                  {
-                     v_fprint_register(stdout,h_processor->reg[A_REG]);
-                     fprintf(stdout, "\tf = %02x", h_processor->f);
-                  }
-                  break;
-               default:
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            case 01: /* load constant n */
-               if (h_processor->trace) fprintf(stdout, "load constant %d\t", i_opcode >> 6);
-               h_processor->reg[C_REG]->nibble[h_processor->p] = i_opcode >> 6;
-               v_op_dec_p(h_processor);
-               if (h_processor->trace)
-               {
-                  v_fprint_register(stdout,h_processor->reg[C_REG]);
-                  fprintf(stdout, "\tp = %d", h_processor->p);
-               }
-               break;
-            case 02: /* c -> data register(n) */
-               h_processor->addr &= 0xfff0;
-               h_processor->addr += (i_opcode >> 6);
-               if (h_processor->trace) fprintf(stdout, "c -> data register(%d)", h_processor->addr);
-               if ((h_processor->addr) < MEMORY_SIZE)
-               {
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->mem[h_processor->addr], h_processor->reg[C_REG]); /* C -> reg(n) */
-               }
-               else
-               {
-                  if (h_processor->trace) fprintf(stdout, "\n");
-                  v_error(errno, h_err_invalid_address, i_opcode >> 6, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               }
-               break;
-            case 03: /* data -> c or data register(n)-> c */
-               h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-               if ((i_opcode >> 6) == 0)
-               {
-                  if (h_processor->trace) fprintf(stdout, "data -> c\t\t");
-                  v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->mem[h_processor->addr]);
-               }
+   [OP_PIK1120] = {"pik1120"},
+   [OP_PIK1220] = {"pik1220"},
+   [OP_PIK1320] = {"pik1320"},
+   [OP_PIK1720] = {"pik1720"},
+#endif
+   [OP_SELECT_ROM] = {"select rom %02o"},
+#if defined(HP67)
+   [OP_SET_DISPLAY_DIGITS] = {"set display digits"},
+   [OP_TEST_DISPLAY_DIGITS] = {"test display digits"},
+   [OP_MOTOR_ON] = {"motor on"},
+   [OP_MOTOR_OFF] = {"motor off"},
+   [OP_TEST_CARD] = {"test card inserted"},
+   [OP_SET_WRITE_MODE] = {"set write mode"},
+   [OP_SET_READ_MODE] = {"set read mode"},
+#endif
+   [OP_BANK_SWITCH] = {"bank switch"},
+   [OP_C_TO_ADDR] = {"c -> data address"},
+   [OP_CLEAR_DATA] = {"clear data registers"},
+   [OP_C_TO_DATA] = {"c -> data"},
 #if defined(HP10)
-               else if (((i_opcode >> 6) == 0xf) && (h_processor->addr == 0xff))
-               {
-                  if (h_processor->trace) fprintf(stdout, "data -> c\t\t");
-                  h_processor->reg[C_REG]->nibble[2] = (h_processor->code >> 4);
-                  h_processor->reg[C_REG]->nibble[1] = (h_processor->code & 0x0f);
-                  h_processor->reg[C_REG]->nibble[0] = 0;
-                  h_processor->code = 0; /* Clear the key code (so it isn't read twice if the key is held down) */
-               }
+   [OP_PIK1660] = {"pik1660"},
+#endif
+   [OP_ROM_CHECKSUM] = {"rom checksum"},
+   [OP_HI_WOODSTOCK] = {"hi I'm woodstock"},
+   [OP_SET_S] = {"1 -> s(%d)"},
+   [OP_TEST_S1] = {"if 1 = s(%d)", True},
+   [OP_TEST_P] = {"if p = %d", True},
+   [OP_DELAYED_ROM] = {"delayed select rom %d"},
+   [OP_CLEAR_REGISTERS] = {"clear registers"},
+   [OP_CLEAR_STATUS] = {"clear status"},
+   [OP_DISPLAY_TOGGLE] = {"display toggle"},
+   [OP_DISPLAY_OFF] = {"display off"},
+   [OP_M_EXCH_C] = {"m exch c"},
+   [OP_M_TO_C] = {"m -> c"},
+   [OP_N_EXCH_C] = {"n exch c"},
+   [OP_N_TO_C] = {"n -> c"},
+   [OP_STACK_TO_A] = {"stack -> a"},
+   [OP_DOWN_ROTATE] = {"down rotate"},
+   [OP_Y_TO_A] = {"y -> a"},
+   [OP_C_TO_STACK] = {"c -> stack"},
+   [OP_DECIMAL] = {"decimal"},
+   [OP_F_TO_A] = {"f -> a"},
+   [OP_F_EXCH_A] = {"f exch a"},
+   [OP_LOAD_CONSTANT] = {"load constant %d"},
+   [OP_C_TO_REGISTER] = {"c -> data register(%d)"},
+   [OP_DATA_TO_C] = {"data -> c"},
+   [OP_CLEAR_S] = {"0 -> s(%d)"},
+   [OP_TEST_S0] = {"if 0 = s(%d)", True},
+   [OP_TEST_P_NE] = {"if p != %d", True},
+   [OP_SET_P] = {"%d -> p"},
+   [OP_JSB] = {"jsb"},
+   [OP_GO_TO] = {"if nc go to"},
+};
+#endif
+
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+static const omnemonic o_mnemonic[HANDLERS] = {
+   [0x00] = {"a = 0 %s"},
+   [0x01] = {"b = 0 %s"},
+   [0x02] = {"c = 0 %s"},
+   [0x03] = {"abex %s"},
+   [0x04] = {"b = a %s"},
+   [0x05] = {"acex %s"},
+   [0x06] = {"c = b %s"},
+   [0x07] = {"bcex %s"},
+   [0x08] = {"a = c %-3s"},
+   [0x09] = {"a = a + b %-3s"},
+   [0x0a] = {"a = a + c %-3s"},
+   [0x0b] = {"a = a + 1 %-3s"},
+   [0x0c] = {"a = a - b %-3s"},
+   [0x0d] = {"a = a - 1 %-3s"},
+   [0x0e] = {"a = a - c %-3s"},
+   [0x0f] = {"c = c + c %-3s"},
+   [0x10] = {"c = c + a %-3s"},
+   [0x11] = {"c = c + 1 %-3s"},
+   [0x12] = {"c = a - c %-3s"},
+   [0x13] = {"c = c - 1 %-3s"},
+   [0x14] = {"c = 0 - c %-3s"},
+   [0x15] = {"c = - c - 1 %-3s"},
+   [0x16] = {"? b != 0 %-3s"},
+   [0x17] = {"? c != 0 %-3s"},
+   [0x18] = {"? a < c %-3s"},
+   [0x19] = {"? a < b %-3s"},
+   [0x1a] = {"? a != 0 %-3s"},
+   [0x1b] = {"? a != c %-3s"},
+   [0x1c] = {"shr a %s"},
+   [0x1d] = {"shr b %s"},
+   [0x1e] = {"shr c %s"},
+   [0x1f] = {"shl a %s"},
+   [OP_NOP] = {"nop"},
+   [OP_CLEAR_S] = {"st = 0 %-2d"},
+   [OP_CLEAR_STATUS] = {"clrst"},
+   [OP_SET_S] = {"st = 1 %-2d"},
+   [OP_RESET_KEYBOARD] = {"rstkb"},
+   [OP_TEST_S1] = {"? st = 1 %-2d"},
+   [OP_TEST_KEYBOARD] = {"chkkb"},
+   [OP_LOAD_CONSTANT] = {"lc %1x"},
+   [OP_TEST_PT] = {"? pt = %d"},
+   [OP_DEC_PT] = {"dec pt"},
+   [OP_G_FROM_C] = {"g = c"},
+   [OP_C_FROM_G] = {"c = g"},
+   [OP_C_EXCH_G] = {"cgex"},
+   [OP_M_FROM_C] = {"m = c"},
+   [OP_C_FROM_M] = {"c = m"},
+   [OP_C_EXCH_M] = {"cmex"},
+   [OP_C_FROM_ST] = {"c = st"},
+   [OP_C_EXCH_ST] = {"cstex"},
+   [OP_SET_PT] = {"pt = %d"},
+   [OP_INC_PT] = {"inc pt"},
+   [OP_POWER_OFF] = {"powoff"},
+   [OP_SELECT_P] = {"sel p"},
+   [OP_SELECT_Q] = {"sel q"},
+   [OP_TEST_P_Q] = {"? p = q"},
+   [OP_TEST_LLD] = {"? lld"},
+   [OP_CLEAR_ABC] = {"clrabc"},
+   [OP_C_TO_PC] = {"goto c"},
+   [OP_KEYS_TO_C] = {"c = keys"},
+   [OP_SET_HEX] = {"sethex"},
+   [OP_SET_DEC] = {"setdec"},
+   [OP_DISPLAY_OFF] = {"disoff"},
+   [OP_DISPLAY_TOGGLE] = {"distog"},
+   [OP_RETURN_C] = {"rtn c"},
+   [OP_RETURN_NC] = {"rtn nc"},
+   [OP_RETURN] = {"rtn"},
+   [OP_C_TO_REGISTER] = {"regn = c %-2d"},
+   [OP_BLINK] = {"blink"},
+   [OP_N_FROM_C] = {"n = c"},
+   [OP_C_FROM_N] = {"c = n"},
+   [OP_C_EXCH_N] = {"cnex"},
+   [OP_LOAD_IMMEDIATE] = {"ldi"},
+   [OP_PUSH_C] = {"stk = c"},
+   [OP_POP_C] = {"c = stk"},
+   [OP_C_TO_ADDR] = {"dadd = c"},
+   [OP_C_TO_DATA] = {"data = c"},
+   [OP_CXISA] = {"cxisa"},
+   [OP_C_OR_A] = {"c = c or a"},
+   [OP_C_AND_A] = {"c = c and a"},
+   [OP_REGISTER_TO_C] = {"c = regn %-2d"},
+   [OP_ROTATE_C] = {"rcr %-3d"},
+   [OP_GSB_NC] = {"? nc gsb"},
+   [OP_GSB_C] = {"? c gsb"},
+   [OP_GO_TO_NC] = {"? nc goto"},
+   [OP_GO_TO_C] = {"? c goto"},
+   [OP_JC] = {"jc"},
+   [OP_JNC] = {"jnc"},
+};
+#endif
+
+/*
+ * fprint_instruction (file, address, opcode, next)
+ *
+ * Prints an instruction using the same text as the trace, but only  uses
+ * the op-code and the word after it so it doesn't need a processor.  Any
+ * value the trace takes from the processor is left out, so the data
+ * register number is just the one in the op-code.
+ *
+ */
+
+void v_fprint_instruction(FILE *h_file, unsigned int i_address, unsigned int i_opcode, unsigned int i_next) /* Print an instruction */
+{
+   odecoded o_decoded;
+   char c_text[64];
+   unsigned int i_following = i_next_address(i_address);
+   size_t i_length;
+
+   v_decode(&o_decoded, i_address, i_opcode, i_next);
+   fprintf(h_file, h_msg_opcode, (i_address >> 12), (i_address & 0x0fff), i_opcode);
+   if (o_decoded.handler < ARITHMETIC)
+      snprintf(c_text, sizeof(c_text), o_mnemonic[o_decoded.handler].text, s_field_name[o_decoded.field]);
+   else if (o_mnemonic[o_decoded.handler].text != NULL)
+      snprintf(c_text, sizeof(c_text), o_mnemonic[o_decoded.handler].text, o_decoded.arg);
+   else
+      c_text[0] = 0; /* Unexpected op-code */
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   if ((o_decoded.handler == OP_REGISTER_TO_C) && (o_decoded.arg == 0)) strcpy(c_text, "c = data");
+#elif defined(WOODSTOCK) || defined(SPICE) || defined(HP67) /* The HP10 uses the same op-code to read the key code */
+   if ((o_decoded.handler == OP_DATA_TO_C) && (o_decoded.arg != 0)) snprintf(c_text, sizeof(c_text), "data register(%d) -> c", o_decoded.arg);
+#endif
+   i_length = strlen(c_text);
+   while ((i_length > 0) && (c_text[i_length - 1] == ' ')) i_length--;
+   fprintf(h_file, "%.*s", (int) i_length, c_text);
+
+   switch (o_decoded.handler) /* Then anything that depends on the address */
+   {
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   case OP_LOAD_IMMEDIATE:
+      fprintf(h_file, "\n");
+      fprintf(h_file, h_msg_opcode, (i_following >> 12), (i_following & 0x0fff), i_next);
+      fprintf(h_file, "  ");
+      fprintf(h_file, h_msg_address, i_next);
+      break;
+   case OP_GSB_NC:
+   case OP_GSB_C:
+   case OP_GO_TO_NC:
+   case OP_GO_TO_C:
+      fprintf(h_file, "\n");
+      fprintf(h_file, h_msg_opcode, (i_following >> 12), (i_following & 0x0fff), i_next);
+      fprintf(h_file, "  ");
+      fprintf(h_file, h_msg_address, o_decoded.address);
+      break;
+   case OP_JC:
+   case OP_JNC:
+      fprintf(h_file, " ");
+      v_fprint_offset(h_file, i_opcode);
+      break;
 #else
-               else
-               {
-                  h_processor->addr &= 0xfff0;
-                  h_processor->addr += (i_opcode >> 6);
-                  if (h_processor->trace) fprintf(stdout, "data register(%d) -> c", h_processor->addr);
-                  if ((h_processor->addr) < MEMORY_SIZE)
-                     v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->mem[h_processor->addr]);
-                  else
-                  {
-                     if (h_processor->trace) fprintf(stdout, "\n");
-                     v_error(errno, h_err_invalid_address, h_processor->addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-                  }
-               }
+   case OP_JSB:
+   case OP_GO_TO:
+      fprintf(h_file, " ");
+      fprintf(h_file, h_msg_address, ((i_following & 0x0f00) | i_opcode >> 2)); /* Note - uses and eight bit address */
+      break;
 #endif
-               if (h_processor->trace)
-                  v_fprint_register(stdout,h_processor->reg[C_REG]);
-               break;
-            default:
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
+   default:
+      if (o_mnemonic[o_decoded.handler].go_to)
+      {
+         fprintf(h_file, "\n");
+         fprintf(h_file, h_msg_opcode, (i_following >> 12), (i_following & 0x0fff), i_next);
+         fprintf(h_file,"  then go to ");
+#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
+         fprintf(h_file, h_msg_address, (i_following & 0xf00) | i_next >> 2);
+#else
+         fprintf(h_file, h_msg_address, ((i_following & 0xc00) | i_next));
+#endif
+      }
+   }
+}
 
-         case 03: /* Op-Codes matching x xxx xx1 100 */
-            switch ((i_opcode >> 4) & 03)
-            {
-            case 00: /* 0 -> s(n) */
-               if (h_processor->trace) fprintf(stdout, "0 -> s(%d)\t\t", i_opcode >> 6);
-               h_processor->status[i_opcode >> 6] = False;
-               if (h_processor->trace) v_fprint_status(stdout, h_processor);
-               break;
-            case 01: /* if 0 = s(n) */
-               if (h_processor->trace) fprintf(stdout, "if 0 = s(%d) ", i_opcode >> 6);
-               h_processor->flags[CARRY] = !h_processor->status[i_opcode >> 6];
-               v_op_goto(h_processor);
-               break;
-            case 02: /* if p != n */
-               /* 01354 if p !=  0  00554 if p !=  1  00354 if p !=  2
-                * 00754 if p !=  3  00054 if p !=  4  01254 if p !=  5
-                * 00654 if p !=  6  01654 if p !=  7  00154 if p !=  8
-                * 00454 if p !=  9  01554 if p != 10  01454 if p != 11
-                * 00254 if p != 12  01154 if p != 13  N/A   if p != 14
-                * N/A   if p != 15
-               */
-               if (h_processor->trace) fprintf(stdout, "if p != %d", i_tst_p[i_opcode >> 6]);
-               h_processor->flags[CARRY] = (h_processor->p != i_tst_p[i_opcode >> 6]);
-               v_op_goto(h_processor);
-               break;
-            case 03: /* n -> p*/
-               /* 01474  0 -> p  01074  1 -> p  00574  2 -> p
-                * 01174  3 -> p  00174  4 -> p  01674  5 -> p
-                * 01374  6 -> p  00274  7 -> p  00374  8 -> p
-                * 01574  9 -> p  00674 10 -> p  00474 11 -> p
-                * 00774 12 -> p  01274 13 -> p  N/A   14 -> p
-                * N/A   15 -> p
-                * */
-               if (h_processor->trace) fprintf(stdout, "%d -> p\t\t\t", i_set_p[i_opcode >> 6]);
-               h_processor->p = i_set_p[i_opcode >> 6];
-               if (h_processor->trace) fprintf(stdout, "p = %d", h_processor->p);
-               break;
-            }
-            break;
-         }
-         break;
+#if defined(__GNUC__)
+static inline void v_processor_execute(oprocessor *h_processor, const int b_trace) __attribute__ ((always_inline));
+#endif
+static inline void v_processor_execute(oprocessor *h_processor, const int b_trace) /* Decode and execute a single instruction */
+{
+   unsigned int i_last; /* Save the current PC */
+   unsigned int i_opcode;
+   odecoded *h_decoded; /* Predecoded instruction */
+   const char *s_field; /* Holds pointer to field name */
+
+   if (h_processor->enabled && !h_processor->sleep)
+   {
+
+#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
+      /* TIMER : status[11] = 1, status[3] = 0
+       * PRGM  : status[11] = 0, status[3] = 1
+       * RUN   : status[11] = 0, status[3] = 0 */
+      if (h_processor->keypressed) h_processor->status[0] = True; /* Set status bit 0 if key pressed */
+      if (h_processor->mode) h_processor->status[3] = True; /* Set status bits based on switch position */
+      if (h_processor->timer) h_processor->status[11] = True;
+#endif
+
+#if defined(HP21) || defined(HP22) || defined(HP25) || defined(HP25c) || defined(HP27) || defined(HP29c)
+      if (h_processor->keypressed) h_processor->status[15] = True; /* Set status bit if key pressed */
+      if (h_processor->mode) h_processor->status[3] = True; /* Set status bits based on switch position */
+      h_processor->status[5] = True; /* Low Power */
+#endif
+
+#if defined(HP67) /* Seems to use a flag rather then the status word for the switch position */
+      if (h_processor->keypressed) h_processor->status[15] = True; /* Set status bit 15 if key pressed */
+      h_processor->flags[MODE] = h_processor->mode; /* Set the program mode flag based on switch position */
+#endif
+
+#if defined(HP31e) || defined(HP32e) || defined(HP33e) || defined(HP33c) || defined(HP34c) || defined(HP37e) || defined(HP38e) || defined(HP38c) /* Setting S(5) breaks the self test */
+      if (h_processor->keypressed) h_processor->status[15] = True; /* Set status bit if key pressed */
+      if (h_processor->mode) h_processor->status[3] = True; /* Set status bits based on switch position */
+      h_processor->status[5] = False; /* Self Test */
 #endif
 
 #if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
-      case 0x00: /* Type 0 - Special operations */
-         switch ((i_opcode >> 2) & 0xf)
+      if (h_processor->keypressed) h_processor->kyf = True; /* Set keyboard flag if key pressed */
+#endif
+
+      i_opcode = h_processor->rom[h_processor->pc]; /* Get next instruction */
+      i_last = h_processor->pc;
+      h_decoded = &h_processor->decoded[i_last];
+      h_processor->ticks++;
+      if (b_trace)
+         fprintf(h_processor->output, h_msg_opcode, (i_last >> 12), (i_last & 0x0fff), h_processor->rom[i_last]);
+      v_op_inc_pc(h_processor); /* Increment program counter _before_ decoding the opcode */
+      s_field = s_field_name[h_decoded->field];
+      if (h_decoded->handler < ARITHMETIC) /* Type 2 - Arithmetic operations */
+      {
+         if (h_decoded->first >= 0) /* Field fixed when decoded */
+         {
+            h_processor->first = h_decoded->first; h_processor->last = h_decoded->last;
+         }
+         else switch (h_decoded->field) /* Field determined by a pointer */
          {
-         case 0x00:
-            switch (i_opcode >> 6)
+#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
+         case 00: /* P */
+            h_processor->first = h_processor->p; h_processor->last = h_processor->p;
+            if (h_processor->p >= REG_SIZE)
             {
-            case 0x00: /* No operation (00 0000 0000) */
-               if (h_processor->trace) fprintf(stdout, "nop");
-               break;
-            default:
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
             break;
-
-         case 0x01: /* 0 -> status[7:0] - Clear status (11 1100 0100) or 0 -> status[d] - Clear status bit (dd dd00 0100) */
-            if ((i_opcode >> 6) == 7) /* Reserved opcode (01 1100 0100) */
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            if ((i_opcode >> 6) < 15)
-            {
-               if (h_processor->trace) fprintf(stdout, "st = 0 %-2d\t\t", n_map_i[i_opcode >> 6]);
-               h_processor->status[n_map_i[i_opcode >> 6]] = (unsigned char)False;
-            }
-            else
+         case 04: /* WP */
+            h_processor->first =  0; h_processor->last =  h_processor->p; /* break; bug in orig??? */
+            if (h_processor->p >= REG_SIZE)
             {
-               int i_count;
-               if (h_processor->trace) fprintf(stdout, "clrst\t\t");
-               for (i_count = 7; i_count >= 0; i_count--) /* Note only clears bits 7-0 of the status register */
-                  h_processor->status[n_map_i[i_opcode >> 6]] = (unsigned char)False;
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
-            if (h_processor->trace) v_fprint_status(stdout, h_processor);
             break;
-         case 0x02: /* 0 -> kyf  - Reset keyboard (11 1100 1000) or 1 -> status[d] - Set status bit (dd dd00 0100) */
-            if ((i_opcode >> 6) == 7) /* Reserved opcode (01 1100 1000) */
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            if ((i_opcode >> 6) < 15)
-            {
-               if (h_processor->trace) fprintf(stdout, "st = 1 %-2d\t\t", n_map_i[i_opcode >> 6]);
-               h_processor->status[n_map_i[i_opcode >> 6]] = (unsigned char)True;
-               if (h_processor->trace) v_fprint_status(stdout, h_processor);
-            }
-            else
+#endif
+#if defined(WOODSTOCK) || defined(SPICE) || defined(HP10) || defined(HP67)
+         case 00: /* P */
+            h_processor->first = h_processor->p; h_processor->last = h_processor->p;
+            if (h_processor->p >= REG_SIZE)
             {
-               if (h_processor->trace) fprintf(stdout, "rstkb");
-               if (!h_processor->keypressed) h_processor->flags[CARRY] = h_processor->kyf = False; /* Clear keyboard flag if no key pressed */
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
             break;
-         case 0x03: /* Test status bit [dddd] if 0 <= dddd <= 14 (dd dd00 1100) or test keyboard (11 1100 1100) */
-            if ((i_opcode >> 6) == 7) /* Reserved opcode (01 1100 1100) */
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            if ((i_opcode >> 6) < 15)
-            {
-               if (h_processor->trace) fprintf(stdout, "? st = 1 %-2d", n_map_i[i_opcode >> 6]);
-               h_processor->flags[CARRY] = h_processor->status[n_map_i[i_opcode >> 6]];
-            }
-            else
+         case 01: /* WP */
+            h_processor->first =  0; h_processor->last =  h_processor->p; /* break; bug in orig??? */
+            if (h_processor->p >= REG_SIZE)
             {
-               if (h_processor->trace) fprintf(stdout, "chkkb ");
-               h_processor->flags[CARRY] = h_processor->kyf;
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
             break;
-         case 0x04: /* nn -> c[pt] - Load constant n (nn nn01 0000) */
-            if (h_processor->trace) fprintf(stdout, "lc %1x\t\t", i_opcode >> 6);
-            h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor)] = i_opcode >> 6;
-            v_op_dec_pt(h_processor);
-            if (h_processor->trace)
-               v_fprint_register(stdout, h_processor->reg[C_REG]);
-            break;
-         case 0x05: /* Test pointer equal to dddd if 0 <= dddd <= 14 (dd dd00 1100) or decrement pointer (11 1101 0100) */
-            if ((i_opcode >> 6) == 7) /* Reserved opcode (01 1101 0100) */
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            if ((i_opcode >> 6) < 15)
-            {
-               if (h_processor->trace) fprintf(stdout, "? pt = %d", n_map_i[i_opcode >> 6]);
-               h_processor->flags[CARRY] = (*h_active_pointer(h_processor) == n_map_i[i_opcode >> 6]);
-            }
+#endif
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+         case 00: /* Active pointer */
+            if (h_processor->ptr)
+               h_processor->first = h_processor->last = h_processor->q;
             else
+               h_processor->first = h_processor->last = h_processor->p;
+            if (h_processor->p >= REG_SIZE || h_processor->q >= REG_SIZE)
             {
-               if (h_processor->trace) fprintf(stdout, "dec pt");
-               v_op_dec_pt(h_processor);
-            }
-            break;
-
-         case 0x06:
-            switch (i_opcode >> 6)
-            {
-            case 0x0: /* Reserved opcode (00 0001 1000) */
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-               break;
-            case 0x01: /* c[pt + 1:pt] -> g - Load g from c (00 0101 1000) */
-               if (h_processor->trace) fprintf(stdout, "g = c\t\t");
-               h_processor->g[0]  = h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor)] & 0x0f; /* c[pt] -> g[0] */
-               if (*h_active_pointer(h_processor) < (REG_SIZE - 1))  /* Check that pt + 1 is valid */
-                  h_processor->g[1] = h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor) + 1] & 0x0f; /* c[pt + 1] -> g[1] */
-               if (h_processor->trace)
-                  fprintf(stdout, "g = 0x%02x", h_processor->g[0] | (h_processor->g[1] << 4));
-               break;
-            case 0x02: /* g -> c[pt + 1:pt] - Load c from g (00 0101 1000) */
-               if (h_processor->trace) fprintf(stdout, "c = g\t\t");
-               h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor)] = h_processor->g[0]; /* g[0] -> c[pt] */
-               if (*h_active_pointer(h_processor) < (REG_SIZE - 1))  /* Check that pt + 1 is valid */
-                  h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor) + 1] = h_processor->g[1]; /* g[1] -> c[pt + 1] */
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               break;
-            case 0x03: /* g -> c[pt + 1:pt], c[pt + 1:pt] -> g - Exchange c and g (00 1101 1000 */
-               if (h_processor->trace) fprintf(stdout, "cgex\t\t");
-               {
-                  int i_temp[2];
-                  i_temp[0] = h_processor->g[0]; i_temp[1] = h_processor->g[1];
-                  h_processor->g[0] = h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor)] & 0x0f; /* c[pt] -> g[0] */
-                  h_processor->g[1] = 0; /* (0 -> g[1]) */
-                  h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor)] = i_temp[0]; /* g[0] -> c[pt] */
-                  if (*h_active_pointer(h_processor) < (REG_SIZE - 1))  /* Check that pt + 1 is valid */
-                  {
-                     h_processor->g[1] = h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor) + 1] & 0x0f; /* c[pt + 1] -> g[1] */
-                     h_processor->reg[C_REG]->nibble[*h_active_pointer(h_processor) + 1] = i_temp[1]; /* g[1] -> c[pt + 1] */
-                  }
-               }
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               if (h_processor->trace) fprintf(stdout, "g = 0x%02x", h_processor->g[0] | (h_processor->g[1] << 4));
-               break;
-            case 0x05: /* c -> m - Copy C register to M register (01 0101 1000) */
-               if (h_processor->trace) fprintf(stdout, "m = c\t\t");
-               h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-               v_reg_copy(h_processor, h_processor->reg[M_REG], h_processor->reg[C_REG]);
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[M_REG]);
-               break;
-            case 0x06: /* m -> c - Copy M register to C register (01 1001 1000) */
-               if (h_processor->trace) fprintf(stdout, "c = m\t\t");
-               h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-               v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[M_REG]);
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               break;
-            case 0x07: /* c -> m, m -> c - Exchange C register and M register (01 1101 1000) */
-               if (h_processor->trace) fprintf(stdout, "cmex\t\t");
-               h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-               v_reg_exch(h_processor, h_processor->reg[M_REG], h_processor->reg[C_REG]);
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[M_REG]);
-               break;
-            case 0x0e: /* st[0:7] -> c[0:1] - Load c register from the status byte (11 1001 1000) */
-               if (h_processor->trace) fprintf(stdout, "c = st\t\t");
-               {
-                  int i_status, i_count;
-                  i_status = 0;
-                  for (i_count = 7; i_count >= 0 ; i_count--)
-                  {
-                     i_status <<= 1;
-                     if (h_processor->status[i_count]) i_status |= 0x1;
-                  }
-                  h_processor->reg[C_REG]->nibble[0] = i_status & 0xf;
-                  h_processor->reg[C_REG]->nibble[1] = i_status >> 4;
-               }
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               break;
-            case 0x0f: /* c[0:1] -> st[0:7], st[0:7] -> c[0:1] - Exchange c register and the status byte (11 1101 1000) */
-               if (h_processor->trace) fprintf(stdout, "cstex\t\t");
-               {
-                  int i_temp, i_status, i_count;
-                  i_status = 0; /* Save st[0:7] */
-                  for (i_count = 7; i_count >= 0 ; i_count--)
-                  {
-                     i_status <<= 1;
-                     if (h_processor->status[i_count]) i_status |= 0x1;
-                  }
-                  i_temp = h_processor->reg[C_REG]->nibble[0] | h_processor->reg[C_REG]->nibble[1] << 4;
-                  for (i_count = 0; i_count <=7; i_count++)
-                  {
-                     if (i_temp & 0x1)
-                        h_processor->status[i_count] = True;
-                     else
-                        h_processor->status[i_count] = False;
-                     i_temp >>= 1;
-                  }
-                  h_processor->reg[C_REG]->nibble[0] = i_status & 0xf;
-                  h_processor->reg[C_REG]->nibble[1] = i_status >> 4;
-               }
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               if (h_processor->trace) v_fprint_status(stdout, h_processor);
-               break;
-            default:
-               if (h_processor->trace) fprintf(stdout, "\n");
-               /** debug(fprintf(stderr,"%02x\n", (i_opcode >> 6) & 0xf)); */
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
             break;
-         case 0x07: /* Load pointer with dddd if 0 <= dddd <= 14 (dd dd00 1100) or decrement pointer (11 1101 0100) */
-            if ((i_opcode >> 6) == 7) /* Reserved opcode (01 1101 0100)*/
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            if ((i_opcode >> 6) < 15)
-            {
-               if (h_processor->trace) fprintf(stdout, "pt = %d", n_map_i[i_opcode >> 6]);
-               *h_active_pointer(h_processor) = n_map_i[i_opcode >> 6];
-               if (h_processor->trace) fprintf(stdout, "\t\tpt = %02d  ", *h_active_pointer(h_processor));
-            }
+         case 02: /* Word up to the active pointer */
+            h_processor->first =  0;
+            if (h_processor->ptr)
+               h_processor->last = h_processor->q;
             else
+               h_processor->last = h_processor->p;
+            if (h_processor->p >= REG_SIZE || h_processor->q >= REG_SIZE)
             {
-               if (h_processor->trace) fprintf(stdout, "inc pt");
-               v_op_inc_pt(h_processor);
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
             break;
-
-         case 0x08: /* xxxx 10 0000 */
-            switch ((i_opcode >> 6) & 0xf)
+         case 04: /* Selects range based on pointers */
+            h_processor->first = h_processor->p;
+            if (h_processor->p > h_processor->q)
+               h_processor->last = REG_SIZE - 1;
+            else
+               h_processor->last = h_processor->q;
+            if (h_processor->p >= REG_SIZE || h_processor->q >= REG_SIZE)
             {
-            case 0x01: /* Power off (00 0110 0000) */
-               if (h_processor->trace) fprintf(stdout, "powoff");
-               if (h_processor->flags[DISPLAY_ENABLE]) /* Sleep */
-               {
-                  h_processor->sleep = True;
-               }
-               else  /* Poweroff */
-               {
-                  h_processor->flags[CARRY] = True; /* Carry set on deep sleep */
-                  h_processor->enabled = False;
-               }
-               h_processor->pc = 0;
-               break;
-            case 0x02: /* pt = p - Select pointer p (00 1010 0000) */
-               if (h_processor->trace) fprintf(stdout, "sel p\t\t");
-               h_processor->ptr = False;
-               break;
-            case 0x03: /* pt = q - Select pointer q (00 1110 0000) */
-               if (h_processor->trace) fprintf(stdout, "sel q\t\t");
-               h_processor->ptr = True;
-               break;
-            case 0x04: /* ? p == q - Test p equal to q  (01 0010 0000) */
-               if (h_processor->trace) fprintf(stdout, "? p = q\t\t");
-               if (h_processor->p == h_processor->q) h_processor->flags[CARRY] = True;
-               break;
-            case 0x05: /* ? low level detect - Test battery state (01 0110 0000) */
-               if (h_processor->trace) fprintf(stdout, "? lld\t\t");
-               /* Do nothing - battery can never go flat */
-               break;
-            case 0x06: /* 0 -> a, 0 -> b, 0 -> c - Clear registers a, b and c (01 1010 0000) */
-               if (h_processor->trace) fprintf(stdout, "clrabc\t\t");
-               h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-               v_reg_copy(h_processor, h_processor->reg[A_REG], NULL);
-               v_reg_copy(h_processor, h_processor->reg[B_REG], NULL);
-               v_reg_copy(h_processor, h_processor->reg[C_REG], NULL);
-               if (h_processor->trace)
-               {
-                  v_fprint_register(stdout, h_processor->reg[A_REG]);
-                  v_fprint_register(stdout, h_processor->reg[B_REG]);
-                  v_fprint_register(stdout, h_processor->reg[C_REG]);
-               }
-               break;
-            case 0x07: /* c[6:3] -> pc - Branch using C register (01 1110 0000) */
-               if (h_processor->trace) fprintf(stdout, "goto c\t\t");
-               h_processor->pc = (((h_processor->reg[C_REG]->nibble[6])<< 12) |
-                  (h_processor->reg[C_REG]->nibble[5] << 8) |
-                  (h_processor->reg[C_REG]->nibble[4] << 4) |
-                  (h_processor->reg[C_REG]->nibble[3]));
-               break;
-            case 0x08: /* keys -> c[4:3] - Load c from keys (10 0010 0000) */
-               if (h_processor->trace) fprintf(stdout, "c = keys\t\t");
-               h_processor->reg[C_REG]->nibble[3] = h_processor->code & 0xf;
-               h_processor->reg[C_REG]->nibble[4] = (h_processor->code >> 4) & 0xf;
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               break;
-            case 0x09: /* 0 -> decimal - Set hex mode(10 0110 0000) */
-               if (h_processor->trace) fprintf(stdout, "sethex");
-               h_processor->base = 16;
-               break;
-            case 0x0a: /* 1 -> decimal - Set decimal mode (10 0110 0000) */
-               if (h_processor->trace) fprintf(stdout, "setdec");
-               h_processor->base = 10;
-               break;
-            case 0x0b: /* 0 -> display - Display off (10 1110 0000) */
-               if (h_processor->trace) fprintf(stdout, "disoff");
-               h_processor->flags[DISPLAY_ENABLE] = False;
-               break;
-            case 0x0c: /* ~display -> display - Display toggle (10 1110 0000) */
-               if (h_processor->trace) fprintf(stdout, "distog");
-               h_processor->flags[DISPLAY_ENABLE] = !h_processor->flags[DISPLAY_ENABLE];
-               break;
-            case 0x0d: /* if carry stack[0] -> pc, stack[1] -> stack[0], stack[2] -> stack[1], stack[3] -> stack[2], 0 -> stack[3] - Return if carry (11 0110 0000) */
-               if (h_processor->trace) fprintf(stdout, "rtn c");
-               if (h_processor->flags[PREV_CARRY])
-               {
-                  h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
-                  h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter from the stack */
-               }
-               break;
-            case 0x0e: /* if !carry stack[0] -> pc, stack[1] -> stack[0], stack[2] -> stack[1], stack[3] -> stack[2], 0 -> stack[3] - Return if no carry (11 1010 0000) */
-               if (h_processor->trace) fprintf(stdout, "rtn nc");
-               if (!h_processor->flags[PREV_CARRY])
-               {
-                  h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
-                  h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter from the stack */
-               }
-               break;
-            case 0x0f: /* stack[0] -> pc, stack[1] -> stack[0], stack[2] -> stack[1], stack[3] -> stack[2], 0 -> stack[3] - Return (11 1110 0000) */
-               if (h_processor->trace) fprintf(stdout, "rtn");
-               h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
-               h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter from the stack */
-               break;
-            default:
-               if (h_processor->trace) fprintf(stdout, "\n");
-               /** debug(fprintf(stderr,"%02x\n", (i_opcode >> 6) & 0xf)); */
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
             break;
-         case 0x0a: /* {addr[11:4], nnnn} -> addr, c -> reg[addr] - Load register from c (nn nn10 1000) */
-            if (h_processor->trace) fprintf(stdout, "regn = c %-2d", (i_opcode >> 6));
-            h_processor->addr = (h_processor->addr & 0xff0) | (i_opcode >> 6);
-            h_processor->first = 0;
-            h_processor->last = REG_SIZE - 1;
-            if (i_translate_addr(h_processor->addr) < MEMORY_SIZE)
-#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
-               if ((h_processor->addr != 0x08) && (h_processor->addr != 0x18))  /* Non existent registers */
 #endif
-               {
-                  v_reg_copy(h_processor, h_processor->mem[i_translate_addr(h_processor->addr)], h_processor->reg[C_REG]);
-                  if (h_processor->trace) v_fprint_register(stdout, h_processor->mem[i_translate_addr(h_processor->addr)]);
-               }
-            break;
-         case 0x0c:
-            switch ((i_opcode >> 6) & 0xf)
-            {
-#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
-            case 0x00: /* display blink- Display blink (00 0011 0000) */
-               if (h_processor->trace) fprintf(stdout, "blink\t\t");
-               h_processor->flags[DISPLAY_ENABLE] = True;
-               break;
-#endif
-            case 0x01: /* c -> n - Load n from c (00 0111 0000) */
-               if (h_processor->trace) fprintf(stdout, "n = c\t\t");
-               h_processor->first = 0;
-               h_processor->last = REG_SIZE - 1;
-               v_reg_copy(h_processor, h_processor->reg[N_REG], h_processor->reg[C_REG]);
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[N_REG]);
-               break;
-            case 0x02: /* n -> c - Load C from N (00 1011 0000) */
-               if (h_processor->trace) fprintf(stdout, "c = n\t\t");
-               h_processor->first = 0;
-               h_processor->last = REG_SIZE - 1;
-               v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[N_REG]);
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               break;
-            case 0x03: /* c -> n, n-> c - Exchange c and n (00 1111 0000) */
-               h_processor->first = 0;
-               h_processor->last = REG_SIZE - 1;
-               if (h_processor->trace) fprintf(stdout, "cnex\t\t");
-               v_reg_exch(h_processor, h_processor->reg[N_REG], h_processor->reg[C_REG]);
-               if (h_processor->trace)
-               {
-                  v_fprint_register(stdout, h_processor->reg[C_REG]);
-                  v_fprint_register(stdout, h_processor->reg[N_REG]);
-               }
-            break;
-            case 0x04: /* rom[pc++] -> c[2:0] - Load immediate (01 0011 0000) */
-               {
-                  int i_next;
-                  i_next = h_processor->rom[h_processor->pc]; /* Get next opcode */
-                  h_processor->reg[C_REG]->nibble[2] = (i_next >> 8) & 0xf;
-                  h_processor->reg[C_REG]->nibble[1] = (i_next >> 4) & 0xf;
-                  h_processor->reg[C_REG]->nibble[0] = i_next & 0xf;
-                  if (h_processor->trace)
-                  {
-                     fprintf(stdout, "ldi\n");
-                     fprintf(stdout, h_msg_opcode, (h_processor->pc >> 12), (h_processor->pc & 0x0fff), h_processor->rom[h_processor->pc]);
-                     fprintf(stdout,"  ");
-                     fprintf(stdout, h_msg_address, i_next);
-                     fprintf(stdout, "\t\t");
-                     v_fprint_register(stdout, h_processor->reg[C_REG]);
-                  }
-                  v_op_inc_pc(h_processor); /* Increment program counter */
-               }
-               break;
-            case 0x05: /* stack[2] -> stack[3], stack[1] -> stack[2], stack[0] -> stack[1], c -> stack[0] - Push c[6:3] onto the stack (01 0111 0000) */
-               if (h_processor->trace) fprintf(stdout, "stk = c\t\t");
-               h_processor->stack[h_processor->sp] = (h_processor->reg[C_REG]->nibble[6] << 12) | (h_processor->reg[C_REG]->nibble[5] << 8) | (h_processor->reg[C_REG]->nibble[4] << 4) | (h_processor->reg[C_REG]->nibble[3]);
-               h_processor->sp = (h_processor->sp + 1) & (STACK_SIZE - 1); /* Update stack pointer */
-               break;
-            case 0x06: /* stack[2] -> stack[3], stack[1] -> stack[2], stack[0] -> stack[1], c -> stack[0] - Pop c[6:3] from the stack (01 0111 0000) */
-               if (h_processor->trace) fprintf(stdout, "c = stk\t\t");
-               h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
-               h_processor->reg[C_REG]->nibble[3] = h_processor->stack[h_processor->sp] & 0xf;
-               h_processor->reg[C_REG]->nibble[4] = (h_processor->stack[h_processor->sp] >> 4) & 0xf;
-               h_processor->reg[C_REG]->nibble[5] = (h_processor->stack[h_processor->sp] >> 8) & 0xf;
-               h_processor->reg[C_REG]->nibble[6] = (h_processor->stack[h_processor->sp] >> 12) & 0xf;
-               break;
-            case 0x09: /* {addr[11:4], nnnn} -> addr, c -> reg[addr] - Load register address from c (10 0111 1000) */
-                  if (h_processor->trace) fprintf(stdout, "dadd = c\t\t");
-                  h_processor->addr = ((h_processor->reg[C_REG]->nibble[2] << 8) |
-                     (h_processor->reg[C_REG]->nibble[1] << 4) |
-                     (h_processor->reg[C_REG]->nibble[0])) & 0x3ff; /* Load 12 bit address into address register from c */
-                  if (h_processor->trace) fprintf(stdout, "addr = %d", h_processor->addr);
-               break;
-            case 0x0b: /* data = c - Load register from c (10 1111 0000) */
-               if (h_processor->trace) fprintf(stdout, "data = c\t\t");
-               if ((i_translate_addr(h_processor->addr) < MEMORY_SIZE) && (h_processor->addr != 0x08) && (h_processor->addr != 0x18))
-               {
-                  h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-                  v_reg_copy(h_processor, h_processor->mem[i_translate_addr(h_processor->addr)], h_processor->reg[C_REG]);
-                  if (h_processor->trace) v_fprint_register(stdout, h_processor->mem[i_translate_addr(h_processor->addr)]);
-               }
-               break;
-            case 0x0c: /* c[6:3] -> addr, ram[addr] -> c[2:0] - Exchange c and memory (11 0011 0000) */
-               if (h_processor->trace) fprintf(stdout, "cxisa\t\t");
-               {
-                  int i_addr;
-                  i_addr = (((h_processor->reg[C_REG]->nibble[6])<< 12) | (h_processor->reg[C_REG]->nibble[5] << 8) |
-                     (h_processor->reg[C_REG]->nibble[4] << 4) | (h_processor->reg[C_REG]->nibble[3]));
-                  if (i_addr > ROM_SIZE)
-                     {
-                        if (h_processor->trace) fprintf(stdout, "\n");
-                        v_error(errno, h_err_invalid_address, i_addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-                     }
-                  else
-                  {
-                     h_processor->reg[C_REG]->nibble[2] = (h_processor->rom[i_addr] >> 8) & 0xf;
-                     h_processor->reg[C_REG]->nibble[1] = (h_processor->rom[i_addr] >> 4) & 0xf;
-                     h_processor->reg[C_REG]->nibble[0] = (h_processor->rom[i_addr]) & 0xf;
-                  }
-               }
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               break;
-            case 0x0d: /* c | a -> c - Load c with c or a (11 0111 0000) */
-               if (h_processor->trace) fprintf(stdout, "c = c or a\t\t");
-               h_processor->first = 0;
-               h_processor->last = REG_SIZE - 1;
-               v_reg_or(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               break;
-            case 0x0e: /* c | a -> c - Load c with c and a (11 0111 0000) */
-               if (h_processor->trace) fprintf(stdout, "c = c and a");
-               h_processor->first = 0;
-               h_processor->last = REG_SIZE - 1;
-               v_reg_and(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
-               if (h_processor->trace) v_fprint_register(stdout, h_processor->reg[C_REG]);
-               break;
-
-            default:
-               if (h_processor->trace) fprintf(stdout, "\n");
-               /** debug(fprintf(stderr,"%02x\n", (i_opcode >> 6) & 0xf)); */
-               v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
-         case 0x0e: /* {addr[11:4], nnnn} -> addr, reg[addr] -> c - Load c from register (nn nn11 1000) */
-            if (i_opcode >> 6)
-            {
-               if (h_processor->trace) fprintf(stdout, "c = regn %-2d", i_opcode >> 6);
-               h_processor->addr = (h_processor->addr & 0xff0) | (i_opcode >> 6);
-            }
-            else
-               if (h_processor->trace) fprintf(stdout, "c = data\t\t");
-            h_processor->first = 0;
-            h_processor->last = REG_SIZE - 1;
-            if ((i_translate_addr(h_processor->addr) < MEMORY_SIZE) && (h_processor->addr != 0x08) && (h_processor->addr != 0x18)) /* Treat registers 8 and 18 as if they dont exist */
-               v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->mem[i_translate_addr(h_processor->addr)]);
-            else
-               v_reg_copy(h_processor, h_processor->reg[C_REG], NULL); /* Return zeros if memory doesnt' exist */
-            if (h_processor->trace)
-            {
-               v_fprint_register(stdout,h_processor->reg[C_REG]);
-               fprintf(stdout, "\taddr = %d", h_processor->addr);
-            }
-            break;
-         case 0x0f: /* Rotate c register right (dddd 1111 00) */
-            if (h_processor->trace) fprintf(stdout, "rcr %-3d\t\t", n_map_i[i_opcode >> 6]);
-            {
-               int i_count; ;
-               for (i_count = n_map_i[i_opcode >> 6]; i_count > 0; i_count--)
-               {
-                  int c_temp, i_count;
-                  c_temp = h_processor->reg[C_REG]->nibble[0];
-                  for (i_count = 0; i_count < REG_SIZE; i_count++)
-                     h_processor->reg[C_REG]->nibble[i_count] = h_processor->reg[C_REG]->nibble[i_count + 1];
-                  h_processor->reg[C_REG]->nibble[REG_SIZE - 1] = c_temp;
-                  h_processor->flags[PREV_CARRY] = h_processor->flags[CARRY] = False;
-               }
-            }
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-
          default:
-            if (h_processor->trace) fprintf(stdout, "\n");
-            /** debug(fprintf(stderr,"%02x\n", (i_opcode >> 2) & 0xf)); */
+            if (b_trace) fprintf(h_processor->output, "\n");
             v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
          }
-         break;
-#endif
+      }
 
-#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
-      case 01: /* Type 1 - Branch instruction (two words) */
+      switch (h_decoded->handler) /* Everything needed to execute the instruction was worked out when it was decoded */
+      {
+#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
+      case 000: /* if b[f] = 0 */
+         if (b_trace) fprintf(h_processor->output, "if b[%s] = 0", s_field);
+         v_reg_test_eq(h_processor, h_processor->reg[B_REG], NULL);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 001: /* 0 -> b[f] */
+         if (b_trace)fprintf(h_processor->output, "0 -> b[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[B_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 002: /* if a >= c[f] */
+         if (b_trace) fprintf(h_processor->output, "if a >= c[%s]", s_field);
+         v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[C_REG]); /* Less than */
+         h_processor->flags[CARRY] = !h_processor->flags[CARRY];
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 003: /* if c[f] != 0 */
+         if (b_trace) fprintf(h_processor->output, "if c[%s] != 0", s_field);
+         v_reg_test_ne(h_processor, h_processor->reg[C_REG], NULL);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 004: /* b -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "b -> c[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 005: /* 0 - c -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "0 - c -> c[%s]", s_field);
+         v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 006: /* 0 -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "0 -> c[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[C_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 007: /* 0 - c - 1 -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "0 - c - 1 -> c[%s]\t\t", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 010: /* shift left a[f] */
+         if (b_trace) fprintf(h_processor->output, "shift left a[%s]\t\t", s_field);
+         v_reg_shl(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 011: /* a -> b[f] */
+         if (b_trace) fprintf(h_processor->output, "a -> b[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[B_REG], h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 012: /* a - c -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "a - c -> c[%s]\t\t", s_field);
+         v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 013: /* c - 1 -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "c - 1 -> c[%s]\t\t", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 014: /* c -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "c -> a[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 015: /* if c[f] = 0 */
+         if (b_trace) fprintf(h_processor->output, "if c[%s] = 0", s_field);
+         v_reg_test_eq(h_processor, h_processor->reg[C_REG], NULL);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 016: /* a + c -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "a + c -> c[%s]\t\t", s_field);
+         v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 017: /* c + 1 -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "c + 1 -> c[%s]\t\t", s_field);
+         v_reg_inc(h_processor, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 020: /* if a >= b[f] */
+         if (b_trace) fprintf(h_processor->output, "if a >= b[%s]", s_field);
+         v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[B_REG]); /* Less than */
+         h_processor->flags[CARRY] = !h_processor->flags[CARRY];
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 021: /* b exchange c[f] */
+         if (b_trace) fprintf(h_processor->output, "b exch c[%s]\t\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[B_REG], h_processor->reg[C_REG]);
+         if (b_trace)
          {
-            int i_address, i_next;
-            i_address = i_opcode >> 2;
-            i_next = h_processor->rom[h_processor->pc]; /* Get next opcode */
-            i_address |= ((i_next & 0x3fc) << 6);
-            if (h_processor->trace)
-            {
-               switch (i_next & 0x3)
-               {
-               case 0x0:
-                  fprintf(stdout, "? nc gsb\t\t");
-                  break;
-               case 0x1:
-                  fprintf(stdout, "? c gsb\t\t");
-                  break;
-               case 0x2:
-                  fprintf(stdout, "? nc goto\t\t");
-                  break;
-               case 0x3:
-                  fprintf(stdout, "? c goto\t\t");
-                  break;
-               }
-               fprintf(stdout, "\n");
-               fprintf(stdout, h_msg_opcode, (h_processor->pc >> 12), (h_processor->pc & 0x0fff), h_processor->rom[h_processor->pc]);
-               fprintf(stdout,"  ");
-               fprintf(stdout, h_msg_address, i_address);
-            }
-            h_processor->flags[CARRY] = h_processor->flags[PREV_CARRY]; /* Save carry */
-            v_op_inc_pc(h_processor); /* Increment program counter */
-            switch (i_next & 0x3)
-            {
-            case 0x0: /* if no carry then stack[2] -> stack[3], stack[1] -> stack[2], stack[0] -> stack[1], pc -> stack[0], a -> pc - Branch to subroutine on no carry (aa aaaa aa00, aa aaaa aa00) */
-               if (i_address < ROM_SIZE) /* Check that the target address exists otherwise treat as a 'nop' */
-                  if (!h_processor->flags[PREV_CARRY]) op_jsb(h_processor, i_address);
-               break;
-            case 0x1: /* if carry then stack[2] -> stack[3], stack[1] -> stack[2], stack[0] -> stack[1], pc -> stack[0], a -> pc - Branch to subroutine on no carry (aa aaaa aa00, aa aaaa aa01) */
-               if (i_address < ROM_SIZE) /* Check that the target address exists otherwise treat as a 'nop' */
-                  if (h_processor->flags[PREV_CARRY]) op_jsb(h_processor, i_address);
-               break;
-            case 0x2:  /* if no carry then a -> pc - Branch on no carry (aa aaaa aa00, aa aaaa aa10) */
-               if (!h_processor->flags[PREV_CARRY])
-                  h_processor->pc = i_address;
-               break;
-            case 0x3: /* if carry then a -> pc - Branch on carry (aa aaaa aa00, aa aaaa aa11) */
-               if (h_processor->flags[PREV_CARRY])
-                  h_processor->pc = i_address;
-               break;
-            }
+            v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
          }
          break;
-#else
-      case 01: /* Type 1 - Jump subroutine */
-         if (h_processor->trace) {fprintf(stdout, "jsb "); fprintf(stdout, h_msg_address, ((h_processor->pc & 0x0f00) | i_opcode >> 2));}
-         op_jsb(h_processor, (i_opcode >> 2)); /* Note - uses and eight bit address */
+      case 022: /* shift right c[f] */
+         if (b_trace) fprintf(h_processor->output, "shift right c[%s]\t", s_field);
+         v_reg_shr(h_processor, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 023: /* if a[f] != 0 */
+         if (b_trace) fprintf(h_processor->output, "if a[%s] != 0", s_field);
+         v_reg_test_ne(h_processor, h_processor->reg[A_REG], NULL);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 024: /* shift right b[f] */
+         v_reg_shr(h_processor, h_processor->reg[B_REG]);
+         if (b_trace) fprintf(h_processor->output, "shift right b[%s]\t", s_field);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 025: /* c + c -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "c + c -> c[%s]\t", s_field);
+         v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 026: /* shift right a[f] */
+         if (b_trace) fprintf(h_processor->output, "shift right a[%s]\t", s_field);
+         v_reg_shr(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 027: /* 0 -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "0 -> a[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[A_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 030: /* a - b -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a - b -> a[%s]\t", s_field);
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 031: /* a exch b[f] */
+         if (b_trace) fprintf(h_processor->output, "a exch b[%s]\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         }
+         break;
+      case 032: /* a - c -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a - c -> a[%s]\t", s_field);
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 033: /* a - 1 -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a - 1 -> a[%s]\t", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 034: /* a + b -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a + b -> a[%s]\t", s_field);
+         v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 035: /* a exch c[f] */
+         if (b_trace) fprintf(h_processor->output, "a exch c[%s]\t\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         }
+         break;
+      case 036: /* a + c -> a[a + c -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a + c -> a[%s]", s_field);
+         v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 037: /* a + 1 -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a + 1 -> a[%s]", s_field);
+         v_reg_inc(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
          break;
-#endif
 
-#if defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
-      case 02: /* Type 2 - Arithmetic operations */
-         i_field = (i_opcode >> 2) & 7;
-         switch (i_field) /* Select field
-            000   P  : determined by P                   [P]
-            001   M  : mantissa                          [3 .. 12]
-            010   X  : exponent                          [0 ..  1]
-            011   W  : word                              [0 .. 13]
-            100  WP  : word up to and including P        [0 ..  P]
-            101  MS  : mantissa and sign                 [3 .. 13]
-            110  XS  : exponent sign                     [2]
-            111   S  : sign                              [13] */
+      case OP_NOP: /* nop */
+         if (b_trace) fprintf(h_processor->output, "nop");
+         break;
+      case OP_SELECT_ROM: /* select rom */
+         if (b_trace) fprintf(h_processor->output, "select rom %02o", h_decoded->arg); /* Note - Not the same as the Woodstock CPU */
+         h_processor->pc = ((h_decoded->arg) << 8) + ((h_processor->pc) & 0xff);
+         break;
+      case OP_KEYS_TO_ROM: /* keys -> rom address */
+         if (b_trace) fprintf(h_processor->output, "keys -> rom address");
+         h_processor->pc &= 0xff00;
+         v_delayed_rom(h_processor);
+         h_processor->pc += h_processor->code;
+         h_processor->keyscan = True;
+         break;
+      case OP_RETURN: /* return */
+         if (b_trace) fprintf(h_processor->output, "return");
+         h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
+         h_processor->pc = (h_processor->pc & (~0xff)) + (h_processor->stack[h_processor->sp] & 0xff); /* Pop program counter from the stack */
+         if (h_processor->profile != NULL) v_profile_return(h_processor);
+         break;
+      case OP_C_TO_ADDR: /* c -> data address */
          {
-         case 00: /* P */
-            s_field = "p";
-            h_processor->first = h_processor->p; h_processor->last = h_processor->p;
-            if (h_processor->p >= REG_SIZE)
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
-         case 01: /* M */
-            s_field = "m";
-            h_processor->first = EXP_SIZE; h_processor->last = REG_SIZE - 2;
-            break;
-         case 02: /* X */
-            s_field = "x";
-            h_processor->first = 0; h_processor->last = EXP_SIZE - 1;
-            break;
-         case 03: /* W */
-            s_field = "w";
-            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-            break;
-         case 04: /* WP */
-            s_field = "wp";
-            h_processor->first =  0; h_processor->last =  h_processor->p; /* break; bug in orig??? */
-            if (h_processor->p >= REG_SIZE)
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+            int i_addr;
+            if (b_trace) fprintf(h_processor->output, "c -> data address\t");
+            i_addr = NIBBLE(h_processor->reg[C_REG], 12);
+            h_processor->addr = i_addr;
+            if (i_addr < MEMORY_SIZE)
+               h_processor->addr = i_addr;
+            else {
+               h_processor->addr = MEMORY_SIZE - 1;
             }
-            break;
-         case 05: /* MS */
-            s_field = "ms";
-            h_processor->first = EXP_SIZE; h_processor->last = REG_SIZE - 1;
-            break;
-         case 06: /* XS */
-            s_field = "xs";
-            h_processor->first = EXP_SIZE - 1; h_processor->last = EXP_SIZE - 1;
-            break;
-         case 07: /* S */
-            s_field = "s";
-            h_processor->first = REG_SIZE - 1; h_processor->last = REG_SIZE - 1;
-            break;
          }
-
-         switch (i_opcode >> 5)
+         if (b_trace) fprintf(h_processor->output, "addr = %d", h_processor->addr);
+         break;
+      case OP_C_TO_DATA: /* c -> data */
+         if (b_trace) fprintf(h_processor->output, "c -> data\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         if (h_processor->addr < MEMORY_SIZE)
+            v_reg_copy(h_processor, h_processor->mem[h_processor->addr], h_processor->reg[C_REG]);
+         else
          {
-         case 000: /* if b[f] = 0 */
-            if (h_processor->trace) fprintf(stdout, "if b[%s] = 0", s_field);
-            v_reg_test_eq(h_processor, h_processor->reg[B_REG], NULL);
-            v_op_goto(h_processor);
-            break;
-         case 001: /* 0 -> b[f] */
-            if (h_processor->trace)fprintf(stdout, "0 -> b[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[B_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 002: /* if a >= c[f] */
-            if (h_processor->trace) fprintf(stdout, "if a >= c[%s]", s_field);
-            v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[C_REG]); /* Less than */
-            h_processor->flags[CARRY] = !h_processor->flags[CARRY];
-            v_op_goto(h_processor);
-            break;
-         case 003: /* if c[f] != 0 */
-            if (h_processor->trace) fprintf(stdout, "if c[%s] != 0", s_field);
-            v_reg_test_ne(h_processor, h_processor->reg[C_REG], NULL);
-            v_op_goto(h_processor);
-            break;
-         case 004: /* b -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "b -> c[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 005: /* 0 - c -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "0 - c -> c[%s]", s_field);
-            v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 006: /* 0 -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "0 -> c[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[C_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 007: /* 0 - c - 1 -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "0 - c - 1 -> c[%s]\t\t", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 010: /* shift left a[f] */
-            if (h_processor->trace) fprintf(stdout, "shift left a[%s]\t\t", s_field);
-            v_reg_shl(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 011: /* a -> b[f] */
-            if (h_processor->trace) fprintf(stdout, "a -> b[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[B_REG], h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 012: /* a - c -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "a - c -> c[%s]\t\t", s_field);
-            v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 013: /* c - 1 -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "c - 1 -> c[%s]\t\t", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 014: /* c -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "c -> a[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 015: /* if c[f] = 0 */
-            if (h_processor->trace) fprintf(stdout, "if c[%s] = 0", s_field);
-            v_reg_test_eq(h_processor, h_processor->reg[C_REG], NULL);
-            v_op_goto(h_processor);
-            break;
-         case 016: /* a + c -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "a + c -> c[%s]\t\t", s_field);
-            v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 017: /* c + 1 -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "c + 1 -> c[%s]\t\t", s_field);
-            v_reg_inc(h_processor, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 020: /* if a >= b[f] */
-            if (h_processor->trace) fprintf(stdout, "if a >= b[%s]", s_field);
-            v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[B_REG]); /* Less than */
-            h_processor->flags[CARRY] = !h_processor->flags[CARRY];
-            v_op_goto(h_processor);
-            break;
-         case 021: /* b exchange c[f] */
-            if (h_processor->trace) fprintf(stdout, "b exch c[%s]\t\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[B_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace)
+            if (b_trace) fprintf(h_processor->output, "\n");
+            v_error(errno, h_err_invalid_register, h_processor->addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+         }
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->mem[h_processor->addr]);
+         break;
+      case OP_SET_S: /* 1 -> s(n) */
+         if (b_trace) fprintf(h_processor->output, "1 -> s(%d)\t\t", h_decoded->arg);
+         h_processor->status[h_decoded->arg] = True;
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_TEST_S0: /* if 0 = s(n) */
+         if (b_trace) fprintf(h_processor->output, "if 0 = s(%d) ", h_decoded->arg);
+         h_processor->flags[CARRY] = !h_processor->status[h_decoded->arg];
+         h_processor->keytest = ((h_decoded->arg) == KEY_STATUS);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case OP_CLEAR_S: /* 0 -> s(n) */
+         if (b_trace) fprintf(h_processor->output, "0 -> s(%d)\t\t", h_decoded->arg);
+         h_processor->status[h_decoded->arg] = False;
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_CLEAR_STATUS: /* clear status */
+         if (b_trace) fprintf(h_processor->output, "clear status\t");
+         {
+            int i_count;
+            for (i_count = 0; i_count < sizeof(h_processor->status) / sizeof(*h_processor->status); i_count++)
+               h_processor->status[i_count] = False; /* Clear all bits */
+         }
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_DELAYED_ROM: /* delayed select rom n */
+         if (b_trace) fprintf(h_processor->output, "delayed select rom %d", h_decoded->arg); /* Note - Not the same as the Woodstock CPU */
+         h_processor->rom_number = h_decoded->arg;
+         h_processor->flags[DELAYED_ROM] = True;
+         break;
+      case OP_LOAD_CONSTANT: /* load constant n */
+         if (b_trace) fprintf(h_processor->output, "load constant %d\t", h_decoded->arg);
+         v_nibble_set(h_processor->reg[C_REG], h_processor->p, h_decoded->arg);
+         v_op_dec_p(h_processor);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case OP_DISPLAY_TOGGLE: /* display toggle */
+         if (b_trace) fprintf(h_processor->output, "display toggle");
+         h_processor->flags[DISPLAY_ENABLE] = (!h_processor->flags[DISPLAY_ENABLE]);
+         break;
+      case OP_M_EXCH_C: /* m exch c */
+         if (b_trace) fprintf(h_processor->output, "m exch c\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_exch(h_processor, h_processor->reg[M_REG], h_processor->reg[C_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[M_REG]);
+         }
+         break;
+      case OP_C_TO_STACK: /* c -> stack */
+         if (b_trace) fprintf(h_processor->output, "c -> stack\t\t");
+            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+            v_reg_copy(h_processor, h_processor->reg[T_REG], h_processor->reg[Z_REG]); /* T = Z */
+            v_reg_copy(h_processor, h_processor->reg[Z_REG], h_processor->reg[Y_REG]); /* T = Z */
+            v_reg_copy(h_processor, h_processor->reg[Y_REG], h_processor->reg[C_REG]); /* T = Z */
+            if (b_trace)
             {
-               v_fprint_register(stdout,h_processor->reg[B_REG]);
-               v_fprint_register(stdout,h_processor->reg[C_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[Y_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[Z_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[T_REG]);
             }
-            break;
-         case 022: /* shift right c[f] */
-            if (h_processor->trace) fprintf(stdout, "shift right c[%s]\t", s_field);
-            v_reg_shr(h_processor, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 023: /* if a[f] != 0 */
-            if (h_processor->trace) fprintf(stdout, "if a[%s] != 0", s_field);
-            v_reg_test_ne(h_processor, h_processor->reg[A_REG], NULL);
-            v_op_goto(h_processor);
-            break;
-         case 024: /* shift right b[f] */
-            v_reg_shr(h_processor, h_processor->reg[B_REG]);
-            if (h_processor->trace) fprintf(stdout, "shift right b[%s]\t", s_field);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 025: /* c + c -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "c + c -> c[%s]\t", s_field);
-            v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 026: /* shift right a[f] */
-            if (h_processor->trace) fprintf(stdout, "shift right a[%s]\t", s_field);
-            v_reg_shr(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 027: /* 0 -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "0 -> a[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[A_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 030: /* a - b -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a - b -> a[%s]\t", s_field);
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 031: /* a exch b[f] */
-            if (h_processor->trace) fprintf(stdout, "a exch b[%s]\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace)
+         break;
+      case OP_STACK_TO_A: /* stack -> a */
+         if (b_trace) fprintf(h_processor->output, "stack -> a\t\t");
+            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+            v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[Y_REG]); /* T = Z */
+            v_reg_copy(h_processor, h_processor->reg[Y_REG], h_processor->reg[Z_REG]); /* T = Z */
+            v_reg_copy(h_processor, h_processor->reg[Z_REG], h_processor->reg[T_REG]); /* T = Z */
+            if (b_trace)
             {
-               v_fprint_register(stdout,h_processor->reg[A_REG]);
-               v_fprint_register(stdout,h_processor->reg[B_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[Y_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[Z_REG]);
             }
-            break;
-         case 032: /* a - c -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a - c -> a[%s]\t", s_field);
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 033: /* a - 1 -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a - 1 -> a[%s]\t", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 034: /* a + b -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a + b -> a[%s]\t", s_field);
-            v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 035: /* a exch c[f] */
-            if (h_processor->trace) fprintf(stdout, "a exch c[%s]\t\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace)
+         break;
+      case OP_DISPLAY_OFF: /* display off */
+         if (b_trace) fprintf(h_processor->output, "display off");
+         h_processor->flags[DISPLAY_ENABLE] = False;
+         break;
+      case OP_M_TO_C: /* m -> c */
+         if (b_trace) fprintf(h_processor->output, "m -> c\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[M_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case OP_DOWN_ROTATE: /* down rotate */
+         if (b_trace) fprintf(h_processor->output, "down rotate\t\t");
+            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+            v_reg_exch(h_processor, h_processor->reg[T_REG], h_processor->reg[C_REG]); /* T <> C - C to T */
+            v_reg_exch(h_processor, h_processor->reg[C_REG], h_processor->reg[Y_REG]); /* C <> Y - Y to C */
+            v_reg_exch(h_processor, h_processor->reg[Y_REG], h_processor->reg[Z_REG]); /* Y <> Z - Z to Y and T ends up in Z */
+            if (b_trace)
             {
-               v_fprint_register(stdout,h_processor->reg[A_REG]);
-               v_fprint_register(stdout,h_processor->reg[C_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[Y_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[Z_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[T_REG]);
             }
-            break;
-         case 036: /* a + c -> a[a + c -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a + c -> a[%s]", s_field);
-            v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 037: /* a + 1 -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a + 1 -> a[%s]", s_field);
-            v_reg_inc(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         default:
-            if (h_processor->trace) fprintf(stdout, "\n");
-            v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+         break;
+      case OP_CLEAR_REGISTERS: /* clear registers */
+         if (b_trace) fprintf(h_processor->output, "clear registers");
+         {
+            int i_count;
+            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+            for (i_count = 0; i_count < REGISTERS - 2; i_count++) /* Don't clear M or N */
+               v_reg_copy(h_processor, h_processor->reg[i_count], NULL); /* Copying nothing to a register clears it */
+         }
+         break;
+      case OP_DATA_TO_C: /* data -> c */
+         if (b_trace) fprintf(h_processor->output, "data -> c\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->mem[h_processor->addr]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case OP_SET_P: /* n -> p */
+         if (b_trace) fprintf(h_processor->output, "%d -> p", h_decoded->arg);
+         h_processor->p = h_decoded->arg;
+         break;
+      case OP_DEC_P: /* p - 1 -> p */
+         if (b_trace) fprintf(h_processor->output, "p - 1 -> p");
+         v_op_dec_p(h_processor);
+         break;
+      case OP_TEST_P_NE: /* if p != n */
+         if (b_trace) fprintf(h_processor->output, "if p != %d", h_decoded->arg);
+         h_processor->flags[CARRY] = (h_processor->p != h_decoded->arg);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case OP_INC_P: /* p + 1 -> p */
+         if (b_trace) fprintf(h_processor->output, "p + 1 -> p");
+         v_op_inc_p(h_processor);
+         break;
+      case OP_JSB: /* Type 1 - Jump subroutine */
+         if (b_trace) {fprintf(h_processor->output, "jsb "); fprintf(h_processor->output, h_msg_address, ((h_processor->pc & 0x0f00) | i_opcode >> 2));}
+         op_jsb(h_processor, h_decoded->address); /* Note - uses and eight bit address */
+         break;
+      case OP_GO_TO: /* Type 3 - if nc go to */
+         if (b_trace) {fprintf(h_processor->output, "if nc go to "); fprintf(h_processor->output, h_msg_address, ((h_processor->pc & 0x0f00) | i_opcode >> 2));} /* Note - uses and eight bit address */
+         if (!h_processor->flags[PREV_CARRY])
+         {
+            h_processor->pc = (h_processor->pc & 0xff00) | h_decoded->address;
+            v_delayed_rom(h_processor);
          }
          break;
 #endif
 
 #if defined(WOODSTOCK) || defined(SPICE) || defined(HP10) || defined(HP67)
-      case 02: /* Type 2 - Arithmetic operations */
-         i_field = (i_opcode >> 2) & 7;
-         switch (i_field) /* Select field
-            000   P  : determined by P                   [P]
-            001  WP  : word up to and including P        [0 ..  P]
-            010  XS  : exponent sign                     [2]
-            011   X  : exponent                          [0 ..  1]
-            100   S  : sign                              [13]
-            101   M  : mantissa                          [3 .. 12]
-            110   W  : word                              [0 .. 13]
-            111  MS  : mantissa and sign                 [3 .. 13] */
+      case 000: /* 0 -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "0 -> a[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[A_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 001: /* 0 -> b[f] */
+         if (b_trace)fprintf(h_processor->output, "0 -> b[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[B_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 002: /* a exch b[f] */
+         if (b_trace) fprintf(h_processor->output, "a exch b[%s]\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace)
          {
-         case 00: /* P */
-            s_field = "p";
-            h_processor->first = h_processor->p; h_processor->last = h_processor->p;
-            if (h_processor->p >= REG_SIZE)
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
-         case 01: /* WP */
-            s_field = "wp";
-            h_processor->first =  0; h_processor->last =  h_processor->p; /* break; bug in orig??? */
-            if (h_processor->p >= REG_SIZE)
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
-         case 02: /* XS */
-            s_field = "xs";
-            h_processor->first = EXP_SIZE - 1; h_processor->last = EXP_SIZE - 1;
-            break;
-         case 03: /* X */
-            s_field = "x";
-            h_processor->first = 0; h_processor->last = EXP_SIZE - 1;
-            break;
-         case 04: /* S */
-            s_field = "s";
-            h_processor->first = REG_SIZE - 1; h_processor->last = REG_SIZE - 1;
-            break;
-         case 05: /* M */
-            s_field = "m";
-            h_processor->first = EXP_SIZE; h_processor->last = REG_SIZE - 2;
-            break;
-         case 06: /* W */
-            s_field = "w";
-            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-            break;
-         case 07: /* MS */
-            s_field = "ms";
-            h_processor->first = EXP_SIZE; h_processor->last = REG_SIZE - 1;
-            break;
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
          }
-
-         switch (i_opcode >> 5)
+         break;
+      case 003: /* a -> b[f] */
+         if (b_trace) fprintf(h_processor->output, "a -> b[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[B_REG], h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 004: /* a exch c[f] */
+         if (b_trace) fprintf(h_processor->output, "a exch c[%s]\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace)
          {
-         case 000: /* 0 -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "0 -> a[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[A_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 001: /* 0 -> b[f] */
-            if (h_processor->trace)fprintf(stdout, "0 -> b[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[B_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 002: /* a exch b[f] */
-            if (h_processor->trace) fprintf(stdout, "a exch b[%s]\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace)
-            {
-               v_fprint_register(stdout,h_processor->reg[A_REG]);
-               v_fprint_register(stdout,h_processor->reg[B_REG]);
-            }
-            break;
-         case 003: /* a -> b[f] */
-            if (h_processor->trace) fprintf(stdout, "a -> b[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[B_REG], h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 004: /* a exch c[f] */
-            if (h_processor->trace) fprintf(stdout, "a exch c[%s]\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace)
-            {
-               v_fprint_register(stdout,h_processor->reg[A_REG]);
-               v_fprint_register(stdout,h_processor->reg[C_REG]);
-            }
-            break;
-         case 005: /* c -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "c -> a[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 006: /* b -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "b -> c[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 007: /* b exchange c[f] */
-            if (h_processor->trace) fprintf(stdout, "b exch c[%s]\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[B_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace)
-            {
-               v_fprint_register(stdout,h_processor->reg[B_REG]);
-               v_fprint_register(stdout,h_processor->reg[C_REG]);
-            }
-            break;
-         case 010: /* 0 -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "0 -> c[%s]\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[C_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 011: /* a + b -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a + b -> a[%s]\t", s_field);
-            v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 012: /* a + c -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a + c -> a[%s]\t", s_field);
-            v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 013: /* c + c -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "c + c -> c[%s]\t", s_field);
-            v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 014: /* a + c -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "a + c -> c[%s]\t", s_field);
-            v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 015: /* a + 1 -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a + 1 -> a[%s]\t", s_field);
-            v_reg_inc(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 016: /* shift left a[f] */
-            if (h_processor->trace) fprintf(stdout, "shift left a[%s]\t", s_field);
-            fflush(stdout);
-            v_reg_shl(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 017: /* c + 1 -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "c + 1 -> c[%s]\t", s_field);
-            v_reg_inc(h_processor, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 020: /* a - b -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a - b -> a[%s]\t", s_field);
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 021: /* a - c -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "a - c -> c[%s]\t", s_field);
-            v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 022: /* a - 1 -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a - 1 -> a[%s]\t", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 023: /* c - 1 -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "c - 1 -> c[%s]\t", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 024: /* 0 - c -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "0 - c -> c[%s]\t", s_field);
-            v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 025: /* 0 - c - 1 -> c[f] */
-            if (h_processor->trace) fprintf(stdout, "0 - c - 1 -> c[%s]\t", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 026: /* if b[f] = 0 */
-            if (h_processor->trace) fprintf(stdout, "if b[%s] = 0", s_field);
-            v_reg_test_eq(h_processor, h_processor->reg[B_REG], NULL);
-            v_op_goto(h_processor);
-            break;
-         case 027: /* if c[f] = 0 */
-            if (h_processor->trace) fprintf(stdout, "if c[%s] = 0", s_field);
-            v_reg_test_eq(h_processor, h_processor->reg[C_REG], NULL);
-            v_op_goto(h_processor);
-            break;
-         case 030: /* if a >= c[f] */
-            if (h_processor->trace) fprintf(stdout, "if a >= c[%s]", s_field);
-            v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[C_REG]); /* Less than */
-            h_processor->flags[CARRY] = !h_processor->flags[CARRY];
-            v_op_goto(h_processor);
-            break;
-         case 031: /* if a >= b[f] */
-            if (h_processor->trace) fprintf(stdout, "if a >= b[%s]", s_field);
-            v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[B_REG]); /* Less than */
-            h_processor->flags[CARRY] = !h_processor->flags[CARRY];
-            v_op_goto(h_processor);
-            break;
-         case 032: /* if a[f] != 0 */
-            if (h_processor->trace) fprintf(stdout, "if a[%s] != 0", s_field);
-            v_reg_test_ne(h_processor, h_processor->reg[A_REG], NULL);
-            v_op_goto(h_processor);
-            break;
-         case 033: /* if c[f] != 0 */
-            if (h_processor->trace) fprintf(stdout, "if c[%s] != 0", s_field);
-            v_reg_test_ne(h_processor, h_processor->reg[C_REG], NULL);
-            v_op_goto(h_processor);
-            break;
-         case 034: /* a - c -> a[f] */
-            if (h_processor->trace) fprintf(stdout, "a - c -> a[%s]\t", s_field);
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 035: /* shift right a[f] */
-            if (h_processor->trace) fprintf(stdout, "shift right a[%s]\t", s_field);
-            v_reg_shr(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 036: /* shift right b[f] */
-            v_reg_shr(h_processor, h_processor->reg[B_REG]);
-            if (h_processor->trace) fprintf(stdout, "shift right b[%s]\t", s_field);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 037: /* shift right c[f] */
-            if (h_processor->trace) fprintf(stdout, "shift right c[%s]\t", s_field);
-            v_reg_shr(h_processor, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         default:
-            if (h_processor->trace) fprintf(stdout, "\n");
-            v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
          }
          break;
-#endif
-
-#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
-      case 0x02: /* Type 2 - Arithmetic operations */
-         i_field = (i_opcode >> 2) & 7;
-         switch (i_field) /* Select field
-            000   R  : determined by active pointer            [R]
-            001 S+X  : exponent and sign                       [0 .. 2]
-            010  WR  : word up to and including active pointer [0 ..  P]
-            011   W  : word                                    [0 .. 13]
-            100 P-Q  : word from P up to and including Q       [P .. Q]
-            101  XS  : exponent sign only                      [2]
-            110   M  : mantissa                                [3 .. 12]
-            111   S  : sign                                    [13] */
+      case 005: /* c -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "c -> a[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 006: /* b -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "b -> c[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 007: /* b exchange c[f] */
+         if (b_trace) fprintf(h_processor->output, "b exch c[%s]\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[B_REG], h_processor->reg[C_REG]);
+         if (b_trace)
          {
-         case 00: /* Active pointer */
-            s_field = "pt";
-            if (h_processor->ptr)
-               h_processor->first = h_processor->last = h_processor->q;
-            else
-               h_processor->first = h_processor->last = h_processor->p;
-            if (h_processor->p >= REG_SIZE || h_processor->q >= REG_SIZE)
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
-         case 01: /* Exponent and sign */
-            s_field = "x";
-            h_processor->first = 0; h_processor->last = EXP_SIZE - 1;
-            break;
-         case 02: /* Word up to the active pointer */
-            s_field = "wpt";
-            h_processor->first =  0;
-            if (h_processor->ptr)
-               h_processor->last = h_processor->q;
-            else
-               h_processor->last = h_processor->p;
-            if (h_processor->p >= REG_SIZE || h_processor->q >= REG_SIZE)
-            {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            }
-            break;
-         case 03: /* All nibbles in the word */
-            s_field = "all";
-            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
-            break;
-         case 04: /* Selects range based on pointers */
-            s_field = "pq";
-            h_processor->first = h_processor->p;
-            if (h_processor->p > h_processor->q)
-               h_processor->last = REG_SIZE - 1;
+            v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         }
+         break;
+      case 010: /* 0 -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "0 -> c[%s]\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[C_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 011: /* a + b -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a + b -> a[%s]\t", s_field);
+         v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 012: /* a + c -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a + c -> a[%s]\t", s_field);
+         v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 013: /* c + c -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "c + c -> c[%s]\t", s_field);
+         v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 014: /* a + c -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "a + c -> c[%s]\t", s_field);
+         v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 015: /* a + 1 -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a + 1 -> a[%s]\t", s_field);
+         v_reg_inc(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 016: /* shift left a[f] */
+         if (b_trace) fprintf(h_processor->output, "shift left a[%s]\t", s_field);
+         fflush(stdout);
+         v_reg_shl(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 017: /* c + 1 -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "c + 1 -> c[%s]\t", s_field);
+         v_reg_inc(h_processor, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 020: /* a - b -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a - b -> a[%s]\t", s_field);
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 021: /* a - c -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "a - c -> c[%s]\t", s_field);
+         v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 022: /* a - 1 -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a - 1 -> a[%s]\t", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 023: /* c - 1 -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "c - 1 -> c[%s]\t", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 024: /* 0 - c -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "0 - c -> c[%s]\t", s_field);
+         v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 025: /* 0 - c - 1 -> c[f] */
+         if (b_trace) fprintf(h_processor->output, "0 - c - 1 -> c[%s]\t", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 026: /* if b[f] = 0 */
+         if (b_trace) fprintf(h_processor->output, "if b[%s] = 0", s_field);
+         v_reg_test_eq(h_processor, h_processor->reg[B_REG], NULL);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 027: /* if c[f] = 0 */
+         if (b_trace) fprintf(h_processor->output, "if c[%s] = 0", s_field);
+         v_reg_test_eq(h_processor, h_processor->reg[C_REG], NULL);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 030: /* if a >= c[f] */
+         if (b_trace) fprintf(h_processor->output, "if a >= c[%s]", s_field);
+         v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[C_REG]); /* Less than */
+         h_processor->flags[CARRY] = !h_processor->flags[CARRY];
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 031: /* if a >= b[f] */
+         if (b_trace) fprintf(h_processor->output, "if a >= b[%s]", s_field);
+         v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[B_REG]); /* Less than */
+         h_processor->flags[CARRY] = !h_processor->flags[CARRY];
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 032: /* if a[f] != 0 */
+         if (b_trace) fprintf(h_processor->output, "if a[%s] != 0", s_field);
+         v_reg_test_ne(h_processor, h_processor->reg[A_REG], NULL);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 033: /* if c[f] != 0 */
+         if (b_trace) fprintf(h_processor->output, "if c[%s] != 0", s_field);
+         v_reg_test_ne(h_processor, h_processor->reg[C_REG], NULL);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case 034: /* a - c -> a[f] */
+         if (b_trace) fprintf(h_processor->output, "a - c -> a[%s]\t", s_field);
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 035: /* shift right a[f] */
+         if (b_trace) fprintf(h_processor->output, "shift right a[%s]\t", s_field);
+         v_reg_shr(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 036: /* shift right b[f] */
+         v_reg_shr(h_processor, h_processor->reg[B_REG]);
+         if (b_trace) fprintf(h_processor->output, "shift right b[%s]\t", s_field);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 037: /* shift right c[f] */
+         if (b_trace) fprintf(h_processor->output, "shift right c[%s]\t", s_field);
+         v_reg_shr(h_processor, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+
+      case OP_NOP: /* nop */
+         if (b_trace) fprintf(h_processor->output, "nop");
+         break;
+#if defined(HP67)
+      /*
+       * 00100   Test ready
+       * 00300   Test W/PGM switch
+       * 00400   Set key pressed
+       * 00500   Test if a key was pressed
+       * 01000   Set default function keys
+       * 01100   Test if default function keys set
+       * 01200   Set merge flag
+       * 01300   Test merge flag
+       * 01400   Set waiting for card side 2 flag
+       * 01500   Test waiting for card side 2 flag
+       * 01700   Read/Write data to/from card via RAM $99 and $9B
+       */
+      case OP_TEST_MOTOR: /* test motor on */
+         if (b_trace) fprintf(h_processor->output, "test motor on");
+         h_processor->status[3] = True; /* device always ready */
+         h_processor->crc[CARD] = False;
+         break;
+      case OP_TEST_MODE: /* test mode flag */
+         if (b_trace) fprintf(h_processor->output, "test mode flag (%d)", !h_processor->flags[MODE] );
+         h_processor->status[3] = !h_processor->flags[MODE]; /* Test the PRGM/RUN switch */
+         break;
+      case OP_SET_KEY_FLAG: /* set key pressed flag */
+         if (b_trace) fprintf(h_processor->output, "set key pressed flag");
+         h_processor->crc[ANYKEY] = True; /* Sets the any key pressed flag */
+         break;
+      case OP_TEST_KEY_FLAG: /* test key pressed flag */ /* f -x- */
+         if (b_trace) fprintf(h_processor->output, "test key pressed flag");
+         h_processor->status[3] = h_processor->crc[ANYKEY];
+         if (h_processor->crc[ANYKEY]) h_processor->crc[ANYKEY] = False;
+         break;
+      case OP_SET_FUNCTION_FLAG: /* set default function flag */
+         if (b_trace) fprintf(h_processor->output, "set flag 4");
+         h_processor->crc[FUNCTION] = True;
+         break;
+      case OP_TEST_FUNCTION_FLAG: /* test default function key flag */
+         if (b_trace) fprintf(h_processor->output, "test flag 4");
+         h_processor->status[3] = h_processor->crc[FUNCTION];
+         if (h_processor->crc[FUNCTION]) h_processor->crc[FUNCTION] = False;
+         break;
+      case OP_SET_MERGE_FLAG: /* set merge flag */
+         if (b_trace) fprintf(h_processor->output, "set merge flag");
+         h_processor->crc[MERGE] = True;
+         break;
+      case OP_TEST_MERGE_FLAG: /* test merge flag */
+         if (b_trace) fprintf(h_processor->output, "clear flag 0");
+         h_processor->status[3] = h_processor->crc[MERGE];
+         if (h_processor->crc[MERGE]) h_processor->crc[MERGE] = False;
+         break;
+      case OP_SET_PAUSE_FLAG: /* set waiting flag */
+         if (b_trace) fprintf(h_processor->output, "clear waiting flag");
+         h_processor->crc[PAUSE] = True;
+         break;
+      case OP_TEST_PAUSE_FLAG: /* test pause flag ? */
+         if (b_trace) fprintf(h_processor->output, "clear flag 1");
+         h_processor->status[3] = h_processor->crc[PAUSE];
+         if (h_processor->crc[PAUSE]) h_processor->crc[PAUSE] = False;
+         break;
+      case OP_CARD_READ_WRITE: /* read from or write to card */
+         if (b_trace) fprintf(h_processor->output, "card read write");
+         h_processor->status[3] = h_processor->crc[PAUSE];
+         if (h_processor->crc[PAUSE]) h_processor->crc[PAUSE] = False;
+         break;
+#endif
+      case OP_KEYS_TO_ROM: /* keys -> rom address (0 000 010 000) */
+         if (b_trace) fprintf(h_processor->output, "keys -> rom address");
+         h_processor->pc &= 0xff00;
+         v_delayed_rom(h_processor);
+         h_processor->pc += h_processor->code;
+         h_processor->keyscan = True;
+         break;
+      case OP_KEYS_TO_A: /* keys -> a[2:1] (0 001 010 000) */
+         if (b_trace) fprintf(h_processor->output, "keys -> a\t\t");
+         h_processor->keyscan = True;
+         /* The HP10 and HP19C use this to get the state of the printer mode switch */
+#if defined(HP10)
+         /* HP10 - All = 1, Print = 2 (print with display off), Display = 4 */
+         /* HP19C/97 - Trace = 1, Normal = 2 (print with display off), Manual = 4 */
+         v_nibble_set(h_processor->reg[A_REG], 1, h_processor->print);
+#else
+         v_nibble_set(h_processor->reg[A_REG], 2, (h_processor->code >> 4)); /* Put keycode in A_REG */
+         v_nibble_set(h_processor->reg[A_REG], 1, (h_processor->code & 0x0f));
+#endif
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case OP_A_TO_ROM: /* a -> rom address */
+         {
+            int i_addr;
+            if (b_trace) fprintf(h_processor->output, "a -> rom address");
+            h_processor->pc &= 0x0ff00;
+            i_addr = h_processor->pc + (NIBBLE(h_processor->reg[A_REG], 2) << 4) + NIBBLE(h_processor->reg[A_REG], 1);
+            if (i_addr < ROM_SIZE)
+                h_processor->pc = i_addr;
             else
-               h_processor->last = h_processor->q;
-            if (h_processor->p >= REG_SIZE || h_processor->q >= REG_SIZE)
             {
-               if (h_processor->trace) fprintf(stdout, "\n");
-               v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_invalid_address, i_addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
-            break;
-         case 05: /* XS */
-            s_field = "xs";
-            h_processor->first = EXP_SIZE - 1; h_processor->last = EXP_SIZE - 1;
-            break;
-         case 06: /* M */
-            s_field = "m";
-            h_processor->first = EXP_SIZE; h_processor->last = REG_SIZE - 2;
-            break;
-         case 07: /* S */
-            s_field = "s";
-            h_processor->first = REG_SIZE - 1; h_processor->last = REG_SIZE - 1;
-            break;
+            v_delayed_rom(h_processor);
          }
-
-         switch (i_opcode >> 5)
+         break;
+      case OP_RESET_TWF: /* reset twf */
+         if (b_trace) fprintf(h_processor->output, "reset twf");
+         break;
+      case OP_BINARY: /* binary */
+         if (b_trace) fprintf(h_processor->output, "binary");
+         h_processor->base = 16;
+         break;
+      case OP_ROTATE_LEFT_A: /* rotate left a */
+         if (b_trace) fprintf(h_processor->output, "rotate left a");
          {
-         case 0x00: /* 0 -> a[f] - Clear a (00 000f ff10) */
-            if (h_processor->trace) fprintf(stdout, "a = 0 %s\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[A_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x01: /* 0 -> b[f] - Clear b (00 001f ff10) */
-            if (h_processor->trace)fprintf(stdout, "b = 0 %s\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[B_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 0x02: /* 0 -> c[f] - Clear c (00 010f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = 0 %s\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[C_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x03: /* a exch b[f] - Exchange a and b (00 011f ff10) */
-            if (h_processor->trace) fprintf(stdout, "abex %s\t\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace)
+            uint64_t i_temp = h_processor->reg[A_REG]->value & PACKED_REGISTER;
+            h_processor->reg[A_REG]->value = (h_processor->reg[A_REG]->value & ~PACKED_REGISTER) | (((i_temp << 4) | (i_temp >> (4 * (REG_SIZE - 1)))) & PACKED_REGISTER);
+            h_processor->flags[PREV_CARRY] = h_processor->flags[CARRY] = False;
+         }
+         break;
+      case OP_DEC_P: /* p - 1 -> p */
+         if (b_trace) fprintf(h_processor->output, "p - 1 -> p\t\t\t");
+         v_op_dec_p(h_processor);
+         if (b_trace) fprintf(h_processor->output, "p = %d", h_processor->p);
+         break;
+      case OP_INC_P: /* p + 1 -> p */
+         if (b_trace) fprintf(h_processor->output, "p + 1 -> p\t\t\t");
+         v_op_inc_p(h_processor);
+         if (b_trace) fprintf(h_processor->output, "p = %d", h_processor->p);
+         break;
+      case OP_RETURN: /* return */
+         if (b_trace) fprintf(h_processor->output, "return");
+         h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
+         h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter from the stack */
+         if (h_processor->profile != NULL) v_profile_return(h_processor);
+         break;
+#if defined(HP10)
+      case OP_PIK1120: /* pik1120 */
+         if (b_trace) fprintf(h_processor->output, "pik1120\t\t");
+         v_fprint_buffer (stdout, h_processor);
+         h_processor->status[3] = True; /* Set status bit 3 if printer ready (it always will be!) */
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_PIK1220: /* pik1220 */
+         if (b_trace) fprintf(h_processor->output, "pik1220\t\t");
+         v_fprint_buffer (stdout, h_processor);
+         h_processor->status[3] = True; /* Clear status bit 3 if printer is out of paper */
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_PIK1320: /* pik1320 */
+         if (b_trace) fprintf(h_processor->output, "pik1320\t\t");
+         v_fprint_buffer (stdout, h_processor);
+         if (h_processor->keypressed && h_processor->code) h_processor->status[3] = True; /* Set status bit 3 if key is pressed and a key code is pending */
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_PIK1720: /* pik1720 print numeric (4 bit data)*/
+         if (b_trace) fprintf(h_processor->output, "pik1720\t\t");
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         if (h_processor->buffer[h_processor->position] == 0x3f) h_processor->position++;
+         {
+            int i_count;
+            for (i_count = 0; (i_count < REG_SIZE)  && (NIBBLE(h_processor->reg[C_REG], i_count) != 0xf); i_count++)
             {
-               v_fprint_register(stdout,h_processor->reg[A_REG]);
-               v_fprint_register(stdout,h_processor->reg[B_REG]);
+               h_processor->position--;
+               h_processor->buffer[h_processor->position] = (NIBBLE(h_processor->reg[C_REG], i_count) << 2) | 0x3;
             }
-            break;
-         case 0x04: /* a -> b[f] - Load b from a (00 100f ff10) */
-            if (h_processor->trace) fprintf(stdout, "b = a %s\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[B_REG], h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 0x05: /* a exch c[f] - Exchange a and c (00 101f ff10) */
-            if (h_processor->trace) fprintf(stdout, "acex %s\t\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace)
+         }
+         break;
+#endif
+      case OP_SELECT_ROM: /* select rom */
+         if (b_trace) fprintf(h_processor->output, "select rom %02o", h_decoded->arg);
+         h_processor->pc = ((h_decoded->arg) << 8) + ((h_processor->pc) & 0xff);
+         break;
+#if defined(HP67)
+      /*
+       * 00060   Set display digits
+       * 00160   Test display digits
+       * 00260   Motor on
+       * 00360   Motor off
+       * 00560   Test if card inserted
+       * 00660   Set card write mode
+       * 00760   Set card read mode
+       */
+      case OP_SET_DISPLAY_DIGITS: /* set display digits */
+         if (b_trace) fprintf(h_processor->output, "set display digits");
+         h_processor->crc[DISPLAY] = True;
+         break;
+      case OP_TEST_DISPLAY_DIGITS: /* test display digits */
+         if (b_trace) fprintf(h_processor->output, "test display digits");
+         h_processor->status[3] = h_processor->crc[DISPLAY];
+         if (h_processor->crc[DISPLAY]) h_processor->crc[DISPLAY] = False;
+         break;
+      case OP_MOTOR_ON: /* card reader motor on */
+         if (b_trace) fprintf(h_processor->output, "motor on");
+         break;
+      case OP_MOTOR_OFF: /* card reader motor off */
+         if (b_trace) fprintf(h_processor->output, "motor off");
+         break;
+      case OP_TEST_CARD: /* test card inserted */
+         if (b_trace) fprintf(h_processor->output, "test card inserted");
+         h_processor->status[3] = h_processor->crc[CARD]; /* Test if card is inserted */
+         break;
+      case OP_SET_WRITE_MODE: /* card reader set write mode */
+         if (b_trace) fprintf(h_processor->output, "set write mode");
+         break;
+      case OP_SET_READ_MODE: /* card reader set read mode */
+         if (b_trace) fprintf(h_processor->output, "set read mode");
+         break;
+#endif
+      case OP_BANK_SWITCH: /* bank switch */
+         if (b_trace) fprintf(h_processor->output, "bank switch");
+         h_processor->flags[BANK_SWITCH] = (!h_processor->flags[BANK_SWITCH]); /* Toggle bank switch */
+         h_processor->pc ^=  0x01000; /* Toggle bank */
+         break;
+      case OP_C_TO_ADDR: /* c -> data address */
+         {
+            int i_addr;
+            if (b_trace) fprintf(h_processor->output, "c -> data address\t");
+            i_addr = (NIBBLE(h_processor->reg[C_REG], 1) << 4) + NIBBLE(h_processor->reg[C_REG], 0);
+#if defined(HP10)
+            if ((i_addr < MEMORY_SIZE) || (i_addr == 0xFF)) /* Address 0xFF tells the PIK chip to put the key code on the data bus */
+               h_processor->addr = i_addr;
+            else
             {
-               v_fprint_register(stdout,h_processor->reg[A_REG]);
-               v_fprint_register(stdout,h_processor->reg[C_REG]);
+               h_processor->addr = MEMORY_SIZE - 1;
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_invalid_register, i_addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
-            break;
-         case 0x06: /* b -> c[f] - Load c from b (00 110f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = b %s\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x07: /* b exch c[f] - Exchange b and c (00 111f ff10) */
-            if (h_processor->trace) fprintf(stdout, "bcex %s\t\t", s_field);
-            v_reg_exch(h_processor, h_processor->reg[B_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace)
+#else
+            if (i_addr < MEMORY_SIZE)
+               h_processor->addr = i_addr;
+            else
             {
-               v_fprint_register(stdout,h_processor->reg[B_REG]);
-               v_fprint_register(stdout,h_processor->reg[C_REG]);
+               h_processor->addr = MEMORY_SIZE - 1;
             }
-            break;
-         case 0x08: /* c -> a[f] - Load a from c (01 000f ff10) */
-            if (h_processor->trace) fprintf(stdout, "a = c %-3s\t\t", s_field);
-            v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x09: /* a + b -> a[f] - Load a with a plus b (01 001f ff10) */
-            if (h_processor->trace) fprintf(stdout, "a = a + b %-3s", s_field);
-            v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x0a: /* a + c -> a[f] - Load a with a plus c (01 010f ff10) */
-            if (h_processor->trace) fprintf(stdout, "a = a + c %-3s", s_field);
-            v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x0b: /* a + 1 -> a[f] - Load a with a plus 1 (01 011f ff10) */
-            if (h_processor->trace) fprintf(stdout, "a = a + 1 %-3s", s_field);
-            v_reg_inc(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x0c: /* a - b -> a[f] - Load a with a minus b (01 100f ff10) */
-            if (h_processor->trace) fprintf(stdout, "a = a - b %-3s", s_field);
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x0d: /* a - 1 -> a[f] - Load a with a minus 1 (01 101f ff10) */
-            if (h_processor->trace) fprintf(stdout, "a = a - 1 %-3s", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x0e: /* a - c -> a[f] - Load a with a minus c (01 110f ff10) */
-            if (h_processor->trace) fprintf(stdout, "a = a - c %-3s", s_field);
-            v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x0f: /* c + c -> c[f] - Load c with c plus c (01 111f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = c + c %-3s", s_field);
-            v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x10: /* a + c -> c[f] - Load c with a plus c (10 000f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = c + a %-3s", s_field);
-            v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x11: /* c + 1 -> c[f] - Load c with c plus 1 (10 001f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = c + 1 %-3s", s_field);
-            v_reg_inc(h_processor, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x12: /* c - a -> c[f] - Load c with c minus a (10 010f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = a - c %-3s", s_field);
-            v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x13: /* c - 1 -> c[f] - Load c with c minus 1 (10 011f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = c - 1 %-3s", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], NULL);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x14: /* 0 - c -> c f - Load c with 0 minus c (10 100f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = 0 - c %-3s", s_field);
-            v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x15: /* 0 - c - 1 -> c[f] - Complement c (10 101f ff10) */
-            if (h_processor->trace) fprintf(stdout, "c = - c - 1 %-3s", s_field);
-            h_processor->flags[CARRY] = True; /* Set carry */
-            v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x16: /* ? b[f] != 0 - Test b not equal to zero (10 110f ff10) */
-            if (h_processor->trace) fprintf(stdout, "? b != 0 %-3s", s_field);
-            v_reg_test_ne(h_processor, h_processor->reg[B_REG], NULL);
-            break;
-         case 0x17: /* ? c != 0 - Test c not equal to zero (10 111f ff10) */
-            if (h_processor->trace) fprintf(stdout, "? c != 0 %-3s", s_field);
-            v_reg_test_ne(h_processor, h_processor->reg[C_REG], NULL);
-            break;
-         case 0x18: /* ? a < c - Test a less than c (11 000f ff10) */
-            if (h_processor->trace) fprintf(stdout, "? a < c %-3s", s_field);
-            v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[C_REG]);/* Less than */
-            break;
-         case 0x19: /* ? a < b - Test a less than b (11 001f ff10) */
-            if (h_processor->trace) fprintf(stdout, "? a < b %-3s", s_field);
-            v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[B_REG]); /* Less than */
-            break;
-         case 0x1a: /* ? a != 0 - Test a not equal to zero  (11 010f ff10) */
-            if (h_processor->trace) fprintf(stdout, "? a != 0 %-3s", s_field);
-            v_reg_test_ne(h_processor, h_processor->reg[A_REG], NULL);
-            break;
-         case 0x1b: /* ? a != c - Test a not equal to c (11 011f ff10) */
-            if (h_processor->trace) fprintf(stdout, "? a != c %-3s", s_field);
-            v_reg_test_ne(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
-            break;
-         case 0x1c: /* a >> 1 -> a[f] - Shift right a (11 100f ff10) */
-            if (h_processor->trace) fprintf(stdout, "shr a %s\t\t", s_field);
-            v_reg_shr(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         case 0x1d: /* b >> 1 -> b[f] - Shift right b (11 101f ff10) */
-            v_reg_shr(h_processor, h_processor->reg[B_REG]);
-            if (h_processor->trace) fprintf(stdout, "shr b %s\t\t", s_field);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[B_REG]);
-            break;
-         case 0x1e: /* c >> 1 -> c[f] - Shift right c (11 110f ff10) */
-            if (h_processor->trace) fprintf(stdout, "shr c %s\t\t", s_field);
-            v_reg_shr(h_processor, h_processor->reg[C_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[C_REG]);
-            break;
-         case 0x1f: /* a << 1 -> a[f] - Shift left a (11 111f ff10) */
-            if (h_processor->trace) fprintf(stdout, "shl a %s\t\t", s_field);
-            fflush(stdout);
-            v_reg_shl(h_processor, h_processor->reg[A_REG]);
-            if (h_processor->trace) v_fprint_register(stdout,h_processor->reg[A_REG]);
-            break;
-         default:
-            if (h_processor->trace) fprintf(stdout, "\n");
-            v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+#endif
          }
+         if (b_trace) fprintf(h_processor->output, "\taddr = %d", h_processor->addr);
          break;
+      case OP_CLEAR_DATA: /* clear data registers */
+         {
+#if (defined(HP25) || defined(HP25c)) && defined(CONTINIOUS)
+            /* Ignore the instruction */
+#else
+            int i_count;
+            if (b_trace) fprintf(h_processor->output, "clear data registers");
+#if (defined(HP67)) && defined(CONTINIOUS)
+            if (h_processor->crc[READY])
+               h_processor->crc[READY]++;
+            else
 #endif
-
-      case 03:/* Type 3 - Conditional branch */
-         switch (i_opcode & 03)
+            {
+               h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+               for (i_count = h_processor->addr & ~0x0f; i_count < (h_processor->addr & ~0x0f) + 16; i_count++)
+               {
+                  if (i_count < MEMORY_SIZE) /* Check memory size */
+                     v_reg_copy(h_processor, h_processor->mem[i_count], NULL); /* Copying nothing to a register clears it */
+               }
+            }
+#endif
+         }
+         break;
+      case OP_C_TO_DATA: /* c -> data */
+         if (b_trace) fprintf(h_processor->output, "c -> data\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->mem[h_processor->addr], h_processor->reg[C_REG]);
+         if (b_trace)
+            v_fprint_register(h_processor->output, h_processor->mem[h_processor->addr]);
+         break;
+#if defined(HP10)
+      case OP_PIK1660: /* pik1660 print alpha (6 bit data)*/
+         if (b_trace) fprintf(h_processor->output, "pik1660");
          {
-         case 00:
-            if (h_processor->trace) {fprintf(stdout, "call "); fprintf(stdout, h_msg_address, i_opcode >> 2);}
-            if (h_processor->trace) fprintf(stdout, "\n");
-            v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            break;
-         case 01:
-            if (h_processor->trace) {fprintf(stdout, "call "); fprintf(stdout, h_msg_address, i_opcode >> 2);}
-            if (h_processor->trace) fprintf(stdout, "\n");
-            v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            break;
-         case 02:
-            if (h_processor->trace) {fprintf(stdout, "jump "); fprintf(stdout, h_msg_address, i_opcode >> 2);}
-            if (h_processor->trace) fprintf(stdout, "\n");
-            v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-            break;
-#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
-         case 03: /* Relative jump */
+            int i_counter = 0;
+            int i_count;
+            for (i_count = 0; (i_count < REG_SIZE - 1) && (h_processor->position >= 0); i_count++)
             {
-               int i_offset;
-               i_offset = i_opcode >> 3;
-               if (i_offset >= 0x40) i_offset = i_offset - 128; /* Fixed relative jump offset */
-               if (i_opcode & 00004)
+               h_processor->position--;
+               if((i_counter & 1) == 0) /* Even numbered nibble */
                {
-                  if (h_processor->trace) fprintf(stdout, "jc ");
-                  if (h_processor->flags[PREV_CARRY])
-                     h_processor->pc = ((i_last + i_offset) & 0xffff);
+                  h_processor->buffer[h_processor->position] = (NIBBLE(h_processor->reg[C_REG], i_count)) | ((NIBBLE(h_processor->reg[C_REG], i_count + 1)) & 0x3) << 4;
                }
                else
                {
-                  if (h_processor->trace) fprintf(stdout, "jnc ");
-                  if (!h_processor->flags[PREV_CARRY])
-                     h_processor->pc = ((i_last + i_offset) & 0xffff);
+                  h_processor->buffer[h_processor->position] = ((NIBBLE(h_processor->reg[C_REG], i_count)) >> 2) | (NIBBLE(h_processor->reg[C_REG], i_count + 1)) << 2;
+                  i_count++;
                }
-               if (h_processor->trace)
-               {
-                  if (i_offset < 0)
-                     fprintf(stdout, h_msg_negative_offset, abs(i_offset));
-                  else
-                     fprintf(stdout, h_msg_positive_offset , abs(i_offset));
+               i_counter++;
+               if (h_processor->buffer[h_processor->position] == 0x3f) i_count = REG_SIZE;
+            }
+         }
+         break;
+#endif
+      case OP_ROM_CHECKSUM: /* rom checksum */
+         if (b_trace) fprintf(h_processor->output, "rom checksum");
+         h_processor->status[5] = False;
+         h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
+         h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter on the stack */
+         if (h_processor->profile != NULL) v_profile_return(h_processor);
+         break;
+      case OP_HI_WOODSTOCK: /* hi I'm woodstock */
+         if (b_trace) fprintf(h_processor->output, "hi I'm woodstock");
+         break;
+      case OP_SET_S: /* 1 -> s(n) */
+         if (b_trace) fprintf(h_processor->output, "1 -> s(%d)\t\t", h_decoded->arg);
+         h_processor->status[h_decoded->arg] = True;
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_TEST_S1: /* if 1 = s(n) */
+         if (b_trace) fprintf(h_processor->output, "if 1 = s(%d)", h_decoded->arg);
+         h_processor->flags[CARRY] = h_processor->status[h_decoded->arg];
+         h_processor->keytest = ((h_decoded->arg) == KEY_STATUS);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case OP_TEST_P: /* if p = n */
+         if (b_trace) fprintf(h_processor->output, "if p = %d", h_decoded->arg);
+         h_processor->flags[CARRY] = (h_processor->p == h_decoded->arg);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case OP_DELAYED_ROM: /* delayed select rom n */
+         if (b_trace) fprintf(h_processor->output, "delayed select rom %d", h_decoded->arg);
+         h_processor->rom_number = h_decoded->arg;
+         h_processor->flags[DELAYED_ROM] = True;
+         break;
+      case OP_CLEAR_REGISTERS: /* clear registers */
+         if (b_trace) fprintf(h_processor->output, "clear registers");
+         {
+            int i_count;
+            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+            for (i_count = 0; i_count < REGISTERS - 2; i_count++) /* Don't clear M or N */
+               v_reg_copy(h_processor, h_processor->reg[i_count], NULL); /* Copying nothing to a register clears it */
+         }
+         break;
+      case OP_CLEAR_STATUS: /* clear status */
+         if (b_trace) fprintf(h_processor->output, "clear status\t");
+         {
+            int i_count;
+            for (i_count = 0; i_count < sizeof(h_processor->status) / sizeof(*h_processor->status); i_count++)
+               switch (i_count) {
+                  case 1:  /* Scientific notation */
+                  case 2:  /* Auto Enter (if set entering digit will push 'X') */
+#if (!defined(HP10))
+                  case 5:  /* Low power (Woodstock) / Self test (Spice) */
+#endif
+                  case 15: /* Set if any key is pressed */
+                     break;
+                  default:
+                     h_processor->status[i_count] = False; /* Clear all bits except bits 1, 2, 5, 15 */
                }
+         }
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_DISPLAY_TOGGLE: /* display toggle */
+         if (b_trace) fprintf(h_processor->output, "display toggle");
+         h_processor->flags[DISPLAY_ENABLE] = (!h_processor->flags[DISPLAY_ENABLE]);
+         break;
+      case OP_DISPLAY_OFF: /* display off */
+         if (b_trace) fprintf(h_processor->output, "display off");
+         h_processor->flags[DISPLAY_ENABLE] = False;
+         break;
+      case OP_M_EXCH_C: /* m exch c */
+         if (b_trace) fprintf(h_processor->output, "m exch c\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_exch(h_processor, h_processor->reg[M_REG], h_processor->reg[C_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[M_REG]);
+         }
+         break;
+      case OP_M_TO_C: /* m -> c */
+         if (b_trace) fprintf(h_processor->output, "m -> c\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[M_REG]);
+         if (b_trace)
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case OP_N_EXCH_C: /* n exch c */
+         if (b_trace) fprintf(h_processor->output, "n exch c\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_exch(h_processor, h_processor->reg[N_REG], h_processor->reg[C_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[N_REG]);
+         }
+         break;
+      case OP_N_TO_C: /* n -> c */
+         if (b_trace) fprintf(h_processor->output, "n -> c\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[N_REG]);
+         if (b_trace)
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case OP_STACK_TO_A: /* stack -> a */
+         if (b_trace) fprintf(h_processor->output, "stack -> a");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[Y_REG]); /* A = Y */
+         v_reg_copy(h_processor, h_processor->reg[Y_REG], h_processor->reg[Z_REG]); /* Y = Z */
+         v_reg_copy(h_processor, h_processor->reg[Z_REG], h_processor->reg[T_REG]); /* Z = T */
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[Y_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[Z_REG]);
+         }
+         break;
+      case OP_DOWN_ROTATE: /* down rotate */
+         if (b_trace) fprintf(h_processor->output, "down rotate\t");
+            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+            v_reg_exch(h_processor, h_processor->reg[T_REG], h_processor->reg[C_REG]); /* T <> C - C to T */
+            v_reg_exch(h_processor, h_processor->reg[C_REG], h_processor->reg[Y_REG]); /* C <> Y - Y to C */
+            v_reg_exch(h_processor, h_processor->reg[Y_REG], h_processor->reg[Z_REG]); /* Y <> Z - Z to Y and T ends up in Z */
+            if (b_trace)
+            {
+               v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[Y_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[Z_REG]);
+               v_fprint_register(h_processor->output,h_processor->reg[T_REG]);
             }
-            break;
+         break;
+      case OP_Y_TO_A: /* y -> a */
+         if (b_trace) fprintf(h_processor->output, "y -> a\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[Y_REG]);
+         if (b_trace)
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case OP_C_TO_STACK: /* c _> stack */
+         if (b_trace) fprintf(h_processor->output, "c -> stack\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[T_REG], h_processor->reg[Z_REG]); /* T = Z */
+         v_reg_copy(h_processor, h_processor->reg[Z_REG], h_processor->reg[Y_REG]); /* T = Z */
+         v_reg_copy(h_processor, h_processor->reg[Y_REG], h_processor->reg[C_REG]); /* T = Z */
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[Y_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[Z_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[T_REG]);
+         }
+         break;
+      case OP_DECIMAL: /* decimal */
+         if (b_trace) fprintf(h_processor->output, "decimal");
+         h_processor->base = 10;
+         break;
+      case OP_F_TO_A: /* f -> a */
+         v_nibble_set(h_processor->reg[A_REG], 0, h_processor->f);
+         if (b_trace) fprintf(h_processor->output, "f -> a\t\t");
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case OP_F_EXCH_A: /* f exch a */
+         if (b_trace) fprintf(h_processor->output, "f exch a\t\t");
+         {
+            int i_temp;
+            i_temp = NIBBLE(h_processor->reg[A_REG], 0);
+            v_nibble_set(h_processor->reg[A_REG], 0, h_processor->f);
+            h_processor->f = i_temp;
+         }
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+            fprintf(h_processor->output, "\tf = %02x", h_processor->f);
+         }
+         break;
+      case OP_LOAD_CONSTANT: /* load constant n */
+         if (b_trace) fprintf(h_processor->output, "load constant %d\t", h_decoded->arg);
+         v_nibble_set(h_processor->reg[C_REG], h_processor->p, h_decoded->arg);
+         v_op_dec_p(h_processor);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+            fprintf(h_processor->output, "\tp = %d", h_processor->p);
+         }
+         break;
+      case OP_C_TO_REGISTER: /* c -> data register(n) */
+         h_processor->addr &= 0xfff0;
+         h_processor->addr += (h_decoded->arg);
+         if (b_trace) fprintf(h_processor->output, "c -> data register(%d)", h_processor->addr);
+         if ((h_processor->addr) < MEMORY_SIZE)
+         {
+            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+            v_reg_copy(h_processor, h_processor->mem[h_processor->addr], h_processor->reg[C_REG]); /* C -> reg(n) */
+         }
+         else
+         {
+            if (b_trace) fprintf(h_processor->output, "\n");
+            v_error(errno, h_err_invalid_address, h_decoded->arg, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+         }
+         break;
+      case OP_DATA_TO_C: /* data -> c or data register(n)-> c */
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         if ((h_decoded->arg) == 0)
+         {
+            if (b_trace) fprintf(h_processor->output, "data -> c\t\t");
+            v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->mem[h_processor->addr]);
+         }
+#if defined(HP10)
+         else if (((h_decoded->arg) == 0xf) && (h_processor->addr == 0xff))
+         {
+            if (b_trace) fprintf(h_processor->output, "data -> c\t\t");
+            v_nibble_set(h_processor->reg[C_REG], 2, (h_processor->code >> 4));
+            v_nibble_set(h_processor->reg[C_REG], 1, (h_processor->code & 0x0f));
+            v_nibble_set(h_processor->reg[C_REG], 0, 0);
+            h_processor->code = 0; /* Clear the key code (so it isn't read twice if the key is held down) */
+         }
 #else
-         case 03: /* if nc go to */
-            if (h_processor->trace) {fprintf(stdout, "if nc go to "); fprintf(stdout, h_msg_address, ((h_processor->pc & 0x0f00) | i_opcode >> 2));} /* Note - uses and eight bit address */
-            if (!h_processor->flags[PREV_CARRY])
+         else
+         {
+            h_processor->addr &= 0xfff0;
+            h_processor->addr += (h_decoded->arg);
+            if (b_trace) fprintf(h_processor->output, "data register(%d) -> c", h_processor->addr);
+            if ((h_processor->addr) < MEMORY_SIZE)
+               v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->mem[h_processor->addr]);
+            else
             {
-               h_processor->pc = (h_processor->pc & 0xff00) | i_opcode >> 2;
-               v_delayed_rom(h_processor);
+               if (b_trace) fprintf(h_processor->output, "\n");
+               v_error(errno, h_err_invalid_address, h_processor->addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
             }
-            break;
+         }
 #endif
-         default:
-            if (h_processor->trace) fprintf(stdout, "\n");
-            v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+         if (b_trace)
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case OP_CLEAR_S: /* 0 -> s(n) */
+         if (b_trace) fprintf(h_processor->output, "0 -> s(%d)\t\t", h_decoded->arg);
+         h_processor->status[h_decoded->arg] = False;
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_TEST_S0: /* if 0 = s(n) */
+         if (b_trace) fprintf(h_processor->output, "if 0 = s(%d) ", h_decoded->arg);
+         h_processor->flags[CARRY] = !h_processor->status[h_decoded->arg];
+         h_processor->keytest = ((h_decoded->arg) == KEY_STATUS);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case OP_TEST_P_NE: /* if p != n */
+         /* 01354 if p !=  0  00554 if p !=  1  00354 if p !=  2
+          * 00754 if p !=  3  00054 if p !=  4  01254 if p !=  5
+          * 00654 if p !=  6  01654 if p !=  7  00154 if p !=  8
+          * 00454 if p !=  9  01554 if p != 10  01454 if p != 11
+          * 00254 if p != 12  01154 if p != 13  N/A   if p != 14
+          * N/A   if p != 15
+         */
+         if (b_trace) fprintf(h_processor->output, "if p != %d", h_decoded->arg);
+         h_processor->flags[CARRY] = (h_processor->p != h_decoded->arg);
+         v_op_goto(h_processor, b_trace);
+         break;
+      case OP_SET_P: /* n -> p*/
+         /* 01474  0 -> p  01074  1 -> p  00574  2 -> p
+          * 01174  3 -> p  00174  4 -> p  01674  5 -> p
+          * 01374  6 -> p  00274  7 -> p  00374  8 -> p
+          * 01574  9 -> p  00674 10 -> p  00474 11 -> p
+          * 00774 12 -> p  01274 13 -> p  N/A   14 -> p
+          * N/A   15 -> p
+          * */
+         if (b_trace) fprintf(h_processor->output, "%d -> p\t\t\t", h_decoded->arg);
+         h_processor->p = h_decoded->arg;
+         if (b_trace) fprintf(h_processor->output, "p = %d", h_processor->p);
+         break;
+      case OP_JSB: /* Type 1 - Jump subroutine */
+         if (b_trace) {fprintf(h_processor->output, "jsb "); fprintf(h_processor->output, h_msg_address, ((h_processor->pc & 0x0f00) | i_opcode >> 2));}
+         op_jsb(h_processor, h_decoded->address); /* Note - uses and eight bit address */
+         break;
+      case OP_GO_TO: /* Type 3 - if nc go to */
+         if (b_trace) {fprintf(h_processor->output, "if nc go to "); fprintf(h_processor->output, h_msg_address, ((h_processor->pc & 0x0f00) | i_opcode >> 2));} /* Note - uses and eight bit address */
+         if (!h_processor->flags[PREV_CARRY])
+         {
+            h_processor->pc = (h_processor->pc & 0xff00) | h_decoded->address;
+            v_delayed_rom(h_processor);
          }
          break;
-      default:
-         if (h_processor->trace) fprintf(stdout, "\n");
-         v_error(errno, h_err_unexpected_error, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
-      }
-      if (h_processor->trace) fprintf(stdout, "\n");
-      h_processor->opcode = i_opcode; /* Keep track of the previous opcode so you know when to increment 'P' */
-   }
+#endif
+
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+      case 0x00: /* 0 -> a[f] - Clear a (00 000f ff10) */
+         if (b_trace) fprintf(h_processor->output, "a = 0 %s\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[A_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x01: /* 0 -> b[f] - Clear b (00 001f ff10) */
+         if (b_trace)fprintf(h_processor->output, "b = 0 %s\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[B_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 0x02: /* 0 -> c[f] - Clear c (00 010f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = 0 %s\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[C_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x03: /* a exch b[f] - Exchange a and b (00 011f ff10) */
+         if (b_trace) fprintf(h_processor->output, "abex %s\t\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         }
+         break;
+      case 0x04: /* a -> b[f] - Load b from a (00 100f ff10) */
+         if (b_trace) fprintf(h_processor->output, "b = a %s\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[B_REG], h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 0x05: /* a exch c[f] - Exchange a and c (00 101f ff10) */
+         if (b_trace) fprintf(h_processor->output, "acex %s\t\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         }
+         break;
+      case 0x06: /* b -> c[f] - Load c from b (00 110f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = b %s\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x07: /* b exch c[f] - Exchange b and c (00 111f ff10) */
+         if (b_trace) fprintf(h_processor->output, "bcex %s\t\t", s_field);
+         v_reg_exch(h_processor, h_processor->reg[B_REG], h_processor->reg[C_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         }
+         break;
+      case 0x08: /* c -> a[f] - Load a from c (01 000f ff10) */
+         if (b_trace) fprintf(h_processor->output, "a = c %-3s\t\t", s_field);
+         v_reg_copy(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x09: /* a + b -> a[f] - Load a with a plus b (01 001f ff10) */
+         if (b_trace) fprintf(h_processor->output, "a = a + b %-3s", s_field);
+         v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x0a: /* a + c -> a[f] - Load a with a plus c (01 010f ff10) */
+         if (b_trace) fprintf(h_processor->output, "a = a + c %-3s", s_field);
+         v_reg_add(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x0b: /* a + 1 -> a[f] - Load a with a plus 1 (01 011f ff10) */
+         if (b_trace) fprintf(h_processor->output, "a = a + 1 %-3s", s_field);
+         v_reg_inc(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x0c: /* a - b -> a[f] - Load a with a minus b (01 100f ff10) */
+         if (b_trace) fprintf(h_processor->output, "a = a - b %-3s", s_field);
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[B_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x0d: /* a - 1 -> a[f] - Load a with a minus 1 (01 101f ff10) */
+         if (b_trace) fprintf(h_processor->output, "a = a - 1 %-3s", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x0e: /* a - c -> a[f] - Load a with a minus c (01 110f ff10) */
+         if (b_trace) fprintf(h_processor->output, "a = a - c %-3s", s_field);
+         v_reg_sub(h_processor, h_processor->reg[A_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x0f: /* c + c -> c[f] - Load c with c plus c (01 111f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = c + c %-3s", s_field);
+         v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x10: /* a + c -> c[f] - Load c with a plus c (10 000f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = c + a %-3s", s_field);
+         v_reg_add(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x11: /* c + 1 -> c[f] - Load c with c plus 1 (10 001f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = c + 1 %-3s", s_field);
+         v_reg_inc(h_processor, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x12: /* c - a -> c[f] - Load c with c minus a (10 010f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = a - c %-3s", s_field);
+         v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x13: /* c - 1 -> c[f] - Load c with c minus 1 (10 011f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = c - 1 %-3s", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], NULL);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x14: /* 0 - c -> c f - Load c with 0 minus c (10 100f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = 0 - c %-3s", s_field);
+         v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x15: /* 0 - c - 1 -> c[f] - Complement c (10 101f ff10) */
+         if (b_trace) fprintf(h_processor->output, "c = - c - 1 %-3s", s_field);
+         h_processor->flags[CARRY] = True; /* Set carry */
+         v_reg_sub(h_processor, h_processor->reg[C_REG], NULL, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x16: /* ? b[f] != 0 - Test b not equal to zero (10 110f ff10) */
+         if (b_trace) fprintf(h_processor->output, "? b != 0 %-3s", s_field);
+         v_reg_test_ne(h_processor, h_processor->reg[B_REG], NULL);
+         break;
+      case 0x17: /* ? c != 0 - Test c not equal to zero (10 111f ff10) */
+         if (b_trace) fprintf(h_processor->output, "? c != 0 %-3s", s_field);
+         v_reg_test_ne(h_processor, h_processor->reg[C_REG], NULL);
+         break;
+      case 0x18: /* ? a < c - Test a less than c (11 000f ff10) */
+         if (b_trace) fprintf(h_processor->output, "? a < c %-3s", s_field);
+         v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[C_REG]);/* Less than */
+         break;
+      case 0x19: /* ? a < b - Test a less than b (11 001f ff10) */
+         if (b_trace) fprintf(h_processor->output, "? a < b %-3s", s_field);
+         v_reg_sub(h_processor, NULL, h_processor->reg[A_REG], h_processor->reg[B_REG]); /* Less than */
+         break;
+      case 0x1a: /* ? a != 0 - Test a not equal to zero  (11 010f ff10) */
+         if (b_trace) fprintf(h_processor->output, "? a != 0 %-3s", s_field);
+         v_reg_test_ne(h_processor, h_processor->reg[A_REG], NULL);
+         break;
+      case 0x1b: /* ? a != c - Test a not equal to c (11 011f ff10) */
+         if (b_trace) fprintf(h_processor->output, "? a != c %-3s", s_field);
+         v_reg_test_ne(h_processor, h_processor->reg[A_REG], h_processor->reg[C_REG]);
+         break;
+      case 0x1c: /* a >> 1 -> a[f] - Shift right a (11 100f ff10) */
+         if (b_trace) fprintf(h_processor->output, "shr a %s\t\t", s_field);
+         v_reg_shr(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+      case 0x1d: /* b >> 1 -> b[f] - Shift right b (11 101f ff10) */
+         v_reg_shr(h_processor, h_processor->reg[B_REG]);
+         if (b_trace) fprintf(h_processor->output, "shr b %s\t\t", s_field);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[B_REG]);
+         break;
+      case 0x1e: /* c >> 1 -> c[f] - Shift right c (11 110f ff10) */
+         if (b_trace) fprintf(h_processor->output, "shr c %s\t\t", s_field);
+         v_reg_shr(h_processor, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case 0x1f: /* a << 1 -> a[f] - Shift left a (11 111f ff10) */
+         if (b_trace) fprintf(h_processor->output, "shl a %s\t\t", s_field);
+         fflush(stdout);
+         v_reg_shl(h_processor, h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[A_REG]);
+         break;
+
+      case OP_NOP: /* No operation (00 0000 0000) */
+         if (b_trace) fprintf(h_processor->output, "nop");
+         break;
+      case OP_CLEAR_S: /* 0 -> status[d] - Clear status bit (dd dd00 0100) */
+         if (b_trace) fprintf(h_processor->output, "st = 0 %-2d\t\t", h_decoded->arg);
+         h_processor->status[h_decoded->arg] = (unsigned char)False;
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_CLEAR_STATUS: /* 0 -> status[7:0] - Clear status (11 1100 0100) */
+         {
+            int i_count;
+            if (b_trace) fprintf(h_processor->output, "clrst\t\t");
+            for (i_count = 7; i_count >= 0; i_count--) /* Note only clears bits 7-0 of the status register */
+               h_processor->status[h_decoded->arg] = (unsigned char)False;
+         }
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_SET_S: /* 1 -> status[d] - Set status bit (dd dd00 0100) */
+         if (b_trace) fprintf(h_processor->output, "st = 1 %-2d\t\t", h_decoded->arg);
+         h_processor->status[h_decoded->arg] = (unsigned char)True;
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_RESET_KEYBOARD: /* 0 -> kyf  - Reset keyboard (11 1100 1000) */
+         if (b_trace) fprintf(h_processor->output, "rstkb");
+         if (!h_processor->keypressed) h_processor->flags[CARRY] = h_processor->kyf = False; /* Clear keyboard flag if no key pressed */
+         break;
+      case OP_TEST_S1: /* Test status bit [dddd] if 0 <= dddd <= 14 (dd dd00 1100) */
+         if (b_trace) fprintf(h_processor->output, "? st = 1 %-2d", h_decoded->arg);
+         h_processor->flags[CARRY] = h_processor->status[h_decoded->arg];
+         break;
+      case OP_TEST_KEYBOARD: /* Test keyboard (11 1100 1100) */
+         if (b_trace) fprintf(h_processor->output, "chkkb ");
+         h_processor->flags[CARRY] = h_processor->kyf;
+         h_processor->keytest = True;
+         break;
+      case OP_LOAD_CONSTANT: /* nn -> c[pt] - Load constant n (nn nn01 0000) */
+         if (b_trace) fprintf(h_processor->output, "lc %1x\t\t", h_decoded->arg);
+         v_nibble_set(h_processor->reg[C_REG], *h_active_pointer(h_processor), h_decoded->arg);
+         v_op_dec_pt(h_processor);
+         if (b_trace)
+            v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_TEST_PT: /* Test pointer equal to dddd if 0 <= dddd <= 14 (dd dd00 1100) */
+         if (b_trace) fprintf(h_processor->output, "? pt = %d", h_decoded->arg);
+         h_processor->flags[CARRY] = (*h_active_pointer(h_processor) == h_decoded->arg);
+         break;
+      case OP_DEC_PT: /* Decrement pointer (11 1101 0100) */
+         if (b_trace) fprintf(h_processor->output, "dec pt");
+         v_op_dec_pt(h_processor);
+         break;
+      case OP_G_FROM_C: /* c[pt + 1:pt] -> g - Load g from c (00 0101 1000) */
+         if (b_trace) fprintf(h_processor->output, "g = c\t\t");
+         h_processor->g[0]  = NIBBLE(h_processor->reg[C_REG], *h_active_pointer(h_processor)) & 0x0f; /* c[pt] -> g[0] */
+         if (*h_active_pointer(h_processor) < (REG_SIZE - 1))  /* Check that pt + 1 is valid */
+            h_processor->g[1] = NIBBLE(h_processor->reg[C_REG], *h_active_pointer(h_processor) + 1) & 0x0f; /* c[pt + 1] -> g[1] */
+         if (b_trace)
+            fprintf(h_processor->output, "g = 0x%02x", h_processor->g[0] | (h_processor->g[1] << 4));
+         break;
+      case OP_C_FROM_G: /* g -> c[pt + 1:pt] - Load c from g (00 0101 1000) */
+         if (b_trace) fprintf(h_processor->output, "c = g\t\t");
+         v_nibble_set(h_processor->reg[C_REG], *h_active_pointer(h_processor), h_processor->g[0]); /* g[0] -> c[pt] */
+         if (*h_active_pointer(h_processor) < (REG_SIZE - 1))  /* Check that pt + 1 is valid */
+            v_nibble_set(h_processor->reg[C_REG], *h_active_pointer(h_processor) + 1, h_processor->g[1]); /* g[1] -> c[pt + 1] */
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_C_EXCH_G: /* g -> c[pt + 1:pt], c[pt + 1:pt] -> g - Exchange c and g (00 1101 1000 */
+         if (b_trace) fprintf(h_processor->output, "cgex\t\t");
+         {
+            int i_temp[2];
+            i_temp[0] = h_processor->g[0]; i_temp[1] = h_processor->g[1];
+            h_processor->g[0] = NIBBLE(h_processor->reg[C_REG], *h_active_pointer(h_processor)) & 0x0f; /* c[pt] -> g[0] */
+            h_processor->g[1] = 0; /* (0 -> g[1]) */
+            v_nibble_set(h_processor->reg[C_REG], *h_active_pointer(h_processor), i_temp[0]); /* g[0] -> c[pt] */
+            if (*h_active_pointer(h_processor) < (REG_SIZE - 1))  /* Check that pt + 1 is valid */
+            {
+               h_processor->g[1] = NIBBLE(h_processor->reg[C_REG], *h_active_pointer(h_processor) + 1) & 0x0f; /* c[pt + 1] -> g[1] */
+               v_nibble_set(h_processor->reg[C_REG], *h_active_pointer(h_processor) + 1, i_temp[1]); /* g[1] -> c[pt + 1] */
+            }
+         }
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         if (b_trace) fprintf(h_processor->output, "g = 0x%02x", h_processor->g[0] | (h_processor->g[1] << 4));
+         break;
+      case OP_M_FROM_C: /* c -> m - Copy C register to M register (01 0101 1000) */
+         if (b_trace) fprintf(h_processor->output, "m = c\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[M_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[M_REG]);
+         break;
+      case OP_C_FROM_M: /* m -> c - Copy M register to C register (01 1001 1000) */
+         if (b_trace) fprintf(h_processor->output, "c = m\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[M_REG]);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_C_EXCH_M: /* c -> m, m -> c - Exchange C register and M register (01 1101 1000) */
+         if (b_trace) fprintf(h_processor->output, "cmex\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_exch(h_processor, h_processor->reg[M_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[M_REG]);
+         break;
+      case OP_C_FROM_ST: /* st[0:7] -> c[0:1] - Load c register from the status byte (11 1001 1000) */
+         if (b_trace) fprintf(h_processor->output, "c = st\t\t");
+         {
+            int i_status, i_count;
+            i_status = 0;
+            for (i_count = 7; i_count >= 0 ; i_count--)
+            {
+               i_status <<= 1;
+               if (h_processor->status[i_count]) i_status |= 0x1;
+            }
+            v_nibble_set(h_processor->reg[C_REG], 0, i_status & 0xf);
+            v_nibble_set(h_processor->reg[C_REG], 1, i_status >> 4);
+         }
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_C_EXCH_ST: /* c[0:1] -> st[0:7], st[0:7] -> c[0:1] - Exchange c register and the status byte (11 1101 1000) */
+         if (b_trace) fprintf(h_processor->output, "cstex\t\t");
+         {
+            int i_temp, i_status, i_count;
+            i_status = 0; /* Save st[0:7] */
+            for (i_count = 7; i_count >= 0 ; i_count--)
+            {
+               i_status <<= 1;
+               if (h_processor->status[i_count]) i_status |= 0x1;
+            }
+            i_temp = NIBBLE(h_processor->reg[C_REG], 0) | NIBBLE(h_processor->reg[C_REG], 1) << 4;
+            for (i_count = 0; i_count <=7; i_count++)
+            {
+               if (i_temp & 0x1)
+                  h_processor->status[i_count] = True;
+               else
+                  h_processor->status[i_count] = False;
+               i_temp >>= 1;
+            }
+            v_nibble_set(h_processor->reg[C_REG], 0, i_status & 0xf);
+            v_nibble_set(h_processor->reg[C_REG], 1, i_status >> 4);
+         }
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_status(h_processor->output, h_processor);
+         break;
+      case OP_SET_PT: /* Load pointer with dddd if 0 <= dddd <= 14 (dd dd00 1100) */
+         if (b_trace) fprintf(h_processor->output, "pt = %d", h_decoded->arg);
+         *h_active_pointer(h_processor) = h_decoded->arg;
+         if (b_trace) fprintf(h_processor->output, "\t\tpt = %02d  ", *h_active_pointer(h_processor));
+         break;
+      case OP_INC_PT: /* Increment pointer (11 1101 0100) */
+         if (b_trace) fprintf(h_processor->output, "inc pt");
+         v_op_inc_pt(h_processor);
+         break;
+      case OP_POWER_OFF: /* Power off (00 0110 0000) */
+         if (b_trace) fprintf(h_processor->output, "powoff");
+         if (h_processor->flags[DISPLAY_ENABLE]) /* Sleep */
+         {
+            h_processor->sleep = True;
+         }
+         else  /* Poweroff */
+         {
+            h_processor->flags[CARRY] = True; /* Carry set on deep sleep */
+            h_processor->enabled = False;
+         }
+         h_processor->pc = 0;
+         break;
+      case OP_SELECT_P: /* pt = p - Select pointer p (00 1010 0000) */
+         if (b_trace) fprintf(h_processor->output, "sel p\t\t");
+         h_processor->ptr = False;
+         break;
+      case OP_SELECT_Q: /* pt = q - Select pointer q (00 1110 0000) */
+         if (b_trace) fprintf(h_processor->output, "sel q\t\t");
+         h_processor->ptr = True;
+         break;
+      case OP_TEST_P_Q: /* ? p == q - Test p equal to q  (01 0010 0000) */
+         if (b_trace) fprintf(h_processor->output, "? p = q\t\t");
+         if (h_processor->p == h_processor->q) h_processor->flags[CARRY] = True;
+         break;
+      case OP_TEST_LLD: /* ? low level detect - Test battery state (01 0110 0000) */
+         if (b_trace) fprintf(h_processor->output, "? lld\t\t");
+         /* Do nothing - battery can never go flat */
+         break;
+      case OP_CLEAR_ABC: /* 0 -> a, 0 -> b, 0 -> c - Clear registers a, b and c (01 1010 0000) */
+         if (b_trace) fprintf(h_processor->output, "clrabc\t\t");
+         h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[A_REG], NULL);
+         v_reg_copy(h_processor, h_processor->reg[B_REG], NULL);
+         v_reg_copy(h_processor, h_processor->reg[C_REG], NULL);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output, h_processor->reg[A_REG]);
+            v_fprint_register(h_processor->output, h_processor->reg[B_REG]);
+            v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         }
+         break;
+      case OP_C_TO_PC: /* c[6:3] -> pc - Branch using C register (01 1110 0000) */
+         if (b_trace) fprintf(h_processor->output, "goto c\t\t");
+         h_processor->pc = (((NIBBLE(h_processor->reg[C_REG], 6))<< 12) |
+            (NIBBLE(h_processor->reg[C_REG], 5) << 8) |
+            (NIBBLE(h_processor->reg[C_REG], 4) << 4) |
+            (NIBBLE(h_processor->reg[C_REG], 3)));
+         break;
+      case OP_KEYS_TO_C: /* keys -> c[4:3] - Load c from keys (10 0010 0000) */
+         if (b_trace) fprintf(h_processor->output, "c = keys\t\t");
+         h_processor->keyscan = True;
+         v_nibble_set(h_processor->reg[C_REG], 3, h_processor->code & 0xf);
+         v_nibble_set(h_processor->reg[C_REG], 4, (h_processor->code >> 4) & 0xf);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_SET_HEX: /* 0 -> decimal - Set hex mode(10 0110 0000) */
+         if (b_trace) fprintf(h_processor->output, "sethex");
+         h_processor->base = 16;
+         break;
+      case OP_SET_DEC: /* 1 -> decimal - Set decimal mode (10 0110 0000) */
+         if (b_trace) fprintf(h_processor->output, "setdec");
+         h_processor->base = 10;
+         break;
+      case OP_DISPLAY_OFF: /* 0 -> display - Display off (10 1110 0000) */
+         if (b_trace) fprintf(h_processor->output, "disoff");
+         h_processor->flags[DISPLAY_ENABLE] = False;
+         break;
+      case OP_DISPLAY_TOGGLE: /* ~display -> display - Display toggle (10 1110 0000) */
+         if (b_trace) fprintf(h_processor->output, "distog");
+         h_processor->flags[DISPLAY_ENABLE] = !h_processor->flags[DISPLAY_ENABLE];
+         break;
+      case OP_RETURN_C: /* if carry stack[0] -> pc, stack[1] -> stack[0], stack[2] -> stack[1], stack[3] -> stack[2], 0 -> stack[3] - Return if carry (11 0110 0000) */
+         if (b_trace) fprintf(h_processor->output, "rtn c");
+         if (h_processor->flags[PREV_CARRY])
+         {
+            h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
+            h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter from the stack */
+            if (h_processor->profile != NULL) v_profile_return(h_processor);
+         }
+         break;
+      case OP_RETURN_NC: /* if !carry stack[0] -> pc, stack[1] -> stack[0], stack[2] -> stack[1], stack[3] -> stack[2], 0 -> stack[3] - Return if no carry (11 1010 0000) */
+         if (b_trace) fprintf(h_processor->output, "rtn nc");
+         if (!h_processor->flags[PREV_CARRY])
+         {
+            h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
+            h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter from the stack */
+            if (h_processor->profile != NULL) v_profile_return(h_processor);
+         }
+         break;
+      case OP_RETURN: /* stack[0] -> pc, stack[1] -> stack[0], stack[2] -> stack[1], stack[3] -> stack[2], 0 -> stack[3] - Return (11 1110 0000) */
+         if (b_trace) fprintf(h_processor->output, "rtn");
+         h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
+         h_processor->pc = h_processor->stack[h_processor->sp]; /* Pop program counter from the stack */
+         if (h_processor->profile != NULL) v_profile_return(h_processor);
+         break;
+      case OP_C_TO_REGISTER: /* {addr[11:4], nnnn} -> addr, c -> reg[addr] - Load register from c (nn nn10 1000) */
+         if (b_trace) fprintf(h_processor->output, "regn = c %-2d", (h_decoded->arg));
+         h_processor->addr = (h_processor->addr & 0xff0) | (h_decoded->arg);
+         h_processor->first = 0;
+         h_processor->last = REG_SIZE - 1;
+         if (i_translate_addr(h_processor->addr) < MEMORY_SIZE)
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+            if ((h_processor->addr != 0x08) && (h_processor->addr != 0x18))  /* Non existent registers */
+#endif
+            {
+               v_reg_copy(h_processor, h_processor->mem[i_translate_addr(h_processor->addr)], h_processor->reg[C_REG]);
+               if (b_trace) v_fprint_register(h_processor->output, h_processor->mem[i_translate_addr(h_processor->addr)]);
+            }
+         break;
+      case OP_BLINK: /* display blink- Display blink (00 0011 0000) */
+         if (b_trace) fprintf(h_processor->output, "blink\t\t");
+         h_processor->flags[DISPLAY_ENABLE] = True;
+         break;
+      case OP_N_FROM_C: /* c -> n - Load n from c (00 0111 0000) */
+         if (b_trace) fprintf(h_processor->output, "n = c\t\t");
+         h_processor->first = 0;
+         h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[N_REG], h_processor->reg[C_REG]);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[N_REG]);
+         break;
+      case OP_C_FROM_N: /* n -> c - Load C from N (00 1011 0000) */
+         if (b_trace) fprintf(h_processor->output, "c = n\t\t");
+         h_processor->first = 0;
+         h_processor->last = REG_SIZE - 1;
+         v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->reg[N_REG]);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_C_EXCH_N: /* c -> n, n-> c - Exchange c and n (00 1111 0000) */
+         h_processor->first = 0;
+         h_processor->last = REG_SIZE - 1;
+         if (b_trace) fprintf(h_processor->output, "cnex\t\t");
+         v_reg_exch(h_processor, h_processor->reg[N_REG], h_processor->reg[C_REG]);
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+            v_fprint_register(h_processor->output, h_processor->reg[N_REG]);
+         }
+         break;
+      case OP_LOAD_IMMEDIATE: /* rom[pc++] -> c[2:0] - Load immediate (01 0011 0000) */
+         {
+            int i_next;
+            i_next = h_processor->rom[h_processor->pc]; /* Get next opcode */
+            v_nibble_set(h_processor->reg[C_REG], 2, (i_next >> 8) & 0xf);
+            v_nibble_set(h_processor->reg[C_REG], 1, (i_next >> 4) & 0xf);
+            v_nibble_set(h_processor->reg[C_REG], 0, i_next & 0xf);
+            if (b_trace)
+            {
+               fprintf(h_processor->output, "ldi\n");
+               fprintf(h_processor->output, h_msg_opcode, (h_processor->pc >> 12), (h_processor->pc & 0x0fff), h_processor->rom[h_processor->pc]);
+               fprintf(h_processor->output,"  ");
+               fprintf(h_processor->output, h_msg_address, i_next);
+               fprintf(h_processor->output, "\t\t");
+               v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+            }
+            v_op_inc_pc(h_processor); /* Increment program counter */
+         }
+         break;
+      case OP_PUSH_C: /* stack[2] -> stack[3], stack[1] -> stack[2], stack[0] -> stack[1], c -> stack[0] - Push c[6:3] onto the stack (01 0111 0000) */
+         if (b_trace) fprintf(h_processor->output, "stk = c\t\t");
+         h_processor->stack[h_processor->sp] = (NIBBLE(h_processor->reg[C_REG], 6) << 12) | (NIBBLE(h_processor->reg[C_REG], 5) << 8) | (NIBBLE(h_processor->reg[C_REG], 4) << 4) | (NIBBLE(h_processor->reg[C_REG], 3));
+         h_processor->sp = (h_processor->sp + 1) & (STACK_SIZE - 1); /* Update stack pointer */
+         break;
+      case OP_POP_C: /* stack[2] -> stack[3], stack[1] -> stack[2], stack[0] -> stack[1], c -> stack[0] - Pop c[6:3] from the stack (01 0111 0000) */
+         if (b_trace) fprintf(h_processor->output, "c = stk\t\t");
+         h_processor->sp = (h_processor->sp - 1) & (STACK_SIZE - 1); /* Update stack pointer */
+         v_nibble_set(h_processor->reg[C_REG], 3, h_processor->stack[h_processor->sp] & 0xf);
+         v_nibble_set(h_processor->reg[C_REG], 4, (h_processor->stack[h_processor->sp] >> 4) & 0xf);
+         v_nibble_set(h_processor->reg[C_REG], 5, (h_processor->stack[h_processor->sp] >> 8) & 0xf);
+         v_nibble_set(h_processor->reg[C_REG], 6, (h_processor->stack[h_processor->sp] >> 12) & 0xf);
+         break;
+      case OP_C_TO_ADDR: /* {addr[11:4], nnnn} -> addr, c -> reg[addr] - Load register address from c (10 0111 1000) */
+         if (b_trace) fprintf(h_processor->output, "dadd = c\t\t");
+         h_processor->addr = ((NIBBLE(h_processor->reg[C_REG], 2) << 8) |
+            (NIBBLE(h_processor->reg[C_REG], 1) << 4) |
+            (NIBBLE(h_processor->reg[C_REG], 0))) & 0x3ff; /* Load 12 bit address into address register from c */
+         if (b_trace) fprintf(h_processor->output, "addr = %d", h_processor->addr);
+         break;
+      case OP_C_TO_DATA: /* data = c - Load register from c (10 1111 0000) */
+         if (b_trace) fprintf(h_processor->output, "data = c\t\t");
+         if ((i_translate_addr(h_processor->addr) < MEMORY_SIZE) && (h_processor->addr != 0x08) && (h_processor->addr != 0x18))
+         {
+            h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+            v_reg_copy(h_processor, h_processor->mem[i_translate_addr(h_processor->addr)], h_processor->reg[C_REG]);
+            if (b_trace) v_fprint_register(h_processor->output, h_processor->mem[i_translate_addr(h_processor->addr)]);
+         }
+         break;
+      case OP_CXISA: /* c[6:3] -> addr, ram[addr] -> c[2:0] - Exchange c and memory (11 0011 0000) */
+         if (b_trace) fprintf(h_processor->output, "cxisa\t\t");
+         {
+            int i_addr;
+            i_addr = (((NIBBLE(h_processor->reg[C_REG], 6))<< 12) | (NIBBLE(h_processor->reg[C_REG], 5) << 8) |
+               (NIBBLE(h_processor->reg[C_REG], 4) << 4) | (NIBBLE(h_processor->reg[C_REG], 3)));
+            if (i_addr > ROM_SIZE)
+               {
+                  if (b_trace) fprintf(h_processor->output, "\n");
+                  v_error(errno, h_err_invalid_address, i_addr, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+               }
+            else
+            {
+               v_nibble_set(h_processor->reg[C_REG], 2, (h_processor->rom[i_addr] >> 8) & 0xf);
+               v_nibble_set(h_processor->reg[C_REG], 1, (h_processor->rom[i_addr] >> 4) & 0xf);
+               v_nibble_set(h_processor->reg[C_REG], 0, (h_processor->rom[i_addr]) & 0xf);
+            }
+         }
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_C_OR_A: /* c | a -> c - Load c with c or a (11 0111 0000) */
+         if (b_trace) fprintf(h_processor->output, "c = c or a\t\t");
+         h_processor->first = 0;
+         h_processor->last = REG_SIZE - 1;
+         v_reg_or(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_C_AND_A: /* c | a -> c - Load c with c and a (11 0111 0000) */
+         if (b_trace) fprintf(h_processor->output, "c = c and a");
+         h_processor->first = 0;
+         h_processor->last = REG_SIZE - 1;
+         v_reg_and(h_processor, h_processor->reg[C_REG], h_processor->reg[C_REG], h_processor->reg[A_REG]);
+         if (b_trace) v_fprint_register(h_processor->output, h_processor->reg[C_REG]);
+         break;
+      case OP_REGISTER_TO_C: /* {addr[11:4], nnnn} -> addr, reg[addr] -> c - Load c from register (nn nn11 1000) */
+         if (h_decoded->arg)
+         {
+            if (b_trace) fprintf(h_processor->output, "c = regn %-2d", h_decoded->arg);
+            h_processor->addr = (h_processor->addr & 0xff0) | (h_decoded->arg);
+         }
+         else
+            if (b_trace) fprintf(h_processor->output, "c = data\t\t");
+         h_processor->first = 0;
+         h_processor->last = REG_SIZE - 1;
+         if ((i_translate_addr(h_processor->addr) < MEMORY_SIZE) && (h_processor->addr != 0x08) && (h_processor->addr != 0x18)) /* Treat registers 8 and 18 as if they dont exist */
+            v_reg_copy(h_processor, h_processor->reg[C_REG], h_processor->mem[i_translate_addr(h_processor->addr)]);
+         else
+            v_reg_copy(h_processor, h_processor->reg[C_REG], NULL); /* Return zeros if memory doesnt' exist */
+         if (b_trace)
+         {
+            v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+            fprintf(h_processor->output, "\taddr = %d", h_processor->addr);
+         }
+         break;
+      case OP_ROTATE_C: /* Rotate c register right (dddd 1111 00) */
+         if (b_trace) fprintf(h_processor->output, "rcr %-3d\t\t", h_decoded->arg);
+         {
+            uint64_t i_temp = h_processor->reg[C_REG]->value & PACKED_REGISTER;
+            int i_shift = 4 * (h_decoded->arg % REG_SIZE); /* Rotating all the way round leaves the register unchanged */
+            if (h_decoded->arg > 0)
+            {
+               h_processor->reg[C_REG]->value = (h_processor->reg[C_REG]->value & ~PACKED_REGISTER) | (((i_temp >> i_shift) | (i_temp << (4 * REG_SIZE - i_shift))) & PACKED_REGISTER);
+               h_processor->flags[PREV_CARRY] = h_processor->flags[CARRY] = False;
+            }
+         }
+         if (b_trace) v_fprint_register(h_processor->output,h_processor->reg[C_REG]);
+         break;
+      case OP_GSB_NC: /* if no carry then stack[2] -> stack[3], stack[1] -> stack[2], stack[0] -> stack[1], pc -> stack[0], a -> pc - Branch to subroutine on no carry (aa aaaa aa00, aa aaaa aa00) */
+         if (b_trace) fprintf(h_processor->output, "? nc gsb\t\t");
+         v_op_branch(h_processor, h_decoded->address, b_trace);
+         if (h_decoded->address < ROM_SIZE) /* Check that the target address exists otherwise treat as a 'nop' */
+            if (!h_processor->flags[PREV_CARRY]) op_jsb(h_processor, h_decoded->address);
+         break;
+      case OP_GSB_C: /* if carry then stack[2] -> stack[3], stack[1] -> stack[2], stack[0] -> stack[1], pc -> stack[0], a -> pc - Branch to subroutine on no carry (aa aaaa aa00, aa aaaa aa01) */
+         if (b_trace) fprintf(h_processor->output, "? c gsb\t\t");
+         v_op_branch(h_processor, h_decoded->address, b_trace);
+         if (h_decoded->address < ROM_SIZE) /* Check that the target address exists otherwise treat as a 'nop' */
+            if (h_processor->flags[PREV_CARRY]) op_jsb(h_processor, h_decoded->address);
+         break;
+      case OP_GO_TO_NC: /* if no carry then a -> pc - Branch on no carry (aa aaaa aa00, aa aaaa aa10) */
+         if (b_trace) fprintf(h_processor->output, "? nc goto\t\t");
+         v_op_branch(h_processor, h_decoded->address, b_trace);
+         if (!h_processor->flags[PREV_CARRY])
+            h_processor->pc = h_decoded->address;
+         break;
+      case OP_GO_TO_C: /* if carry then a -> pc - Branch on carry (aa aaaa aa00, aa aaaa aa11) */
+         if (b_trace) fprintf(h_processor->output, "? c goto\t\t");
+         v_op_branch(h_processor, h_decoded->address, b_trace);
+         if (h_processor->flags[PREV_CARRY])
+            h_processor->pc = h_decoded->address;
+         break;
+      case OP_JC: /* Relative jump on carry */
+         if (b_trace) fprintf(h_processor->output, "jc ");
+         if (h_processor->flags[PREV_CARRY])
+            h_processor->pc = h_decoded->address; /* Target address was fixed when decoded */
+         if (b_trace) v_fprint_offset(h_processor->output, i_opcode);
+         break;
+      case OP_JNC: /* Relative jump on no carry */
+         if (b_trace) fprintf(h_processor->output, "jnc ");
+         if (!h_processor->flags[PREV_CARRY])
+            h_processor->pc = h_decoded->address;
+         if (b_trace) v_fprint_offset(h_processor->output, i_opcode);
+         break;
+#endif
+
+      default: /* Unexpected opcode */
+         if (b_trace) fprintf(h_processor->output, "\n");
+         v_error(errno, h_err_unexpected_opcode, i_opcode, (i_last >> 12), (i_last & 0xfff), __FILE__, __LINE__);
+      }
+      if (b_trace) fprintf(h_processor->output, "\n");
+      h_processor->opcode = i_opcode; /* Keep track of the previous opcode so you know when to increment 'P' */
+   }
+}
+
+void v_processor_tick(oprocessor *h_processor) /* Execute a single instruction (without any tracing) */
+{
+   v_processor_execute(h_processor, False);
+}
+
+void v_processor_trace(oprocessor *h_processor) /* Execute a single instruction and trace it */
+{
+   v_processor_execute(h_processor, True);
+}
+
+void v_breakpoint(oprocessor *h_processor, unsigned int i_address, int b_set) /* Set or clear a breakpoint */
+{
+   if (i_address < ROM_SIZE)
+   {
+      if (b_set)
+         h_processor->breakpoints[i_address >> 3] |= (1 << (i_address & 7));
+      else
+         h_processor->breakpoints[i_address >> 3] &= ~(1 << (i_address & 7));
+   }
+}
+
+int i_breakpoint(oprocessor *h_processor, unsigned int i_address) /* Check for a breakpoint at an address */
+{
+   if (i_address < ROM_SIZE)
+      return ((h_processor->breakpoints[i_address >> 3] >> (i_address & 7)) & 1);
+   return False;
+}
+
+void v_trap(oprocessor *h_processor, unsigned int i_opcode, int b_set) /* Set or clear an instruction trap */
+{
+   if (i_opcode < TRAPS)
+   {
+      if (b_set)
+         h_processor->traps[i_opcode >> 3] |= (1 << (i_opcode & 7));
+      else
+         h_processor->traps[i_opcode >> 3] &= ~(1 << (i_opcode & 7));
+   }
+}
+
+int i_processor_break(oprocessor *h_processor) /* Check for a breakpoint at the current address or a trapped opcode */
+{
+   unsigned int i_opcode = h_processor->rom[h_processor->pc] & (TRAPS - 1);
+   return (((h_processor->breakpoints[h_processor->pc >> 3] >> (h_processor->pc & 7)) |
+      (h_processor->traps[i_opcode >> 3] >> (i_opcode & 7))) & 1);
+}
+
+static void v_processor_state(oprocessor *h_processor, ostate *h_state) /* Copy the current processor state */
+{
+   int i_count;
+   memset(h_state, 0, sizeof(*h_state)); /* Clear any padding so states can be compared */
+   for (i_count = 0; i_count < REGISTERS; i_count++)
+      h_state->value[i_count] = h_processor->reg[i_count]->value;
+   memcpy(h_state->flags, h_processor->flags, sizeof(h_state->flags));
+   memcpy(h_state->status, h_processor->status, sizeof(h_state->status));
+   memcpy(h_state->stack, h_processor->stack, sizeof(h_state->stack));
+   h_state->writes = h_processor->writes;
+   h_state->opcode = h_processor->opcode;
+   h_state->pc = h_processor->pc;
+   h_state->sp = h_processor->sp;
+   h_state->addr = h_processor->addr;
+   h_state->base = h_processor->base;
+   h_state->code = h_processor->code;
+   h_state->f = h_processor->f;
+   h_state->p = h_processor->p;
+   h_state->keypressed = h_processor->keypressed;
+   h_state->mode = h_processor->mode;
+   h_state->timer = h_processor->timer;
+   h_state->sleep = h_processor->sleep;
+   h_state->enabled = h_processor->enabled;
+#if defined(HP67)
+   memcpy(h_state->crc, h_processor->crc, sizeof(h_state->crc));
+#endif
+#if defined(HP10)
+   h_state->print = h_processor->print;
+   h_state->position = h_processor->position;
+   memcpy(h_state->buffer, h_processor->buffer, sizeof(h_state->buffer));
+#endif
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   h_state->kyf = h_processor->kyf;
+   h_state->g[0] = h_processor->g[0];
+   h_state->g[1] = h_processor->g[1];
+   h_state->q = h_processor->q;
+   h_state->ptr = h_processor->ptr;
+#else
+   h_state->rom_number = h_processor->rom_number;
+#endif
+}
+
+#if defined(SNAPSHOT)
+static void v_processor_restore(oprocessor *h_processor, ostate *h_state) /* Restore the processor state */
+{
+   int i_count;
+   for (i_count = 0; i_count < REGISTERS; i_count++)
+      h_processor->reg[i_count]->value = h_state->value[i_count];
+   memcpy(h_processor->flags, h_state->flags, sizeof(h_state->flags));
+   memcpy(h_processor->status, h_state->status, sizeof(h_state->status));
+   memcpy(h_processor->stack, h_state->stack, sizeof(h_state->stack));
+   h_processor->writes = h_state->writes;
+   h_processor->opcode = h_state->opcode;
+   h_processor->pc = h_state->pc;
+   h_processor->sp = h_state->sp;
+   h_processor->addr = h_state->addr;
+   h_processor->base = h_state->base;
+   h_processor->f = h_state->f;
+   h_processor->p = h_state->p;
+   h_processor->sleep = h_state->sleep; /* The switches and keyboard belong to the front end */
+#if !defined(SWITCHES)
+   h_processor->enabled = h_state->enabled; /* Unless there is no power switch */
+#endif
+#if defined(HP67)
+   memcpy(h_processor->crc, h_state->crc, sizeof(h_state->crc));
+#endif
+#if defined(HP10)
+   h_processor->print = h_state->print;
+   h_processor->position = h_state->position;
+   memcpy(h_processor->buffer, h_state->buffer, sizeof(h_state->buffer));
+#endif
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   h_processor->kyf = h_state->kyf;
+   h_processor->g[0] = h_state->g[0];
+   h_processor->g[1] = h_state->g[1];
+   h_processor->q = h_state->q;
+   h_processor->ptr = h_state->ptr;
+#else
+   h_processor->rom_number = h_state->rom_number;
+#endif
+   h_processor->first = 0; h_processor->last = REG_SIZE - 1;
+   h_processor->idle = ROM_SIZE; /* No keyboard test seen yet */
+}
+
+void v_take_snapshot(oprocessor *h_processor, osnapshot *h_snapshot) /* Copy the complete processor state into a snapshot */
+/*
+ * Memory is left out of the snapshot if it is kept in a memory mapped file.
+ */
+{
+   int i_count;
+
+   memset(h_snapshot, 0, sizeof(*h_snapshot));
+   memcpy(h_snapshot->header.magic, SNAPSHOT_MAGIC, sizeof(h_snapshot->header.magic));
+   h_snapshot->header.version = SNAPSHOT_VERSION;
+   strncpy(h_snapshot->header.model, FILENAME, sizeof(h_snapshot->header.model) - 1);
+   v_processor_state(h_processor, &h_snapshot->state);
+   if (h_processor->mapped != NULL)
+   {
+      h_snapshot->header.flags = SNAPSHOT_MAPPED;
+      h_snapshot->header.length = sizeof(h_snapshot->state);
+   }
+   else
+   {
+      h_snapshot->header.length = sizeof(h_snapshot->state) + sizeof(h_snapshot->memory);
+      for (i_count = 0; i_count < MEMORY_SIZE; i_count++)
+         h_snapshot->memory[i_count] = h_processor->mem[i_count]->value;
+   }
+   h_snapshot->header.checksum = i_checksum((unsigned char *) &h_snapshot->state, h_snapshot->header.length);
+}
+
+void v_restore_snapshot(oprocessor *h_processor, osnapshot *h_snapshot) /* Restore the processor state from a snapshot taken earlier */
+{
+   int i_count;
+
+   v_processor_restore(h_processor, &h_snapshot->state);
+   if (!(h_snapshot->header.flags & SNAPSHOT_MAPPED)) /* Otherwise memory is still in the mapped file */
+      for (i_count = 0; i_count < MEMORY_SIZE; i_count++)
+         h_processor->mem[i_count]->value = h_snapshot->memory[i_count];
+}
+
+int i_write_snapshot(osnapshot *h_snapshot, char *s_pathname) /* Save a snapshot of the processor state */
+/*
+ * Returns True if the snapshot was saved.
+ */
+{
+   char *s_temp;
+   int i_file, i_size, b_error = True;
+
+   i_size = offsetof(osnapshot, state) + h_snapshot->header.length;
+
+   if ((s_temp = malloc(strlen(s_pathname) + 5)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   strcpy(s_temp, s_pathname);
+   strcat(s_temp, ".tmp");
+   i_file = open(s_temp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+   if (i_file < 0)
+      v_warning(h_err_opening_file, s_temp);
+   else
+   {
+      fprintf(stderr,h_msg_saving, s_pathname);
+      b_error = (write(i_file, h_snapshot, i_size) != i_size);
+      b_error |= (fsync(i_file) != 0); /* Make sure the new file is on disk before it replaces the old one */
+      b_error |= (close(i_file) != 0);
+      if (b_error || (rename(s_temp, s_pathname) != 0)) /* Either the old or the new file survives a crash */
+      {
+         v_warning(h_err_creating_file, s_pathname);
+         unlink(s_temp);
+         b_error = True;
+      }
+   }
+   free(s_temp);
+   return !b_error;
+}
+
+int i_read_memory(oprocessor *h_processor, char *s_pathname) /* Load memory from a memory file */
+{
+   omemoryfile *h_memory;
+   struct stat o_stat;
+   int i_file, i_count, b_valid;
+
+   if ((i_file = open(s_pathname, O_RDONLY)) < 0) return False; /* No memory file */
+   if ((fstat(i_file, &o_stat) != 0) || (o_stat.st_size != sizeof(*h_memory)))
+      h_memory = MAP_FAILED;
+   else
+      h_memory = mmap(NULL, sizeof(*h_memory), PROT_READ, MAP_PRIVATE, i_file, 0);
+   close(i_file);
+   b_valid = (h_memory != MAP_FAILED) &&
+      !memcmp(h_memory->header.magic, MEMORY_FILE_MAGIC, sizeof(h_memory->header.magic)) &&
+      (h_memory->header.version == MEMORY_FILE_VERSION) &&
+      !strncmp(h_memory->header.model, FILENAME, sizeof(h_memory->header.model));
+   if (b_valid)
+   {
+      fprintf(stderr,h_msg_loading, s_pathname);
+      for (i_count = 0; i_count < MEMORY_SIZE; i_count++)
+         h_processor->mem[i_count]->value = h_memory->memory[i_count].value;
+   }
+   else
+      v_warning(h_err_memory_file, s_pathname);
+   if (h_memory != MAP_FAILED) munmap(h_memory, sizeof(*h_memory));
+   return b_valid;
+}
+
+int i_read_snapshot(oprocessor *h_processor, char *s_pathname, int b_memory) /* Restore the complete processor state */
+/*
+ * If 'b_memory' is set memory is also restored, either from the snapshot
+ * or if it was left out of the snapshot from the memory file next to it.
+ */
+{
+   osnapshot *h_snapshot;
+   struct stat o_stat;
+   char *s_memory;
+   int i_file, i_count, b_valid, b_mapped;
+
+   if ((i_file = open(s_pathname, O_RDONLY)) < 0) return False;
+   if ((fstat(i_file, &o_stat) != 0) || (o_stat.st_size < offsetof(osnapshot, memory)) || (o_stat.st_size > sizeof(*h_snapshot)))
+   {
+      close(i_file);
+      return False; /* Not a snapshot (or not from this build) */
+   }
+   h_snapshot = mmap(NULL, o_stat.st_size, PROT_READ, MAP_PRIVATE, i_file, 0);
+   close(i_file);
+   if (h_snapshot == MAP_FAILED) return False;
+   b_mapped = (h_snapshot->header.flags & SNAPSHOT_MAPPED);
+   b_valid = !memcmp(h_snapshot->header.magic, SNAPSHOT_MAGIC, sizeof(h_snapshot->header.magic)) &&
+      (h_snapshot->header.version == SNAPSHOT_VERSION) &&
+      !strncmp(h_snapshot->header.model, FILENAME, sizeof(h_snapshot->header.model)) &&
+      (h_snapshot->header.length == sizeof(h_snapshot->state) + (b_mapped ? 0 : sizeof(h_snapshot->memory))) &&
+      (o_stat.st_size == offsetof(osnapshot, state) + h_snapshot->header.length) &&
+      (h_snapshot->header.checksum == i_checksum((unsigned char *) &h_snapshot->state, h_snapshot->header.length));
+   if (b_valid)
+   {
+      fprintf(stderr,h_msg_loading, s_pathname);
+      v_processor_restore(h_processor, &h_snapshot->state);
+      if (b_memory && !b_mapped)
+         for (i_count = 0; i_count < MEMORY_SIZE; i_count++)
+            h_processor->mem[i_count]->value = h_snapshot->memory[i_count];
+   }
+   else if (!memcmp(h_snapshot->header.magic, SNAPSHOT_MAGIC, sizeof(h_snapshot->header.magic)))
+      v_warning(h_err_snapshot, s_pathname); /* A snapshot but damaged or from another model */
+   munmap(h_snapshot, o_stat.st_size);
+   if (b_valid && b_memory && b_mapped) /* Memory was kept in the memory file */
+   {
+      s_memory = s_datafile_type(s_pathname, ".mem");
+      i_read_memory(h_processor, s_memory);
+      free(s_memory);
+   }
+   return b_valid;
+}
+#endif
+
+static int i_processor_idle(oprocessor *h_processor, unsigned int i_address) /* Check if the ROM is just waiting for a key */
+{
+   ostate o_state;
+   if (h_processor->keypressed) return False;
+   v_processor_state(h_processor, &o_state);
+   if ((h_processor->idle == i_address) && !memcmp(&o_state, &h_processor->state, sizeof(o_state)))
+      return True; /* Nothing has changed since the last time the keyboard was tested here */
+   h_processor->idle = i_address;
+   h_processor->state = o_state;
+   return False;
+}
+
+static int i_profile_context(oprofile *h_profile, int i_parent, unsigned int i_address) /* Find the calling context of a subroutine (adding it if necessary) */
+{
+   ocontext *h_context;
+   int i_context;
+   for (i_context = h_profile->context[i_parent].child; i_context >= 0; i_context = h_profile->context[i_context].sibling)
+      if (h_profile->context[i_context].address == i_address) return (i_context);
+   if (h_profile->contexts >= h_profile->size) /* Make room for more contexts */
+   {
+      h_profile->size *= 2;
+      if ((h_profile->context = realloc(h_profile->context, sizeof(*h_profile->context) * h_profile->size)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   }
+   i_context = h_profile->contexts++;
+   h_context = &h_profile->context[i_context];
+   h_context->address = i_address;
+   h_context->parent = i_parent;
+   h_context->child = -1;
+   h_context->sibling = h_profile->context[i_parent].child; /* Add to the list of subroutines called by the caller */
+   h_context->calls = 0;
+   h_context->count = 0;
+   h_profile->context[i_parent].child = i_context;
+   return (i_context);
+}
+
+void v_profile_start(oprocessor *h_processor) /* Start counting the instructions executed */
+{
+   oprofile *h_profile;
+   if (h_processor->profile != NULL) return; /* Already started */
+   if ((h_profile = malloc(sizeof(*h_profile))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   memset(h_profile->address, 0, sizeof(h_profile->address));
+   memset(h_profile->type, 0, sizeof(h_profile->type));
+   h_profile->size = 256;
+   if ((h_profile->context = malloc(sizeof(*h_profile->context) * h_profile->size)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   h_profile->context[0].address = 0; /* The root context isn't a subroutine */
+   h_profile->context[0].parent = -1;
+   h_profile->context[0].child = -1;
+   h_profile->context[0].sibling = -1;
+   h_profile->context[0].calls = 0;
+   h_profile->context[0].count = 0;
+   h_profile->contexts = 1;
+   h_profile->current = 0;
+   h_profile->depth = 0;
+   h_processor->profile = h_profile;
+}
+
+void v_profile_call(oprocessor *h_processor) /* Enter the subroutine at the current address */
+{
+   oprofile *h_profile = h_processor->profile;
+   unsigned int i_address[STACK_SIZE];
+   int i_count, i_context;
+
+   if (h_profile->depth >= STACK_SIZE) /* The stack is full so the oldest return address is lost */
+   {
+      for (i_count = h_profile->depth, i_context = h_profile->current; i_count > 0; i_count--, i_context = h_profile->context[i_context].parent)
+         i_address[i_count - 1] = h_profile->context[i_context].address;
+      for (i_count = 1, i_context = 0; i_count < h_profile->depth; i_count++) /* Follow the same calls without the oldest one */
+         i_context = i_profile_context(h_profile, i_context, i_address[i_count]);
+      h_profile->current = i_context;
+      h_profile->depth--;
+   }
+   h_profile->current = i_profile_context(h_profile, h_profile->current, h_processor->pc);
+   h_profile->context[h_profile->current].calls++;
+   h_profile->depth++;
+}
+
+void v_profile_return(oprocessor *h_processor) /* Return to the caller */
+{
+   oprofile *h_profile = h_processor->profile;
+   if (h_profile->depth > 0) /* Ignore returns to an unknown caller */
+   {
+      h_profile->current = h_profile->context[h_profile->current].parent;
+      h_profile->depth--;
+   }
+}
+
+typedef struct {
+   unsigned long count;
+   unsigned int first;
+   unsigned int second;
+} oentry;
+
+static int i_compare_count(const void *h_first, const void *h_second) /* Sort by count (highest first) */
+{
+   const oentry *h_left = h_first, *h_right = h_second;
+   if (h_left->count != h_right->count) return (h_left->count < h_right->count) ? 1 : -1;
+   if (h_left->first != h_right->first) return (h_left->first > h_right->first) ? 1 : -1;
+   if (h_left->second != h_right->second) return (h_left->second > h_right->second) ? 1 : -1;
+   return 0;
+}
+
+static int i_compare_edge(const void *h_first, const void *h_second) /* Sort by caller and then subroutine */
+{
+   const oentry *h_left = h_first, *h_right = h_second;
+   if (h_left->first != h_right->first) return (h_left->first > h_right->first) ? 1 : -1;
+   if (h_left->second != h_right->second) return (h_left->second > h_right->second) ? 1 : -1;
+   return 0;
+}
+
+static void v_fprint_location(FILE *h_file, unsigned int i_address) /* Print a ROM address */
+{
+   fprintf(h_file, h_msg_location, (i_address >> 12), (i_address & 0xfff));
+}
+
+static void v_fprint_context(FILE *h_file, oprofile *h_profile, int i_context) /* Print the subroutines that led to a context (outermost first) */
+{
+   if (i_context == 0)
+      fprintf(h_file, "%s", FILENAME); /* Root of every stack */
+   else
+   {
+      v_fprint_context(h_file, h_profile, h_profile->context[i_context].parent);
+      fprintf(h_file, ";");
+      v_fprint_location(h_file, h_profile->context[i_context].address);
+   }
+}
+
+/*
+ * write_profile (processor, pathname)
+ *
+ * Writes a report giving the number of instructions executed at each ROM
+ * address, of each instruction type, and the number of calls between each
+ * subroutine (most frequent first).  The calling contexts are also written
+ * to a separate file (with '.folded' added to the name) in the folded stack
+ * format used by flame graph tools.
+ *
+ */
+
+void v_write_profile(oprocessor *h_processor, char *s_pathname) /* Write the execution profile */
+{
+   oprofile *h_profile = h_processor->profile;
+   oentry *h_entry;
+   FILE *h_file;
+   char *s_folded;
+   unsigned long l_total = 0;
+   int i_count, i_entries, i_type, i_op;
+
+   if (h_profile == NULL) return;
+   if ((h_entry = malloc(sizeof(*h_entry) * (ROM_SIZE > h_profile->contexts ? ROM_SIZE : h_profile->contexts))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   if ((h_file = fopen(s_pathname, "w")) == NULL)
+      v_warning(h_err_creating_file, s_pathname);
+   else
+   {
+      for (i_count = 0; i_count < ROM_SIZE; i_count++)
+         l_total += h_profile->address[i_count];
+      fprintf(h_file, "%s\n\nInstructions  %lu\n", FILENAME, l_total);
+
+      fprintf(h_file, "\n%-7s%-6s%-12s%6s\n", "Addr", "Op", "Count", "%"); /* Instructions executed at each address */
+      for (i_count = i_entries = 0; i_count < ROM_SIZE; i_count++)
+      {
+         if (h_profile->address[i_count] == 0) continue;
+         h_entry[i_entries].count = h_profile->address[i_count];
+         h_entry[i_entries].first = i_count;
+         h_entry[i_entries++].second = 0;
+      }
+      qsort(h_entry, i_entries, sizeof(*h_entry), i_compare_count);
+      for (i_count = 0; i_count < i_entries; i_count++)
+      {
+         fprintf(h_file, h_msg_opcode, (h_entry[i_count].first >> 12), (h_entry[i_count].first & 0xfff), h_processor->rom[h_entry[i_count].first]);
+         fprintf(h_file, "%-11lu %6.2f\n", h_entry[i_count].count, 100.0 * h_entry[i_count].count / l_total);
+      }
+
+      fprintf(h_file, "\n%-6s%-4s%-12s%6s\n", "Type", "Op", "Count", "%"); /* Instructions executed of each type */
+      for (i_type = i_entries = 0; i_type < 4; i_type++)
+         for (i_op = 0; i_op < 32; i_op++)
+         {
+            if (h_profile->type[i_type][i_op] == 0) continue;
+            h_entry[i_entries].count = h_profile->type[i_type][i_op];
+            h_entry[i_entries].first = i_type;
+            h_entry[i_entries++].second = i_op;
+         }
+      qsort(h_entry, i_entries, sizeof(*h_entry), i_compare_count);
+      for (i_count = 0; i_count < i_entries; i_count++)
+         fprintf(h_file, "%-4u  %02o  %-11lu %6.2f\n", h_entry[i_count].first, h_entry[i_count].second, h_entry[i_count].count, 100.0 * h_entry[i_count].count / l_total);
+
+      fprintf(h_file, "\nCaller  Called  Calls\n"); /* Calls from one subroutine to another (in any context) */
+      for (i_count = 1, i_entries = 0; i_count < h_profile->contexts; i_count++)
+      {
+         h_entry[i_entries].count = h_profile->context[i_count].calls;
+         h_entry[i_entries].first = (h_profile->context[i_count].parent == 0) ? ROM_SIZE : h_profile->context[h_profile->context[i_count].parent].address;
+         h_entry[i_entries++].second = h_profile->context[i_count].address;
+      }
+      qsort(h_entry, i_entries, sizeof(*h_entry), i_compare_edge);
+      for (i_count = 1, i_op = 0; i_count < i_entries; i_count++) /* Combine the calls between the same subroutines */
+      {
+         if (i_compare_edge(&h_entry[i_count], &h_entry[i_op]) == 0)
+            h_entry[i_op].count += h_entry[i_count].count;
+         else
+            h_entry[++i_op] = h_entry[i_count];
+      }
+      if (i_entries > 0) i_entries = i_op + 1;
+      qsort(h_entry, i_entries, sizeof(*h_entry), i_compare_count);
+      for (i_count = 0; i_count < i_entries; i_count++)
+      {
+         if (h_entry[i_count].first == ROM_SIZE)
+            fprintf(h_file, "%-6s", "-"); /* Caller unknown */
+         else
+            v_fprint_location(h_file, h_entry[i_count].first);
+         fprintf(h_file, "  ");
+         v_fprint_location(h_file, h_entry[i_count].second);
+         fprintf(h_file, "  %lu\n", h_entry[i_count].count);
+      }
+      if (fclose(h_file) != 0) v_warning(h_err_creating_file, s_pathname);
+   }
+
+   if ((s_folded = malloc(strlen(s_pathname) + 8)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   strcpy(s_folded, s_pathname);
+   strcat(s_folded, ".folded");
+   if ((h_file = fopen(s_folded, "w")) == NULL)
+      v_warning(h_err_creating_file, s_folded);
+   else
+   {
+      for (i_count = 0; i_count < h_profile->contexts; i_count++) /* One line for each context, with the instructions executed in it */
+      {
+         if (h_profile->context[i_count].count == 0) continue;
+         v_fprint_context(h_file, h_profile, i_count);
+         fprintf(h_file, " %lu\n", h_profile->context[i_count].count);
+      }
+      if (fclose(h_file) != 0) v_warning(h_err_creating_file, s_folded);
+   }
+   free(s_folded);
+   free(h_entry);
+}
+
+static int i_history_save(ohistory *h_history) /* Write the history to its file (only using functions that are safe to use in a signal handler) */
+{
+   unsigned long i_count = h_history->count;
+   unsigned int i_records, i_first;
+   int b_error;
+#if defined(SNAPSHOT)
+   int i_file;
+#else
+   FILE *h_file;
+#endif
+
+   i_records = (i_count < HISTORY_SIZE) ? i_count : HISTORY_SIZE;
+   i_first = (i_count < HISTORY_SIZE) ? 0 : (i_count & (HISTORY_SIZE - 1)); /* Oldest record */
+   h_history->header.records = i_records;
+#if defined(SNAPSHOT)
+   if ((i_file = open(h_history->pathname, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0) return False;
+   b_error = (write(i_file, &h_history->header, sizeof(h_history->header)) != sizeof(h_history->header));
+   b_error |= (write(i_file, &h_history->record[i_first], sizeof(orecord) * (i_records - i_first)) != sizeof(orecord) * (i_records - i_first));
+   if (i_first > 0) b_error |= (write(i_file, &h_history->record[0], sizeof(orecord) * i_first) != sizeof(orecord) * i_first);
+   b_error |= (close(i_file) != 0);
+#else
+   if ((h_file = fopen(h_history->pathname, "wb")) == NULL) return False;
+   b_error = (fwrite(&h_history->header, sizeof(h_history->header), 1, h_file) != 1);
+   b_error |= (fwrite(&h_history->record[i_first], sizeof(orecord), i_records - i_first, h_file) != i_records - i_first);
+   if (i_first > 0) b_error |= (fwrite(&h_history->record[0], sizeof(orecord), i_first, h_file) != i_first);
+   b_error |= (fclose(h_file) != 0);
+#endif
+   return (!b_error);
+}
+
+#if defined(SNAPSHOT)
+static void v_history_signal(int i_signal) /* Write the history when a signal is received */
+{
+   if ((h_fatal_processor != NULL) && (h_fatal_processor->history != NULL)) i_history_save(h_fatal_processor->history);
+   if (i_signal != SIGUSR1) raise(i_signal); /* The default action has already been restored */
+}
+#endif
+
+void v_history_start(oprocessor *h_processor, char *s_pathname) /* Start recording every instruction executed */
+{
+   ohistory *h_history = h_processor->history;
+
+   if (h_history == NULL)
+   {
+      if ((h_history = malloc(sizeof(*h_history))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+      memset(&h_history->header, 0, sizeof(h_history->header));
+      memcpy(h_history->header.magic, HISTORY_MAGIC, sizeof(h_history->header.magic));
+      h_history->header.version = HISTORY_VERSION;
+      strncpy(h_history->header.model, FILENAME, sizeof(h_history->header.model) - 1);
+      h_history->header.size = sizeof(orecord);
+      h_history->count = 0;
+      h_history->pathname = FILENAME ".trc"; /* Default to the current directory */
+      h_processor->history = h_history;
+   }
+   if (s_pathname != NULL) h_history->pathname = s_pathname;
+   memcpy(h_history->shadow, h_processor->store, sizeof(h_history->shadow)); /* Only record changes from now on */
+   h_processor->record = True;
+}
+
+/*
+ * history_catch (processor)
+ *
+ * Writes the history of this processor when the program gets SIGUSR1  or
+ * is about to end unexpectedly.  There is only one set of signal handlers
+ * for the whole program so this is only used for the processor driven by
+ * the front end, the history of any other processor (such as a job in  a
+ * headless batch) is never written by a signal.
+ *
+ */
+
+void v_history_catch(oprocessor *h_processor) /* Write the history of this processor on a signal */
+{
+#if defined(SNAPSHOT)
+   static const int i_fatal[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+   struct sigaction o_action;
+   int i_count;
+#endif
+
+   h_fatal_processor = h_processor;
+#if defined(SNAPSHOT)
+   memset(&o_action, 0, sizeof(o_action));
+   sigemptyset(&o_action.sa_mask);
+   o_action.sa_handler = v_history_signal;
+   o_action.sa_flags = SA_RESTART;
+   sigaction(SIGUSR1, &o_action, NULL); /* Write the history on demand */
+   o_action.sa_flags = SA_RESETHAND; /* Then do whatever would have happened anyway */
+   for (i_count = 0; i_count < sizeof(i_fatal) / sizeof(*i_fatal); i_count++)
+      sigaction(i_fatal[i_count], &o_action, NULL);
+#endif
+}
+
+void v_history_write(oprocessor *h_processor) /* Write the history to a file */
+{
+   if (h_processor->history == NULL) return;
+   fprintf(stderr, h_msg_saving, h_processor->history->pathname);
+   if (!i_history_save(h_processor->history)) v_warning(h_err_creating_file, h_processor->history->pathname);
+}
+
+void v_history_fatal(void) /* Write the history before exiting after an error */
+{
+   if ((h_fatal_processor != NULL) && (h_fatal_processor->history != NULL)) i_history_save(h_fatal_processor->history);
+}
+
+/*
+ * history_decode (processor, pathname)
+ *
+ * Prints  the instructions in a history file using the same text as  the
+ * trace,  followed by the values saved in the history.  Each  instruction
+ * is decoded from the op-code that was recorded, only the word after it is
+ * taken from the processor's ROM.
+ *
+ */
+
+void v_history_decode(oprocessor *h_processor, char *s_pathname) /* Print the instructions in a history file */
+{
+   ohistory o_history;
+   orecord o_record;
+   oregister o_register;
+   FILE *h_file;
+   unsigned int i_count;
+
+   if ((h_file = fopen(s_pathname, "rb")) == NULL) v_error(errno, h_err_opening_file, s_pathname);
+   if ((fread(&o_history.header, sizeof(o_history.header), 1, h_file) != 1) ||
+      memcmp(o_history.header.magic, HISTORY_MAGIC, sizeof(o_history.header.magic)) ||
+      (o_history.header.version != HISTORY_VERSION) || (o_history.header.size != sizeof(orecord)) ||
+      strncmp(o_history.header.model, FILENAME, sizeof(o_history.header.model)))
+      v_error(EINVAL, h_err_history, s_pathname); /* Not a history file, or from a different model */
+   for (i_count = 0; (i_count < o_history.header.records) && (fread(&o_record, sizeof(o_record), 1, h_file) == 1); i_count++)
+   {
+      if (o_record.pc >= ROM_SIZE) v_error(EINVAL, h_err_history, s_pathname);
+      v_fprint_instruction(stdout, o_record.pc, o_record.opcode, h_processor->rom[i_next_address(o_record.pc)]);
+      fprintf(stdout, "\t\tp = %-2d  c = %d", o_record.p, (o_record.flags & HISTORY_CARRY) != 0);
+      if (o_record.flags & HISTORY_CHANGED)
+      {
+         o_register.id = (o_record.reg < REGISTERS) ? (o_record.reg + 1) * -1 : o_record.reg - REGISTERS;
+         o_register.value = o_record.value;
+         v_fprint_register(stdout, &o_register);
+         if (o_record.flags & HISTORY_MORE) fprintf(stdout, " ...");
+      }
+      fprintf(stdout, "\n");
+   }
+   fclose(h_file);
+}
+
+static void v_processor_record(oprocessor *h_processor, const int b_trace) /* Execute a single instruction and add it to the history */
+{
+   static const int i_changes[4] = {REGISTERS, 0, 3, 0}; /* Arithmetic instructions only use A, B and C, and branches don't change any registers */
+   ohistory *h_history = h_processor->history;
+   orecord *h_record = &h_history->record[h_history->count & (HISTORY_SIZE - 1)];
+   oregister *h_register = NULL;
+   unsigned long i_writes = h_processor->writes;
+   int i_count, i_registers;
+
+   h_record->pc = h_processor->pc;
+   h_record->opcode = h_processor->rom[h_processor->pc];
+   i_registers = i_changes[h_processor->decoded[h_processor->pc].type];
+   if (b_trace)
+      v_processor_trace(h_processor);
+   else
+      v_processor_tick(h_processor);
+   h_record->p = h_processor->p;
+   h_record->flags = h_processor->flags[CARRY] ? HISTORY_CARRY : 0;
+   if ((h_processor->writes != i_writes) && (h_processor->addr < MEMORY_SIZE)) /* Memory register written */
+   {
+      h_register = h_processor->mem[h_processor->addr];
+      h_record->reg = REGISTERS + h_processor->addr;
+   }
+   if ((i_registers > 0) && memcmp(h_history->shadow, h_processor->store, sizeof(*h_processor->store) * i_registers)) /* Check the registers all at once */
+   for (i_count = 0; i_count < i_registers; i_count++) /* Find the working registers that changed */
+   {
+      if (h_history->shadow[i_count].value == h_processor->store[i_count].value) continue;
+      h_history->shadow[i_count] = h_processor->store[i_count];
+      if (h_register != NULL)
+         h_record->flags |= HISTORY_MORE;
+      else
+      {
+         h_register = h_processor->reg[i_count];
+         h_record->reg = i_count;
+      }
+   }
+   if (h_register != NULL)
+   {
+      h_record->value = h_register->value & PACKED_REGISTER;
+      h_record->flags |= HISTORY_CHANGED;
+   }
+   h_history->count++;
+}
+
+static void v_processor_monitor(oprocessor *h_processor, const int b_trace) /* Execute a single instruction and add it to the profile and/or history */
+{
+   oprofile *h_profile = h_processor->profile;
+   odecoded *h_decoded;
+   if (h_profile != NULL)
+   {
+      h_decoded = &h_processor->decoded[h_processor->pc];
+      h_profile->address[h_processor->pc]++;
+      h_profile->type[h_decoded->type][h_decoded->op & 0x1f]++;
+      h_profile->context[h_profile->current].count++;
+   }
+   if (h_processor->record)
+      v_processor_record(h_processor, b_trace);
+   else if (b_trace)
+      v_processor_trace(h_processor);
+   else
+      v_processor_tick(h_processor);
+}
+
+void v_processor_step(oprocessor *h_processor) /* Execute a single instruction and trace it, keeping the profile and/or history */
+{
+   if (h_processor->record || (h_processor->profile != NULL))
+      v_processor_monitor(h_processor, True);
+   else
+      v_processor_trace(h_processor);
+}
+
+int i_processor_run(oprocessor *h_processor, int i_budget) /* Execute instructions until the budget is used up or something needs attention */
+{
+   unsigned int i_address;
+   unsigned char c_display;
+   while (i_budget-- > 0)
+   {
+      if (i_processor_break(h_processor)) /* Stop before executing the instruction */
+         return STOP_BREAKPOINT;
+      if (!h_processor->enabled || h_processor->sleep)
+         return STOP_SLEEP;
+      c_display = h_processor->flags[DISPLAY_ENABLE];
+      i_address = h_processor->pc;
+      h_processor->keyscan = h_processor->keytest = False;
+      if (h_processor->record || (h_processor->profile != NULL))
+         v_processor_monitor(h_processor, False);
+      else
+         v_processor_tick(h_processor);
+      if (h_processor->flags[DISPLAY_ENABLE] != c_display)
+         return STOP_DISPLAY;
+      if (h_processor->keyscan)
+         return STOP_KEYBOARD;
+      if (h_processor->keytest && i_processor_idle(h_processor, i_address))
+         return STOP_IDLE;
+   }
+   return STOP_BUDGET;
+}
+
+int i_key_seen(oprocessor *h_processor, int i_stop) /* Check if the ROM has noticed the last key change from the reason it stopped */
+{
+   if ((i_stop == STOP_KEYBOARD) && h_processor->keypressed)
+      return (True); /* The ROM has read the key that is down */
+   return (i_stop == STOP_IDLE); /* The ROM is waiting for the next key so has seen the last one released */
 }
@@ -56,6 +56,46 @@
  *                     print - MT
  * 06 Jun 23         - Removed unused references to HP91c and HP97 - MT
  * 21 Oct 23         - Defined MANUAL, NORMAL, and TRACE print modes - MT
+ * 18 Oct 26         - Added a table of predecoded instructions - MT
+ *                   - Registers and memory are stored in a single  block
+ *                     inside  the  processor  structure, the  register and
+ *                     memory pointers just point into this block - MT
+ *                   - Added separate functions to execute an instruction
+ *                     with and without tracing - MT
+ *                   - Added  a function to execute a number of  instruc-
+ *                     tions at a time along with the properties needed to
+ *                     work out when to stop - MT
+ *                   - Replaced the single breakpoint and trap properties
+ *                     with bitmaps - MT
+ *                   - Added the properties needed to detect when the ROM
+ *                     is just waiting for a key to be pressed - MT
+ *                   - Added processor_free() - MT
+ *                   - Defined the layout of a binary snapshot - MT
+ *                   - Added a pointer to memory mapped from a file - MT
+ *                   - Defined the layout of a binary ROM image - MT
+ *                   - Defined the layout of the memory mapped file,  and
+ *                     snapshots  no  longer contain memory when it is kept
+ *                     in this file - MT
+ *                   - ROM images hold a checksum of the ROM file instead of
+ *                     its modification time and the complete ROM so they
+ *                     can be used directly by the processor - MT
+ *                   - The ROM is constant, and a writable copy is  only
+ *                     made if the ROM is loaded from a file - MT
+ *                   - Added an optional execution profile - MT
+ *                   - Added a history of the last instructions executed,
+ *                     kept as binary records in a ring buffer - MT
+ *                   - The nibbles in each register are packed into a  64
+ *                     bit value, so use NIBBLE() to read a nibble - MT
+ *                   - Added write_state() prototype - MT
+ *                   - Moved the number of ticks to hold down each key here
+ *                     so both front ends can use them - MT
+ *                   - SNAPSHOT is defined here so the front end can  save
+ *                     a snapshot taken by another thread - MT
+ *                   - Added the handler and operand to each decoded  in-
+ *                     struction - MT
+ *                   - Added fprint_instruction() prototype - MT
+ *                   - Added processor_step() and history_catch()  proto-
+ *                     types - MT
  *
  */
 
@@ -67,6 +107,7 @@
 #define EXP_SIZE        3              /* Two digit exponent plus a sign digit */
 #define STATUS_BITS     16
 #define FLAGS           9
+#define TRAPS           1024           /* One for every possible opcode */
 
 #if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
 #define STACK_SIZE      4
@@ -114,15 +155,151 @@
 #define BUFSIZE         20             /* Output buffer size */
 #endif
 
+#define STOP_BUDGET     0              /* Executed all the instructions */
+#define STOP_SLEEP      1              /* Processor is asleep or disabled */
+#define STOP_DISPLAY    2              /* Display enabled or disabled */
+#define STOP_KEYBOARD   3              /* Keyboard read */
+#define STOP_BREAKPOINT 4              /* Reached a breakpoint or trap */
+#define STOP_IDLE       5              /* Waiting for a key to be pressed */
+
+#define HOLD            32             /* Minimum number of ticks between key presses and releases once the ROM has seen the last one */
+#define HOLD_LIMIT      1000           /* Number of ticks after which a key changes even if the ROM hasn't seen the last one */
+
+#if defined(__GNUC__) && (defined(unix) || defined(__unix__) || defined(__APPLE__))
+#define CACHE_LINE      64
+#define CACHE_ALIGNED   __attribute__ ((aligned (CACHE_LINE)))
+#else
+#define CACHE_ALIGNED
+#endif
+
+#define NIBBLE(h_register, i_nibble) ((int) (((h_register)->value >> (4 * (i_nibble))) & 0x0f)) /* Get a nibble from a register */
+
 typedef struct {
    int id;
-   unsigned char nibble[REG_SIZE];
+   unsigned long long value;           /* Nibbles (four bits each with nibble zero in the lowest bits) */
 } oregister;
 
+typedef struct {                       /* Everything that affects what the next instruction does */
+   unsigned long long value[REGISTERS];
+   unsigned char flags[FLAGS];
+   unsigned char status[STATUS_BITS];
+   unsigned int stack[STACK_SIZE];
+   unsigned long writes;
+   unsigned int opcode, pc, sp, addr, base, code;
+   unsigned char f, p, keypressed, mode, timer, sleep, enabled;
+#if defined(HP67)
+   unsigned char crc[STATES];
+#endif
+#if defined(HP10)
+   unsigned char print;
+   unsigned int position;
+   unsigned char buffer[BUFSIZE];
+#endif
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   unsigned char kyf, g[2], q, ptr;
+#else
+   unsigned int rom_number;
+#endif
+} ostate;
+
+typedef struct {
+   unsigned char type;                 /* Instruction type */
+   unsigned char op;                   /* Operation (or branch condition) */
+   unsigned char handler;              /* What executes the instruction */
+   unsigned char arg;                  /* Operand (status bit, pointer value, register, etc) */
+   unsigned char field;                /* Field select */
+   signed char first;                  /* First nibble in field (negative if determined by a pointer) */
+   signed char last;                   /* Last nibble in field */
+   unsigned int address;               /* Branch target address */
+} odecoded;
+
+#define HISTORY_MAGIC   "X11T"
+#define HISTORY_VERSION 1
+#define HISTORY_SIZE    16384          /* Instructions kept in the history (must be a power of two) */
+
+#define HISTORY_CARRY   1              /* Carry set by the instruction */
+#define HISTORY_CHANGED 2              /* Instruction changed a register */
+#define HISTORY_MORE    4              /* Instruction changed more than one register */
+
+typedef struct {                       /* Instruction executed (16 bytes) */
+   unsigned short pc;                  /* Address */
+   unsigned short opcode;              /* Instruction */
+   unsigned char p;                    /* P register after the instruction */
+   unsigned char flags;                /* Carry and changed registers */
+   unsigned short reg;                 /* First register changed (memory registers follow the working registers) */
+   unsigned long long value;           /* New contents of the register */
+} orecord;
+
+typedef struct {                       /* Recent instructions */
+   struct {
+      char magic[4];                   /* Always HISTORY_MAGIC */
+      unsigned int version;            /* Format version */
+      char model[16];                  /* Model (file name) */
+      unsigned int records;            /* Number of records that follow (oldest first) */
+      unsigned int size;               /* Size of each record */
+   } header;
+   orecord record[HISTORY_SIZE];       /* Ring buffer */
+   unsigned long count;                /* Instructions recorded */
+   oregister shadow[REGISTERS];        /* Working registers after the last instruction */
+   char *pathname;                     /* File the history is written to */
+} ohistory;
+
+typedef struct {                       /* Calling context (a node in the call tree) */
+   unsigned int address;               /* Address of the subroutine */
+   int parent;                         /* Calling context of the caller */
+   int child;                          /* First subroutine called from here */
+   int sibling;                        /* Next subroutine called by the same caller */
+   unsigned long calls;                /* Number of calls */
+   unsigned long count;                /* Instructions executed in this context */
+} ocontext;
+
+typedef struct {                       /* Execution profile */
+   unsigned long address[ROM_SIZE];   /* Instructions executed at each address */
+   unsigned long type[4][32];          /* Instructions executed of each type and operation */
+   ocontext *context;                  /* Call tree */
+   int contexts;                       /* Number of calling contexts used */
+   int size;                           /* Number of calling contexts allocated */
+   int current;                        /* Current calling context */
+   int depth;                          /* Return addresses on the stack */
+} oprofile;
+
+#define ROM_IMAGE_MAGIC  "X11R"
+#define ROM_IMAGE_VERSION 2
+
+typedef struct {                       /* Binary copy of a ROM file */
+   struct {
+      char magic[4];                   /* Always ROM_IMAGE_MAGIC */
+      unsigned int version;            /* Format version */
+      char model[16];                  /* Model (file name) */
+      long long size;                  /* Size of the ROM file */
+      unsigned int source;             /* Checksum of the ROM file */
+      unsigned int base;               /* Checksum of the ROM it was loaded over */
+      unsigned int checksum;           /* Checksum of the ROM contents */
+   } header;
+   unsigned short word[ROM_SIZE];      /* ROM contents after loading the ROM file */
+} oromimage;
+
+#define MEMORY_FILE_MAGIC  "X11M"
+#define MEMORY_FILE_VERSION 1
+
+typedef struct {                       /* Memory kept in a memory mapped file */
+   struct {
+      char magic[4];                   /* Always MEMORY_FILE_MAGIC */
+      unsigned int version;            /* Format version */
+      char model[16];                  /* Model (file name) */
+   } header;
+   oregister memory[MEMORY_SIZE];      /* Memory */
+} omemoryfile;
+
 typedef struct {
+   oregister store[REGISTERS + MEMORY_SIZE] CACHE_ALIGNED; /* Registers followed by memory */
    oregister *reg[REGISTERS];          /* Registers */
    oregister *mem[MEMORY_SIZE];        /* Memory registers */
-   int *rom;
+   omemoryfile *mapped;                /* Memory mapped from a file (if any) */
+   const unsigned short *rom;          /* ROM */
+   unsigned short *overlay;            /* Writable copy of the ROM (if loaded from a file) */
+   oromimage *image;                   /* Binary ROM image mapped from a file (if any) */
+   odecoded *decoded;                  /* Predecoded instructions */
    int first;
    int last;
    unsigned int stack[STACK_SIZE];     /* Call stack */
@@ -137,13 +314,25 @@ typedef struct {
    unsigned int addr;                  /* Address register */
    unsigned int base;                  /* Current arithmetic base */
    unsigned int code;                  /* Key code */
+   unsigned long ticks;                /* Instructions executed */
+   unsigned char breakpoints[(ROM_SIZE + 7) >> 3]; /* Breakpoint for each address */
+   unsigned char traps[TRAPS >> 3];    /* Trap for each opcode */
+   oprofile *profile;                  /* Execution profile (if enabled) */
+   ohistory *history;                  /* Recent instructions (if enabled) */
+   FILE *output;                       /* Trace output */
+   unsigned long writes;               /* Memory writes */
+   unsigned int idle;                  /* Address of last keyboard test */
+   ostate state;                       /* State at last keyboard test */
    unsigned char f;                    /* F register */
    unsigned char p;                    /* P register */
    unsigned char keypressed;           /* Key pressed */
+   unsigned char keyscan;              /* Keyboard read by last instruction */
+   unsigned char keytest;              /* Keyboard status tested by last instruction */
    unsigned char mode;                 /* Save run/prgm switch state */
    unsigned char timer;                /* Save timer switch state */
    unsigned char trace;                /* Trace flag */
    unsigned char step;                 /* Step flag */
+   unsigned char record;               /* Record each instruction in the history */
    unsigned char sleep;                /* Sleep */
    unsigned char enabled;              /* Enabled */
 #if defined(HP10)
@@ -161,21 +350,99 @@ typedef struct {
 #endif
 } oprocessor;
 
-oprocessor *h_processor_create(int *h_rom);
+#if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#define SNAPSHOT                       /* Save the state as a binary snapshot */
+#endif
+
+#define SNAPSHOT_MAGIC  "X11C"
+#define SNAPSHOT_VERSION 3
+
+#define SNAPSHOT_MAPPED 1              /* Memory is in the memory mapped file and not in the snapshot */
+
+typedef struct {                       /* Saved processor state */
+   struct {
+      char magic[4];                   /* Always SNAPSHOT_MAGIC */
+      unsigned int version;            /* Format version */
+      char model[16];                  /* Model (file name) */
+      unsigned int flags;              /* SNAPSHOT_MAPPED if memory isn't included */
+      unsigned int length;             /* Length of the state and memory */
+      unsigned int checksum;           /* Checksum of the state and memory */
+   } header;
+   ostate state;                       /* Processor */
+   unsigned long long memory[MEMORY_SIZE]; /* Memory */
+} osnapshot;
+
+oprocessor *h_processor_create(const unsigned short *h_rom);
+
+void v_processor_free(oprocessor *h_processor);
 
 void v_processor_reset(oprocessor *h_processor);
 
+void v_processor_decode(oprocessor *h_processor);
+
+void v_fprint_instruction(FILE *h_file, unsigned int i_address, unsigned int i_opcode, unsigned int i_next);
+
 void v_read_rom(oprocessor *h_processor, char *s_pathname);
 
 void v_read_state(oprocessor *h_processor, char *s_pathname);
 
+void v_write_state(oprocessor *h_processor, char *s_pathname);
+
+void v_take_snapshot(oprocessor *h_processor, osnapshot *h_snapshot);
+
+void v_save_snapshot(oprocessor *h_processor, osnapshot *h_snapshot);
+
+void v_restore_snapshot(oprocessor *h_processor, osnapshot *h_snapshot);
+
 void v_restore_state(oprocessor *h_processor);
 
 void v_save_state(oprocessor *h_processor);
 
+int i_write_snapshot(osnapshot *h_snapshot, char *s_pathname);
+
+int i_read_snapshot(oprocessor *h_processor, char *s_pathname, int b_memory);
+
+int i_read_memory(oprocessor *h_processor, char *s_pathname);
+
+void v_map_memory(oprocessor *h_processor, int b_import);
+
 void v_fprint_registers(FILE *h_file, oprocessor *h_procesor);
 
 void v_fprint_memory(FILE *h_file, oprocessor *h_procesor);
 
 void v_processor_tick(oprocessor *h_procesor);
+
+void v_processor_trace(oprocessor *h_procesor);
+
+void v_processor_step(oprocessor *h_processor);
+
+int i_processor_run(oprocessor *h_processor, int i_budget);
+
+int i_key_seen(oprocessor *h_processor, int i_stop);
+
+void v_breakpoint(oprocessor *h_processor, unsigned int i_address, int b_set);
+
+int i_breakpoint(oprocessor *h_processor, unsigned int i_address);
+
+void v_trap(oprocessor *h_processor, unsigned int i_opcode, int b_set);
+
+int i_processor_break(oprocessor *h_processor);
+
+void v_profile_start(oprocessor *h_processor);
+
+void v_profile_call(oprocessor *h_processor);
+
+void v_profile_return(oprocessor *h_processor);
+
+void v_write_profile(oprocessor *h_processor, char *s_pathname);
+
+void v_history_start(oprocessor *h_processor, char *s_pathname);
+
+void v_history_catch(oprocessor *h_processor);
+
+void v_history_write(oprocessor *h_processor);
+
+void v_history_fatal(void);
+
+void v_history_decode(oprocessor *h_processor, char *s_pathname);
 #endif
@@ -62,14 +62,21 @@
  * 09 Apr 24         - Finally renamed x11-calc-segment to the more correct
  *                     x11-calc-digit - MT
  * 23 Apr 24         - Separated out prototypes for error handlers - MT
+ * 18 Oct 26         - Drawing functions are not needed in a headless build
+ *                     so don't include the X11 headers - MT
+ *                   - Keeps the mask that was last drawn - MT
+ *                   - Draws digits by copying a cached pixmap for each
+ *                     combination  of segments, which is created the first
+ *                     time it is used and recreated if the size of digits
+ *                     changes - MT
  *
- * TO DO :           - Optimize drawing of display digits.
+ * TO DO :           -
  ^
  */
 
 #define NAME           "x11-calc-digit"
-#define BUILD          "0013"
-#define DATE           "09 Apr 24"
+#define BUILD          "0014"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <errno.h>     /* errno */
@@ -77,8 +84,12 @@
 #include <stdio.h>     /* fprintf(), etc */
 #include <stdlib.h>    /* malloc(), etc */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc */
 #include <X11/Xutil.h> /* XSizeHints etc */
+#endif
 
 #include "x11-calc-messages.h"
 #include "x11-calc-errors.h"
@@ -94,6 +105,16 @@
 
 #include "gcc-debug.h"
 
+#if !defined(HEADLESS)
+static struct { /* Pixmap of each combination of segments at the current size */
+   Display *display;
+   GC gc;
+   int width, height;
+   unsigned int foreground, background;
+   Pixmap pixmap[SEG_MASKS];
+} o_glyphs;
+#endif
+
 /*
  * digit_create (index, text, left, top, width, height, state,
  *                colour)
@@ -113,6 +134,7 @@ odigit *h_digit_create(int i_index, int i_mask, int i_left, int i_top,
 
    h_digit->index = i_index;
    h_digit->mask = i_mask;
+   h_digit->drawn = -1; /* Not drawn yet */
 
    h_digit->digit_position.x = i_left;
    h_digit->digit_position.y = i_top;
@@ -144,23 +166,24 @@ int i_digit_resize(odigit *h_digit, float f_scale) /* Resize digit based on orig
    return 0;
 }
 
-int i_digit_draw(Display *h_display, int x_application_window, int i_screen, odigit *h_digit){ /* Draws all the digits */
-
+#if !defined(HEADLESS)
+static void v_digit_render(Display *h_display, Drawable x_drawable, int i_screen, odigit *h_digit, int i_x, int i_y) /* Draw a digit at the given position */
+{
    int i_left, i_right, i_upper, i_lower;
    int i_offset;
 #if defined(HP10) || defined(HP67) || defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
    int i_middle;
 #endif
    i_upper = h_digit->digit_position.height / 4;
-   i_lower = h_digit->digit_position.y +  h_digit->digit_position.height - i_upper;
-   i_upper = h_digit->digit_position.y + i_upper;
+   i_lower = i_y +  h_digit->digit_position.height - i_upper;
+   i_upper = i_y + i_upper;
    i_offset = i_upper + (i_lower - i_upper) / 2;
-   i_left = h_digit->digit_position.x + 2;
+   i_left = i_x + 2;
 #if defined(HP10) || defined(HP67) || defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
-   i_right = h_digit->digit_position.x + h_digit->digit_position.width - 2;
+   i_right = i_x + h_digit->digit_position.width - 2;
    i_middle = i_left + ((i_right - i_left) / 2);
 #else
-   i_right = h_digit->digit_position.x + h_digit->digit_position.width - 7;
+   i_right = i_x + h_digit->digit_position.width - 7;
 #endif
 
    debug(fprintf(stderr, "%4d,%d (%dx%d) %.1X%.1X%.1X%.1X %.1X%.1X%.1X%.1X.\n", \
@@ -172,65 +195,65 @@ int i_digit_draw(Display *h_display, int x_application_window, int i_screen, odi
 
    /* Draw the display digit background */
    XSetForeground(h_display, DefaultGC(h_display, i_screen), h_digit->background);
-   XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), h_digit->digit_position.x, h_digit->digit_position.y, h_digit->digit_position.width, h_digit->digit_position.height);
-   XDrawRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), h_digit->digit_position.x, h_digit->digit_position.y, h_digit->digit_position.width, h_digit->digit_position.height);
+   XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_x, i_y, h_digit->digit_position.width, h_digit->digit_position.height);
+   XDrawRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_x, i_y, h_digit->digit_position.width, h_digit->digit_position.height);
 
 #if !(defined(__aarch64__) || defined(__aarch__) || defined(__arm__) || defined(__arm64__) || defined(__alpha)) || defined(__APPLE__)
    /* Fill in the background for each active display digit */
    XSetForeground(h_display, DefaultGC(h_display, i_screen), i_shade(h_digit->foreground));
 
    if (h_digit->mask & SEG_A) { /* Draw the segment A */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left, i_upper, i_right, i_upper);
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left + 1, i_upper - 1, i_right - i_left - 1, 3);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left, i_upper, i_right, i_upper);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left + 1, i_upper - 1, i_right - i_left - 1, 3);
    }
 
    if (h_digit->mask & SEG_B) { /* Draw the segment B */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left , i_upper, i_left, i_offset);
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left - 1, i_upper + 1, 3, i_offset - i_upper - 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left , i_upper, i_left, i_offset);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left - 1, i_upper + 1, 3, i_offset - i_upper - 1);
    }
 
    if (h_digit->mask & SEG_C) { /* Draw the segment C */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left , i_offset, i_left, i_lower);
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left - 1, i_offset + 1, 3, i_lower - i_offset - 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left , i_offset, i_left, i_lower);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left - 1, i_offset + 1, 3, i_lower - i_offset - 1);
    }
 
    if (h_digit->mask & SEG_D) { /* Draw the segment D */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left, i_lower, i_right, i_lower);
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left + 1, i_lower - 1, i_right - i_left - 1, 3);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left, i_lower, i_right, i_lower);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left + 1, i_lower - 1, i_right - i_left - 1, 3);
    }
 
    if (h_digit->mask & SEG_E) { /* Draw the segment E */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right , i_lower, i_right, i_offset);
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right - 1, i_offset + 1, 3, i_lower - i_offset - 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right , i_lower, i_right, i_offset);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right - 1, i_offset + 1, 3, i_lower - i_offset - 1);
    }
 
    if (h_digit->mask & SEG_F) { /* Draw the segment F */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right , i_offset, i_right, i_upper);
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right - 1, i_upper + 1, 3, i_offset - i_upper - 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right , i_offset, i_right, i_upper);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right - 1, i_upper + 1, 3, i_offset - i_upper - 1);
    }
 
    if (h_digit->mask & SEG_G) { /* Draw the segment G */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left, i_offset, i_right, i_offset);
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left + 1, i_offset - 1, i_right - i_left - 1, 3);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left, i_offset, i_right, i_offset);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left + 1, i_offset - 1, i_right - i_left - 1, 3);
    }
 
 #if defined(HP10) || defined(HP67) || defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
    if (h_digit->mask & SEG_DECIMAL) { /* Draw a decimal point separator */
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_middle - 1 , (i_upper + 3 * (i_lower - i_upper) / 4) - 1, 3, 3);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_middle - 1 , (i_upper + 3 * (i_lower - i_upper) / 4) - 1, 3, 3);
    }
 #else
    if (h_digit->mask & SEG_DECIMAL) { /* Draw a decimal point separator */
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_lower - 1, 3, 3);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_lower - 1, 3, 3);
    }
 
    if (h_digit->mask & SEG_COMMA) { /* Draw a comma separator */
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_lower - 1, 3, 3);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_lower + 2, i_right + 3, i_lower + 2);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_lower - 1, 3, 3);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_lower + 2, i_right + 3, i_lower + 2);
    }
 
    if (h_digit->mask & SEG_COLON) { /* Draw a colon separator */
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_offset - 4, 3, 3);
-      XFillRectangle(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_offset + 2, 3, 3);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_offset - 4, 3, 3);
+      XFillRectangle(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_offset + 2, 3, 3);
    }
 #endif
 
@@ -239,57 +262,106 @@ int i_digit_draw(Display *h_display, int x_application_window, int i_screen, odi
    /* Draw the in the foreground elements */
    XSetForeground(h_display, DefaultGC(h_display, i_screen), h_digit->foreground);
    if (h_digit->mask & SEG_A) { /* Draw the segment A */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left + 1, i_upper, i_right - 1, i_upper);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left + 1, i_upper, i_right - 1, i_upper);
    }
 
    if (h_digit->mask & SEG_B) { /* Draw the segment B */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left , i_upper + 1, i_left, i_offset - 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left , i_upper + 1, i_left, i_offset - 1);
    }
 
    if (h_digit->mask & SEG_C) { /* Draw the segment C */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left , i_offset + 1, i_left, i_lower - 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left , i_offset + 1, i_left, i_lower - 1);
    }
 
    if (h_digit->mask & SEG_D) { /* Draw the segment D */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left + 1, i_lower, i_right - 1, i_lower);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left + 1, i_lower, i_right - 1, i_lower);
    }
 
    if (h_digit->mask & SEG_E) { /* Draw the segment E */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right , i_lower - 1, i_right, i_offset + 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right , i_lower - 1, i_right, i_offset + 1);
    }
 
    if (h_digit->mask & SEG_F) { /* Draw the segment F */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right , i_offset - 1, i_right, i_upper + 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right , i_offset - 1, i_right, i_upper + 1);
    }
 
    if (h_digit->mask & SEG_G) { /* Draw the segment G */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_left + 1, i_offset, i_right - 1, i_offset);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_left + 1, i_offset, i_right - 1, i_offset);
    }
 
 #if defined(HP10) || defined(HP67) || defined(HP35) || defined(HP80) || defined(HP45) || defined(HP70) || defined(HP55)
    if (h_digit->mask & SEG_DECIMAL) { /* Draw a decimal point separator */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_middle, (i_upper + 3 * (i_lower - i_upper) / 4) - 1, i_middle, (i_upper + 3 * (i_lower - i_upper) / 4) + 1);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_middle - 1, (i_upper + 3 * (i_lower - i_upper) / 4), i_middle + 1, (i_upper + 3 * (i_lower - i_upper) / 4));
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_middle, (i_upper + 3 * (i_lower - i_upper) / 4) - 1, i_middle, (i_upper + 3 * (i_lower - i_upper) / 4) + 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_middle - 1, (i_upper + 3 * (i_lower - i_upper) / 4), i_middle + 1, (i_upper + 3 * (i_lower - i_upper) / 4));
    }
 #else
    if (h_digit->mask & SEG_DECIMAL) { /* Draw a decimal point separator */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_lower, i_right + 5, i_lower);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 4, i_lower - 1, i_right + 4, i_lower + 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_lower, i_right + 5, i_lower);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 4, i_lower - 1, i_right + 4, i_lower + 1);
    }
 
    if (h_digit->mask & SEG_COMMA) { /* Draw a comma separator */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_lower, i_right + 5, i_lower);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 4, i_lower - 1, i_right + 4, i_lower + 1);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_lower + 3, i_right + 4, i_lower + 3);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 2, i_lower + 4, i_right + 3, i_lower + 4);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_lower, i_right + 5, i_lower);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 4, i_lower - 1, i_right + 4, i_lower + 1);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_lower + 3, i_right + 4, i_lower + 3);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 2, i_lower + 4, i_right + 3, i_lower + 4);
    }
 
    if (h_digit->mask & SEG_COLON) { /* Draw a decimal point separator */
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_offset - 3, i_right + 5, i_offset - 3);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 4, i_offset - 4, i_right + 4, i_offset - 2);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 3, i_offset + 3, i_right + 5, i_offset + 3);
-      XDrawLine(h_display, x_application_window, DefaultGC(h_display, i_screen), i_right + 4, i_offset + 4, i_right + 4, i_offset + 2);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_offset - 3, i_right + 5, i_offset - 3);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 4, i_offset - 4, i_right + 4, i_offset - 2);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 3, i_offset + 3, i_right + 5, i_offset + 3);
+      XDrawLine(h_display, x_drawable, DefaultGC(h_display, i_screen), i_right + 4, i_offset + 4, i_right + 4, i_offset + 2);
    }
 #endif
+}
+
+/*
+ * digit_draw (display, window, screen, digit)
+ *
+ * Draws a digit by copying a pixmap of the segments from the cache, which
+ * is created the first time the digit is drawn with those segments lit.
+ *
+ */
+
+int i_digit_draw(Display *h_display, int x_application_window, int i_screen, odigit *h_digit) /* Draws a digit */
+{
+   int i_count;
+
+   if ((o_glyphs.display != h_display) || (o_glyphs.width != h_digit->digit_position.width) ||
+      (o_glyphs.height != h_digit->digit_position.height) || (o_glyphs.foreground != h_digit->foreground) ||
+      (o_glyphs.background != h_digit->background)) /* Cached glyphs are the wrong size or colour */
+   {
+      for (i_count = 0; i_count < SEG_MASKS; i_count++)
+         if (o_glyphs.pixmap[i_count] != None)
+         {
+            XFreePixmap(o_glyphs.display, o_glyphs.pixmap[i_count]);
+            o_glyphs.pixmap[i_count] = None;
+         }
+      if (o_glyphs.display != h_display)
+      {
+         XGCValues x_values;
+         if (o_glyphs.display != NULL) XFreeGC(o_glyphs.display, o_glyphs.gc);
+         x_values.graphics_exposures = False; /* Copying from a pixmap never needs an expose event */
+         o_glyphs.gc = XCreateGC(h_display, x_application_window, GCGraphicsExposures, &x_values);
+      }
+      o_glyphs.display = h_display;
+      o_glyphs.width = h_digit->digit_position.width;
+      o_glyphs.height = h_digit->digit_position.height;
+      o_glyphs.foreground = h_digit->foreground;
+      o_glyphs.background = h_digit->background;
+   }
+
+   if (o_glyphs.pixmap[h_digit->mask & (SEG_MASKS - 1)] == None) /* Draw the segments into a new pixmap */
+   {
+      o_glyphs.pixmap[h_digit->mask & (SEG_MASKS - 1)] = XCreatePixmap(h_display, x_application_window,
+         o_glyphs.width + 1, o_glyphs.height + 1, DefaultDepth(h_display, i_screen));
+      v_digit_render(h_display, o_glyphs.pixmap[h_digit->mask & (SEG_MASKS - 1)], i_screen, h_digit, 0, 0);
+   }
+
+   XCopyArea(h_display, o_glyphs.pixmap[h_digit->mask & (SEG_MASKS - 1)], x_application_window, o_glyphs.gc,
+      0, 0, o_glyphs.width + 1, o_glyphs.height + 1, h_digit->digit_position.x, h_digit->digit_position.y);
+   h_digit->drawn = h_digit->mask;
    return(True);
 }
+#endif
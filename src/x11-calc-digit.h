@@ -27,6 +27,8 @@
  * 14 Jul 13         - Initial version - MT
  * 09 Apr 24         - Finally renamed x11-calc-segment to the more correct
  *                     x11-calc-digit - MT
+ * 18 Oct 26         - Added the mask last drawn - MT
+ *                   - Added the number of combinations of segments - MT
  *
  */
 
@@ -40,12 +42,14 @@
 #define SEG_DECIMAL    0x0080
 #define SEG_COMMA      0x0100
 #define SEG_COLON      0x0200
+#define SEG_MASKS      0x0400 /* Number of combinations of segments */
 
 typedef struct { /* Calculator 7 segment display structure. */
    int index;
    XRectangle digit_position;    /* Current digit position */
    XRectangle digit_geometry;    /* Original digit position */
    int mask;
+   int drawn;                    /* Mask when last drawn (or -1) */
    unsigned int foreground;
    unsigned int background;
 } odigit;
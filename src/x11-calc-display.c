@@ -87,12 +87,21 @@
  *                     on the display (fixed segmentation fault) - MT
  * 22 Apr 24         - Shortened long lines - MT
  * 23 Apr 24         - Separated out prototypes for error handlers - MT
+ * 18 Oct 26         - In  a headless build the front end creates its  own
+ *                     display and only needs display_update() so  don't
+ *                     include the X11 headers - MT
+ *                   - Added  display_refresh() which only redraws  the
+ *                     digits that have changed since they were last drawn
+ *                     and doesn't draw anything if nothing has changed - MT
+ *                   - Added display_save() and display_load() to copy the
+ *                     contents of the display to and from a frame - MT
+ *                   - Use NIBBLE() to read the packed registers - MT
  *
  */
 
 #define NAME           "x11-calc-display"
-#define BUILD          "0035"
-#define DATE           "09 Apr 24"
+#define BUILD          "0036"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <errno.h>     /* errno */
@@ -100,8 +109,12 @@
 #include <stdlib.h>    /* malloc(), etc. */
 #include <stdio.h>     /* fprintf(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-messages.h"
 #include "x11-calc-errors.h"
@@ -119,6 +132,7 @@
 
 #include "gcc-debug.h"
 
+#if !defined(HEADLESS)
 /*
  * display_create (index, text, left, top, width, height,
  *                margin, header, footer,
@@ -181,6 +195,11 @@ odisplay *h_display_create(int i_index, int i_left, int i_top, int i_width, int
       h_display->digit[i_count]->mask = DISPLAY_SPACE;
    }
 
+#if defined(INDECATORS)
+   for (i_count = 0; i_count < INDECATORS; i_count++)
+      h_display->drawn[i_count] = -1; /* Not drawn yet */
+#endif
+
 #if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
    i_top += i_display_height - h_small_font->descent;
    i_height = h_small_font->ascent + h_small_font->descent;
@@ -257,13 +276,52 @@ int i_display_draw(Display *x_display, int x_application_window, int i_screen, o
 
 #if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
    for (i_count = 0; i_count < INDECATORS; i_count++)
-      if (!(h_display->label[i_count] == NULL)) i_label_draw(x_display, x_application_window, i_screen, h_display->label[i_count]);
+      if (!(h_display->label[i_count] == NULL))
+      {
+         i_label_draw(x_display, x_application_window, i_screen, h_display->label[i_count]);
+         h_display->drawn[i_count] = h_display->label[i_count]->state;
+      }
 #endif
 
   return (True);
 
 }
 
+/*
+ * display_refresh (display, window, screen, display)
+ *
+ * Only redraws the digits that have changed since they were last drawn, so
+ * nothing is sent to the X server if the display hasn't changed.
+ *
+ */
+
+int i_display_refresh(Display *x_display, int x_application_window, int i_screen, odisplay *h_display)
+{
+   int i_count, b_changed = False;
+
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   for (i_count = 0; i_count < INDECATORS; i_count++) /* Annunciators are only drawn when on so redraw everything */
+      if ((h_display->label[i_count] != NULL) && (h_display->label[i_count]->state != h_display->drawn[i_count]))
+         return (i_display_draw(x_display, x_application_window, i_screen, h_display));
+#endif
+
+   for (i_count = 0; i_count < DIGITS; i_count++) /* Draw each digit that has changed */
+      if ((h_display->digit[i_count] != NULL) && (h_display->digit[i_count]->mask != h_display->digit[i_count]->drawn))
+      {
+         i_digit_draw(x_display, x_application_window, i_screen, h_display->digit[i_count]);
+         b_changed = True;
+      }
+
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   if (b_changed) /* The annunciators overlap the bottom of the digits */
+      for (i_count = 0; i_count < INDECATORS; i_count++)
+         if (h_display->label[i_count] != NULL) i_label_draw(x_display, x_application_window, i_screen, h_display->label[i_count]);
+#endif
+
+   return (b_changed);
+}
+#endif
+
 /*
  * display_resize (display, scale)
  *
@@ -330,22 +388,22 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
             case 0: /* Ignore */
                break;
             case 12: /* Sign */
-               if (h_processor->reg[A_REG]->nibble[REG_SIZE - i_count] == 0x0F)
+               if (NIBBLE(h_processor->reg[A_REG], REG_SIZE - i_count) == 0x0F)
                   h_display->digit[i_count]->mask = DISPLAY_SPACE;
                else
                {
-                  if (h_processor->reg[A_REG]->nibble[REG_SIZE - i_count] & 0x01)
+                  if (NIBBLE(h_processor->reg[A_REG], REG_SIZE - i_count) & 0x01)
                      h_display->digit[0]->mask = DISPLAY_SPACE;
                   else
                      h_display->digit[0]->mask = DISPLAY_MINUS;
-                  if (h_processor->reg[A_REG]->nibble[REG_SIZE - i_count] >> 1)
+                  if (NIBBLE(h_processor->reg[A_REG], REG_SIZE - i_count) >> 1)
                      h_display->digit[i_count]->mask = DISPLAY_MINUS;
                   else
                      h_display->digit[i_count]->mask = DISPLAY_SPACE;
                }
                break;
             default:
-               switch (h_processor->reg[B_REG]->nibble[REG_SIZE - i_count] & 0x0F)
+               switch (NIBBLE(h_processor->reg[B_REG], REG_SIZE - i_count) & 0x0F)
                {
                case 0x03: /* Decimal point */
                   h_display->digit[i_count]->mask = DISPLAY_DECIMAL;
@@ -358,7 +416,7 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
                case 0x09:
                case 0x04:
                case 0x00: /* Number */
-                  h_display->digit[i_count]->mask = c_digits[h_processor->reg[A_REG]->nibble[REG_SIZE - i_count]];
+                  h_display->digit[i_count]->mask = c_digits[NIBBLE(h_processor->reg[A_REG], REG_SIZE - i_count)];
                   break;
                default:
                   debug(v_fprint_registers(stderr, h_processor);
@@ -389,21 +447,21 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
             switch (i_count)
             {
             case 0:
-               if (h_processor->reg[A_REG]->nibble[REG_SIZE - i_count - 1] == 9)
+               if (NIBBLE(h_processor->reg[A_REG], REG_SIZE - i_count - 1) == 9)
                   h_display->digit[i_count]->mask = DISPLAY_MINUS;
                else
                   h_display->digit[i_count]->mask = DISPLAY_SPACE;
             break;
             case 12:
                i_offset = 2;
-               if ((h_processor->reg[A_REG]->nibble[REG_SIZE - i_count] == 9) &&
-                  (h_processor->reg[B_REG]->nibble[REG_SIZE - i_count] == 0))
+               if ((NIBBLE(h_processor->reg[A_REG], REG_SIZE - i_count) == 9) &&
+                  (NIBBLE(h_processor->reg[B_REG], REG_SIZE - i_count) == 0))
                   h_display->digit[i_count]->mask = DISPLAY_MINUS;
                else
                   h_display->digit[i_count]->mask = DISPLAY_SPACE;
             break;
             default:
-               switch (h_processor->reg[B_REG]->nibble[REG_SIZE - i_count] & 0x0F)
+               switch (NIBBLE(h_processor->reg[B_REG], REG_SIZE - i_count) & 0x0F)
                {
                case 2: /* Decimal point */
                   h_display->digit[i_count]->mask = DISPLAY_DECIMAL;
@@ -413,7 +471,7 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
                   h_display->digit[i_count]->mask = DISPLAY_SPACE;
                   break;
                case 0: /* Number */
-                  if (i_offset >= 0) h_display->digit[i_count]->mask = c_digits[h_processor->reg[A_REG]->nibble[i_offset]];
+                  if (i_offset >= 0) h_display->digit[i_count]->mask = c_digits[NIBBLE(h_processor->reg[A_REG], i_offset)];
                   break;
                default:
                   debug(v_fprint_registers(stderr, h_processor);
@@ -443,12 +501,12 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
             if (i_count == 0)
                h_display->digit[i_count]->mask = DISPLAY_SPACE;
             else
-               h_display->digit[i_count]->mask = c_digits[h_processor->reg[A_REG]->nibble[REG_SIZE - 1 - i_count]];
-            if ((h_processor->reg[B_REG]->nibble[REG_SIZE - 1 - i_count] & 0x04) != 0)
+               h_display->digit[i_count]->mask = c_digits[NIBBLE(h_processor->reg[A_REG], REG_SIZE - 1 - i_count)];
+            if ((NIBBLE(h_processor->reg[B_REG], REG_SIZE - 1 - i_count) & 0x04) != 0)
             {
                if (i_count > 1)
                {
-                  if (h_processor->reg[A_REG]->nibble[REG_SIZE - 1 - i_count]== 0x9)
+                  if (NIBBLE(h_processor->reg[A_REG], REG_SIZE - 1 - i_count)== 0x9)
                      h_display->digit[i_count]->mask = DISPLAY_MINUS;
                   else
                      h_display->digit[i_count]->mask = DISPLAY_SPACE;
@@ -456,17 +514,17 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
                else
                   if (i_count == 1) h_display->digit[0]->mask = DISPLAY_MINUS; /* Negative value */
             }
-            if ((h_processor->reg[B_REG]->nibble[REG_SIZE - 1 - i_count] & 0x02) != 0)
+            if ((NIBBLE(h_processor->reg[B_REG], REG_SIZE - 1 - i_count) & 0x02) != 0)
             {
                if ((h_display->digit[i_count]->mask != DISPLAY_COMMA)
                   && (h_display->digit[i_count]->mask != DISPLAY_SPACE)
                   && (h_display->digit[i_count]->mask != DISPLAY_MINUS))
                   h_display->digit[i_count]->mask = h_display->digit[i_count]->mask | DISPLAY_COMMA;
-               if ((i_count == 1) && ((h_processor->reg[B_REG]->nibble[REG_SIZE - 3] & 0x02) != 0))
+               if ((i_count == 1) && ((NIBBLE(h_processor->reg[B_REG], REG_SIZE - 3) & 0x02) != 0))
                   h_display->digit[0]->mask = DISPLAY_MINUS; /* Self test */
 
             }
-            if ((h_processor->reg[B_REG]->nibble[REG_SIZE - 1 - i_count] & 0x01) != 0)
+            if ((NIBBLE(h_processor->reg[B_REG], REG_SIZE - 1 - i_count) & 0x01) != 0)
             {
                if (i_count == 0)
                   h_display->digit[i_count]->mask = DISPLAY_SPACE;
@@ -494,7 +552,7 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
          if (h_processor->flags[DISPLAY_ENABLE] && h_processor->enabled && h_display->enabled) /* Allows print mode to disable display */
          {
             if (h_display->digit[i_count] != NULL)
-               h_display->digit[i_count]->mask = c_digits[h_processor->reg[A_REG]->nibble[REG_SIZE - i_offset - i_count - 1]];
+               h_display->digit[i_count]->mask = c_digits[NIBBLE(h_processor->reg[A_REG], REG_SIZE - i_offset - i_count - 1)];
          }
          else
             h_display->digit[i_count]->mask = DISPLAY_SPACE;
@@ -536,13 +594,13 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
    if (h_processor->flags[DISPLAY_ENABLE] && h_processor->enabled)
    {
       h_display->label[0]->state = False;                                     /* USER - not used */
-      h_display->label[1]->state = (h_processor->mem[10]->nibble[13] & 0x4);  /* f */
+      h_display->label[1]->state = (NIBBLE(h_processor->mem[10], 13) & 0x4);  /* f */
       h_display->label[2]->state = False;                                     /* g - not used */
-      h_display->label[3]->state = (h_processor->mem[9]->nibble[2] & 0x1);    /* RAD */
-      h_display->label[4]->state = (h_processor->mem[9]->nibble[1] & 0x4);    /* GRAD */
+      h_display->label[3]->state = (NIBBLE(h_processor->mem[9], 2) & 0x1);    /* RAD */
+      h_display->label[4]->state = (NIBBLE(h_processor->mem[9], 1) & 0x4);    /* GRAD */
       h_display->label[5]->state = False;                                     /* D.MY - not used */
       h_display->label[6]->state = False;                                     /* C - not used */
-      h_display->label[7]->state = (h_processor->mem[9]->nibble[4] & 0x4);    /* PRGM */
+      h_display->label[7]->state = (NIBBLE(h_processor->mem[9], 4) & 0x4);    /* PRGM */
    }
 #else
    static int i_map [DIGITS][9][3] =
@@ -567,18 +625,18 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
 
    if (h_processor->flags[DISPLAY_ENABLE] && h_processor->enabled)
    {
-      h_display->label[0]->state = (h_processor->mem[9]->nibble[4] & 0x1);    /* USER */
-      h_display->label[1]->state = (h_processor->mem[9]->nibble[3] & 0x1);    /* f */
-      h_display->label[2]->state = (h_processor->mem[9]->nibble[2] & 0x1);    /* g */
+      h_display->label[0]->state = (NIBBLE(h_processor->mem[9], 4) & 0x1);    /* USER */
+      h_display->label[1]->state = (NIBBLE(h_processor->mem[9], 3) & 0x1);    /* f */
+      h_display->label[2]->state = (NIBBLE(h_processor->mem[9], 2) & 0x1);    /* g */
 #if defined(HP12c)
-      h_display->label[3]->state = (h_processor->mem[9]->nibble[1] & 0x4);    /* BEGIN */
+      h_display->label[3]->state = (NIBBLE(h_processor->mem[9], 1) & 0x4);    /* BEGIN */
 #else
-      h_display->label[3]->state = (h_processor->mem[10]->nibble[1] & 0x4);   /* RAD */
-      h_display->label[4]->state = (h_processor->mem[10]->nibble[3] & 0x4);   /* GRAD */
+      h_display->label[3]->state = (NIBBLE(h_processor->mem[10], 1) & 0x4);   /* RAD */
+      h_display->label[4]->state = (NIBBLE(h_processor->mem[10], 3) & 0x4);   /* GRAD */
 #endif
-      h_display->label[5]->state = (h_processor->mem[10]->nibble[9] & 0x4);   /* D.MY */
-      h_display->label[6]->state = (h_processor->mem[10]->nibble[8] & 0x1);   /* C */
-      h_display->label[7]->state = (h_processor->mem[10]->nibble[10] & 0x1);  /* PRGM */
+      h_display->label[5]->state = (NIBBLE(h_processor->mem[10], 9) & 0x4);   /* D.MY */
+      h_display->label[6]->state = (NIBBLE(h_processor->mem[10], 8) & 0x1);   /* C */
+      h_display->label[7]->state = (NIBBLE(h_processor->mem[10], 10) & 0x1);  /* PRGM */
    }
 #endif
    for (i_count = 0; i_count < DIGITS; i_count++)
@@ -591,7 +649,7 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
             for (i_counter = 0; i_counter < 9; i_counter++)
             {
                if (i_map[i_count][i_counter][0] > 0)
-                  if ((h_processor->mem[i_map[i_count][i_counter][0]]->nibble[i_map[i_count][i_counter][1]] & i_map[i_count][i_counter][2]))
+                  if ((NIBBLE(h_processor->mem[i_map[i_count][i_counter][0]], i_map[i_count][i_counter][1]) & i_map[i_count][i_counter][2]))
                      h_display->digit[i_count]->mask |= (1 << i_counter); /* Mask determines which segments are on */
             }
          }
@@ -611,11 +669,11 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
       {
          if (h_processor->flags[DISPLAY_ENABLE] && h_processor->enabled)
          {
-            h_display->digit[i_count]->mask = c_digits[h_processor->reg[A_REG]->nibble[REG_SIZE - 1 - i_count]];
-            switch (h_processor->reg[B_REG]->nibble[REG_SIZE - 1 - i_count] & 0x07)
+            h_display->digit[i_count]->mask = c_digits[NIBBLE(h_processor->reg[A_REG], REG_SIZE - 1 - i_count)];
+            switch (NIBBLE(h_processor->reg[B_REG], REG_SIZE - 1 - i_count) & 0x07)
             {
             case 0x02: /* Sign */
-               if (h_processor->reg[A_REG]->nibble[REG_SIZE - 1 - i_count])
+               if (NIBBLE(h_processor->reg[A_REG], REG_SIZE - 1 - i_count))
                   h_display->digit[i_count]->mask = DISPLAY_MINUS;
                else
                   h_display->digit[i_count]->mask = DISPLAY_SPACE;
@@ -631,3 +689,53 @@ int i_display_update(odisplay *h_display, oprocessor *h_processor)
 #endif
    return (True);
 }
+
+/*
+ * display_save (display, frame)
+ *
+ * Copies the state of each digit and annunciator into a frame.  Returns
+ * True if the frame has changed.
+ *
+ */
+
+int i_display_save(odisplay *h_display, oframe *h_frame)
+{
+   int i_count, b_changed = False;
+
+   for (i_count = 0; i_count < DIGITS; i_count++)
+   {
+      int i_mask = (h_display->digit[i_count] != NULL) ? h_display->digit[i_count]->mask : DISPLAY_SPACE;
+      if (h_frame->mask[i_count] != i_mask) b_changed = True;
+      h_frame->mask[i_count] = i_mask;
+   }
+#if defined(INDECATORS)
+   for (i_count = 0; i_count < INDECATORS; i_count++)
+   {
+      int i_state = (h_display->label[i_count] != NULL) ? h_display->label[i_count]->state : False;
+      if (h_frame->state[i_count] != i_state) b_changed = True;
+      h_frame->state[i_count] = i_state;
+   }
+#endif
+   return (b_changed);
+}
+
+/*
+ * display_load (display, frame)
+ *
+ * Sets the state of each digit and annunciator from a frame, ready to be
+ * drawn by display_refresh().
+ *
+ */
+
+int i_display_load(odisplay *h_display, oframe *h_frame)
+{
+   int i_count;
+
+   for (i_count = 0; i_count < DIGITS; i_count++)
+      if (h_display->digit[i_count] != NULL) h_display->digit[i_count]->mask = h_frame->mask[i_count];
+#if defined(INDECATORS)
+   for (i_count = 0; i_count < INDECATORS; i_count++)
+      if (h_display->label[i_count] != NULL) h_display->label[i_count]->state = h_frame->state[i_count];
+#endif
+   return (True);
+}
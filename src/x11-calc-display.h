@@ -44,6 +44,10 @@
  *                     and the current position of the display - MT
  *                   - Finally renamed x11-calc-segment to the more correct
  *                     x11-calc-digit - MT
+ * 18 Oct 26         - Added display_refresh() and the state of each annun-
+ *                     ciator when it was last drawn - MT
+ *                   - Added  a frame structure holding just the state  of
+ *                     the display so it can be passed between threads - MT
  *
  */
 
@@ -94,9 +98,18 @@ typedef struct /* Calculator display structure. */
    unsigned int border;
 #if defined(INDECATORS)
    olabel* label[INDECATORS];
+   int drawn[INDECATORS];        /* State of each annunciator when last drawn */
 #endif
 } odisplay;
 
+typedef struct /* Contents of the display, without any of the geometry. */
+{
+   int mask[DIGITS];
+#if defined(INDECATORS)
+   int state[INDECATORS];
+#endif
+} oframe;
+
 odisplay *h_display_create(int i_index,
    int i_left, int i_top, int i_width, int i_height,
    int i_display_left, int i_display_top, int i_display_width, int i_display_height,
@@ -104,6 +117,12 @@ odisplay *h_display_create(int i_index,
 
 int i_display_draw(Display *x_display, int x_application_window, int i_screen, odisplay *h_display);
 
+int i_display_refresh(Display *x_display, int x_application_window, int i_screen, odisplay *h_display);
+
 int i_display_resize(odisplay *h_display, float f_scale);
 
 int i_display_update(odisplay *h_display, oprocessor *h_processor);
+
+int i_display_save(odisplay *h_display, oframe *h_frame);
+
+int i_display_load(odisplay *h_display, oframe *h_frame);
@@ -0,0 +1,146 @@
+/*
+ * x11-calc-grid.c - RPN (Reverse Polish) calculator simulator.
+ *
+ * Copyright(C) 2026   MT
+ *
+ * Defines the routines and data structures used to find the button  (or
+ * switch) at a point in the window.
+ *
+ * The  window is divided into square cells, and each cell has a  list  of
+ * the areas that overlap it, so only those areas need to be checked to see
+ * which one contains a point however many there are.   The lists for all
+ * the cells are held one after another in a single array.
+ *
+ * This  program is free software: you can redistribute it and/or modify it
+ * under  the terms of the GNU General Public License as published  by  the
+ * Free  Software Foundation, either version 3 of the License, or (at  your
+ * option) any later version.
+ *
+ * This  program  is distributed in the hope that it will  be  useful,  but
+ * WITHOUT   ANY   WARRANTY;   without even   the   implied   warranty   of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You  should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * 18 Oct 26         - Initial version - MT
+ *
+ */
+
+#define NAME           "x11-calc-grid"
+#define BUILD          "0001"
+#define DATE           "18 Oct 26"
+#define AUTHOR         "MT"
+
+#include <errno.h>     /* errno */
+
+#include <stdio.h>     /* fprintf(), etc. */
+#include <stdlib.h>    /* malloc(), etc. */
+
+#include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
+
+#include "x11-calc-messages.h"
+#include "x11-calc-errors.h"
+
+#include "x11-calc-grid.h"
+
+#include "gcc-debug.h"
+
+/*
+ * grid_create (areas)
+ *
+ * Allocates  storage for a grid that can hold the specified number of
+ * areas, or exits the program if there isn't enough memory available.
+ *
+ */
+
+ogrid *h_grid_create(int i_areas)
+{
+   ogrid *h_grid;
+
+   if ((h_grid = malloc(sizeof(*h_grid))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   if ((h_grid->area = malloc(sizeof(*h_grid->area) * i_areas)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   h_grid->areas = i_areas;
+   h_grid->columns = h_grid->rows = 0;
+   h_grid->first = h_grid->entry = NULL;
+   return (h_grid);
+}
+
+/*
+ * grid_build (grid, areas, width, height)
+ *
+ * Divides a window of the given size into cells and lists the areas that
+ * overlap each cell.  Needs to be called again whenever any of the areas
+ * move or the window is resized.  Returns the number of entries.
+ *
+ */
+
+int i_grid_build(ogrid *h_grid, XRectangle o_area[], int i_width, int i_height)
+{
+   int i_count, i_column, i_row, i_cells, i_entries;
+   int *h_next;
+
+   h_grid->columns = (i_width + GRID_SIZE - 1) / GRID_SIZE;
+   h_grid->rows = (i_height + GRID_SIZE - 1) / GRID_SIZE;
+   i_cells = h_grid->columns * h_grid->rows;
+
+   free(h_grid->first);
+   free(h_grid->entry);
+   if ((h_grid->first = calloc(i_cells + 1, sizeof(*h_grid->first))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   if ((h_next = malloc(sizeof(*h_next) * (i_cells + 1))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+
+   for (i_count = 0; i_count < h_grid->areas; i_count++) /* Count the areas overlapping each cell */
+   {
+      h_grid->area[i_count] = o_area[i_count];
+      if ((o_area[i_count].width > 0) && (o_area[i_count].height > 0))
+         for (i_row = o_area[i_count].y / GRID_SIZE; i_row <= (o_area[i_count].y + o_area[i_count].height) / GRID_SIZE; i_row++)
+            for (i_column = o_area[i_count].x / GRID_SIZE; i_column <= (o_area[i_count].x + o_area[i_count].width) / GRID_SIZE; i_column++)
+               if ((i_row >= 0) && (i_row < h_grid->rows) && (i_column >= 0) && (i_column < h_grid->columns))
+                  h_grid->first[i_row * h_grid->columns + i_column + 1]++;
+   }
+
+   for (i_count = 0; i_count < i_cells; i_count++) /* Work out where the list for each cell starts */
+      h_grid->first[i_count + 1] += h_grid->first[i_count];
+   i_entries = h_grid->first[i_cells];
+   for (i_count = 0; i_count <= i_cells; i_count++)
+      h_next[i_count] = h_grid->first[i_count];
+
+   if ((h_grid->entry = malloc(sizeof(*h_grid->entry) * (i_entries + 1))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   for (i_count = 0; i_count < h_grid->areas; i_count++) /* Fill in the lists, keeping the areas in order */
+      if ((o_area[i_count].width > 0) && (o_area[i_count].height > 0))
+         for (i_row = o_area[i_count].y / GRID_SIZE; i_row <= (o_area[i_count].y + o_area[i_count].height) / GRID_SIZE; i_row++)
+            for (i_column = o_area[i_count].x / GRID_SIZE; i_column <= (o_area[i_count].x + o_area[i_count].width) / GRID_SIZE; i_column++)
+               if ((i_row >= 0) && (i_row < h_grid->rows) && (i_column >= 0) && (i_column < h_grid->columns))
+                  h_grid->entry[h_next[i_row * h_grid->columns + i_column]++] = i_count;
+
+   free(h_next);
+   return (i_entries);
+}
+
+/*
+ * grid_find (grid, x, y)
+ *
+ * Returns  the index of the first area that contains the point, or -1 if
+ * there isn't one.  Like the buttons and switches, the edges of an area
+ * are not included.
+ *
+ */
+
+int i_grid_find(ogrid *h_grid, int i_xpos, int i_ypos)
+{
+   int i_cell, i_count;
+   XRectangle *h_area;
+
+   if ((i_xpos < 0) || (i_ypos < 0) || (i_xpos / GRID_SIZE >= h_grid->columns) || (i_ypos / GRID_SIZE >= h_grid->rows))
+      return (-1);
+   i_cell = (i_ypos / GRID_SIZE) * h_grid->columns + (i_xpos / GRID_SIZE);
+   for (i_count = h_grid->first[i_cell]; i_count < h_grid->first[i_cell + 1]; i_count++)
+   {
+      h_area = &h_grid->area[h_grid->entry[i_count]];
+      if ((i_xpos > h_area->x) && (i_xpos < h_area->x + h_area->width) &&
+         (i_ypos > h_area->y) && (i_ypos < h_area->y + h_area->height))
+         return (h_grid->entry[i_count]);
+   }
+   return (-1);
+}
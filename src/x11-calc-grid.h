@@ -0,0 +1,41 @@
+/*
+ * x11-calc-grid.h - RPN (Reverse Polish) calculator simulator.
+ *
+ * Copyright(C) 2026   MT
+ *
+ * Defines the routines and data structures used to find the button  (or
+ * switch) at a point in the window.
+ *
+ * This  program is free software: you can redistribute it and/or modify it
+ * under  the terms of the GNU General Public License as published  by  the
+ * Free  Software Foundation, either version 3 of the License, or (at  your
+ * option) any later version.
+ *
+ * This  program  is distributed in the hope that it will  be  useful,  but
+ * WITHOUT   ANY   WARRANTY;   without even   the   implied   warranty   of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You  should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * 18 Oct 26         - Initial version - MT
+ *
+ */
+
+#define GRID_SIZE       16    /* Width and height of each cell in pixels */
+
+typedef struct { /* Uniform grid giving the areas that overlap each cell */
+   int columns;
+   int rows;
+   int areas;                    /* Number of areas */
+   XRectangle *area;             /* Position of each area */
+   int *first;                   /* First entry for each cell (plus one for the end) */
+   int *entry;                   /* Areas overlapping each cell */
+} ogrid;
+
+ogrid *h_grid_create(int i_areas);
+
+int i_grid_build(ogrid *h_grid, XRectangle o_area[], int i_width, int i_height);
+
+int i_grid_find(ogrid *h_grid, int i_xpos, int i_ypos);
@@ -0,0 +1,835 @@
+/*
+ * x11-calc-headless.c - RPN (Reverse Polish) calculator simulator.
+ *
+ * Copyright(C) 2026 - MT
+ *
+ * Headless front end.
+ *
+ * Runs the same emulator as the X11 front end without a display, reading
+ * keystrokes  from  a script (or the standard input) and  writing  the
+ * contents of the display as text to the standard output.
+ *
+ * Each  line of the script is a list of keys separated by spaces.  A key
+ * may be given using the same keyboard shortcut as the X11 front end (for
+ * example  '7',  '+', or 'f'), the text on the key (for  example  'ENTER',
+ * 'SIN' or 'R/S'), or an octal key code prefixed with '@'.  On models with
+ * switches  the  text  of a switch position (for example  'PRGM'  or  'RUN')
+ * moves the switch to that position.  Anything after a '#' is  ignored.
+ *
+ * If more than one saved state is given on the command line (or the number
+ * of jobs is specified using '-j') then the same script is run on each one
+ * in  turn,  using  a separate processor for each job and as many  worker
+ * threads as there are processors, and the final contents of the X register
+ * and the display are written to the standard output once every job  has
+ * finished.
+ *
+ * After  each  key is released the emulator runs until the ROM is waiting
+ * for the next key to be pressed (or the processor goes to sleep), and at
+ * the  end of each line the display is written to the standard output  as
+ * a single line of text.
+ *
+ * Deliberately parses the command line without using 'getopt' or 'argparse'
+ * to maximise portability.
+ *
+ * This  program is free software: you can redistribute it and/or modify it
+ * under  the terms of the GNU General Public License as published  by  the
+ * Free  Software Foundation, either version 3 of the License, or (at  your
+ * option) any later version.
+ *
+ * This  program  is distributed in the hope that it will  be  useful,  but
+ * WITHOUT   ANY   WARRANTY;   without even   the   implied   warranty   of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You  should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * 18 Oct 26   0.1   - Initial version - MT
+ *                   - Runs the same script on any number of saved states
+ *                     using a pool of worker threads - MT
+ *                   - Uses the same key map as the X11 front end to find
+ *                     the button for a keyboard shortcut - MT
+ *                   - Added '--profile' option to write an execution pro-
+ *                     file after the script has finished - MT
+ *                   - Added '--trace' option to keep a history of the
+ *                     instructions executed and '--decode' to print it - MT
+ *                   - Use NIBBLE() to read the packed registers - MT
+ *                   - Added '--export' option to write the final state to
+ *                     a text data file - MT
+ *                   - Holds each key down until the ROM has read it, like
+ *                     the X11 front end, instead of for 1000 ticks - MT
+ *                   - Only the history of the processor used without '-j'
+ *                     is written on a signal - MT
+ *
+ */
+
+#define  NAME          "x11-calc-headless"
+#define  VERSION       "0.14"
+#define  BUILD         "0001"
+#define  DATE          "18 Oct 26"
+#define  AUTHOR        "MT"
+
+#define  SETTLE 1000   /* Minimum number of ticks to run after switching on or moving a switch */
+#define  LIMIT 100000000L /* Default maximum number of ticks to run after each key */
+#define  LINE_SIZE 1024 /* Maximum length of a line in a script */
+#define  TEXT_SIZE (3 * DIGITS + 64) /* Maximum length of the display text */
+#define  THREADS 1024  /* Maximum number of worker threads */
+
+#if defined(HP34c) || defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+#define  X_REG N_REG   /* X is kept in N while waiting for a key */
+#else
+#define  X_REG C_REG
+#endif
+
+#define  KEY           1
+#define  SWITCH        2
+
+#include <errno.h>     /* errno */
+
+#include <stdarg.h>    /* strlen(), etc */
+#include <string.h>    /* strlen(), etc */
+#include <stdio.h>     /* fprintf(), etc */
+#include <stdlib.h>    /* getenv(), etc */
+
+#include <ctype.h>     /* isprint(), etc */
+
+#include <pthread.h>   /* pthread_create(), etc */
+#include <unistd.h>    /* sysconf() */
+
+#include "x11-calc-headless.h" /* True, False, etc. */
+
+#include "x11-calc-messages.h"
+#include "x11-calc-errors.h"
+
+#include "x11-calc-font.h"
+#include "x11-calc-button.h"
+#include "x11-calc-switch.h"
+#include "x11-calc-label.h"
+#include "x11-calc-colour.h"
+
+#include "x11-calc.h"
+
+#include "x11-calc-digit.h"
+#include "x11-calc-display.h"
+#include "x11-calc-cpu.h"
+
+#include "gcc-debug.h" /* print() */
+
+static const struct { int mask; char c_char; } o_segments[] = /* Seven segment patterns */
+{
+   {SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F, '0'},
+   {SEG_E | SEG_F, '1'},
+   {SEG_A | SEG_C | SEG_D | SEG_F | SEG_G, '2'},
+   {SEG_A | SEG_D | SEG_E | SEG_F | SEG_G, '3'},
+   {SEG_B | SEG_E | SEG_F | SEG_G, '4'},
+   {SEG_A | SEG_B | SEG_D | SEG_E | SEG_G, '5'},
+   {SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_G, '6'},
+   {SEG_A | SEG_E | SEG_F, '7'},
+   {SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, '8'},
+   {SEG_A | SEG_B | SEG_E | SEG_F | SEG_G, '9'},
+   {SEG_A | SEG_B | SEG_D | SEG_E | SEG_F | SEG_G, '9'},
+   {SEG_G, '-'},
+   {SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G, 'A'},
+   {SEG_B | SEG_C | SEG_D | SEG_E | SEG_G, 'b'},
+   {SEG_A | SEG_B | SEG_C | SEG_D, 'C'},
+   {SEG_C | SEG_D | SEG_G, 'c'},
+   {SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, 'd'},
+   {SEG_A | SEG_B | SEG_C | SEG_D | SEG_G, 'E'},
+   {SEG_A | SEG_B | SEG_C | SEG_G, 'F'},
+   {SEG_A | SEG_B | SEG_C | SEG_D | SEG_E, 'G'},
+   {SEG_B | SEG_C | SEG_E | SEG_F | SEG_G, 'H'},
+   {SEG_B | SEG_C | SEG_E | SEG_G, 'h'},
+   {SEG_C, 'i'},
+   {SEG_D | SEG_E | SEG_F, 'J'},
+   {SEG_B | SEG_C | SEG_D, 'L'},
+   {SEG_C | SEG_E | SEG_G, 'n'},
+   {SEG_C | SEG_D | SEG_E | SEG_G, 'o'},
+   {SEG_A | SEG_B | SEG_C | SEG_F | SEG_G, 'P'},
+   {SEG_C | SEG_G, 'r'},
+   {SEG_B | SEG_C | SEG_D | SEG_G, 't'},
+   {SEG_B | SEG_C | SEG_D | SEG_E | SEG_F, 'U'},
+   {SEG_C | SEG_D | SEG_E, 'u'},
+   {SEG_B | SEG_D | SEG_E | SEG_F | SEG_G, 'y'},
+   {DISPLAY_SPACE, ' '}
+};
+
+typedef struct { /* A key press or switch position */
+   char type;
+   int code;                  /* Key code or switch number */
+   char state;                /* Switch position */
+   char *token;               /* Text from the script */
+} ostep;
+
+typedef struct { /* A saved state and the results of running the script */
+   char *pathname;
+   char x[REG_SIZE + 8];      /* X register */
+   char text[TEXT_SIZE];      /* Display */
+} ojob;
+
+typedef struct { /* Everything shared by the worker threads */
+   const unsigned short *rom;
+   long limit;
+   char enabled;              /* Initial switch positions */
+   char mode;
+   ostep *step;               /* Script */
+   int steps;
+   ojob *job;
+   int jobs;
+   int next;                  /* Next job to run */
+   pthread_mutex_t lock;      /* Protects next */
+} obatch;
+
+void v_version() /* Display version information */
+{
+   fprintf(stdout, "%s: Version %s.%s %s", FILENAME, VERSION, BUILD, COMMIT_ID);
+   if (__DATE__[4] == ' ') fprintf(stdout, " 0"); else fprintf(stdout, " %c", __DATE__[4]);
+   fprintf(stdout, "%c %c%c%c %s %s\n", __DATE__[5],
+      __DATE__[0], __DATE__[1], __DATE__[2], &__DATE__[9], __TIME__ );
+}
+
+void v_warning(const char *s_format, ...) /* Print formatted warning message and exit */
+{
+   va_list t_args;
+   va_start(t_args, s_format);
+   fprintf(stderr, "%s: ", FILENAME);
+   vfprintf(stderr, s_format, t_args);
+   va_end(t_args);
+}
+
+void v_error(int i_errno, const char *s_format, ...) /* Print formatted error message and exit returning errno */
+{
+   va_list t_args;
+   if (!(i_errno)) i_errno = -1; /* If errno not set return -1 */
+   va_start(t_args, s_format);
+   fprintf(stderr, "%s: ", FILENAME);
+   vfprintf(stderr, s_format, t_args);
+   va_end(t_args);
+   v_history_fatal(); /* Keep a record of what led to the error */
+   exit(i_errno);
+}
+
+/*
+ * text_display_create ()
+ *
+ * Creates a display with the same digits and annunciators as the one used
+ * by the X11 front end, but without any fonts or geometry, so the display
+ * can be updated from the processor using i_display_update().
+ *
+ */
+
+static odisplay *h_text_display_create(void)
+{
+   odisplay *h_display;
+   int i_count;
+
+   if ((h_display = malloc(sizeof(*h_display)))==NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   h_display->index = 0;
+   h_display->enabled = True;
+   for (i_count = 0; i_count < DIGITS; i_count++)
+      h_display->digit[i_count] = h_digit_create(i_count, DISPLAY_SPACE, 0, 0, 0, 0, 0, 0);
+
+#if defined(HP10c) || defined(HP11c) || defined(HP12c) || defined(HP15c) || defined(HP16c)
+   h_display->label[0] = h_label_create(001, "USER", NULL, 0, 0, 0, 0, 0, 0, False);
+   h_display->label[1] = h_label_create(002, "f", NULL, 0, 0, 0, 0, 0, 0, False);
+   h_display->label[2] = h_label_create(003, "g", NULL, 0, 0, 0, 0, 0, 0, False);
+#if defined(HP12c)
+   h_display->label[3] = h_label_create(004, "BEGIN", NULL, 0, 0, 0, 0, 0, 0, False);
+   h_display->label[4] = NULL;
+#else
+   h_display->label[3] = h_label_create(004, "RAD", NULL, 0, 0, 0, 0, 0, 0, False);
+   h_display->label[4] = h_label_create(005, "GRAD", NULL, 0, 0, 0, 0, 0, 0, False);
+#endif
+   h_display->label[5] = h_label_create(006, "D.MY", NULL, 0, 0, 0, 0, 0, 0, False);
+   h_display->label[6] = h_label_create(007, "C", NULL, 0, 0, 0, 0, 0, 0, False);
+   h_display->label[7] = h_label_create(010, "PRGM", NULL, 0, 0, 0, 0, 0, 0, False);
+#endif
+
+   return (h_display);
+}
+
+static void v_text_display_free(odisplay *h_display)
+{
+   int i_count;
+
+   for (i_count = 0; i_count < DIGITS; i_count++)
+      free(h_display->digit[i_count]);
+#if defined(INDECATORS)
+   for (i_count = 0; i_count < INDECATORS; i_count++)
+      free(h_display->label[i_count]);
+#endif
+   free(h_display);
+}
+
+/*
+ * display_text (display, text)
+ *
+ * Converts the segments shown on each digit into the nearest character and
+ * appends any annunciators that are visible.  Decimal points and commas are
+ * shown after the digit they belong to.
+ *
+ */
+
+static char *s_display_text(odisplay *h_display, char *s_text)
+{
+   int i_count, i_index, i_length = 0;
+   int i_mask;
+
+   for (i_count = 0; i_count < DIGITS; i_count++)
+   {
+      if (h_display->digit[i_count] == NULL) continue;
+      i_mask = h_display->digit[i_count]->mask;
+      if ((i_mask & ~(SEG_DECIMAL | SEG_COMMA | SEG_COLON)) || !(i_mask & (SEG_DECIMAL | SEG_COMMA | SEG_COLON)))
+      {
+         s_text[i_length] = '?'; /* Unknown pattern */
+         for (i_index = 0; i_index < sizeof(o_segments) / sizeof(*o_segments); i_index++)
+            if (o_segments[i_index].mask == (i_mask & (SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G)))
+            {
+               s_text[i_length] = o_segments[i_index].c_char;
+               break;
+            }
+         i_length++;
+      }
+      if (i_mask & SEG_DECIMAL) s_text[i_length++] = '.';
+      if (i_mask & SEG_COMMA) s_text[i_length++] = ',';
+      if (i_mask & SEG_COLON) s_text[i_length++] = ':';
+   }
+   while ((i_length > 0) && (s_text[i_length - 1] == ' ')) i_length--; /* Remove any trailing spaces */
+   s_text[i_length] = '\0';
+
+#if defined(INDECATORS)
+   for (i_count = 0; i_count < INDECATORS; i_count++)
+      if ((h_display->label[i_count] != NULL) && (h_display->label[i_count]->state))
+      {
+         strcat(s_text, " ");
+         strcat(s_text, h_display->label[i_count]->text);
+      }
+#endif
+   return (s_text);
+}
+
+/*
+ * run (processor, minimum, limit)
+ *
+ * Runs the processor until it is waiting for a key to be pressed, goes to
+ * sleep, or it has executed the specified number of instructions.  Always
+ * runs for a minimum number of instructions, as the ROM may test the keys
+ * while it is still busy (for example just after it is switched on, or a
+ * key is released).  Returns the reason for stopping.
+ *
+ */
+
+static int i_run(oprocessor *h_processor, long l_minimum, long l_limit)
+{
+   unsigned long i_start = h_processor->ticks;
+   int i_stop = STOP_BUDGET;
+
+   while ((h_processor->ticks - i_start) < l_limit)
+   {
+      i_stop = i_processor_run(h_processor, (l_limit - (h_processor->ticks - i_start)) > 1000000 ?
+         1000000 : (int) (l_limit - (h_processor->ticks - i_start)));
+      if (i_stop == STOP_SLEEP) break;
+      if ((i_stop == STOP_IDLE) && ((h_processor->ticks - i_start) >= l_minimum)) break;
+   }
+   return (i_stop);
+}
+
+/*
+ * register_text (register, text)
+ *
+ * Formats the contents of a register holding a floating point number (the
+ * X register) using scientific notation.
+ *
+ */
+
+static char *s_register_text(oregister *h_register, char *s_text)
+{
+   static const char c_hex[] = "0123456789abcdef";
+   int i_count, i_length = 0;
+   int i_exponent;
+
+   s_text[i_length++] = (NIBBLE(h_register, REG_SIZE - 1) ? '-' : '+'); /* Sign */
+   for (i_count = REG_SIZE - 2; i_count >= EXP_SIZE; i_count--) /* Mantissa */
+   {
+      s_text[i_length++] = c_hex[NIBBLE(h_register, i_count)];
+      if (i_count == REG_SIZE - 2) s_text[i_length++] = '.';
+   }
+   i_exponent = 0;
+   for (i_count = EXP_SIZE - 2; i_count >= 0; i_count--) /* Exponent */
+      i_exponent = i_exponent * 10 + NIBBLE(h_register, i_count);
+   if (NIBBLE(h_register, EXP_SIZE - 1)) i_exponent -= 100; /* Negative exponents are stored as a tens complement */
+   sprintf(&s_text[i_length], "e%+03d", i_exponent);
+   return (s_text);
+}
+
+/*
+ * press (processor, code, limit)
+ *
+ * Holds down a key until the ROM has read it, then releases it and waits
+ * until the ROM has finished processing it.  The key is released anyway
+ * if the ROM hasn't read it after HOLD_LIMIT ticks.
+ *
+ */
+
+static int i_press(oprocessor *h_processor, int i_code, long l_limit)
+{
+   unsigned long i_changed;
+   int i_stop;
+
+   h_processor->code = i_code;
+   h_processor->keypressed = True;
+#if !defined(SWITCHES)
+   h_processor->enabled = True; /* Any key press wil wake up the processor */
+   h_processor->sleep = False;
+#endif
+   i_changed = h_processor->ticks;
+   do
+      i_stop = i_processor_run(h_processor, (int) (i_changed + HOLD_LIMIT - h_processor->ticks));
+   while ((i_stop != STOP_SLEEP) && !i_key_seen(h_processor, i_stop) && ((h_processor->ticks - i_changed) < HOLD_LIMIT));
+   if ((h_processor->ticks - i_changed) < HOLD) /* Keep it down for a minimum time even if it was seen at once */
+      i_run(h_processor, HOLD, (long) (i_changed + HOLD - h_processor->ticks));
+   h_processor->keypressed = False;
+   return (i_run(h_processor, HOLD, l_limit));
+}
+
+/*
+ * parse (token, buttons, switches, step)
+ *
+ * Works out which key or switch a token refers to.  Returns False if the
+ * token isn't recognised.
+ *
+ */
+
+static int i_parse(char *s_token, obutton *h_button[], obutton *h_keymap[], oswitch *h_switch[], ostep *h_step)
+{
+   int i_count, i_offset;
+
+   h_step->type = KEY;
+   h_step->code = -1;
+   h_step->token = s_token;
+   if ((s_token[0] == '@') && (s_token[1] != '\0')) /* Octal key code */
+   {
+      h_step->code = 0;
+      for (i_offset = 1; s_token[i_offset] != '\0'; i_offset++)
+      {
+         if ((s_token[i_offset] < '0') || (s_token[i_offset] > '7'))
+            v_error(EINVAL, h_err_invalid_number, s_token);
+         h_step->code = h_step->code * 8 + s_token[i_offset] - '0';
+      }
+   }
+   if ((h_step->code < 0) && (s_token[1] == '\0') && (h_keymap[(unsigned char) s_token[0]] != NULL)) /* Look for a keyboard shortcut */
+      h_step->code = h_keymap[(unsigned char) s_token[0]]->index;
+   for (i_count = 0; (h_step->code < 0) && (i_count < BUTTONS); i_count++) /* Look for the text on a key */
+      if ((h_button[i_count] != NULL) && (h_button[i_count]->text != NULL) && !strcasecmp(s_token, h_button[i_count]->text))
+         h_step->code = h_button[i_count]->index;
+   if (h_step->code >= 0) return (True);
+#if defined(SWITCHES)
+   h_step->type = SWITCH;
+   for (i_count = 0; i_count < SWITCHES; i_count++) /* Look for a switch position */
+   {
+      h_step->code = i_count;
+      if (!strncasecmp(s_token, h_switch[i_count]->on, strlen(s_token)) && (strlen(s_token) == strcspn(h_switch[i_count]->on, " ")))
+         h_step->state = False;
+      else if (!strncasecmp(s_token, h_switch[i_count]->off, strlen(s_token)) && (strlen(s_token) == strcspn(h_switch[i_count]->off, " ")))
+         h_step->state = True;
+      else
+         continue;
+      return (True);
+   }
+#endif
+   return (False);
+}
+
+/*
+ * step (processor, step, limit)
+ *
+ * Presses a key or moves a switch and then waits until the ROM is waiting
+ * for the next key.
+ *
+ */
+
+static void v_step(oprocessor *h_processor, ostep *h_step, long l_limit)
+{
+   switch (h_step->type)
+   {
+   case KEY:
+      if (i_press(h_processor, h_step->code, l_limit) == STOP_BUDGET)
+         v_warning(h_err_limit, h_step->token);
+      break;
+#if defined(SWITCHES)
+   case SWITCH:
+      if (h_step->code == 0)
+      {
+         if (h_step->state && !h_processor->enabled)
+         {
+            oregister o_memory[MEMORY_SIZE];
+            memcpy(o_memory, h_processor->mem[0], sizeof(o_memory)); /* Switching off and on again */
+            v_processor_reset(h_processor);
+#if defined(CONTINIOUS)
+            memcpy(h_processor->mem[0], o_memory, sizeof(o_memory)); /* only clears memory if it isn't continious */
+#endif
+         }
+         h_processor->enabled = h_step->state;
+      }
+      else
+         h_processor->mode = h_step->state;
+      i_run(h_processor, SETTLE, l_limit);
+      break;
+#endif
+   }
+}
+
+/*
+ * run_job (batch, job)
+ *
+ * Creates a new processor, loads the saved state and then runs the script
+ * from start to finish.  The processor and display are only used by this
+ * job so any number of jobs can be run at the same time.
+ *
+ */
+
+static void v_run_job(obatch *h_batch, ojob *h_job)
+{
+   oprocessor *h_processor;
+   odisplay *h_display;
+   int i_count;
+
+   h_processor = h_processor_create(h_batch->rom);
+   h_display = h_text_display_create();
+   v_read_state(h_processor, h_job->pathname);
+#if defined(SWITCHES)
+   h_processor->enabled = h_batch->enabled;
+   h_processor->mode = h_batch->mode;
+#endif
+   i_run(h_processor, SETTLE, h_batch->limit); /* Power on */
+   for (i_count = 0; i_count < h_batch->steps; i_count++)
+      v_step(h_processor, &h_batch->step[i_count], h_batch->limit);
+   i_display_update(h_display, h_processor);
+   s_display_text(h_display, h_job->text);
+   s_register_text(h_processor->reg[X_REG], h_job->x);
+   v_processor_free(h_processor);
+   v_text_display_free(h_display);
+}
+
+/*
+ * worker (batch)
+ *
+ * Keeps taking the next job from the batch until they have all been run.
+ *
+ */
+
+static void *h_worker(void *h_data)
+{
+   obatch *h_batch = h_data;
+   int i_next;
+
+   for (;;)
+   {
+      pthread_mutex_lock(&h_batch->lock);
+      i_next = h_batch->next++;
+      pthread_mutex_unlock(&h_batch->lock);
+      if (i_next >= h_batch->jobs) break;
+      v_run_job(h_batch, &h_batch->job[i_next]);
+   }
+   return (NULL);
+}
+
+/*
+ * parse_number (text)
+ *
+ * Returns the value of a positive decimal number.
+ *
+ */
+
+static long l_parse_number(char *s_text, long l_maximum)
+{
+   long l_value = 0;
+   int i_count;
+
+   for (i_count = 0; i_count < strlen(s_text); i_count++) /* Parse decimal number */
+   {
+      if ((s_text[i_count] < '0') || (s_text[i_count] > '9') || (l_value > l_maximum))
+         v_error(EINVAL, h_err_numeric_range, s_text);
+      else
+         l_value = l_value * 10 + s_text[i_count] - '0';
+   }
+   if ((l_value < 1) || (l_value > l_maximum)) v_error(EINVAL, h_err_numeric_range, s_text);
+   return (l_value);
+}
+
+int main(int argc, char *argv[])
+{
+   obutton *h_button[BUTTONS];
+   obutton *h_keymap[KEYS];      /* Button for each keyboard shortcut */
+#if defined(SWITCHES)
+   oswitch *h_switch[SWITCHES];
+#else
+   oswitch **h_switch = NULL;
+#endif
+   odisplay *h_display;
+   oprocessor *h_processor;
+   obatch o_batch;
+   pthread_t *h_thread;
+
+   FILE *h_script = stdin;
+   char *s_pathname = NULL;
+   char *s_profile = NULL; /* Execution profile */
+   char *s_trace = NULL; /* Where to write the history */
+   char *s_decode = NULL; /* History to decode */
+#if defined(CONTINIOUS)
+   char *s_export = NULL; /* Where to write the state as text */
+#endif
+   char c_line[LINE_SIZE];
+   char s_text[TEXT_SIZE];
+   char *s_token;
+   char b_abort = False;         /*Abort flag controls execution of main loop */
+   long l_limit = LIMIT;         /* Maximum number of ticks to run after each key */
+   int i_threads = 0;            /* Number of worker threads (only used for a batch) */
+   int i_offset, i_count, i_index;
+   ostep o_step;
+   int i_keys;
+
+   h_processor = h_processor_create(i_rom);
+   for (i_count = 1; i_count < argc && (b_abort != True); i_count++)
+   {
+      if (argv[i_count][0] == '-')
+      {
+         i_index = 1;
+         while (argv[i_count][i_index] != 0)
+         {
+            switch (argv[i_count][i_index])
+            {
+            case 'j': /* Number of jobs to run at the same time */
+            case 'r': /* Read ROM */
+               if (argv[i_count][i_index + 1] != 0)
+                  v_error(EINVAL, h_err_invalid_argument, argv[i_count][i_index + 1]);
+               else
+                  if (i_count + 1 < argc)
+                  {
+                     if (argv[i_count][i_index] == 'j')
+                        i_threads = l_parse_number(argv[i_count + 1], THREADS);
+                     else
+                        v_read_rom(h_processor, argv[i_count + 1]); /* Load user specified settings */
+                     if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                        for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                           argv[i_offset] = argv[i_offset + 1];
+                     argc--;
+                  }
+                  else
+                     v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+               i_index = strlen(argv[i_count]) - 1;
+               break;
+            case '-': /* '--' terminates command line processing */
+               i_index = strlen(argv[i_count]);
+               if (i_index == 2)
+                 b_abort = True; /* '--' terminates command line processing */
+               else
+                  if (!strncmp(argv[i_count], "--script", i_index))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        if ((h_script = fopen(argv[i_count + 1], "r")) == NULL) v_error(errno, h_err_opening_file, argv[i_count + 1]);
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+                  else if (!strncmp(argv[i_count], "--limit", i_index))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        l_limit = l_parse_number(argv[i_count + 1], LIMIT * 1000);
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+                  else if ((!strncmp(argv[i_count], "--trace", i_index)) || (!strncmp(argv[i_count], "--decode", i_index)))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        if (argv[i_count][2] == 't')
+                           s_trace = argv[i_count + 1];
+                        else
+                           s_decode = argv[i_count + 1];
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+#if defined(CONTINIOUS)
+                  else if (!strncmp(argv[i_count], "--export", i_index))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        s_export = argv[i_count + 1];
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+#endif
+                  else if (!strncmp(argv[i_count], "--profile", i_index))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        s_profile = argv[i_count + 1];
+                        v_profile_start(h_processor); /* Count instructions as they are executed */
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+                  else if (!strncmp(argv[i_count], "--version", i_index))
+                  {
+                     v_version(); /* Display version information */
+                     fprintf(stdout, h_msg_licence, &__DATE__[7], AUTHOR);
+                     exit(0);
+                  }
+                  else if (!strncmp(argv[i_count], "--help", i_index))
+                  {
+                     fprintf(stdout, c_msg_usage, FILENAME);
+                     exit(0);
+                  }
+                  else /* If we get here then the we have an invalid option */
+                     v_error(EINVAL, h_err_unrecognised_option, argv[i_count]);
+               i_index--; /* Leave index pointing at end of string (so argv[i_count][i_index] = 0) */
+               break;
+            default: /* If we get here the single letter option is unknown */
+               v_error(EINVAL, h_err_invalid_option, argv[i_count][i_index]);
+            }
+            i_index++; /* Parse next letter in option */
+         }
+         if (argv[i_count][1] != 0)
+         {
+            for (i_offset = i_count; i_offset < argc - 1; i_offset++)
+               argv[i_offset] = argv[i_offset + 1];
+            argc--; i_count--;
+         }
+      }
+   }
+
+#if defined(CONTINIOUS)
+   if ((argc > 2) && (i_threads == 0)) i_threads = sysconf(_SC_NPROCESSORS_ONLN); /* More than one file so run them as a batch */
+   if ((i_threads > 0) && (argc < 2)) v_error(EINVAL, h_err_invalid_operand); /* A batch needs at least one file */
+   if ((i_threads > 0) && (s_export != NULL)) v_error(EINVAL, h_err_invalid_operand); /* Can only export a single state */
+   if (argc > 1) s_pathname = argv[1]; /* Set path name if a parameter was passed and continuous memory is enabled */
+#else
+   if ((argc > 1) || (i_threads > 0)) v_error(EINVAL, h_err_invalid_operand); /* There shouldn't any command line parameters */
+#endif
+
+   i_count = ROM_SIZE;
+   while ((i_count > 0) && (i_rom[--i_count] == 0)); /* Check that the ROM isn't empty */
+   if (i_count == 0) v_error (ENODATA, h_err_ROM);
+
+   if (s_decode != NULL) /* Print a history instead of running a script */
+   {
+      v_history_decode(h_processor, s_decode);
+      exit(0);
+   }
+
+   v_init_buttons(h_button); /* Only the key codes and text are used */
+   i_button_map(h_keymap, h_button, BUTTONS);
+#if defined(SWITCHES)
+   v_init_switches(h_switch);
+#endif
+
+   if (i_threads > 0) /* Run the same script on each file */
+   {
+      o_batch.rom = h_processor->rom;
+      o_batch.limit = l_limit;
+#if defined(SWITCHES)
+      o_batch.enabled = h_switch[0]->state; /* Allow switches to be undefined if not used */
+      o_batch.mode = (SWITCHES == 2) ? h_switch[1]->state : False;
+#endif
+      o_batch.steps = 0;
+      o_batch.step = NULL;
+      while (fgets(c_line, sizeof(c_line), h_script) != NULL) /* Read the whole script first */
+      {
+         if ((s_token = strchr(c_line, '#')) != NULL) *s_token = '\0'; /* Ignore comments */
+         for (s_token = strtok(c_line, " \t\r\n"); s_token != NULL; s_token = strtok(NULL, " \t\r\n"))
+         {
+            if ((o_batch.step = realloc(o_batch.step, (o_batch.steps + 1) * sizeof(*o_batch.step))) == NULL)
+               v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+            if ((s_token = strdup(s_token)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+            if (!i_parse(s_token, h_button, h_keymap, h_switch, &o_batch.step[o_batch.steps])) v_error(EINVAL, h_err_invalid_key, s_token);
+            o_batch.steps++;
+         }
+      }
+
+      o_batch.jobs = argc - 1;
+      o_batch.next = 0;
+      if ((o_batch.job = malloc(o_batch.jobs * sizeof(*o_batch.job))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+      for (i_count = 0; i_count < o_batch.jobs; i_count++)
+         o_batch.job[i_count].pathname = argv[i_count + 1];
+      if (i_threads > o_batch.jobs) i_threads = o_batch.jobs;
+      pthread_mutex_init(&o_batch.lock, NULL);
+      if ((h_thread = malloc(i_threads * sizeof(*h_thread))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+      for (i_count = 0; i_count < i_threads; i_count++)
+         if ((errno = pthread_create(&h_thread[i_count], NULL, h_worker, &o_batch)) != 0) v_error(errno, h_err_thread);
+      for (i_count = 0; i_count < i_threads; i_count++)
+         pthread_join(h_thread[i_count], NULL);
+      pthread_mutex_destroy(&o_batch.lock);
+
+      for (i_count = 0; i_count < o_batch.jobs; i_count++) /* Results are always in the same order as the files */
+         fprintf(stdout, "%s\t%s\t%s\n", o_batch.job[i_count].pathname, o_batch.job[i_count].x, o_batch.job[i_count].text);
+      exit(0);
+   }
+
+   h_display = h_text_display_create();
+
+   if (s_pathname != NULL) v_read_state(h_processor, s_pathname); /* Never use (or update) the saved state */
+
+#if defined(SWITCHES)
+   h_processor->enabled = h_switch[0]->state; /* Allow switches to be undefined if not used */
+   if (SWITCHES == 2) h_processor->mode = h_switch[1]->state;
+#endif
+
+   if (s_trace != NULL) /* Keep a history of the instructions executed */
+   {
+      v_history_start(h_processor, s_trace);
+      v_history_catch(h_processor);
+   }
+
+   i_run(h_processor, SETTLE, l_limit); /* Power on */
+
+   while (fgets(c_line, sizeof(c_line), h_script) != NULL)
+   {
+      if ((s_token = strchr(c_line, '#')) != NULL) *s_token = '\0'; /* Ignore comments */
+      i_keys = 0;
+      for (s_token = strtok(c_line, " \t\r\n"); s_token != NULL; s_token = strtok(NULL, " \t\r\n"))
+      {
+         if (!i_parse(s_token, h_button, h_keymap, h_switch, &o_step)) v_error(EINVAL, h_err_invalid_key, s_token);
+         v_step(h_processor, &o_step, l_limit);
+         i_keys++;
+      }
+      if (i_keys > 0)
+      {
+         i_display_update(h_display, h_processor);
+         fprintf(stdout, "%s\n", s_display_text(h_display, s_text));
+         fflush(stdout);
+      }
+   }
+
+   if (h_script != stdin) fclose(h_script);
+#if defined(CONTINIOUS)
+   if (s_export != NULL) v_write_state(h_processor, s_export); /* Export the final state as text */
+#endif
+   if (s_profile != NULL) v_write_profile(h_processor, s_profile);
+   if (s_trace != NULL) v_history_write(h_processor);
+   exit(0);
+}
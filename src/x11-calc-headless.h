@@ -0,0 +1,48 @@
+/*
+ * x11-calc-headless.h - RPN (Reverse Polish) calculator simulator.
+ *
+ * Copyright(C) 2026   MT
+ *
+ * Definitions used in place of the X11 headers when building the headless
+ * front end.
+ *
+ * The  processor,  display and keyboard data structures only  refer to  a
+ * few  X11 types and constants, none of which are used to draw  anything
+ * in  a headless build, so rather than depending on X11 just define  the
+ * parts that are referenced.
+ *
+ * This  program is free software: you can redistribute it and/or modify it
+ * under  the terms of the GNU General Public License as published  by  the
+ * Free  Software Foundation, either version 3 of the License, or (at  your
+ * option) any later version.
+ *
+ * This  program  is distributed in the hope that it will  be  useful,  but
+ * WITHOUT   ANY   WARRANTY;   without even   the   implied   warranty   of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You  should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * 18 Oct 26         - Initial version - MT
+ *
+ */
+
+#if !defined(X11_CALC_HEADLESS)
+#define X11_CALC_HEADLESS
+
+#define True            1
+#define False           0
+
+typedef struct _XDisplay Display;      /* Never dereferenced */
+
+typedef struct {                       /* Button, label, and switch positions */
+   short x, y;
+   unsigned short width, height;
+} XRectangle;
+
+typedef struct {                       /* Only the font metrics are used */
+   int ascent, descent;
+} XFontStruct;
+
+#endif
@@ -30,6 +30,8 @@
  * 22 Apr 24         - Shortened long lines - MT
  * 23 Apr 24         - Separated out prototypes for error handlers - MT
  *                   - Removed unnecessary includes - MT
+ * 18 Oct 26         - Drawing functions are not needed in a headless build
+ *                     so don't include the X11 headers - MT
  *
  * TO DO:            - Implement ability to align text in a label using the
  *                     style property to modify the position and appearance
@@ -38,8 +40,8 @@
  */
 
 #define NAME           "x11-calc-label"
-#define BUILD          "0009"
-#define DATE           "23 Apr 24"
+#define BUILD          "0010"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <errno.h>     /* errno */
@@ -48,8 +50,12 @@
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* malloc(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-messages.h"
 #include "x11-calc-errors.h"
@@ -126,6 +132,7 @@ int i_label_resize(olabel *h_label, float f_scale)
    return 0;
 }
 
+#if !defined(HEADLESS)
 /*
  * label_draw (display, window, screen, label)
  *
@@ -165,5 +172,6 @@ int i_label_draw(Display *h_display, int x_application_window, int i_screen, ola
    }
    return(True);
 }
+#endif
 
 
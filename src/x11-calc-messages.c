@@ -55,12 +55,25 @@
  *                     text - MT
  * 04 May 24         - Updated French translations - macmpi
  * 06 May 24         - Use only 7-bit ASCII characters - MT
+ * 18 Oct 26         - Added '--speed' option to the help text - MT
+ *                   - Added help text and error messages for the headless
+ *                     front end - MT
+ *                   - Added '-j' option to the headless help text - MT
+ *                   - Added invalid snapshot error message - MT
+ *                   - Added invalid memory file error message - MT
+ *                   - Added '--map-memory' option to the help text - MT
+ *                   - Thread error message is used on all platforms - MT
+ *                   - Added '--profile' option to the help text - MT
+ *                   - Added invalid history error message - MT
+ *                   - Added '--trace' and '--decode' options to the help
+ *                     text - MT
+ *                   - Added '--export' option to the help text - MT
  *
  */
 
 #define NAME           "x11-calc-messages"
-#define BUILD          "0019"
-#define DATE           "16 Feb 24"
+#define BUILD          "0020"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #if defined(HP10c) || defined(HP11c) || defined(HP12c)|| defined(HP15c) || defined(HP16c)
@@ -77,17 +90,22 @@ There is NO WARRANTY, to the extent permitted by law.\n";
 const char * h_err_creating_file = "Can't create '%s'.\n";
 const char * h_err_memmory_alloc = "Memory allocation failed in %s line : %d\n";
 const char * h_err_ROM = "Empty ROM - no firmware loaded.\n";
+const char * h_err_snapshot = "Invalid snapshot '%s'.\n";
+const char * h_err_memory_file = "Invalid memory file '%s'.\n";
+const char * h_err_history = "Invalid history '%s'.\n";
 
 
 #if defined(HEXADECIMAL)
 const char * h_msg_opcode = "%1x-%03x  %03x   ";
 const char * h_msg_address = "%03x";
+const char * h_msg_location = "%1x-%03x";
 const char * h_msg_negative_offset = "-0x%x";
 const char * h_msg_positive_offset = "+0x%x";
 const char * h_msg_rom = "%x:%x";
 #else
 const char * h_msg_opcode = "%1o-%04o %04o  ";
 const char * h_msg_address = "%04o";
+const char * h_msg_location = "%1o-%04o";
 const char * h_msg_negative_offset = "-0%o";
 const char * h_msg_positive_offset = "+0%o";
 const char * h_msg_rom = "%o:%o";
@@ -120,6 +138,20 @@ const char * h_err_invalid_register = "Registro inválido (REG[%03d]) en %1o-%04
 const char * h_err_missing_argument = "opcion requiere un argumento -- '%s'\n";
 
 #if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#if defined(HEADLESS)
+const char * c_msg_usage = "Uso: %s [OPCION]... [ARCHIVO]...\n\
+Una emulador de calculadora RPN sin pantalla.\n\n\
+  -j  N                    ejecutar N trabajos a la vez\n\
+  -r  FILE                 leer el contenido de la ROM de FILE\n\
+      --script FILE        leer las teclas de FILE (default stdin)\n\
+      --limit N            instrucciones maximas por tecla\n\
+      --profile FILE       escribir un perfil de ejecucion en FILE\n\
+      --trace FILE         grabar una traza y escribirla en FILE\n\
+      --decode FILE        mostrar la traza de FILE y salir\n\
+      --export FILE        escribir el estado en FILE como texto\n\
+      --help               mostrar esta ayuda y salir\n\
+      --version            mostrar version y salir\n\n";
+#else
 const char * c_msg_usage = "Uso: %s [OPCION]... [ARCHIVO]\n\
 Una emulador de emulador RPN para X11.\n\n\
   -b  ADDR                 punto de interrupcion (octal)\n\
@@ -127,17 +159,26 @@ Una emulador de emulador RPN para X11.\n\n\
   -r  FILE                 leer el contenido de la ROM de FILE\n\
   -s,                      un paso\n\
   -t,                      seguimiento de la ejecucion\n\
+      --speed N|max        velocidad (N veces o sin limite)\n\
+      --profile FILE       escribir un perfil de ejecucion en FILE\n\
+      --trace FILE         grabar una traza y escribirla en FILE\n\
+      --map-memory         memoria continua en un archivo mapeado\n\
+      --export FILE        escribir el estado en FILE como texto\n\
       --zoom ZOOM          ampliar el tamaño de la ventana\n\
       --cursor             mostrar cursor (default)\n\
       --no-cursor          ocultar cursor\n\
       --help               mostrar esta ayuda y salir\n\
       --version            mostrar version y salir\n\n";
+#endif
 const char * h_err_invalid_operand = "operando(s) inválido\n";
 const char * h_err_invalid_option = "opcion invalida -- '%c'\n";
 const char * h_err_unrecognised_option = "opcion no reconocida '%s'\n";
 const char * h_err_invalid_number = "no es un numero octal -- '%s' \n";
 const char * h_err_numeric_range = "fuera del rango  -- '%s' \n";
 const char * h_err_invalid_argument = "argumento esperado no es -- '%c' \n";
+const char * h_err_invalid_key = "tecla no reconocida '%s'\n";
+const char * h_err_limit = "limite de instrucciones alcanzado -- '%s'\n";
+const char * h_err_thread = "no se pudo crear el hilo\n";
 #else
 const char * c_msg_usage = "Uso: %s [OPCION]... [ARCHIVO]\n\
 Una emulador de calculadora RPN para X11.\n\n\
@@ -150,6 +191,7 @@ Una emulador de calculadora RPN para X11.\n\n\
 
 const char * h_err_invalid_operand = "parametro(s) invalido(s)\n";
 const char * h_err_invalid_option = "opcion invalida %s\n";
+const char * h_err_thread = "no se pudo crear el hilo\n";
 #endif /* Unix */
 
 
@@ -180,6 +222,20 @@ const char * h_err_invalid_register = "Ungultiges register (REG[%03d]) an %1o-%0
 const char * h_err_missing_argument = "option benoetigt ein argument -- '%s'\n";
 
 #if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#if defined(HEADLESS)
+const char * c_msg_usage = "Verwendung: %s [OPTION]... [DATEI]...\n\
+Eine RPN rechner-emulator ohne anzeige.\n\n\
+  -j  N                    N auftraege gleichzeitig ausfuehren\n\
+  -r  FILE                 lesen sie den ROM inhalt von FILE\n\
+      --script FILE        tasten aus FILE lesen (standard stdin)\n\
+      --limit N            maximale anweisungen pro taste\n\
+      --profile FILE       ausfuehrungsprofil in FILE schreiben\n\
+      --trace FILE         ablaufprotokoll in FILE schreiben\n\
+      --decode FILE        ablaufprotokoll aus FILE anzeigen und beenden\n\
+      --export FILE        zustand als text in FILE schreiben\n\
+      --help               diese hilfe anzeigen und dann beenden\n\
+      --version            versionsinformationen ausgeben und dann beenden\n\n";
+#else
 const char * c_msg_usage = "Verwendung: %s [OPTION]... [DATEI]\n\
 Eine RPN rechner-emulator fur X11.\n\n\
   -b  ADDR                 haltepunkt an adresse setzen (oktal)\n\
@@ -187,17 +243,26 @@ Eine RPN rechner-emulator fur X11.\n\n\
   -r  FILE                 lesen sie den ROM inhalt von FILE\n\
   -s,                      einzelschritt\n\
   -t,                      ausfuehrung protokollieren\n\
+      --speed N|max        geschwindigkeit (N-fach oder unbegrenzt)\n\
+      --profile FILE       ausfuehrungsprofil in FILE schreiben\n\
+      --trace FILE         ablaufprotokoll in FILE schreiben\n\
+      --map-memory         Dauerspeicher in einer gemappten Datei\n\
+      --export FILE        zustand als text in FILE schreiben\n\
       --zoom ZOOM          fenstergrobe erweitern\n\
       --cursor             cursor anzeigen (default)\n\
       --no-cursor          cursor verbergen\n\
       --help               diese hilfe anzeigen und dann beenden\n\
       --version            versionsinformationen ausgeben und dann beenden\n\n";
+#endif
 const char * h_err_invalid_operand = "ungueltige(r) operand(en)\n";
 const char * h_err_invalid_option = "ungueltige option -- '%c'\n";
 const char * h_err_unrecognised_option = "unbekannte option '%s'\n";
 const char * h_err_invalid_number = "keine gueltige oktalzahl -- '%s' \n";
 const char * h_err_numeric_range = "ausserhalb des zahlenbereichs -- '%s' \n";
 const char * h_err_invalid_argument = "argument erwartet, nicht -- '%c' \n";
+const char * h_err_invalid_key = "unbekannte taste '%s'\n";
+const char * h_err_limit = "anweisungslimit erreicht -- '%s'\n";
+const char * h_err_thread = "thread konnte nicht erstellt werden\n";
 #else
 const char * c_msg_usage = "Verwendung: %s [OPTION...] [DATEI]\n\
 Eine RPN rechner-emulator fur X11.\n\n\
@@ -210,6 +275,7 @@ Eine RPN rechner-emulator fur X11.\n\n\
 
 const char * h_err_invalid_operand = "ungueltige(r) parameter\n";
 const char * h_err_invalid_option = "ungueltige option %s\n";
+const char * h_err_thread = "thread konnte nicht erstellt werden\n";
 #endif /* Unix */
 
 
@@ -240,6 +306,20 @@ const char * h_err_invalid_register = "Registre invalide (REG[%03d]) a %1o-%04o
 const char * h_err_missing_argument = "l'option necessite un argument -- '%s'\n";
 
 #if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#if defined(HEADLESS)
+const char * c_msg_usage = "Utilisation : %s [OPTION]... [FICHIER]...\n\
+Un emulateur de calculatrice RPN sans affichage.\n\n\
+  -j  N                    executer N travaux en parallele\n\
+  -r  FILE                 lire le contenu du fichier ROM\n\
+      --script FILE        lire les touches depuis FILE (stdin par defaut)\n\
+      --limit N            nombre maximal d'instructions par touche\n\
+      --profile FILE       ecrire un profil d'execution dans FILE\n\
+      --trace FILE         enregistrer une trace dans FILE\n\
+      --decode FILE        afficher la trace de FILE et quitter\n\
+      --export FILE        ecrire l'etat dans FILE en texte\n\
+      --help               afficher cette aide et quitter\n\
+      --version            afficher la version et quitter\n\n";
+#else
 const char * c_msg_usage = "Utilisation : %s [OPTION]... [FICHIER]\n\
 Un emulateur de calculatrices NPI sur X11.\n\n\
   -b  ADDR                 definir un point d'arret (octal)\n\
@@ -247,17 +327,26 @@ Un emulateur de calculatrices NPI sur X11.\n\n\
   -r  FILE                 lire le contenu du fichier ROM\n\
   -s,                      pas a pas\n\
   -t,                      trace d'execution\n\
+      --speed N|max        vitesse (N fois ou sans limite)\n\
+      --profile FILE       ecrire un profil d'execution dans FILE\n\
+      --trace FILE         enregistrer une trace dans FILE\n\
+      --map-memory         memoire continue dans un fichier mappe\n\
+      --export FILE        ecrire l'etat dans FILE en texte\n\
       --zoom ZOOM          agrandir la taille de la fenetre\n\
       --cursor             curseur d'affichage (par defaut)\n\
       --no-cursor          masquer le curseur\n\
       --help               afficher cette aide et quitter\n\
       --version            afficher les informations de version et quitter\n\n";
+#endif
 const char * h_err_invalid_operand = "operande(s) invalide(s)\n";
 const char * h_err_invalid_option = "option invalide -- '%c'\n";
 const char * h_err_unrecognised_option = "option non reconnue '%s'\n";
 const char * h_err_invalid_number = "pas un nombre octal -- '%s' \n";
 const char * h_err_numeric_range = "hors de portee -- '%s' \n";
 const char * h_err_invalid_argument = "argument attendu -- '%c' \n";
+const char * h_err_invalid_key = "touche non reconnue '%s'\n";
+const char * h_err_limit = "limite d'instructions atteinte -- '%s'\n";
+const char * h_err_thread = "impossible de creer le thread\n";
 #else
 const char * c_msg_usage = "Utilisation : %s [OPTION]... [FICHIER]\n\
 Un emulateur de calculatrices NPI sur X11.\n\n\
@@ -270,6 +359,7 @@ Un emulateur de calculatrices NPI sur X11.\n\n\
 
 const char * h_err_invalid_operand = "parametre(s) invalide(s)\n";
 const char * h_err_invalid_option = "option invalide %s\n";
+const char * h_err_thread = "impossible de creer le thread\n";
 #endif /* Unix */
 
 
@@ -301,6 +391,20 @@ const char * h_err_invalid_register = "Invalid register (REG[%03d]) at %1o-%04o
 const char * h_err_missing_argument = "option requires an argument -- '%s'\n";
 
 #if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#if defined(HEADLESS)
+const char * c_msg_usage = "Usage: %s [OPTION]... [FILE]...\n\
+A headless RPN Calculator emulator.\n\n\
+  -j  N                    run N jobs at the same time\n\
+  -r  FILE                 read ROM from FILE\n\
+      --script FILE        read keys from FILE (default stdin)\n\
+      --limit N            maximum instructions to run after each key\n\
+      --profile FILE       write an execution profile to FILE\n\
+      --trace FILE         record a trace and write it to FILE\n\
+      --decode FILE        print the trace in FILE and exit\n\
+      --export FILE        write the state to FILE as text\n\
+      --help               display this help and exit\n\
+      --version            output version information and exit\n\n";
+#else
 const char * c_msg_usage = "Usage: %s [OPTION]... [FILE]\n\
 An RPN Calculator emulator for X11.\n\n\
   -b  ADDR                 set break-point (octal)\n\
@@ -308,17 +412,26 @@ An RPN Calculator emulator for X11.\n\n\
   -r  FILE                 read ROM from FILE\n\
   -s,                      single step\n\
   -t,                      trace\n\
+      --speed N|max        run N times faster (or without any limit)\n\
+      --profile FILE       write an execution profile to FILE\n\
+      --trace FILE         record a trace and write it to FILE\n\
+      --map-memory         keep continuous memory in a mapped file\n\
+      --export FILE        write the state to FILE as text\n\
       --zoom ZOOM          enlarge window size\n\
       --cursor             display cursor\n\
       --no-cursor          hide cursor\n\
       --help               display this help and exit\n\
       --version            output version information and exit\n\n";
+#endif
 const char * h_err_invalid_operand = "invalid operand(s)\n";
 const char * h_err_invalid_option = "invalid option -- '%c'\n";
 const char * h_err_unrecognised_option = "unrecognised option '%s'\n";
 const char * h_err_invalid_number = "not an octal number -- '%s' \n";
 const char * h_err_numeric_range = "out of range -- '%s' \n";
 const char * h_err_invalid_argument = "expected argument not -- '%c' \n";
+const char * h_err_invalid_key = "unrecognised key '%s'\n";
+const char * h_err_limit = "instruction limit reached -- '%s'\n";
+const char * h_err_thread = "can't create thread\n";
 #else
 const char * c_msg_usage = "Usage: %s [OPTION...] [FILE]\n\
 An RPN Calculator emulator for X11.\n\n\
@@ -331,6 +444,7 @@ An RPN Calculator emulator for X11.\n\n\
 
 const char * h_err_invalid_operand = "invalid parameter(s)\n";
 const char * h_err_invalid_option = "invalid option %s\n";
+const char * h_err_thread = "can't create thread\n";
 #endif /* Unix */
 
 #endif /* Language */
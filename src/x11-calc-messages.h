@@ -28,6 +28,13 @@
  * 10 Feb 24         - Added an error message to warn the user that the ROM
  *                     contents are empty - MT
  * 16 Feb 24         - Added 'Can't create' error message - MT
+ * 18 Oct 26         - Added error messages for the headless front end - MT
+ *                   - Added thread creation error message - MT
+ *                   - Added invalid snapshot error message - MT
+ *                   - Added invalid memory file error message - MT
+ *                   - Thread error message is used on all platforms - MT
+ *                   - Added the format used to print a ROM location - MT
+ *                   - Added invalid history error message - MT
  *
  */
 
@@ -43,6 +50,7 @@ extern char * h_err_invalid_address;
 extern char * h_err_invalid_register;
 extern char * h_msg_opcode;
 extern char * h_msg_address;
+extern char * h_msg_location;
 
 extern char * h_msg_negative_offset;
 extern char * h_msg_positive_offset;
@@ -57,7 +65,10 @@ extern char * h_err_unrecognised_option;
 extern char * h_err_invalid_number;
 extern char * h_err_numeric_range;
 extern char * h_err_invalid_argument;
+extern char * h_err_invalid_key;
+extern char * h_err_limit;
 #endif
+extern char * h_err_thread;
 
 extern char * h_msg_licence;
 extern char * h_err_display;
@@ -68,3 +79,6 @@ extern char * h_err_font;
 extern char * h_err_creating_file;
 extern char * h_err_memmory_alloc;
 extern const char * h_err_ROM;
+extern const char * h_err_snapshot;
+extern const char * h_err_memory_file;
+extern const char * h_err_history;
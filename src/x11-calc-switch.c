@@ -33,12 +33,14 @@
  *                     warnings - MT
  * 23 Apr 24         - Separated out prototypes for error handlers - MT
  *                   - Removed unnecessary includes - MT
+ * 18 Oct 26         - Drawing functions are not needed in a headless build
+ *                     so don't include the X11 headers - MT
  *
  */
 
 #define NAME           "x11-calc-switch"
-#define BUILD          "0011"
-#define DATE           "23 Apr 24"
+#define BUILD          "0012"
+#define DATE           "18 Oct 26"
 #define AUTHOR         "MT"
 
 #include <errno.h>     /* errno */
@@ -47,8 +49,12 @@
 #include <stdio.h>     /* fprintf(), etc. */
 #include <stdlib.h>    /* malloc(), etc. */
 
+#if defined(HEADLESS)
+#include "x11-calc-headless.h" /* True, False, etc. */
+#else
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc. */
 #include <X11/Xutil.h> /* XSizeHints etc. */
+#endif
 
 #include "x11-calc-messages.h"
 #include "x11-calc-errors.h"
@@ -126,6 +132,7 @@ int i_switch_resize(oswitch *h_switch, float f_scale)
    return(True);
 }
 
+#if !defined(HEADLESS)
 /* switch_draw (display, window, screen, switch) */
 
 int i_switch_draw(Display *h_display, int x_application_window, int i_screen, oswitch *h_switch)
@@ -195,6 +202,7 @@ int i_switch_draw(Display *h_display, int x_application_window, int i_screen, os
    }
    return(True);
 }
+#endif
 
 /* switch_click (display, window, screen, switch) - Updates switch status */
 
@@ -308,6 +308,73 @@
  * 03 May 24         - Sets the abort flag and interval counter immediately
  *                     before the main loop - MT
  * 04 May 24         - Do not define unused switches - MT
+ * 18 Oct 26         - Only calls the instruction decoder that includes the
+ *                     trace output when tracing is enabled - MT
+ *                   - Executes instructions in slices  rather than  one
+ *                     at a time unless tracing or single stepping - MT
+ *                   - The '-b' and '-i' options may be repeated to set as
+ *                     many breakpoints and traps as required - MT
+ *                   - Ctrl-B sets or clears a breakpoint at the  current
+ *                     address - MT
+ *                   - If the ROM is waiting for a key to be pressed  wait
+ *                     for the next X event instead of running the ROM  in
+ *                     a busy loop - MT
+ *                   - Paces  execution using the clock frequency of  the
+ *                     original hardware and an absolute deadline for each
+ *                     interval instead of a fixed delay - MT
+ *                   - Ctrl-P displays the effective speed - MT
+ *                   - Added '--speed' option to run faster than the  real
+ *                     hardware, and Ctrl-F to switch speed - MT
+ *                   - Updates the display at a fixed rate - MT
+ *                   - Uses the time (not the number of intervals) to see
+ *                     if the power switch was held down - MT
+ *                   - Added  '--map-memory' option to keep  continuous
+ *                     memory in a memory mapped file - MT
+ *                   - Only redraws the parts of the display that  have
+ *                     changed, except when the window is exposed - MT
+ *                   - Draws  everything into a pixmap and just copies the
+ *                     parts  that change (or are exposed) to the window -
+ *                     MT
+ *                   - Waits for X events as well as the next interval so
+ *                     that keys are seen immediately, and doesn't wake  up
+ *                     at all while the processor is asleep or off - MT
+ *                   - Runs the processor in its own thread so a slow  X
+ *                     server can't hold up the emulation.  Input is passed
+ *                     to it using a queue and the display is passed  back
+ *                     one frame at a time, without using any locks - MT
+ *                   - Queues  key presses and releases with the cycle  at
+ *                     which the ROM should see them, so every key is held
+ *                     down  (and up) long enough for the ROM to notice it
+ *                     however quickly the keys are pressed - MT
+ *                   - Uses a key map to find the button for each key
+ *                     instead of checking every button - MT
+ *                   - Uses a grid to find the button or switch that  was
+ *                     clicked on instead of checking all of them - MT
+ *                   - Added '--profile' option to write an execution pro-
+ *                     file on exit - MT
+ *                   - Tracing keeps a history of the instructions executed
+ *                     instead of printing each one, which is written to a
+ *                     file using 'Ctrl-D',  when tracing stops, at a break-
+ *                     point, or on exit - MT
+ *                   - Added '--trace' option to set the history file - MT
+ *                   - Ctrl-P works out the speed from the number of word
+ *                     cycles actually executed - MT
+ *                   - Added '--export' option to write the state to a text
+ *                     data file on exit - MT
+ *                   - Input events are never dropped, the event loop waits
+ *                     for room in the queue and the emulator's key queue
+ *                     grows as needed so it can always empty it - MT
+ *                   - Holds each key down until the ROM has read it, and
+ *                     up until the ROM is waiting for the next one, instead
+ *                     of for a fixed number of cycles - MT
+ *                   - The event loop blocks on a pipe until there is room
+ *                     in the event queue instead of polling - MT
+ *                   - Register dumps and the speed are formatted by  the
+ *                     emulator but printed by the event loop, which  also
+ *                     writes the state saved when the power is switched
+ *                     off - MT
+ *                   - Instructions executed one at a time are added to the
+ *                     history and profile as well as being traced - MT
  *
  * To Do             - Parse command line in a separate routine.
  *                   - Add verbose option.
@@ -319,12 +386,46 @@
 
 #define  NAME          "x11-calc"
 #define  VERSION       "0.14"
-#define  BUILD         "0154"
-#define  DATE          "04 May 24"
+#define  BUILD         "0155"
+#define  DATE          "18 Oct 26"
 #define  AUTHOR        "MT"
 
 #define  INTERVAL 25   /* Number of ticks to execute before updating the display */
-#define  DELAY 50      /* Number of intervals to wait before exiting */
+#define  DELAY 2000    /* Number of milliseconds to wait before exiting */
+#define  LATENCY 100   /* Maximum number of milliseconds to catch up by */
+#define  REFRESH 20    /* Number of milliseconds between display updates */
+#define  TURBO 400     /* Number of intervals to run at a time when speed is unlimited */
+#define  SPEED 1000    /* Maximum speed multiplier */
+#define  EVENTS 64     /* Size of the event queue, and initial size of the key queue (must be a power of two) */
+
+#if defined(HP67)
+#define  CLOCK_RATE 184000 /* Approximate clock frequency of the original hardware (Hz) */
+#elif defined(VOYAGER)
+#define  CLOCK_RATE 220000
+#elif defined(SPICE)
+#define  CLOCK_RATE 184000
+#elif defined(WOODSTOCK)
+#define  CLOCK_RATE 184000
+#else
+#define  CLOCK_RATE 196000
+#endif
+
+#define  WORD_TIME (56 * 1000000000LL / CLOCK_RATE) /* Each instruction takes one 56 bit word cycle (ns) */
+
+#define  EVENT_PRESS 1   /* A button was pressed */
+#define  EVENT_RELEASE 2 /* The button was released */
+#define  EVENT_POWER 3   /* The power switch was moved */
+#define  EVENT_MODE 4    /* The mode switch was moved */
+#define  EVENT_CONTROL 5 /* A control key was pressed */
+#define  EVENT_QUIT 6    /* Stop the emulator */
+
+#define  FRAME_NEW 4     /* Set if the frame that is ready hasn't been drawn yet */
+
+#if defined(SWITCHES)
+#define  AREAS (BUTTONS + SWITCHES) /* Buttons then switches */
+#else
+#define  AREAS BUTTONS
+#endif
 
 #include <errno.h>     /* errno */
 
@@ -335,6 +436,10 @@
 
 #include <ctype.h>     /* isprint(), etc */
 
+#include <unistd.h>    /* pipe(), read(), write() */
+#include <fcntl.h>     /* fcntl() */
+#include <pthread.h>   /* pthread_create(), etc */
+
 #include <X11/Xlib.h>  /* XOpenDisplay(), etc */
 #include <X11/Xutil.h> /* XSizeHints etc */
 #include <X11/cursorfont.h>
@@ -347,6 +452,7 @@
 #include "x11-calc-switch.h"
 #include "x11-calc-label.h"
 #include "x11-calc-colour.h"
+#include "x11-calc-grid.h"
 
 #include "x11-calc.h"
 
@@ -357,7 +463,47 @@
 #include "x11-keyboard.h"
 
 #include "gcc-debug.h" /* print() */
-#include "gcc-wait.h"  /* i_wait() */
+#include "gcc-wait.h"  /* i_wait(), i_wait_input(), l_clock() */
+
+typedef struct { /* Input passed from the event loop to the emulator */
+   int type;
+   int value;
+} oevent;
+
+typedef struct { /* Key press or release waiting to be seen by the processor */
+   int type;
+   int code;
+} okey;
+
+typedef struct { /* Shared by the event loop and the emulator thread */
+   oprocessor *processor;
+   odisplay *display;            /* Only used by the emulator to decode the display */
+   char *pathname;
+   char run;                     /* Controls execution of instructions */
+   int speed;                    /* Speed multiplier (zero if unlimited) */
+   int fast;                     /* Speed multiplier selected using Ctrl-F */
+   oevent event[EVENTS];         /* Events waiting for the emulator */
+   unsigned int head;            /* Next event to add (only changed by the event loop) */
+   unsigned int tail;            /* Next event to remove (only changed by the emulator) */
+   oframe frame[3];              /* One frame being written, one being drawn, and one ready */
+   int ready;                    /* Frame that is ready to draw (and FRAME_NEW) */
+   int writing;                  /* Frame being written (only used by the emulator) */
+   int reading;                  /* Frame being drawn (only used by the event loop) */
+   int wake[2];                  /* Pipe used to wake up the emulator */
+   int notify[2];                /* Pipe used to wake up the event loop */
+   int space[2];                 /* Pipe used to tell the event loop there is room in the queue */
+   int waiting;                  /* Set while the event loop is waiting for room in the queue */
+   char *output;                 /* Text waiting to be printed by the event loop (if any) */
+#if defined(SWITCHES) && defined(CONTINIOUS) && defined(SNAPSHOT)
+   osnapshot *snapshot;          /* Processor state waiting to be saved by the event loop (if any) */
+#endif
+   okey *key;                    /* Keys waiting for the processor (only used by the emulator) */
+   unsigned int keys;            /* Size of the key queue (a power of two) */
+   unsigned int first;           /* Next key to pass to the processor */
+   unsigned int last;            /* Next free entry in the key queue */
+   unsigned long changed;        /* Cycle at which the processor last saw a key change */
+   char seen;                    /* Set once the ROM has noticed the last key change */
+} oemulator;
 
 void v_version() /* Display version information */
 {
@@ -384,6 +530,7 @@ void v_error(int i_errno, const char *s_format, ...) /* Print formatted error me
    fprintf(stderr, "%s: ", FILENAME);
    vfprintf(stderr, s_format, t_args);
    va_end(t_args);
+   v_history_fatal(); /* Keep a record of what led to the error */
    exit(i_errno);
 }
 
@@ -397,10 +544,428 @@ void v_set_blank_cursor(Display *x_display, Window x_application_window, Cursor
    XFreePixmap (x_display, x_blank); /* Free up pixmap */
 }
 
+void v_copy_area(Display *x_display, Window x_application_window, Pixmap x_pixmap, GC x_gc, XRectangle o_area) /* Copy part of the window from the pixmap */
+{
+   XCopyArea(x_display, x_pixmap, x_application_window, x_gc, o_area.x - 1, o_area.y - 1,
+      o_area.width + 2, o_area.height + 2, o_area.x - 1, o_area.y - 1); /* Include the outline */
+}
+
+void v_signal(int i_file) /* Wake up a thread waiting for input from a pipe */
+{
+   char c_byte = 0;
+   if (write(i_file, &c_byte, 1) < 0) return; /* If the pipe is full the thread will wake up anyway */
+}
+
+void v_drain(int i_file) /* Discard anything waiting to be read from a pipe */
+{
+   char c_buffer[64];
+   while (read(i_file, c_buffer, sizeof(c_buffer)) > 0);
+}
+
+int i_event_put(oemulator *h_emulator, int i_type, int i_value) /* Add an event to the queue and wake up the emulator */
+{
+   unsigned int i_head = h_emulator->head;
+   if (i_head - __atomic_load_n(&h_emulator->tail, __ATOMIC_ACQUIRE) >= EVENTS) return (False); /* Queue is full */
+   h_emulator->event[i_head % EVENTS].type = i_type;
+   h_emulator->event[i_head % EVENTS].value = i_value;
+   __atomic_store_n(&h_emulator->head, i_head + 1, __ATOMIC_RELEASE);
+   v_signal(h_emulator->wake[1]);
+   return (True);
+}
+
+void v_event_send(oemulator *h_emulator, int i_type, int i_value) /* Add an event to the queue waiting for room if it is full */
+/*
+ * The waiting flag is set before the queue is checked again, and the
+ * emulator checks it after removing an event, so one of them always sees
+ * the other and the event loop can't miss being woken up.
+ */
+{
+   if (i_event_put(h_emulator, i_type, i_value)) return;
+   __atomic_store_n(&h_emulator->waiting, True, __ATOMIC_SEQ_CST);
+   while (!i_event_put(h_emulator, i_type, i_value))
+      if (i_wait_input(h_emulator->space[0], -1)) v_drain(h_emulator->space[0]); /* Block until the emulator has removed an event */
+   __atomic_store_n(&h_emulator->waiting, False, __ATOMIC_SEQ_CST);
+}
+
+int i_event_get(oemulator *h_emulator, oevent *h_event) /* Remove the next event from the queue */
+{
+   unsigned int i_tail = h_emulator->tail;
+   if (i_tail == __atomic_load_n(&h_emulator->head, __ATOMIC_ACQUIRE)) return (False); /* Queue is empty */
+   *h_event = h_emulator->event[i_tail % EVENTS];
+   __atomic_store_n(&h_emulator->tail, i_tail + 1, __ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&h_emulator->waiting, __ATOMIC_SEQ_CST)) v_signal(h_emulator->space[1]); /* There is room for the event loop's next event */
+   return (True);
+}
+
+int i_event_pending(oemulator *h_emulator) /* Check if there are any events in the queue */
+{
+   return (h_emulator->tail != __atomic_load_n(&h_emulator->head, __ATOMIC_ACQUIRE));
+}
+
+void v_frame_publish(oemulator *h_emulator, oframe *h_frame) /* Make a new frame ready for the event loop to draw */
+{
+   int i_ready;
+   h_emulator->frame[h_emulator->writing] = *h_frame;
+   i_ready = __atomic_exchange_n(&h_emulator->ready, h_emulator->writing | FRAME_NEW, __ATOMIC_ACQ_REL);
+   h_emulator->writing = i_ready & ~FRAME_NEW; /* Reuse the frame that was ready */
+   if (!(i_ready & FRAME_NEW)) v_signal(h_emulator->notify[1]); /* The last frame has been drawn so wake up the event loop */
+}
+
+int i_frame_fetch(oemulator *h_emulator) /* Get the newest frame, returns False if it has already been drawn */
+{
+   int i_ready;
+   if (!(__atomic_load_n(&h_emulator->ready, __ATOMIC_ACQUIRE) & FRAME_NEW)) return (False);
+   i_ready = __atomic_exchange_n(&h_emulator->ready, h_emulator->reading, __ATOMIC_ACQ_REL);
+   h_emulator->reading = i_ready & ~FRAME_NEW;
+   return (True);
+}
+
+void v_emulator_print(oemulator *h_emulator, const char *s_format, ...) /* Pass some text to the event loop to print */
+/*
+ * The emulator only formats the text,  writing it to the terminal is left
+ * to the event loop so it can't hold up the processor.
+ */
+{
+   va_list t_args;
+   char *s_text, *s_last;
+   int i_length, i_offset = 0;
+
+   va_start(t_args, s_format);
+   i_length = vsnprintf(NULL, 0, s_format, t_args);
+   va_end(t_args);
+   s_last = __atomic_exchange_n(&h_emulator->output, NULL, __ATOMIC_ACQ_REL); /* Only the emulator ever sets it so nothing else can change it now */
+   if (s_last != NULL) i_offset = strlen(s_last); /* Still waiting to be printed so add to it */
+   if ((s_text = malloc(i_offset + i_length + 1)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   if (s_last != NULL) memcpy(s_text, s_last, i_offset);
+   free(s_last);
+   va_start(t_args, s_format);
+   vsnprintf(&s_text[i_offset], i_length + 1, s_format, t_args);
+   va_end(t_args);
+   __atomic_store_n(&h_emulator->output, s_text, __ATOMIC_RELEASE);
+   v_signal(h_emulator->notify[1]);
+}
+
+void v_emulator_collect(oemulator *h_emulator) /* Print any text and save any state passed back by the emulator */
+{
+   char *s_text;
+#if defined(SWITCHES) && defined(CONTINIOUS) && defined(SNAPSHOT)
+   osnapshot *h_snapshot;
+   if ((h_snapshot = __atomic_exchange_n(&h_emulator->snapshot, NULL, __ATOMIC_ACQ_REL)) != NULL)
+   {
+      v_save_snapshot(h_emulator->processor, h_snapshot);
+      free(h_snapshot);
+   }
+#endif
+   if ((s_text = __atomic_exchange_n(&h_emulator->output, NULL, __ATOMIC_ACQ_REL)) != NULL)
+   {
+      fputs(s_text, stdout);
+      fflush(stdout);
+      free(s_text);
+   }
+}
+
+void v_key_put(oemulator *h_emulator, int i_type, int i_code) /* Add a key to the queue */
+{
+   okey *h_key, *h_keys;
+   unsigned int i_count;
+   if (h_emulator->last - h_emulator->first >= h_emulator->keys) /* Queue is full so make it bigger */
+   {
+      if ((h_keys = malloc(sizeof(*h_keys) * h_emulator->keys * 2)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+      for (i_count = 0; i_count < h_emulator->keys; i_count++) /* Keep the keys in order */
+         h_keys[i_count] = h_emulator->key[(h_emulator->first + i_count) % h_emulator->keys];
+      free(h_emulator->key);
+      h_emulator->key = h_keys;
+      h_emulator->first = 0;
+      h_emulator->last = h_emulator->keys;
+      h_emulator->keys *= 2;
+   }
+   h_key = &h_emulator->key[h_emulator->last % h_emulator->keys];
+   h_key->type = i_type;
+   h_key->code = i_code;
+   h_emulator->last++;
+}
+
+void v_key_seen(oemulator *h_emulator, int i_stop) /* Check if the ROM has noticed the last key change */
+{
+   if (i_key_seen(h_emulator->processor, i_stop)) h_emulator->seen = True;
+}
+
+long l_key_apply(oemulator *h_emulator) /* Pass any keys that are due to the processor, returns cycles until the next one */
+/*
+ * Each key press is held until the ROM has read the key, and each release
+ * lasts until the ROM is waiting for the next key, so keys can be typed as
+ * quickly as the ROM can accept them.  A key changes anyway after a fixed
+ * number of cycles in case the ROM never reads the keyboard in the expected
+ * way.
+ */
+{
+   oprocessor *h_processor = h_emulator->processor;
+   while (h_emulator->first != h_emulator->last)
+   {
+      okey *h_key = &h_emulator->key[h_emulator->first % h_emulator->keys];
+      long l_remaining = (long) (h_emulator->changed + (h_emulator->seen ? HOLD : HOLD_LIMIT) - h_processor->ticks);
+      if ((l_remaining > 0) && h_processor->enabled && !h_processor->sleep)
+         return (l_remaining); /* Not due yet (unless the processor is asleep so isn't scanning the keys) */
+      if (h_key->type == EVENT_PRESS)
+      {
+         h_processor->code = h_key->code;
+         h_processor->keypressed = True;
+#if !defined(SWITCHES)
+         h_processor->enabled = True; /* Any key press wil wake up the processor */
+         h_processor->sleep = False;
+#endif
+      }
+      else
+         h_processor->keypressed = False; /* Don't clear the status bit here!! */
+      h_emulator->changed = h_processor->ticks;
+      h_emulator->seen = False;
+      h_emulator->first++;
+   }
+   return (0);
+}
+
+void v_emulator_update(oemulator *h_emulator, oframe *h_frame) /* Publish the display if it has changed since the last frame */
+{
+   i_display_update(h_emulator->display, h_emulator->processor);
+   if (i_display_save(h_emulator->display, h_frame)) v_frame_publish(h_emulator, h_frame);
+}
+
+void v_emulator_wait(oemulator *h_emulator, long long l_deadline) /* Wait until the deadline or the next event */
+{
+   if (i_wait_input(h_emulator->wake[0], l_deadline)) v_drain(h_emulator->wake[0]);
+}
+
+void *h_emulator_run(void *h_context) /* Runs the processor in its own thread until told to quit */
+{
+   oemulator *h_emulator = h_context;
+   oprocessor *h_processor = h_emulator->processor;
+   oevent o_event;
+   oframe o_frame;               /* Last frame published */
+   char b_quit = False;
+   int i_count = 0;
+   long long l_refresh;          /* Time to next update the display */
+   long long l_deadline;         /* Time to start the next interval */
+   long long l_start;            /* Start of the current speed measurement */
+   long long l_blocked = 0;      /* Time spent waiting for a key since the start */
+   long l_waiting = 0;           /* Cycles until the next key is due (zero if none) */
+   unsigned long i_executed;     /* Instructions executed before the start */
+#if defined(SWITCHES) && defined(CONTINIOUS) && defined(SNAPSHOT)
+   osnapshot o_saved;            /* Last state saved (the event loop may not have written it yet) */
+   osnapshot *h_snapshot;
+   char b_saved = False;
+#endif
+
+   memset(&o_frame, -1, sizeof(o_frame)); /* Make sure the first frame is published */
+   i_executed = h_processor->ticks;
+   l_deadline = l_refresh = l_start = l_clock();
+   while (!b_quit)
+   {
+      while (i_event_get(h_emulator, &o_event)) /* Handle any input passed on by the event loop */
+      {
+         switch (o_event.type)
+         {
+         case EVENT_PRESS:
+         case EVENT_RELEASE:
+            v_key_put(h_emulator, o_event.type, o_event.value); /* Keys are queued until the ROM is ready for them */
+            break;
+#if defined(SWITCHES)
+         case EVENT_POWER:
+            if (o_event.value)
+            {
+               v_processor_reset(h_processor); /* Reset the processor */
+#if defined(SWITCHES) && defined(CONTINIOUS) && defined(SNAPSHOT)
+               if (b_saved)
+                  v_restore_snapshot(h_processor, &o_saved); /* Restore the settings saved when it was switched off */
+               else
+#endif
+               v_restore_state(h_processor); /* Restore saved settings */
+            }
+            else
+            {
+#if defined(SWITCHES) && defined(CONTINIOUS) && defined(SNAPSHOT)
+               v_take_snapshot(h_processor, &o_saved); /* Save current settings, but leave writing them to the event loop */
+               b_saved = True;
+               if ((h_snapshot = malloc(sizeof(*h_snapshot))) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+               *h_snapshot = o_saved;
+               free(__atomic_exchange_n(&h_emulator->snapshot, h_snapshot, __ATOMIC_ACQ_REL)); /* Replaces any older state that hasn't been written yet */
+               v_signal(h_emulator->notify[1]);
+#else
+               v_save_state(h_processor); /* Save current settings */
+#endif
+               h_processor->enabled = False; /* Disable the processor */
+            }
+            break;
+         case EVENT_MODE:
+            h_processor->mode = o_event.value; /* Update prgm/run switch */
+            break;
+#endif
+         case EVENT_CONTROL:
+            switch (o_event.value)
+            {
+            case XK_Q & 0x1f: /* Ctrl-Q to resume */
+               h_processor->trace = h_processor->step = !(h_emulator->run = True);
+               break;
+            case XK_S & 0x1f: /* Ctrl-S or space to single step */
+               h_processor->trace = h_processor->step = h_emulator->run = True;
+               break;
+            case XK_T & 0x1f: /* Ctrl-T to toggle tracing */
+               if (h_processor->record)
+               {
+                  h_processor->record = False;
+                  v_history_write(h_processor); /* Write the history when tracing stops */
+               }
+               else
+                  v_history_start(h_processor, NULL);
+               break;
+            case XK_D & 0x1f: /* Ctrl-D to write the history */
+               v_history_write(h_processor);
+               break;
+            case XK_R & 0x1f: /* Ctrl-R to display internal CPU registers */
+               {
+                  char *s_text;
+                  size_t i_size;
+                  FILE *h_file;
+                  if ((h_file = open_memstream(&s_text, &i_size)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+                  v_fprint_registers(h_file, h_processor);
+                  fclose(h_file);
+                  v_emulator_print(h_emulator, "%s", s_text);
+                  free(s_text);
+               }
+               break;
+            case XK_F & 0x1f: /* Ctrl-F to switch between normal and fast speed */
+               h_emulator->speed = (h_emulator->speed == 1) ? h_emulator->fast : 1;
+               l_deadline = l_clock();
+               if (h_emulator->speed == 1)
+                  fprintf(stderr, "** normal speed **\n");
+               else if (h_emulator->speed > 0)
+                  fprintf(stderr, "** speed x%d **\n", h_emulator->speed);
+               else
+                  fprintf(stderr, "** maximum speed **\n");
+               break;
+            case XK_P & 0x1f: /* Ctrl-P to display the speed since the last time */
+               {
+                  long long l_now = l_clock();
+                  double d_elapsed = (l_now - l_start - l_blocked) / 1e9;
+                  double d_words = h_processor->ticks - i_executed; /* Each instruction takes one word cycle */
+                  if (d_elapsed > 0)
+                     v_emulator_print(h_emulator, "Speed: %.0f words/s (%.1f%%)\n",
+                        d_words / d_elapsed, d_words * WORD_TIME / 1e7 / d_elapsed);
+                  i_executed = h_processor->ticks;
+                  l_start = l_now;
+                  l_blocked = 0;
+               }
+               break;
+            case XK_B & 0x1f: /* Ctrl-B to set or clear a breakpoint at the current address */
+               v_breakpoint(h_processor, h_processor->pc, !i_breakpoint(h_processor, h_processor->pc));
+               if (i_breakpoint(h_processor, h_processor->pc))
+                  fprintf(stderr, "** break-point set **\n");
+               else
+                  fprintf(stderr, "** break-point cleared **\n");
+               break;
+            case XK_C & 0x1f: /* Ctrl-C to reset */
+               v_processor_reset(h_processor);
+#if defined(SWITCHES) && defined(CONTINIOUS) && defined(SNAPSHOT)
+               if ((h_emulator->pathname == NULL) && b_saved)
+                  v_restore_snapshot(h_processor, &o_saved); /* The saved settings may not have been written yet */
+               else
+#endif
+               if (h_emulator->pathname == NULL)
+                  v_restore_state(h_processor); /* Load current saved settings */
+               else
+                  v_read_state(h_processor, h_emulator->pathname); /* Load user specified settings */
+               h_emulator->run = True;
+               break;
+            }
+            break;
+         case EVENT_QUIT:
+            b_quit = True;
+            break;
+         }
+      }
+      if (b_quit) break;
+      l_waiting = l_key_apply(h_emulator);
+
+      if (i_count <= 0)
+      {
+         long long l_now = l_clock();
+         if (l_now >= l_refresh) /* Update the display at a fixed rate whatever the speed */
+         {
+            v_emulator_update(h_emulator, &o_frame);
+            l_refresh = l_now + REFRESH * 1000000LL;
+         }
+         if (h_emulator->speed > 0)
+         {
+            i_count = INTERVAL * h_emulator->speed; /* Run more instructions in the same time to go faster */
+            l_deadline += INTERVAL * WORD_TIME; /* Each interval starts a fixed time after the last one */
+            if (l_now - l_deadline > LATENCY * 1000000LL)
+               l_deadline = l_now; /* Too far behind to catch up so start again from now */
+            else
+               v_emulator_wait(h_emulator, l_deadline); /* Sleep for whatever is left of this interval or until an event arrives */
+         }
+         else
+         {
+            i_count = INTERVAL * TURBO; /* Don't wait at all */
+            l_deadline = l_now;
+         }
+      }
+      if (h_emulator->run && !h_processor->trace) /* Execute the rest of this interval in one go */
+      {
+         unsigned long i_ticks = h_processor->ticks;
+         int i_stop = i_processor_run(h_processor, ((l_waiting > 0) && (l_waiting < i_count)) ? (int) l_waiting : i_count); /* Stop when the next key is due */
+         i_count -= (int) (h_processor->ticks - i_ticks);
+         v_key_seen(h_emulator, i_stop);
+         switch (i_stop)
+         {
+         case STOP_SLEEP: /* Nothing will change until a key is pressed or a switch is moved */
+         case STOP_IDLE: /* Nothing will change until a key is pressed */
+            v_emulator_update(h_emulator, &o_frame);
+            if (!i_event_pending(h_emulator) && (h_emulator->first == h_emulator->last)) /* Unless there are keys waiting */
+            {
+               long long l_now = l_clock();
+               v_emulator_wait(h_emulator, -1); /* Block until the next event arrives */
+               l_deadline = l_clock(); /* The time spent waiting doesn't need to be caught up */
+               l_blocked += l_deadline - l_now;
+            }
+            if (i_stop == STOP_SLEEP) i_count = 0;
+            break;
+         case STOP_DISPLAY: /* Show the change immediately */
+            v_emulator_update(h_emulator, &o_frame);
+            break;
+         case STOP_BREAKPOINT:
+            fprintf(stderr, "** break **\n");
+            if (h_processor->record) v_history_write(h_processor); /* Show how it got here */
+            h_processor->trace = h_processor->step = True;
+            break;
+         }
+      }
+      else
+      {
+         i_count--;
+         if (i_processor_break(h_processor)) /* Check for Breakpoint or Instruction Trap */
+         {
+            if (!h_processor->trace || !h_processor->step) fprintf(stderr, "** break **\n");
+            h_processor->trace = h_processor->step = True;
+         }
+         if (h_emulator->run) v_processor_step(h_processor); /* Only trace execution when necessary */
+         else
+         {
+            v_emulator_update(h_emulator, &o_frame); /* Show the display while stopped */
+            if (!i_event_pending(h_emulator)) v_emulator_wait(h_emulator, -1); /* Nothing to do until the next event */
+            i_count = 0;
+         }
+      }
+      if (h_processor->step) h_emulator->run = False;
+   }
+   return (NULL);
+}
+
 int main(int argc, char *argv[])
 {
    Display *x_display; /* Pointer to X display structure */
    Window x_application_window; /* Application window structure */
+   Pixmap x_pixmap; /* Copy of the window contents */
+   GC x_gc; /* Used to copy the pixmap to the window */
+   XGCValues x_values;
    Cursor x_cursor; /* Application cursor */
    XEvent x_event;
    XSizeHints *h_size_hint;
@@ -409,12 +974,21 @@ int main(int argc, char *argv[])
    XRectangle o_window_geometry;
    obutton *h_button[BUTTONS]; /* Array to hold pointers to buttons */
    obutton *h_pressed = NULL;
+   obutton *h_keymap[KEYS];      /* Button for each key */
+   XRectangle o_area[AREAS];     /* Position of each button and switch */
+   ogrid *h_grid;                /* Used to find the button or switch at a point */
+   int i_area;
    odisplay *h_display; /* Pointer to display structure */
    oprocessor *h_processor;
 
    char *s_display_name = ""; /* Just use the default display */
    char *s_title = TITLE; /* Windows title */
    char *s_pathname = NULL;
+   char *s_profile = NULL; /* Execution profile */
+   char *s_trace = NULL; /* Where to write the history */
+#if defined(CONTINIOUS)
+   char *s_export = NULL; /* Where to write the state as text */
+#endif
 
    int i_window_top; /* Window top */
    int i_window_left; /* Window left */
@@ -433,15 +1007,22 @@ int main(int argc, char *argv[])
 
    char b_trace = False;         /* Trace flag */
    char b_step = False;          /* Single step flag flag */
+   char b_record = False;        /* Record a history of the instructions executed */
    char b_cursor = True;         /* Draw a cursor */
-   char b_run = True;            /* Run flag controls CPU instruction execution in main loop */
    char b_abort = False;         /*Abort flag controls execution of main loop */
+#if defined(CONTINIOUS)
+   char b_mapped = False;        /* Keep memory in a memory mapped file */
+#endif
 
    int i_offset, i_count, i_index;
    int i_zoom = 0;               /* Zoom level */
-   int i_breakpoint = -1;        /* Break-point */
-   int i_trap = -1;              /* Trap instruction */
-   int i_ticks = -1;
+   int i_value;                  /* Break-point or trap instruction */
+   int i_speed = 1;              /* Speed multiplier (zero if unlimited) */
+   int i_fast = 0;               /* Speed multiplier selected using Ctrl-F */
+   long long l_timeout = 0;      /* Time to exit if the power switch is held down */
+   int i_files[2];               /* Inputs to wait for */
+   oemulator o_emulator;         /* Shared with the emulator thread */
+   pthread_t x_thread;           /* Runs the emulator */
 
 #if defined(SWITCHES)
    oswitch *h_switch[SWITCHES];
@@ -473,17 +1054,18 @@ int main(int argc, char *argv[])
                else
                   if (i_count + 1 < argc)
                   {
-                     i_breakpoint = 0;
+                     i_value = 0;
                      for (i_offset = 0; i_offset < strlen(argv[i_count + 1]); i_offset++) /* Parse octal number */
                      {
                         if ((argv[i_count + 1][i_offset] < '0') || (argv[i_count + 1][i_offset] > '7'))
                            v_error(EINVAL, h_err_invalid_number, argv[i_count + 1]);
                         else
-                           i_breakpoint = i_breakpoint * 8 + argv[i_count + 1][i_offset] - '0';
+                           i_value = i_value * 8 + argv[i_count + 1][i_offset] - '0';
                      }
-                     if ((i_breakpoint < 0)  || (i_breakpoint > ROM_SIZE) || (i_breakpoint > 07777)) /* Check address range */
+                     if ((i_value < 0)  || (i_value >= ROM_SIZE)) /* Check address range */
                         v_error(EINVAL, h_err_numeric_range, argv[i_count + 1]);
                      else {
+                        v_breakpoint(h_processor, i_value, True); /* Add to the existing breakpoints */
                         if (i_count + 2 < argc) /* Remove the parameter from the arguments */
                            for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
                               argv[i_offset] = argv[i_offset + 1];
@@ -500,18 +1082,19 @@ int main(int argc, char *argv[])
                else
                   if (i_count + 1 < argc)
                   {
-                     i_trap = 0;
+                     i_value = 0;
                      for (i_offset = 0; i_offset < strlen(argv[i_count + 1]); i_offset++) /* Parse octal number */
                      {
                         if ((argv[i_count + 1][i_offset] < '0') || (argv[i_count + 1][i_offset] > '7'))
                            v_error(EINVAL, h_err_invalid_number, argv[i_count + 1]);
                         else
-                           i_trap = i_trap * 8 + argv[i_count + 1][i_offset] - '0';
+                           i_value = i_value * 8 + argv[i_count + 1][i_offset] - '0';
                      }
-                     if ((i_trap < 0) || (i_trap > 01777)) /* Check range */
+                     if ((i_value < 0) || (i_value >= TRAPS)) /* Check range */
                         v_error(EINVAL, h_err_numeric_range, argv[i_count + 1]);
                      else
                      {
+                        v_trap(h_processor, i_value, True); /* Add to the existing traps */
                         if (i_count + 2 < argc) /* Remove the parameter from the arguments */
                            for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
                               argv[i_offset] = argv[i_offset + 1];
@@ -542,7 +1125,7 @@ int main(int argc, char *argv[])
                b_trace = b_step = True;
                break;
             case 't': /* Enable tracing */
-               b_trace = True;
+               b_record = True;
                break;
             case '-': /* '--' terminates command line processing */
                i_index = strlen(argv[i_count]);
@@ -575,6 +1158,79 @@ int main(int argc, char *argv[])
                      else
                         v_error(EINVAL, h_err_missing_argument, argv[i_count]);
                   }
+                  else if (!strncmp(argv[i_count], "--speed", i_index))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        if (!strcmp(argv[i_count + 1], "max"))
+                           i_speed = 0; /* Run as fast as possible */
+                        else
+                        {
+                           i_speed = 0;
+                           for (i_offset = 0; i_offset < strlen(argv[i_count + 1]); i_offset++) /* Parse decimal number */
+                           {
+                              if ((argv[i_count + 1][i_offset] < '0') || (argv[i_count + 1][i_offset] > '9'))
+                                 v_error(EINVAL, h_err_numeric_range, argv[i_count + 1]);
+                              else if (i_speed <= SPEED)
+                                 i_speed = i_speed * 10 + argv[i_count + 1][i_offset] - '0';
+                           }
+                           if ((i_speed < 1) || (i_speed > SPEED)) /* Check range */
+                              v_error(EINVAL, h_err_numeric_range, argv[i_count + 1]);
+                        }
+                        if (i_speed != 1) i_fast = i_speed; /* Ctrl-F switches between this and normal speed */
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+                  else if (!strncmp(argv[i_count], "--trace", i_index))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        s_trace = argv[i_count + 1];
+                        b_record = True; /* Enable tracing */
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+                  else if (!strncmp(argv[i_count], "--profile", i_index))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        s_profile = argv[i_count + 1];
+                        v_profile_start(h_processor); /* Count instructions as they are executed */
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+#if defined(CONTINIOUS)
+                  else if (!strncmp(argv[i_count], "--map-memory", i_index))
+                     b_mapped = True; /* Keep memory in a memory mapped file */
+                  else if (!strncmp(argv[i_count], "--export", i_index))
+                  {
+                     if (i_count + 1 < argc)
+                     {
+                        s_export = argv[i_count + 1];
+                        if (i_count + 2 < argc) /* Remove the parameter from the arguments */
+                           for (i_offset = i_count + 1; i_offset < argc - 1; i_offset++)
+                              argv[i_offset] = argv[i_offset + 1];
+                        argc--;
+                     }
+                     else
+                        v_error(EINVAL, h_err_missing_argument, argv[i_count]);
+                  }
+#endif
                   else if (!strncmp(argv[i_count], "--no-cursor", i_index))
                      b_cursor = False; /* Don't draw a cursor - unless drawn by the window manager */
                   else if (!strncmp(argv[i_count], "--cursor", i_index))
@@ -622,7 +1278,7 @@ int main(int argc, char *argv[])
          else if (!strncmp(argv[i_count], "/NOCURSOR", i_index))
             b_trace = False; /* Enable tracing */
          else if (!strncmp(argv[i_count], "/TRACE", i_index))
-            b_trace = True; /* Enable tracing */
+            b_record = True; /* Enable tracing */
          else if (!strncmp(argv[i_count], "/ROM", i_index))
          {
             if (i_count + 1 < argc)
@@ -733,6 +1389,7 @@ int main(int argc, char *argv[])
       DISPLAY_BACKGROUND, BEZEL_COLOUR); /* Create display */
 
    v_init_buttons(h_button); /* Create buttons */
+   i_button_map(h_keymap, h_button, BUTTONS); /* Map keys to buttons */
 
 #if defined(SWITCHES)
    v_init_switches(h_switch);
@@ -772,10 +1429,46 @@ int main(int argc, char *argv[])
       i_label_resize(h_label[i_count], f_scale);
 #endif
 
+   for (i_count = 0; i_count < AREAS; i_count++) /* Index the new positions of the buttons and switches */
+   {
+      if (i_count < BUTTONS)
+      {
+         if (h_button[i_count] != NULL) o_area[i_count] = h_button[i_count]->button_position;
+         else o_area[i_count].width = o_area[i_count].height = 0;
+      }
+#if defined(SWITCHES)
+      else
+      {
+         if (h_switch[i_count - BUTTONS] != NULL) o_area[i_count] = h_switch[i_count - BUTTONS]->switch_position;
+         else o_area[i_count].width = o_area[i_count].height = 0;
+      }
+#endif
+   }
+   h_grid = h_grid_create(AREAS);
+   i_grid_build(h_grid, o_area, o_window_position.width, o_window_position.height);
+
 #if defined(__linux__) || defined(__NetBSD__) || defined(__FreeBSD__)
    h_keyboard = h_keyboard_create(x_display); /* Only works with Linux */
 #endif
 
+   x_pixmap = XCreatePixmap(x_display, x_application_window, o_window_position.width, o_window_position.height, i_colour_depth);
+   x_values.graphics_exposures = False; /* The pixmap is never obscured */
+   x_gc = XCreateGC(x_display, x_application_window, GCGraphicsExposures, &x_values);
+
+   XSetForeground(x_display, DefaultGC(x_display, i_screen), i_background_colour); /* Draw everything into the pixmap */
+   XFillRectangle(x_display, x_pixmap, DefaultGC(x_display, i_screen), 0, 0, o_window_position.width, o_window_position.height);
+   i_display_draw(x_display, x_pixmap, i_screen, h_display);/* Draw display */
+#if defined(LABELS)
+   for (i_count = 0; i_count < LABELS; i_count++) /* Draw labels */
+      i_label_draw(x_display, x_pixmap, i_screen, h_label[i_count]);
+#endif
+#if defined(SWITCHES)
+   for (i_count = 0; i_count < SWITCHES; i_count++) /* Draw switches */
+      i_switch_draw(x_display, x_pixmap, i_screen, h_switch[i_count]);
+#endif
+   for (i_count = 0; i_count < BUTTONS; i_count++) /* Draw buttons */
+      i_button_draw(x_display, x_pixmap, i_screen, h_button[i_count]);
+
    XSelectInput(x_display, x_application_window, FocusChangeMask | ExposureMask | /* Select kind of events we are interested in */
       KeyPressMask | KeyReleaseMask | ButtonPressMask |
       ButtonReleaseMask | StructureNotifyMask | SubstructureNotifyMask);
@@ -791,46 +1484,65 @@ int main(int argc, char *argv[])
 
    h_processor->trace = b_trace;
    h_processor->step = b_step;
+   v_history_catch(h_processor); /* Write the history on a signal (if one is being kept) */
+   if (b_record) v_history_start(h_processor, s_trace); /* Keep a history of the instructions executed */
 
    if (s_pathname == NULL)
       v_restore_state(h_processor);
    else
       v_read_state(h_processor, s_pathname); /* Load user specified settings */
+#if defined(CONTINIOUS)
+   if (b_mapped) v_map_memory(h_processor, (s_pathname != NULL)); /* Memory loaded from a file given on the command line replaces the memory file */
+#endif
 
 #if defined(SWITCHES)
    h_processor->enabled = h_switch[0]->state; /* Allow switches to be undefined if not used */
    if (SWITCHES == 2) h_processor->mode = h_switch[1]->state;
 #endif
 
+   memset(&o_emulator, 0, sizeof(o_emulator)); /* Set up the emulator */
+   o_emulator.processor = h_processor;
+   o_emulator.display = h_display_create(0, BEZEL_LEFT, BEZEL_TOP, BEZEL_WIDTH, BEZEL_HEIGHT,
+      DISPLAY_LEFT, DISPLAY_TOP, DISPLAY_WIDTH, DISPLAY_HEIGHT, DIGIT_COLOUR, DIGIT_BACKGROUND,
+      DISPLAY_BACKGROUND, BEZEL_COLOUR); /* Never drawn, just holds the display while it is decoded */
+   o_emulator.pathname = s_pathname;
+   o_emulator.run = True;
+   o_emulator.speed = i_speed;
+   o_emulator.fast = i_fast;
+   o_emulator.seen = True; /* No keys have changed yet */
+   o_emulator.keys = EVENTS;
+   if ((o_emulator.key = malloc(sizeof(*o_emulator.key) * o_emulator.keys)) == NULL) v_error(errno, h_err_memmory_alloc, __FILE__, __LINE__);
+   o_emulator.writing = 0;
+   o_emulator.ready = 1;
+   o_emulator.reading = 2;
+   if ((pipe(o_emulator.wake) != 0) || (pipe(o_emulator.notify) != 0) || (pipe(o_emulator.space) != 0)) v_error(errno, h_err_thread);
+   for (i_count = 0; i_count < 2; i_count++) /* Neither thread should ever block on a pipe */
+   {
+      fcntl(o_emulator.wake[i_count], F_SETFL, O_NONBLOCK);
+      fcntl(o_emulator.notify[i_count], F_SETFL, O_NONBLOCK);
+      fcntl(o_emulator.space[i_count], F_SETFL, O_NONBLOCK);
+   }
+   if ((errno = pthread_create(&x_thread, NULL, h_emulator_run, &o_emulator)) != 0) v_error(errno, h_err_thread);
+
    b_abort = False;
-   i_count = 0;
+   i_files[0] = ConnectionNumber(x_display);
+   i_files[1] = o_emulator.notify[0];
    while (!b_abort) /* Main program event loop */
    {
-      i_count--;
-      if (i_count < 0)
+      if (!XPending(x_display)) /* Also flushes any output */
       {
-         i_display_update(h_display, h_processor);
-         i_display_draw(x_display, x_application_window, i_screen, h_display); /* Redraw display */
-         i_count = INTERVAL;
-#if defined(HP67)
-         i_wait(INTERVAL / 4); /* Sleep for ~6.25 ms per tick */
-#elif defined(VOYAGER)
-         i_wait(INTERVAL / 3); /* Sleep for ~8.33 ms per tick */
-#elif defined(SPICE)
-         i_wait(INTERVAL / 3); /* Sleep for ~8.33 ms per tick */
-#else
-         i_wait(INTERVAL / 2); /* Sleep for ~12.5 ms per tick */
-#endif
-         if (i_ticks > 0) i_ticks -= 1;
-         if (i_ticks == 0) b_abort = True;
+         if (i_wait_inputs(i_files, 2, (l_timeout != 0) ? l_timeout : -1) & 2) /* Wait for an event or a new frame */
+            v_drain(o_emulator.notify[0]);
+         if ((l_timeout != 0) && (l_clock() > l_timeout)) b_abort = True; /* The power switch was held down */
       }
-      if (((h_processor->pc & 0xfff) == i_breakpoint) || (h_processor->rom[h_processor->pc] == i_trap)) /* Check for Breakpoint or Instruction Trap */
+
+      if (i_frame_fetch(&o_emulator)) /* Draw any digits that have changed in the latest frame */
       {
-         if (!h_processor->trace || !h_processor->step) fprintf(stderr, "** break **\n");
-         h_processor->trace = h_processor->step = True;
+         i_display_load(h_display, &o_emulator.frame[o_emulator.reading]);
+         if (i_display_refresh(x_display, x_pixmap, i_screen, h_display))
+            v_copy_area(x_display, x_application_window, x_pixmap, x_gc, h_display->bezel_position);
       }
-      if (b_run) v_processor_tick(h_processor);
-      if (h_processor->step) b_run = False;
+      v_emulator_collect(&o_emulator); /* Print or save anything the emulator has passed back */
 
       while (XPending(x_display))
       {
@@ -841,63 +1553,40 @@ int main(int argc, char *argv[])
             if (!(h_pressed == NULL))
             {
                h_pressed->state = False;
-               i_button_draw(x_display, x_application_window, i_screen, h_pressed);
-               h_processor->keypressed = False; /* Don't clear the status bit here!! */
+               i_button_draw(x_display, x_pixmap, i_screen, h_pressed);
+               v_copy_area(x_display, x_application_window, x_pixmap, x_gc, h_pressed->button_position);
+               v_event_send(&o_emulator, EVENT_RELEASE, h_pressed->index);
             }
             break;
 #if defined(__linux__) || defined(__NetBSD__) || defined(__FreeBSD__)
          case KeyPress :
             h_key_pressed(h_keyboard, x_display, x_event.xkey.keycode, x_event.xkey.state); /* Attempts to translate a key code into a character */
-            if (h_keyboard->key == (XK_BackSpace & 0x1f)) h_keyboard->key = XK_Escape & 0x1f; /* Map backspace to escape */
             if (h_keyboard->key == (XK_Z & 0x1f)) /* Ctrl-Z to exit */
                b_abort = True;
-            else if (h_keyboard->key == (XK_Q & 0x1f)) /* Ctrl-Q to resume */
-               h_processor->step = !(b_run  = True);
-            else if (h_keyboard->key == (XK_S & 0x1f)) /* Ctrl-S or space to single step */
-               h_processor->trace = h_processor->step = b_run = True;
-            else if (h_keyboard->key == (XK_T & 0x1f)) /* Ctrl-T to toggle tracing */
-               h_processor->trace = !h_processor->trace;
-            else if (h_keyboard->key == (XK_R & 0x1f)) /* Ctrl-R to display internal CPU registers */
-               v_fprint_registers(stdout, h_processor);
-            else if (h_keyboard->key == (XK_C & 0x1f)) /* Ctrl-C to reset */
+            else if ((h_keyboard->key == (XK_Q & 0x1f)) || (h_keyboard->key == (XK_S & 0x1f)) ||
+               (h_keyboard->key == (XK_T & 0x1f)) || (h_keyboard->key == (XK_R & 0x1f)) ||
+               (h_keyboard->key == (XK_F & 0x1f)) || (h_keyboard->key == (XK_P & 0x1f)) ||
+               (h_keyboard->key == (XK_B & 0x1f)) || (h_keyboard->key == (XK_C & 0x1f)) ||
+               (h_keyboard->key == (XK_D & 0x1f)))
+               v_event_send(&o_emulator, EVENT_CONTROL, h_keyboard->key); /* Let the emulator deal with it */
+            else if ((h_pressed = h_keymap[(unsigned char) h_keyboard->key]) != NULL) /* Look up the matching button */
             {
-               v_processor_reset(h_processor);
-               if (s_pathname == NULL)
-                  v_restore_state(h_processor); /* Load current saved settings */
-               else
-                  v_read_state(h_processor, s_pathname); /* Load user specified settings */
-               b_run = True;
-            }
-            else { /* Check for matching button */
-               int i_count;
-               for (i_count = 0; i_count < BUTTONS; i_count++)
-               {
-                  h_pressed = h_button_key_pressed(h_button[i_count], h_keyboard->key);
-                  if (h_pressed != NULL)
-                  {
-                     h_pressed->state = True;
-                     i_button_draw(x_display, x_application_window, i_screen, h_pressed);
-                     h_processor->code = h_pressed->index;
-                     h_processor->keypressed = True;
-#if !defined(SWITCHES)
-                     h_processor->enabled = True; /* Any key press wil wake up the processor */
-                     h_processor->sleep = False;
-#endif
-                     break;
-                  }
-               }
+               h_pressed->state = True;
+               i_button_draw(x_display, x_pixmap, i_screen, h_pressed);
+               v_copy_area(x_display, x_application_window, x_pixmap, x_gc, h_pressed->button_position);
+               v_event_send(&o_emulator, EVENT_PRESS, h_pressed->index);
             }
             break;
          case KeyRelease :
             h_key_released(h_keyboard, x_display, x_event.xkey.keycode, x_event.xkey.state);
-            if (h_keyboard->key == (XK_BackSpace & 0x1f)) h_keyboard->key = XK_Escape & 0x1f; /* Map backspace to escape */
             if (h_pressed != NULL)
             {
-               if (h_keyboard->key == h_pressed->key)
+               if (h_keymap[(unsigned char) h_keyboard->key] == h_pressed) /* Any key that maps to the button */
                {
                   h_pressed->state = False;
-                  i_button_draw(x_display, x_application_window, i_screen, h_pressed);
-                  h_processor->keypressed = False; /* Don't clear the status bit here!! */
+                  i_button_draw(x_display, x_pixmap, i_screen, h_pressed);
+                  v_copy_area(x_display, x_application_window, x_pixmap, x_gc, h_pressed->button_position);
+                  v_event_send(&o_emulator, EVENT_RELEASE, h_pressed->index);
                }
             }
             break;
@@ -906,54 +1595,31 @@ int main(int argc, char *argv[])
             debug(printf("Mouse button [%d] pressed.\n", x_event.xbutton.button));
             if (x_event.xbutton.button == 1)
             {
-               int i_count;
-               for (i_count = 0; i_count < sizeof(h_button) / sizeof(*h_button); i_count++)
+               i_area = i_grid_find(h_grid, x_event.xbutton.x, x_event.xbutton.y); /* Find what was clicked on */
+               h_pressed = ((i_area >= 0) && (i_area < BUTTONS)) ? h_button[i_area] : NULL;
+               if (!(h_pressed == NULL))
                {
-                  h_pressed = h_button_pressed(h_button[i_count], x_event.xbutton.x, x_event.xbutton.y);
-                  if (!(h_pressed == NULL))
-                  {
-                     h_pressed->state = True;
-                     i_button_draw(x_display, x_application_window, i_screen, h_pressed);
-                     h_processor->code = h_pressed->index;
-                     h_processor->keypressed = True;
-#if !defined(SWITCHES)
-                     h_processor->enabled = True; /* Any key press wil wake up the processor */
-                     h_processor->sleep = False;
-#endif
-                     break;
-                  }
+                  h_pressed->state = True;
+                  i_button_draw(x_display, x_pixmap, i_screen, h_pressed);
+                  v_copy_area(x_display, x_application_window, x_pixmap, x_gc, h_pressed->button_position);
+                  v_event_send(&o_emulator, EVENT_PRESS, h_pressed->index);
                }
 #if defined(SWITCHES)
                if (h_pressed == NULL) { /* It wasn't a button that was pressed check the switches */
-                  if (!(h_switch_pressed(h_switch[0], x_event.xbutton.x, x_event.xbutton.y) == NULL))
+                  if (i_area == BUTTONS)
                   {
                      h_switch[0]->state = !(h_switch[0]->state); /* Toggle switch */
-                     i_switch_draw(x_display, x_application_window, i_screen, h_switch[0]);
-                     if (h_switch[0]->state)
-                     {
-                        v_processor_reset(h_processor); /* Reset the processor */
-                        v_restore_state(h_processor); /* Restore saved settings */
-                     }
-                     else
-                     {
-                        v_save_state(h_processor); /* Save current settings */
-                        h_processor->enabled = False; /* Disable the processor */
-#if defined(HP67)
-                        i_ticks = DELAY * 4; /* Set count down */
-#elif defined(VOYAGER)
-                        i_ticks = DELAY * 3;
-#elif defined(SPICE)
-                        i_ticks = DELAY * 3;
-#else
-                        i_ticks = DELAY * 2;
-#endif
-                     }
+                     i_switch_draw(x_display, x_pixmap, i_screen, h_switch[0]);
+                     v_copy_area(x_display, x_application_window, x_pixmap, x_gc, h_switch[0]->switch_position);
+                     v_event_send(&o_emulator, EVENT_POWER, h_switch[0]->state); /* Reset or disable the processor */
+                     if (!h_switch[0]->state) l_timeout = l_clock() + DELAY * 1000000LL; /* Set count down */
                   }
                   if (SWITCHES == 2)
-                     if (h_switch_pressed(h_switch[1], x_event.xbutton.x, x_event.xbutton.y) != NULL)
+                     if (i_area == BUTTONS + 1)
                      {
-                        h_processor->mode = i_switch_click(h_switch[1]); /* Update prgm/run switch */
-                        i_switch_draw(x_display, x_application_window, i_screen, h_switch[1]);
+                        v_event_send(&o_emulator, EVENT_MODE, i_switch_click(h_switch[1])); /* Update prgm/run switch */
+                        i_switch_draw(x_display, x_pixmap, i_screen, h_switch[1]);
+                        v_copy_area(x_display, x_application_window, x_pixmap, x_gc, h_switch[1]->switch_position);
                      }
                }
 #endif
@@ -965,31 +1631,20 @@ int main(int argc, char *argv[])
                if (!(h_pressed == NULL))
                {
                   h_pressed->state = False;
-                  i_button_draw(x_display, x_application_window, i_screen, h_pressed);
-                  h_processor->keypressed = False; /* Don't clear the status bit here!! */
+                  i_button_draw(x_display, x_pixmap, i_screen, h_pressed);
+                  v_copy_area(x_display, x_application_window, x_pixmap, x_gc, h_pressed->button_position);
+                  v_event_send(&o_emulator, EVENT_RELEASE, h_pressed->index);
                }
 #if defined(SWITCHES)
                if (h_pressed == NULL) /* It wasn't a button that was released so check the switches */
-                  if (!(h_switch_pressed(h_switch[0], x_event.xbutton.x, x_event.xbutton.y) == NULL))
-                     i_ticks = -1;
+                  if (i_grid_find(h_grid, x_event.xbutton.x, x_event.xbutton.y) == BUTTONS)
+                     l_timeout = 0;
 #endif
             }
             break;
-         case Expose : /* Draw or redraw the window */
-            {
-               int i_count;
-               i_display_draw(x_display, x_application_window, i_screen, h_display);/* Draw display */
-#if defined(LABELS)
-               for (i_count = 0; i_count < LABELS; i_count++) /* Draw labels */
-                  i_label_draw(x_display, x_application_window, i_screen, h_label[i_count]);
-#endif
-#if defined(SWITCHES)
-               for (i_count = 0; i_count < SWITCHES; i_count++) /* Draw switches */
-                  i_switch_draw(x_display, x_application_window, i_screen, h_switch[i_count]);
-#endif
-               for (i_count = 0; i_count < BUTTONS; i_count++) /* Draw buttons */
-                  i_button_draw(x_display, x_application_window, i_screen, h_button[i_count]);
-            }
+         case Expose : /* Copy the exposed area from the pixmap */
+            XCopyArea(x_display, x_pixmap, x_application_window, x_gc, x_event.xexpose.x, x_event.xexpose.y,
+               x_event.xexpose.width, x_event.xexpose.height, x_event.xexpose.x, x_event.xexpose.y);
             break;
          case ClientMessage : /* Message from window manager */
             if (x_event.xclient.data.l[0] == wm_delete) b_abort = True;
@@ -998,8 +1653,19 @@ int main(int argc, char *argv[])
       }
    }
 
+   v_event_send(&o_emulator, EVENT_QUIT, 0); /* Stop the emulator */
+   pthread_join(x_thread, NULL);
+   v_emulator_collect(&o_emulator);
+
    v_save_state(h_processor); /* Save state */
+#if defined(CONTINIOUS)
+   if (s_export != NULL) v_write_state(h_processor, s_export); /* Export the state as text */
+#endif
+   if (s_profile != NULL) v_write_profile(h_processor, s_profile);
+   if (h_processor->record) v_history_write(h_processor);
 
+   XFreeGC(x_display, x_gc);
+   XFreePixmap(x_display, x_pixmap);
    XDestroyWindow(x_display, x_application_window); /* Close connection to server */
    XCloseDisplay(x_display);
 